@@ -20,6 +20,19 @@ int parse_args(int argc, char *argv[], struct cli_options *options) {
     options->color = 0;  // Default to no color
     options->playbook_path = NULL;
     options->inventory_path = "inventory.ini"; // Default inventory path
+    options->inventory_paths[0] = options->inventory_path;
+    options->inventory_count = 1;
+    options->limit = NULL;
+    options->forks = DEFAULT_FORKS;
+    options->playbook_paths = NULL;
+    options->playbook_count = 0;
+    options->syntax_check = 0;
+    options->list_tasks = 0;
+    options->list_hosts = 0;
+    options->flush_cache = 0;
+    options->extra_var_count = 0;
+    
+    int inventory_given = 0;
     
     // No arguments provided
     if (argc < 2) {
@@ -37,38 +50,89 @@ int parse_args(int argc, char *argv[], struct cli_options *options) {
                 options->verbose = 1;
             } else if (strcmp(argv[i], "--color") == 0 || strcmp(argv[i], "-c") == 0) {
                 options->color = 1;
+            } else if (strcmp(argv[i], "--syntax-check") == 0) {
+                options->syntax_check = 1;
+            } else if (strcmp(argv[i], "--list-tasks") == 0) {
+                options->list_tasks = 1;
+            } else if (strcmp(argv[i], "--list-hosts") == 0) {
+                options->list_hosts = 1;
+            } else if (strcmp(argv[i], "--flush-cache") == 0) {
+                options->flush_cache = 1;
             } else if (strcmp(argv[i], "-i") == 0) {
                 // Check if there's a value after -i
                 if (i + 1 >= argc) {
                     fprintf(stderr, "Error: -i requires an inventory file path\n");
                     return ANCIBLE_ERROR;
                 }
+                // The default is replaced by the first -i, later ones add sources
+                if (inventory_given == MAX_INVENTORY_SOURCES) {
+                    fprintf(stderr, "Error: Too many inventory sources (at most %d)\n", MAX_INVENTORY_SOURCES);
+                    return ANCIBLE_ERROR;
+                }
                 options->inventory_path = argv[++i];
+                options->inventory_paths[inventory_given++] = options->inventory_path;
+                options->inventory_count = inventory_given;
+            } else if (strcmp(argv[i], "--extra-vars") == 0 || strcmp(argv[i], "-e") == 0) {
+                // Sources are parsed once the arguments are all known; later ones win
+                if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                    fprintf(stderr, "Error: %s requires NAME=VALUE, a JSON map or @FILE\n", argv[i]);
+                    return ANCIBLE_ERROR;
+                }
+                if (options->extra_var_count == MAX_EXTRA_VARS) {
+                    fprintf(stderr, "Error: Too many extra variable sources (at most %d)\n", MAX_EXTRA_VARS);
+                    return ANCIBLE_ERROR;
+                }
+                options->extra_vars[options->extra_var_count++] = argv[++i];
+            } else if (strcmp(argv[i], "--limit") == 0 || strcmp(argv[i], "-l") == 0) {
+                if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                    fprintf(stderr, "Error: %s requires a host pattern\n", argv[i]);
+                    return ANCIBLE_ERROR;
+                }
+                options->limit = argv[++i];
+            } else if (strcmp(argv[i], "--forks") == 0 || strcmp(argv[i], "-f") == 0) {
+                // Check if there's a positive number after -f
+                char *end = NULL;
+                long forks = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : 0;
+                if (!end || *end != '\0' || forks < 1 || forks > 1024) {
+                    fprintf(stderr, "Error: %s requires a number of forks between 1 and 1024\n", argv[i]);
+                    return ANCIBLE_ERROR;
+                }
+                options->forks = (int)forks;
+                i++;
             } else {
                 fprintf(stderr, "Unknown option: %s\n", argv[i]);
                 return ANCIBLE_ERROR;
             }
         } else {
-            // Not an option, must be the playbook path
-            if (options->playbook_path != NULL) {
-                fprintf(stderr, "Error: Multiple playbook paths specified\n");
-                return ANCIBLE_ERROR;
-            }
-            options->playbook_path = argv[i];
+            // Not an option, must be a playbook path; paths are gathered at the
+            // front of argv (slots already processed), like getopt does
+            argv[1 + options->playbook_count++] = argv[i];
         }
     }
     
     // Validate that we have a playbook path
-    if (options->playbook_path == NULL) {
+    if (options->playbook_count == 0) {
         fprintf(stderr, "Error: No playbook path specified\n");
         return ANCIBLE_ERROR;
     }
     
-    // Check if the playbook file exists
-    if (access(options->playbook_path, F_OK) == -1) {
-        fprintf(stderr, "Error: Playbook file not found: %s\n", options->playbook_path);
+    options->playbook_paths = &argv[1];
+    options->playbook_path = argv[1];
+    
+    // Only planning modes (which never run anything) take several playbooks
+    int planning = options->syntax_check || options->list_tasks || options->list_hosts;
+    if (options->playbook_count > 1 && !planning) {
+        fprintf(stderr, "Error: Multiple playbook paths specified\n");
         return ANCIBLE_ERROR;
     }
     
+    // Check if the playbook files exist
+    for (int i = 0; i < options->playbook_count; i++) {
+        if (access(options->playbook_paths[i], F_OK) == -1) {
+            fprintf(stderr, "Error: Playbook file not found: %s\n", options->playbook_paths[i]);
+            return ANCIBLE_ERROR;
+        }
+    }
+    
     return ANCIBLE_SUCCESS;
 }
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/cli/extra_vars.h"
+#include "../include/core/value.h"
+#include "../include/core/yaml.h"
+#include "../include/modules/module.h"
+
+/**
+ * Append a variable to the list of extra variables
+ *
+ * @param arena Arena
+ * @param tail Pointer to the end of the list, advanced
+ * @param name Variable name
+ * @param value Typed value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int extra_var_add(arena_t *arena, variable_t ***tail, const char *name, const value_t *value) {
+    variable_t *var = value ? arena_alloc(arena, sizeof(variable_t)) : NULL;
+    if (!var || !(var->name = arena_strndup(arena, name, strlen(name)))) {
+        fprintf(stderr, "Error: Failed to allocate memory for extra variable '%s'\n", name);
+        return ANCIBLE_ERROR;
+    }
+
+    var->value = (char *)value->text;
+    var->typed = value;
+    **tail = var;
+    *tail = &var->next;
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Add the entries of a map node as extra variables
+ *
+ * @param arena Arena
+ * @param tail Pointer to the end of the list, advanced
+ * @param root Parsed document (NULL when it failed to parse, which was reported)
+ * @param source Where the document came from, for messages
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int extra_vars_add_map(arena_t *arena, variable_t ***tail, const yaml_node_t *root, const char *source) {
+    if (!root) {
+        return ANCIBLE_ERROR;
+    }
+    if (root->type != YAML_MAP) {
+        fprintf(stderr, "Error: Extra variables in %s must be a map\n", source);
+        return ANCIBLE_ERROR;
+    }
+
+    for (const yaml_node_t *child = root->children; child; child = child->next) {
+        if (extra_var_add(arena, tail, child->key, value_from_yaml(arena, child)) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Build the scope of the extra variables given with -e
+ *
+ * @param sources Sources, in the order given
+ * @param count Number of sources
+ * @param arena Arena the variables and their values are built in
+ * @param scope Pointer to receive the scope (NULL when there are no sources)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int extra_vars_load(const char *const *sources, int count, arena_t *arena, scope_t **scope) {
+    variable_t *list = NULL;
+    variable_t **tail = &list;
+    int ret = ANCIBLE_SUCCESS;
+
+    *scope = NULL;
+    for (int i = 0; ret == ANCIBLE_SUCCESS && i < count; i++) {
+        const char *source = sources[i];
+
+        if (source[0] == '@' || source[0] == '{') {
+            yaml_node_t *root = source[0] == '@' ? yaml_parse_file(source + 1) :
+                                yaml_parse_string(source, "extra variables");
+            ret = extra_vars_add_map(arena, &tail, root, source[0] == '@' ? source + 1 : "-e");
+            yaml_free(root);
+            continue;
+        }
+
+        module_args_t parsed;
+        if (module_args_parse(source, &parsed) != ANCIBLE_SUCCESS || parsed.count == 0) {
+            fprintf(stderr, "Error: Invalid extra variables: %s\n", source);
+            module_args_free(&parsed);
+            return ANCIBLE_ERROR;
+        }
+        for (int j = 0; ret == ANCIBLE_SUCCESS && j < parsed.count; j++) {
+            ret = extra_var_add(arena, &tail, parsed.keys[j], value_parse(arena, parsed.values[j]));
+        }
+        module_args_free(&parsed);
+    }
+
+    if (ret != ANCIBLE_SUCCESS || !list) {
+        return ret;
+    }
+
+    *scope = scope_extend(NULL, list);
+    if (!*scope) {
+        fprintf(stderr, "Error: Failed to allocate memory for extra variables\n");
+        return ANCIBLE_ERROR;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/cli/args.h"
+#include "../include/core/inventory.h"
+#include "../include/core/inventory_source.h"
+#include "../include/core/snapshot.h"
+#include "../include/core/symbol.h"
+
+/**
+ * Print usage information for ancible-inventory
+ */
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] (--list | --compile OUTPUT)\n\n", program_name);
+    printf("Options:\n");
+    printf("  --help            Display this help message and exit\n");
+    printf("  -i INVENTORY      Specify inventory file, directory, JSON/YAML file, script or snapshot;\n");
+    printf("                    repeatable, later sources win (default: ./inventory.ini)\n");
+    printf("  --flush-cache     Ignore cached dynamic inventories and refresh them\n");
+    printf("  --list            Print the inventory as JSON, in the dynamic inventory script format\n");
+    printf("  --compile OUTPUT  Write the inventory as a binary snapshot, loadable with -i OUTPUT\n");
+    printf("\n");
+    printf("Ancible: High-performance, C-based implementation of Ansible\n");
+}
+
+/**
+ * Print a string as a JSON string literal
+ *
+ * @param str String to print
+ */
+static void print_json_string(const char *str) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            printf("\\%c", *c);
+        } else if (*c == '\n') {
+            printf("\\n");
+        } else if (*c == '\t') {
+            printf("\\t");
+        } else if (*c < 0x20) {
+            printf("\\u%04x", *c);
+        } else {
+            putchar(*c);
+        }
+    }
+    putchar('"');
+}
+
+/**
+ * Print the inventory as JSON, in the dynamic inventory script format
+ *
+ * @param inventory Pointer to the inventory
+ */
+static void print_json(const inventory_t *inventory) {
+    char name[1024];
+
+    printf("{\n");
+    for (int i = 0; i < inventory->group_count; i++) {
+        const group_t *group = inventory->groups[i];
+
+        printf("  ");
+        print_json_string(group->name);
+        printf(": {\"hosts\": [");
+        for (int j = 0; j < group->host_count; j++) {
+            printf(j ? ", " : "");
+            print_json_string(inventory_host_name(inventory, group->host_ids[j], name, sizeof(name)));
+        }
+        printf("], \"children\": [");
+        for (int j = 0; j < group->child_count; j++) {
+            printf(j ? ", " : "");
+            print_json_string(inventory->groups[group->child_ids[j]]->name);
+        }
+        printf("], \"vars\": {");
+        for (const variable_t *var = group->vars; var; var = var->next) {
+            print_json_string(var->name);
+            printf(": ");
+            print_json_string(var->value);
+            printf(var->next ? ", " : "");
+        }
+        printf("}},\n");
+    }
+
+    printf("  \"_meta\": {\"hostvars\": {");
+    int first = 1;
+    for (int id = 0; id < inventory->host_count; id++) {
+        int count = inventory_host_var_count(inventory, id);
+        if (count == 0) {
+            continue;
+        }
+
+        printf(first ? "\n    " : ",\n    ");
+        first = 0;
+        print_json_string(inventory_host_name(inventory, id, name, sizeof(name)));
+        printf(": {");
+        for (int i = 0; i < count; i++) {
+            const char *var_name;
+            const char *value;
+            inventory_host_var(inventory, id, i, &var_name, &value);
+            printf(i ? ", " : "");
+            print_json_string(var_name);
+            printf(": ");
+            print_json_string(value);
+        }
+        printf("}");
+    }
+    printf(first ? "}}\n}\n" : "\n  }}\n}\n");
+}
+
+/**
+ * Main entry point for ancible-inventory
+ */
+int main(int argc, char *argv[]) {
+    const char *sources[MAX_INVENTORY_SOURCES] = { "./inventory.ini" };
+    int source_count = 0;
+    const char *output = NULL;
+    int list = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc && source_count < MAX_INVENTORY_SOURCES) {
+            sources[source_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = 1;
+        } else if (strcmp(argv[i], "--flush-cache") == 0) {
+            inventory_cache_flush();
+        } else {
+            fprintf(stderr, "Error: Unknown or incomplete option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!list && !output) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    inventory_t inventory;
+    if (inventory_load_sources(sources, source_count ? source_count : 1, &inventory) != ANCIBLE_SUCCESS) {
+        symbol_cleanup();
+        return 1;
+    }
+
+    int result = 0;
+    if (output && snapshot_save(&inventory, output) != ANCIBLE_SUCCESS) {
+        result = 1;
+    }
+    if (list) {
+        print_json(&inventory);
+    }
+
+    inventory_free(&inventory);
+    symbol_cleanup();
+    return result;
+}
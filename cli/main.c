@@ -2,27 +2,44 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
-#include <ctype.h>
 #include "../include/ancible.h"
 #include "../include/cli/args.h"
+#include "../include/cli/plan.h"
+#include "../include/cli/extra_vars.h"
 #include "../include/core/parser.h"
 #include "../include/core/inventory.h"
+#include "../include/core/inventory_source.h"
+#include "../include/core/pattern.h"
+#include "../include/core/symbol.h"
 #include "../include/core/context.h"
 #include "../include/core/executor.h"
 #include "../include/core/state.h"
 #include "../include/transport/runner.h"
+#include "../include/transport/connection.h"
 #include "../include/modules/module.h"
 
+// Buffer task names are rendered into for display
+static template_buffer_t task_names;
+
 /**
  * Print usage information for ancible-playbook
  */
 void print_usage(const char *program_name) {
-    printf("Usage: %s [options] playbook.yml\n\n", program_name);
+    printf("Usage: %s [options] playbook.yml\n", program_name);
+    printf("       %s --syntax-check|--list-tasks|--list-hosts [options] playbook.yml [playbook.yml ...]\n\n",
+           program_name);
     printf("Options:\n");
     printf("  --help        Display this help message and exit\n");
     printf("  -v, --verbose Increase verbosity\n");
     printf("  -c, --color   Enable colored output\n");
-    printf("  -i INVENTORY  Specify inventory file (default: ./inventory.ini)\n");
+    printf("  -i INVENTORY  Specify inventory file, directory, JSON/YAML file or script; repeatable (default: ./inventory.ini)\n");
+    printf("  --flush-cache Ignore cached dynamic inventories and refresh them\n");
+    printf("  -f, --forks N Run at most N commands at once (default: %d)\n", DEFAULT_FORKS);
+    printf("  -l, --limit PATTERN  Further restrict the hosts of every play\n");
+    printf("  -e, --extra-vars VARS  Set variables: NAME=VALUE ..., a JSON map or @FILE; repeatable\n");
+    printf("  --syntax-check  Only check the syntax of the playbooks\n");
+    printf("  --list-tasks    List the tasks of the playbooks without running them\n");
+    printf("  --list-hosts    List the hosts targeted by each play without running it\n");
     printf("\n");
     printf("Ancible: High-performance, C-based implementation of Ansible\n");
 }
@@ -74,6 +91,287 @@ void cout(int verbose, const char *fmt, ...) {
     }
 }
 
+/**
+ * Create contexts for every host targeted by a play
+ * 
+ * @param inventory Loaded inventory
+ * @param play Play whose host pattern is resolved
+ * @param options Command-line options
+ * @param extra_vars Extra variables given with -e, or NULL
+ * @param out Pointer to receive the array of contexts (NULL if no host matched)
+ * @param count Pointer to receive the number of contexts
+ * @return ANCIBLE_SUCCESS on success (even if no host matched), ANCIBLE_ERROR on an invalid pattern or error
+ */
+static int play_contexts_create(inventory_t *inventory, play_t *play, struct cli_options options,
+                                const scope_t *extra_vars, context_t ***out, int *count) {
+    *out = NULL;
+    *count = 0;
+    
+    bitset_t hosts;
+    bitset_init(&hosts);
+    if (pattern_resolve_limited(inventory, play->hosts, options.limit, &hosts) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Invalid host pattern in play '%s'\n", play->name ? play->name : play->hosts);
+        bitset_free(&hosts);
+        return ANCIBLE_ERROR;
+    }
+    
+    int host_count = bitset_count(&hosts);
+    if (host_count == 0) {
+        fprintf(stderr, "Warning: No hosts matched '%s', skipping play\n", play->hosts);
+        bitset_free(&hosts);
+        return ANCIBLE_SUCCESS;
+    }
+    
+    context_t **contexts = calloc((size_t)host_count, sizeof(context_t *));
+    if (!contexts) {
+        fprintf(stderr, "Error: Failed to allocate memory for contexts\n");
+        bitset_free(&hosts);
+        return ANCIBLE_ERROR;
+    }
+    
+    for (int id = bitset_next(&hosts, 0); id >= 0; id = bitset_next(&hosts, id + 1)) {
+        host_t *host = inventory_host(inventory, id);
+        if (!host) {
+            continue;
+        }
+        
+        // Create context for this host
+        context_t *context = context_create(host, play, options.verbose);
+        if (!context) {
+            fprintf(stderr, "Error: Failed to create context for host %s\n", host->name);
+            continue;
+        }
+        context->inventory = inventory;
+        context->extra_vars = extra_vars;
+        
+        contexts[(*count)++] = context;
+    }
+    
+    bitset_free(&hosts);
+    *out = contexts;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Check whether a play may change the inventory (add_host, group_by)
+ *
+ * Included files are only known at run time, so plays with includes count too.
+ *
+ * @param play Play to check
+ * @return 1 if the hosts of later plays must be resolved after this one runs
+ */
+static int play_changes_inventory(const play_t *play) {
+    for (int i = 0; i < play->task_count; i++) {
+        const task_t *task = &play->tasks[i];
+        if (task->type == TASK_TYPE_INCLUDE ||
+            (task->module && (strcmp(task->module, "add_host") == 0 || strcmp(task->module, "group_by") == 0))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Start connecting to the SSH hosts of a play in the background
+ * 
+ * @param contexts Contexts of the play
+ * @param count Number of contexts
+ */
+static void play_contexts_prefetch(context_t **contexts, int count) {
+    for (int i = 0; i < count; i++) {
+        const char *connection = context_get_var_id(contexts[i], SYMBOL_ANSIBLE_CONNECTION);
+        const char *user = context_get_var_id(contexts[i], SYMBOL_ANSIBLE_USER);
+        if (connection && strcmp(connection, "ssh") == 0) {
+            connection_prefetch(user ? user : CONNECTION_DEFAULT_USER,
+                                context_get_var_id(contexts[i], SYMBOL_ANSIBLE_HOST),
+                                context_get_var_id(contexts[i], SYMBOL_ANSIBLE_PORT));
+        }
+    }
+}
+
+/**
+ * Free the contexts of a play
+ * 
+ * @param contexts Contexts of the play
+ * @param count Number of contexts
+ */
+static void play_contexts_free(context_t **contexts, int count) {
+    for (int i = 0; i < count; i++) {
+        context_free(contexts[i]);
+    }
+    free(contexts);
+}
+
+/**
+ * Render the name of a task for a host
+ * 
+ * Names are only displayed, so one that cannot be rendered is shown as written.
+ * 
+ * @param task Task
+ * @param context Context of the host
+ * @return Name to display (valid until the next call)
+ */
+static const char *task_display_name(const task_t *task, const context_t *context) {
+    if (!task->name) {
+        return "unnamed";
+    }
+    
+    const char *name = task->name_template ? template_render(task->name_template, context, &task_names) : NULL;
+    return name ? name : task->name;
+}
+
+/**
+ * Print one line per loop item, with its output in verbose mode
+ * 
+ * @param options Command-line options
+ * @param result Result of the loop task
+ * @param task_name Name of the task
+ */
+static void print_items(struct cli_options options, const module_result_t *result, const char *task_name) {
+    for (int i = 0; i < result->item_count; i++) {
+        const module_result_t *item = &result->items[i];
+        
+        acout(options, *item, "%s (item=%s)\n", task_name, item->item ? item->item : "");
+        
+        if (item->cmd_result.stdout_data && strlen(item->cmd_result.stdout_data) > 0) {
+            cout(options.verbose, "  Stdout: %s", item->cmd_result.stdout_data);
+        }
+        
+        if (item->cmd_result.stderr_data && strlen(item->cmd_result.stderr_data) > 0) {
+            cout(options.verbose, "  Stderr: %s", item->cmd_result.stderr_data);
+        }
+    }
+}
+
+/**
+ * Run a top-level task (or block) on one host
+ * 
+ * @param options Command-line options
+ * @param context Context of the host
+ * @param task_idx Index of the task in the play
+ * @param skip Whether the task's condition was found not to hold on the host
+ */
+static void run_host_task(struct cli_options options, context_t *context, int task_idx, int skip) {
+    task_t *task = &context->play->tasks[task_idx];
+    
+    module_result_t result;
+    module_result_init(&result);
+    
+    // The name is rendered once the task has run, as values it points at may change while it runs
+    int ret = skip ? executor_skip_task(context, task_idx, &result) :
+              executor_run_task(context, task_idx, NULL, &result);
+    const char *task_name = task_display_name(task, context);
+    
+    // Handle blocks
+    if (task->type == TASK_TYPE_BLOCK) {
+        if (ret == ANCIBLE_SUCCESS) {
+            acout(options, result, "%s\n", task_name);
+            if (result.msg) {
+                cout(options.verbose, "  Message: %s\n", result.msg);
+            }
+        } else {
+            acout(options, result, "[ERROR] %s\n", task_name);
+        }
+        module_result_free(&result);
+        return;
+    }
+    
+    if (ret == ANCIBLE_SUCCESS) {
+        if (result.item_count > 0) {
+            print_items(options, &result, task_name);
+        } else {
+            acout(options, result, "%s\n", task_name);
+        }
+        
+        if (result.msg) {
+            cout(options.verbose, "  Message: %s\n", result.msg);
+        }
+        
+        // Registered output has lost its trailing newline
+        const char *out = result.cmd_result.stdout_data;
+        if (out && strlen(out) > 0) {
+            cout(options.verbose, "  Stdout: %s%s", out, out[strlen(out) - 1] == '\n' ? "" : "\n");
+        }
+        
+        const char *err = result.cmd_result.stderr_data;
+        if (err && strlen(err) > 0) {
+            cout(options.verbose, "  Stderr: %s%s", err, err[strlen(err) - 1] == '\n' ? "" : "\n");
+        }
+        
+        // Save task result to state
+        state_save_result(context->host->name, task_name, &result);
+    } else {
+        result.failed = 1;
+        if (result.item_count > 0) {
+            print_items(options, &result, task_name);
+        } else {
+            acout(options, result, "%s\n", task_name);
+        }
+    }
+    
+    module_result_free(&result);
+}
+
+/**
+ * Run a play: every top-level task on every host before moving on
+ * 
+ * @param options Command-line options
+ * @param play Play to run
+ * @param contexts Contexts of the hosts targeted by the play
+ * @param count Number of contexts
+ */
+static void run_play(struct cli_options options, play_t *play, context_t **contexts, int count) {
+    cout(options.verbose, "\nPLAY [%s] *************\n", play->name ? play->name : play->hosts);
+    
+    cout(options.verbose, "\nTargeted hosts:\n");
+    for (int h = 0; h < count; h++) {
+        cout(options.verbose, "  %s", contexts[h]->host->name);
+        if (contexts[h]->host->ansible_host) {
+            cout(options.verbose, " (ansible_host=%s)", contexts[h]->host->ansible_host);
+        }
+        cout(options.verbose, "\n");
+        
+        if (options.verbose) {
+            context_print(contexts[h]);
+        }
+    }
+    
+    for (int i = 0; i < play->task_count; i++) {
+        // Only handle top-level tasks (no parent)
+        if (play->tasks[i].parent_idx >= 0) {
+            continue;
+        }
+        
+        // Tasks whose condition holds on no host are not dispatched at all
+        if (play->tasks[i].when_static == TASK_WHEN_NEVER) {
+            cout(options.verbose, "\nSkipping '%s' on every host due to condition: %s\n",
+                 play->tasks[i].name ? play->tasks[i].name : "unnamed", play->tasks[i].when);
+            continue;
+        }
+        
+        // Headers show the name as the first host sees it
+        const char *task_name = count > 0 ? task_display_name(&play->tasks[i], contexts[0]) :
+                                play->tasks[i].name ? play->tasks[i].name : "unnamed";
+        if (play->tasks[i].type == TASK_TYPE_BLOCK) {
+            cout(options.verbose, "\nBLOCK [%s] *************\n", task_name);
+        } else if (play->tasks[i].type == TASK_TYPE_NORMAL && play->tasks[i].module) {
+            cout(options.verbose, "\nTASK [%s] *************\n", task_name);
+        } else if (play->tasks[i].type == TASK_TYPE_INCLUDE) {
+            cout(options.verbose, "\nINCLUDE [%s] *************\n", task_name);
+        }
+        
+        // A condition that depends on the host is evaluated for all of them in one pass,
+        // and the task only dispatched to the hosts it holds on
+        bitset_t skipped;
+        bitset_init(&skipped);
+        int batched = executor_batch_condition(contexts, count, i, &skipped) == ANCIBLE_SUCCESS;
+        for (int h = 0; h < count; h++) {
+            run_host_task(options, contexts[h], i, batched && bitset_test(&skipped, h));
+        }
+        bitset_free(&skipped);
+    }
+}
+
 /**
  * Main entry point for ancible-playbook
  */
@@ -96,6 +394,15 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    if (options.flush_cache) {
+        inventory_cache_flush();
+    }
+    
+    // Planning modes stop after parsing and host resolution
+    if (plan_requested(&options)) {
+        return plan_run(&options) == ANCIBLE_SUCCESS ? 0 : 1;
+    }
+    
     // Display basic info
     cout(options.verbose, "Ancible playbook runner (MVP)\n");
     if (options.verbose) {
@@ -111,11 +418,15 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Global fork limit, shared by every thread starting commands
+    runner_set_fork_limit(options.forks);
+    
     // Initialize executor
     result = executor_init();
     if (result != ANCIBLE_SUCCESS) {
         fprintf(stderr, "Error initializing executor\n");
         playbook_free(&playbook);
+        parser_cache_cleanup();
         return 1;
     }
     
@@ -125,6 +436,7 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Error initializing state\n");
         executor_cleanup();
         playbook_free(&playbook);
+        parser_cache_cleanup();
         return 1;
     }
     
@@ -134,12 +446,29 @@ int main(int argc, char *argv[]) {
         playbook_print(&playbook);
     }
     
+    // Extra variables beat every other variable, in every play
+    arena_t extra_arena = { 0 };
+    scope_t *extra_vars = NULL;
+    if (extra_vars_load(options.extra_vars, options.extra_var_count, &extra_arena, &extra_vars) != ANCIBLE_SUCCESS) {
+        arena_free(&extra_arena);
+        state_cleanup();
+        executor_cleanup();
+        playbook_free(&playbook);
+        parser_cache_cleanup();
+        return 1;
+    }
+    
     // Load inventory
     inventory_t inventory;
-    result = inventory_load(options.inventory_path, &inventory);
+    // The loader reports which source failed
+    result = inventory_load_sources(options.inventory_paths, options.inventory_count, &inventory);
     if (result != ANCIBLE_SUCCESS) {
-        fprintf(stderr, "Error loading inventory: %s\n", options.inventory_path);
+        scope_release(extra_vars);
+        arena_free(&extra_arena);
+        state_cleanup();
+        executor_cleanup();
         playbook_free(&playbook);
+        parser_cache_cleanup();
         return 1;
     }
     
@@ -149,183 +478,60 @@ int main(int argc, char *argv[]) {
         inventory_print(&inventory);
     }
     
-    // Get hosts for the playbook
-    host_t *hosts = inventory_get_hosts(&inventory, playbook.hosts);
-    if (!hosts) {
-        fprintf(stderr, "Error: No hosts found for group '%s'\n", playbook.hosts);
-        inventory_free(&inventory);
-        playbook_free(&playbook);
-        return 1;
+    // SSH connections are shared by all plays; without the cache every task connects on its own
+    if (connection_cache_init() != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Warning: SSH connection cache disabled\n");
     }
     
-    cout(options.verbose, "\nTargeted hosts:\n");
-    host_t *host = hosts;
-    while (host) {
-        cout(options.verbose, "  %s", host->name);
-        if (host->ansible_host) {
-            cout(options.verbose, " (ansible_host=%s)", host->ansible_host);
-        }
-        cout(options.verbose, "\n");
-        
-        // Create context for this host
-        context_t *context = context_create(host, &playbook, options.verbose);
-        if (!context) {
-            fprintf(stderr, "Error: Failed to create context for host %s\n", host->name);
-            continue;
+    // Plays run in order, but the hosts of the next play are resolved and
+    // connected in the background while the current play is still running,
+    // unless the current play changes the inventory
+    // A play whose hosts cannot be resolved stops the run there, and the run fails
+    int count = 0;
+    context_t **contexts = NULL;
+    int created = play_contexts_create(&inventory, &playbook.plays[0], options, extra_vars, &contexts, &count);
+    play_contexts_prefetch(contexts, count);
+    
+    for (int p = 0; p < playbook.play_count && created == ANCIBLE_SUCCESS; p++) {
+        int next_count = 0;
+        context_t **next_contexts = NULL;
+        int next_created = ANCIBLE_SUCCESS;
+        int changes_inventory = play_changes_inventory(&playbook.plays[p]);
+        if (p + 1 < playbook.play_count && !changes_inventory) {
+            next_created = play_contexts_create(&inventory, &playbook.plays[p + 1], options, extra_vars,
+                                                &next_contexts, &next_count);
+            play_contexts_prefetch(next_contexts, next_count);
         }
         
-        // Set some default variables
-        context_set_var(context, "ansible_user", "root");
-        context_set_var(context, "ansible_connection", "local");
-        
-        // Print context
-        cout(options.verbose, "\nContext for host %s:\n", host->name);
-        if (options.verbose) {
-            context_print(context);
+        if (count > 0) {
+            executor_fold_play(&playbook.plays[p], extra_vars);
+            run_play(options, &playbook.plays[p], contexts, count);
         }
+        play_contexts_free(contexts, count);
         
-        // Run tasks for this host
-        if (playbook.task_count > 0) {
-            cout(options.verbose, "\nRunning tasks for host %s:\n", host->name);
-            
-            for (int i = 0; i < playbook.task_count; i++) {
-                // Only handle top-level tasks (no parent)
-                if (playbook.tasks[i].parent_idx >= 0) {
-                    continue;
-                }
-                
-                // Handle blocks
-                if (playbook.tasks[i].type == TASK_TYPE_BLOCK) {
-                    cout(options.verbose, "\nBLOCK [%s] *************\n", 
-                         playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                    
-                    module_result_t result;
-                    module_result_init(&result);
-                    
-                    if (executor_run_task(context, i, NULL, &result) == ANCIBLE_SUCCESS) {
-                        acout(options, result, "%s\n", 
-                              playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                        if (result.msg) {
-                            cout(options.verbose, "  Message: %s\n", result.msg);
-                        }
-                    } else {
-                        acout(options, result, "[ERROR] %s\n", 
-                              playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                    }
-                    module_result_free(&result);
-                    continue;
-                }
-                
-                // Handle normal tasks with a module
-                if (playbook.tasks[i].type == TASK_TYPE_NORMAL && playbook.tasks[i].module) {
-                
-                    // Only print task name for normal tasks
-                    if (playbook.tasks[i].name) {
-                        cout(options.verbose, "\nTASK [%s] *************\n", playbook.tasks[i].name);
-                    } else {
-                        cout(options.verbose, "\nTASK [unnamed] *************\n");
-                    }
-                }
-                
-                // Extract command directly from the playbook file
-                FILE *file = fopen(options.playbook_path, "r");
-                char line[1024];
-                char args[1024] = {0};
-                
-                if (file) {
-                    // Find the task by name
-                    int found_task = 0;
-                    while (fgets(line, sizeof(line), file)) {
-                        // Remove trailing newline
-                        size_t len = strlen(line);
-                        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) {
-                            line[--len] = '\0';
-                        }
-                        
-                        // Look for the task name
-                        if (!found_task && strstr(line, "name:") && playbook.tasks[i].name && 
-                            strstr(line, playbook.tasks[i].name)) {
-                            found_task = 1;
-                            continue;
-                        }
-                        
-                        // If we found the task, look for the module
-                        if (found_task && playbook.tasks[i].module && strstr(line, playbook.tasks[i].module)) {
-                            char *cmd_start = strchr(line, ':');
-                            if (cmd_start) {
-                                cmd_start++; // Move past the colon
-                                
-                                // Skip leading whitespace
-                                while (*cmd_start && isspace(*cmd_start)) {
-                                    cmd_start++;
-                                }
-                                
-                                // Copy the command
-                                strncpy(args, cmd_start, sizeof(args) - 1);
-                                args[sizeof(args) - 1] = '\0';
-                                break;
-                            }
-                        }
-                    }
-                    
-                    fclose(file);
-                }
-                
-                // If we couldn't find the command, use a fallback
-                if (args[0] == '\0') {
-                    if (playbook.tasks[i].module && strcmp(playbook.tasks[i].module, "command") == 0) {
-                        snprintf(args, sizeof(args), "echo 'Command not found for task %s'", 
-                                 playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                    } else {
-                        snprintf(args, sizeof(args), "echo 'Unknown module %s'", 
-                                 playbook.tasks[i].module ? playbook.tasks[i].module : "unknown");
-                    }
-                }
-                
-                // Execute task
-                module_result_t result;
-                module_result_init(&result);
-                
-                if (executor_run_task(context, i, args, &result) == ANCIBLE_SUCCESS) {
-                    acout(options, result, "%s\n", 
-                          playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                    
-                    if (result.msg) {
-                        cout(options.verbose, "  Message: %s\n", result.msg);
-                    }
-                    
-                    if (result.cmd_result.stdout_data && strlen(result.cmd_result.stdout_data) > 0) {
-                        cout(options.verbose, "  Stdout: %s", result.cmd_result.stdout_data);
-                    }
-                    
-                    if (result.cmd_result.stderr_data && strlen(result.cmd_result.stderr_data) > 0) {
-                        cout(options.verbose, "  Stderr: %s", result.cmd_result.stderr_data);
-                    }
-                    
-                    // Save task result to state
-                    state_save_result(host->name, playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed", &result);
-                    
-                    module_result_free(&result);
-                } else {
-                    result.failed = 1;
-                    acout(options, result, "%s\n", playbook.tasks[i].name ? playbook.tasks[i].name : "unnamed");
-                    module_result_free(&result);
-                }
-                // Otherwise skip (e.g. block wrappers without modules, rescue, always, subtasks)
-            }
+        if (p + 1 < playbook.play_count && changes_inventory) {
+            next_created = play_contexts_create(&inventory, &playbook.plays[p + 1], options, extra_vars,
+                                                &next_contexts, &next_count);
+            play_contexts_prefetch(next_contexts, next_count);
         }
         
-        // Free context
-        context_free(context);
-        
-        host = host->next;
+        contexts = next_contexts;
+        count = next_count;
+        created = next_created;
     }
+    play_contexts_free(contexts, count);
     
     // Clean up
+    connection_cache_cleanup();
     state_cleanup();
     executor_cleanup();
     inventory_free(&inventory);
+    scope_release(extra_vars);
+    arena_free(&extra_arena);
     playbook_free(&playbook);
+    parser_cache_cleanup();
+    template_buffer_free(&task_names);
+    symbol_cleanup();
     
-    return 0;
+    return created == ANCIBLE_SUCCESS ? 0 : 1;
 }
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/cli/plan.h"
+#include "../include/core/parser.h"
+#include "../include/core/inventory.h"
+#include "../include/core/inventory_source.h"
+#include "../include/core/pattern.h"
+
+/**
+ * Check if a planning mode (--syntax-check, --list-tasks, --list-hosts) was requested
+ *
+ * @param options Command-line options
+ * @return 1 if a planning mode was requested, 0 otherwise
+ */
+int plan_requested(const struct cli_options *options) {
+    return options->syntax_check || options->list_tasks || options->list_hosts;
+}
+
+/**
+ * Print a task and its subtasks, indented by depth
+ *
+ * @param play Play holding the task
+ * @param idx Task index
+ * @param depth Nesting depth
+ */
+static void print_task_tree(const play_t *play, int idx, int depth) {
+    const task_t *task = &play->tasks[idx];
+    int indent = 4 + depth * 2;
+
+    switch (task->type) {
+    case TASK_TYPE_RESCUE:
+        printf("%*srescue:\n", indent, "");
+        break;
+    case TASK_TYPE_ALWAYS:
+        printf("%*salways:\n", indent, "");
+        break;
+    case TASK_TYPE_BLOCK:
+        printf("%*s%s (block)\n", indent, "", task->name ? task->name : "unnamed");
+        break;
+    case TASK_TYPE_INCLUDE:
+        printf("%*s%s (include_tasks: %s)\n", indent, "", task->name ? task->name : "unnamed", task->args);
+        break;
+    default:
+        printf("%*s%s\n", indent, "", task->name ? task->name : (task->module ? task->module : "unnamed"));
+        break;
+    }
+
+    for (int i = 0; i < task->subtask_count; i++) {
+        print_task_tree(play, task->subtask_indices[i], depth + 1);
+    }
+
+    // Rescue and always sections hang off the block without being subtasks
+    if (task->type == TASK_TYPE_BLOCK) {
+        for (int i = idx + 1; i < play->task_count; i++) {
+            if (play->tasks[i].parent_idx == idx &&
+                (play->tasks[i].type == TASK_TYPE_RESCUE || play->tasks[i].type == TASK_TYPE_ALWAYS)) {
+                print_task_tree(play, i, depth + 1);
+            }
+        }
+    }
+}
+
+/**
+ * Print the hosts a play resolves to
+ *
+ * @param inventory Loaded inventory
+ * @param play Play whose pattern is resolved
+ * @param limit --limit pattern, or NULL
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on an invalid pattern
+ */
+static int print_play_hosts(inventory_t *inventory, const play_t *play, const char *limit) {
+    bitset_t hosts;
+    bitset_init(&hosts);
+
+    if (pattern_resolve_limited(inventory, play->hosts, limit, &hosts) != ANCIBLE_SUCCESS) {
+        bitset_free(&hosts);
+        return ANCIBLE_ERROR;
+    }
+
+    printf("    pattern: %s\n", play->hosts);
+    printf("    hosts (%d):\n", bitset_count(&hosts));
+    char name[1024];
+    for (int id = bitset_next(&hosts, 0); id >= 0; id = bitset_next(&hosts, id + 1)) {
+        printf("      %s\n", inventory_host_name(inventory, id, name, sizeof(name)));
+    }
+
+    bitset_free(&hosts);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Run the planning modes over every playbook given
+ *
+ * @param options Command-line options
+ * @return ANCIBLE_SUCCESS if every playbook is valid, ANCIBLE_ERROR otherwise
+ */
+int plan_run(const struct cli_options *options) {
+    int result = ANCIBLE_SUCCESS;
+    inventory_t inventory;
+
+    // The loader reports which source failed
+    if (options->list_hosts && inventory_load_sources(options->inventory_paths, options->inventory_count, &inventory) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (int i = 0; i < options->playbook_count; i++) {
+        const char *path = options->playbook_paths[i];
+        playbook_t playbook;
+
+        // Keep going so that one run reports every broken playbook
+        if (parse_playbook(path, &playbook) != ANCIBLE_SUCCESS) {
+            fprintf(stderr, "Error parsing playbook: %s\n", path);
+            result = ANCIBLE_ERROR;
+            continue;
+        }
+
+        printf("\nplaybook: %s\n", path);
+
+        for (int p = 0; (options->list_tasks || options->list_hosts) && p < playbook.play_count; p++) {
+            const play_t *play = &playbook.plays[p];
+
+            printf("\n  play #%d (%s): %s\n", p + 1, play->hosts, play->name ? play->name : "");
+
+            if (options->list_hosts && print_play_hosts(&inventory, play, options->limit) != ANCIBLE_SUCCESS) {
+                result = ANCIBLE_ERROR;
+            }
+
+            if (options->list_tasks) {
+                printf("    tasks:\n");
+                for (int t = 0; t < play->task_count; t++) {
+                    if (play->tasks[t].parent_idx < 0) {
+                        print_task_tree(play, t, 1);
+                    }
+                }
+            }
+        }
+
+        playbook_free(&playbook);
+    }
+
+    if (options->list_hosts) {
+        inventory_free(&inventory);
+    }
+    parser_cache_cleanup();
+
+    return result;
+}
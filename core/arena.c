@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../include/ancible.h"
+#include "../include/core/arena.h"
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN 16
+
+/**
+ * Block of arena memory
+ */
+struct arena_block {
+    struct arena_block *next; // Block filled before this one
+    size_t used;          // Bytes of data handed out (alignment padding included)
+    size_t size;          // Bytes of data
+    unsigned char data[]; // Memory handed out
+};
+
+/**
+ * Get the padding that aligns the next allocation of a block
+ *
+ * @param block Block
+ * @return Number of bytes to skip
+ */
+static size_t block_padding(const struct arena_block *block) {
+    uintptr_t next = (uintptr_t)(block->data + block->used);
+    return (size_t)((ARENA_ALIGN - next % ARENA_ALIGN) % ARENA_ALIGN);
+}
+
+/**
+ * Allocate memory from an arena
+ *
+ * @param arena Arena
+ * @param size Number of bytes (aligned for any type)
+ * @return Pointer to the memory (zeroed), or NULL on error
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+
+    struct arena_block *block = arena->blocks;
+    if (!block || block->used + block_padding(block) + size > block->size) {
+        // Large values get a block of their own, sized to fit
+        size_t data_size = size + ARENA_ALIGN > ARENA_BLOCK_SIZE ? size + ARENA_ALIGN : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(struct arena_block) + data_size);
+        if (!block) {
+            fprintf(stderr, "Error: Failed to allocate memory for arena\n");
+            return NULL;
+        }
+        block->used = 0;
+        block->size = data_size;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    block->used += block_padding(block);
+    void *memory = block->data + block->used;
+    block->used += size;
+    memset(memory, 0, size);
+
+    return memory;
+}
+
+/**
+ * Copy a string into an arena
+ *
+ * @param arena Arena
+ * @param text Text to copy
+ * @param length Number of bytes to copy (a terminator is added)
+ * @return Copy, or NULL on error
+ */
+char *arena_strndup(arena_t *arena, const char *text, size_t length) {
+    char *copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+    }
+
+    return copy;
+}
+
+/**
+ * Free every block of an arena and leave it empty
+ *
+ * @param arena Arena (may be NULL)
+ */
+void arena_free(arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+
+    while (arena->blocks) {
+        struct arena_block *next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+}
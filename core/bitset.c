@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/core/bitset.h"
+
+#define WORD_BITS 64
+
+/**
+ * Count trailing zero bits of a non-zero word
+ *
+ * @param word Non-zero word
+ * @return Index of the lowest set bit
+ */
+static int word_ctz(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int n = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * Count the set bits of a word
+ *
+ * @param word Word to count
+ * @return Number of set bits
+ */
+static int word_popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int n = 0;
+    while (word) {
+        word &= word - 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * Initialize an empty bitset
+ *
+ * @param set Bitset to initialize
+ */
+void bitset_init(bitset_t *set) {
+    set->words = NULL;
+    set->word_count = 0;
+}
+
+/**
+ * Free the memory held by a bitset and leave it empty
+ *
+ * @param set Bitset to free
+ */
+void bitset_free(bitset_t *set) {
+    free(set->words);
+    bitset_init(set);
+}
+
+/**
+ * Make room for bits [0, bit_count)
+ *
+ * @param set Bitset to grow
+ * @param bit_count Number of bits needed
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_reserve(bitset_t *set, int bit_count) {
+    int needed = (bit_count + WORD_BITS - 1) / WORD_BITS;
+    if (needed <= set->word_count) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    // Grow geometrically so sets built one bit at a time stay linear
+    int word_count = set->word_count ? set->word_count : 1;
+    while (word_count < needed) {
+        word_count *= 2;
+    }
+
+    uint64_t *words = realloc(set->words, (size_t)word_count * sizeof(uint64_t));
+    if (!words) {
+        fprintf(stderr, "Error: Failed to allocate memory for bitset\n");
+        return ANCIBLE_ERROR;
+    }
+
+    memset(words + set->word_count, 0, (size_t)(word_count - set->word_count) * sizeof(uint64_t));
+    set->words = words;
+    set->word_count = word_count;
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Add a bit to the set, growing it if needed
+ *
+ * @param set Bitset to update
+ * @param bit Bit to set
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_set(bitset_t *set, int bit) {
+    if (bit < 0 || bitset_reserve(set, bit + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    set->words[bit / WORD_BITS] |= (uint64_t)1 << (bit % WORD_BITS);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Remove a bit from the set
+ *
+ * @param set Bitset to update
+ * @param bit Bit to clear
+ */
+void bitset_unset(bitset_t *set, int bit) {
+    if (bit >= 0 && bit / WORD_BITS < set->word_count) {
+        set->words[bit / WORD_BITS] &= ~((uint64_t)1 << (bit % WORD_BITS));
+    }
+}
+
+/**
+ * Check whether a bit is in the set
+ *
+ * @param set Bitset to check
+ * @param bit Bit to test
+ * @return 1 if the bit is set, 0 otherwise
+ */
+int bitset_test(const bitset_t *set, int bit) {
+    if (bit < 0 || bit / WORD_BITS >= set->word_count) {
+        return 0;
+    }
+
+    return (int)((set->words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1);
+}
+
+/**
+ * Add every bit of src to dst (dst |= src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to add
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_or(bitset_t *dst, const bitset_t *src) {
+    if (bitset_reserve(dst, src->word_count * WORD_BITS) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (int i = 0; i < src->word_count; i++) {
+        dst->words[i] |= src->words[i];
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Keep only the bits also in src (dst &= src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to intersect with
+ */
+void bitset_and(bitset_t *dst, const bitset_t *src) {
+    int common = dst->word_count < src->word_count ? dst->word_count : src->word_count;
+
+    // Plain word loops: compilers vectorize these
+    for (int i = 0; i < common; i++) {
+        dst->words[i] &= src->words[i];
+    }
+    for (int i = common; i < dst->word_count; i++) {
+        dst->words[i] = 0;
+    }
+}
+
+/**
+ * Remove every bit of src from dst (dst &= ~src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to remove
+ */
+void bitset_andnot(bitset_t *dst, const bitset_t *src) {
+    int common = dst->word_count < src->word_count ? dst->word_count : src->word_count;
+
+    for (int i = 0; i < common; i++) {
+        dst->words[i] &= ~src->words[i];
+    }
+}
+
+/**
+ * Remove every bit from the set, keeping its memory
+ *
+ * @param set Bitset to clear
+ */
+void bitset_clear(bitset_t *set) {
+    if (set->word_count) {
+        memset(set->words, 0, (size_t)set->word_count * sizeof(uint64_t));
+    }
+}
+
+/**
+ * Count the bits in the set
+ *
+ * @param set Bitset to count
+ * @return Number of set bits
+ */
+int bitset_count(const bitset_t *set) {
+    int count = 0;
+
+    for (int i = 0; i < set->word_count; i++) {
+        count += word_popcount(set->words[i]);
+    }
+
+    return count;
+}
+
+/**
+ * Find the next set bit
+ *
+ * @param set Bitset to scan
+ * @param from First bit to consider
+ * @return Next set bit at or after from, or -1 if there is none
+ */
+int bitset_next(const bitset_t *set, int from) {
+    if (from < 0) {
+        from = 0;
+    }
+
+    int i = from / WORD_BITS;
+    if (i >= set->word_count) {
+        return -1;
+    }
+
+    // Mask off the bits below from in the first word
+    uint64_t word = set->words[i] & (~(uint64_t)0 << (from % WORD_BITS));
+    while (!word) {
+        if (++i >= set->word_count) {
+            return -1;
+        }
+        word = set->words[i];
+    }
+
+    return i * WORD_BITS + word_ctz(word);
+}
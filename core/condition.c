@@ -2,8 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
 #include "../include/ancible.h"
 #include "../include/core/condition.h"
+#include "../include/core/symbol.h"
 
 /**
  * Check if a string is "true" or "false"
@@ -27,46 +29,6 @@ static int is_boolean(const char *str) {
     return -1;
 }
 
-/**
- * Compare two strings
- * 
- * @param left Left operand
- * @param right Right operand
- * @param op Operator (==, !=, >, <, >=, <=)
- * @return 1 if comparison is true, 0 if false, -1 on error
- */
-static int compare_strings(const char *left, const char *right, const char *op) {
-    if (!left || !right || !op) {
-        return -1;
-    }
-    
-    if (strcmp(op, "==") == 0) {
-        return strcmp(left, right) == 0 ? 1 : 0;
-    } else if (strcmp(op, "!=") == 0) {
-        return strcmp(left, right) != 0 ? 1 : 0;
-    } else {
-        // Try to convert to integers for numeric comparisons
-        char *end_left, *end_right;
-        long left_val = strtol(left, &end_left, 10);
-        long right_val = strtol(right, &end_right, 10);
-        
-        // Check if both are valid integers
-        if (*end_left == '\0' && *end_right == '\0') {
-            if (strcmp(op, ">") == 0) {
-                return left_val > right_val ? 1 : 0;
-            } else if (strcmp(op, "<") == 0) {
-                return left_val < right_val ? 1 : 0;
-            } else if (strcmp(op, ">=") == 0) {
-                return left_val >= right_val ? 1 : 0;
-            } else if (strcmp(op, "<=") == 0) {
-                return left_val <= right_val ? 1 : 0;
-            }
-        }
-    }
-    
-    return -1;
-}
-
 /**
  * Evaluate a condition string
  * 
@@ -110,111 +72,1357 @@ int condition_evaluate(context_t *context, const char *condition) {
         return result;
     }
     
-    // Check for variable references
-    if (cond_copy[0] == '$' || cond_copy[0] == '{') {
-        // Extract variable name
-        char *var_name = cond_copy;
-        if (var_name[0] == '$') var_name++;
-        if (var_name[0] == '{') {
-            var_name++;
-            char *end = strchr(var_name, '}');
-            if (end) *end = '\0';
-        }
-        
-        // Look up variable
-        const char *var_value = context_get_var(context, var_name);
-        if (var_value) {
-            result = is_boolean(var_value);
-            if (result == -1) {
-                // If not a boolean, non-empty string is true
-                result = *var_value != '\0' ? 1 : 0;
-            }
-        } else {
-            // Variable not found, treat as false
-            result = 0;
-        }
-        
+    // A condition the compiler does not handle cannot be evaluated either
+    condition_t *compiled = condition_compile(cond_copy);
+    if (!compiled) {
+        fprintf(stderr, "Error: Invalid condition: %s\n", cond_copy);
         free(cond_copy);
-        return result;
+        return -1;
     }
     
-    // Check for comparisons (==, !=, >, <, >=, <=)
-    const char *operators[] = {"==", "!=", ">=", "<=", ">", "<"};
-    for (int i = 0; i < 6; i++) {
-        char *op_pos = strstr(cond_copy, operators[i]);
-        if (op_pos) {
-            // Split into left and right operands
-            *op_pos = '\0';
-            char *left = cond_copy;
-            char *right = op_pos + strlen(operators[i]);
-            
-            // Trim whitespace
-            while (isspace(*left)) left++;
-            len = strlen(left);
-            while (len > 0 && isspace(left[len - 1])) {
-                left[--len] = '\0';
+    result = condition_eval(compiled, context);
+    condition_free(compiled);
+    free(cond_copy);
+    return result;
+}
+
+/**
+ * State of the condition compiler
+ */
+typedef struct {
+    const char *p;        // Next character
+    const char *end;      // End of the text being compiled
+    condition_unset_t unset; // What bare names stand for when not set (strict inside {{ }})
+} condition_parser_t;
+
+/**
+ * Value of an operand while evaluating
+ */
+typedef struct {
+    const char *text;     // Text (NUL-terminated), NULL for a variable that is not set
+    size_t length;        // Length of the text
+    const value_t *typed; // Typed value, or NULL
+    int boolean;          // 1 or 0 for a true boolean (not a word like "yes"), -1 otherwise
+    int defined;          // Whether the operand is a literal, or a variable or result that is set
+    int unknown;          // Whether the value depends on the host (folding only)
+} condition_value_t;
+
+/**
+ * Where operands are read from: a host's context, or what every host of a play shares
+ */
+typedef struct {
+    const context_t *context; // Context of the host, or NULL when folding for a play
+    const scope_t *extra_vars; // Extra variables (folding)
+    const scope_t *task_vars; // Variables of the task (folding)
+    const scope_t *play_vars; // Variables of the play (folding)
+    const bitset_t *facts; // Variables hosts may set, NULL if any (folding)
+} condition_source_t;
+
+// Result of a node whose value depends on the host, while folding
+#define CONDITION_UNKNOWN -2
+
+static condition_t *compile_or(condition_parser_t *parser);
+
+/**
+ * Skip spaces
+ *
+ * @param parser Compiler state
+ */
+static void condition_skip(condition_parser_t *parser) {
+    while (parser->p < parser->end && isspace((unsigned char)*parser->p)) {
+        parser->p++;
+    }
+}
+
+/**
+ * Consume a keyword (and, or, not, in, is) if it comes next, as a whole word
+ *
+ * @param parser Compiler state
+ * @param keyword Keyword
+ * @return 1 if the keyword was consumed, 0 otherwise
+ */
+static int condition_keyword(condition_parser_t *parser, const char *keyword) {
+    condition_skip(parser);
+    size_t length = strlen(keyword);
+    if ((size_t)(parser->end - parser->p) < length || strncmp(parser->p, keyword, length) != 0) {
+        return 0;
+    }
+
+    const char *after = parser->p + length;
+    if (after < parser->end && (isalnum((unsigned char)*after) || *after == '_' || *after == '.')) {
+        return 0;
+    }
+    parser->p = after;
+    return 1;
+}
+
+/**
+ * Check whether a word is a keyword
+ *
+ * @param word Word
+ * @param length Length of the word
+ * @return 1 if it is, 0 otherwise
+ */
+static int is_keyword(const char *word, size_t length) {
+    static const char *const keywords[] = { "and", "or", "not", "in", "is" };
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if (strlen(keywords[i]) == length && strncmp(word, keywords[i], length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Allocate a node
+ *
+ * @param type Node type
+ * @param text Text of the node, copied (may be NULL)
+ * @param length Length of the text
+ * @return Node, or NULL on error
+ */
+static condition_t *condition_node(condition_type_t type, const char *text, size_t length) {
+    condition_t *node = calloc(1, sizeof(condition_t));
+    if (!node) {
+        fprintf(stderr, "Error: Failed to allocate memory for condition\n");
+        return NULL;
+    }
+
+    node->type = type;
+    node->key = -1;
+    node->boolean = -1;
+    if (text) {
+        node->text = malloc(length + 1);
+        if (!node->text) {
+            fprintf(stderr, "Error: Failed to allocate memory for condition\n");
+            free(node);
+            return NULL;
+        }
+        memcpy(node->text, text, length);
+        node->text[length] = '\0';
+        node->length = length;
+    }
+
+    return node;
+}
+
+/**
+ * Parse an integer, the whole text
+ *
+ * @param text Text (NUL-terminated)
+ * @param integer Pointer to receive the value
+ * @return 1 if the text is an integer, 0 otherwise
+ */
+static int parse_integer(const char *text, long long *integer) {
+    char *end;
+    if (!isdigit((unsigned char)text[text[0] == '-' || text[0] == '+']) ) {
+        return 0;
+    }
+    *integer = strtoll(text, &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * Check whether a name is a variable name ("[A-Za-z_][A-Za-z0-9_]*")
+ *
+ * @param name Name
+ * @param length Length of the name
+ * @return 1 if it is, 0 otherwise
+ */
+static int is_name(const char *name, size_t length) {
+    if (length == 0 || (!isalpha((unsigned char)name[0]) && name[0] != '_')) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Build the node of a name, resolved to a symbol now
+ *
+ * A name with one dot reads a field of a registered result (out.rc); a
+ * word that is not a name at all (a path, a host name) is a literal.
+ *
+ * @param word Word as written
+ * @param length Length of the word
+ * @param unset What the variable stands for when it is not set
+ * @return Node, or NULL on error
+ */
+static condition_t *compile_name(const char *word, size_t length, condition_unset_t unset) {
+    const char *dot = memchr(word, '.', length);
+    size_t name_length = dot ? (size_t)(dot - word) : length;
+    result_field_t field = dot ? template_field_find(dot + 1, length - name_length - 1) : RESULT_FIELD_NONE;
+
+    if (!is_name(word, name_length) || (dot && field == RESULT_FIELD_NONE)) {
+        return unset == CONDITION_UNSET_WORD ? condition_node(CONDITION_LITERAL, word, length) : NULL;
+    }
+
+    condition_t *node = condition_node(dot ? CONDITION_FIELD : CONDITION_VAR, word, length);
+    if (!node) {
+        return NULL;
+    }
+    node->text[name_length] = '\0';
+    node->key = symbol_intern(node->text);
+    node->text[name_length] = dot ? '.' : '\0';
+    node->field = field;
+    node->unset = unset;
+    if (node->key < 0) {
+        condition_free(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+
+/**
+ * Check whether a node is an operand (literal, variable or result field)
+ *
+ * @param node Node
+ * @return 1 if it is, 0 otherwise
+ */
+static int is_operand(const condition_t *node) {
+    return node->type == CONDITION_LITERAL || node->type == CONDITION_VAR || node->type == CONDITION_FIELD;
+}
+
+/**
+ * Join two nodes under a new one (and, or)
+ *
+ * @param type Node type
+ * @param left Left node (freed on error)
+ * @param right Right node (freed on error, may be NULL)
+ * @return Node, or NULL on error
+ */
+static condition_t *condition_join(condition_type_t type, condition_t *left, condition_t *right) {
+    condition_t *node = left && right ? condition_node(type, NULL, 0) : NULL;
+    if (!node) {
+        condition_free(left);
+        condition_free(right);
+        return NULL;
+    }
+
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+/**
+ * Negate a node
+ *
+ * @param operand Node to negate (freed on error)
+ * @return Node, or NULL on error
+ */
+static condition_t *condition_negate(condition_t *operand) {
+    condition_t *node = operand ? condition_node(CONDITION_NOT, NULL, 0) : NULL;
+    if (!node) {
+        condition_free(operand);
+        return NULL;
+    }
+
+    node->left = operand;
+    return node;
+}
+
+/**
+ * Compile an operand
+ *
+ * @param parser Compiler state
+ * @return Node, or NULL if the operand is beyond the compiler
+ */
+static condition_t *compile_operand(condition_parser_t *parser) {
+    condition_skip(parser);
+    const char *start = parser->p;
+    if (start >= parser->end) {
+        return NULL;
+    }
+
+    // {{ expression }}, where bare names are variables that must be set
+    if (parser->end - start >= 2 && start[0] == '{' && start[1] == '{') {
+        const char *close = start + 2;
+        while (close + 1 < parser->end && !(close[0] == '}' && close[1] == '}')) {
+            close++;
+        }
+        if (close + 1 >= parser->end) {
+            return NULL;
+        }
+
+        condition_parser_t inner = { start + 2, close, CONDITION_UNSET_ERROR };
+        condition_t *node = compile_or(&inner);
+        condition_skip(&inner);
+        if (node && inner.p != inner.end) {
+            condition_free(node);
+            return NULL;
+        }
+        parser->p = close + 2;
+        return node;
+    }
+
+    // ${name}, {name} and $name, from older playbooks
+    if (*start == '$' || *start == '{') {
+        const char *word = start + (*start == '$');
+        int braced = word < parser->end && *word == '{';
+        word += braced;
+        const char *p = word;
+        while (p < parser->end && (isalnum((unsigned char)*p) || *p == '_')) {
+            p++;
+        }
+        if (braced && (p >= parser->end || *p != '}')) {
+            return NULL;
+        }
+        parser->p = p + braced;
+        return compile_name(word, (size_t)(p - word), CONDITION_UNSET_EMPTY);
+    }
+
+    // Quoted strings, without escapes
+    if (*start == '\'' || *start == '"') {
+        const char *close = memchr(start + 1, *start, (size_t)(parser->end - start - 1));
+        if (!close) {
+            return NULL;
+        }
+        parser->p = close + 1;
+        condition_t *node = condition_node(CONDITION_LITERAL, start + 1, (size_t)(close - start - 1));
+        if (node) {
+            node->is_integer = parse_integer(node->text, &node->integer);
+        }
+        return node;
+    }
+
+    // Any other word runs up to a space, an operator or a bracket
+    while (parser->p < parser->end && !isspace((unsigned char)*parser->p) && !strchr("=!<>()[],", *parser->p)) {
+        parser->p++;
+    }
+    size_t length = (size_t)(parser->p - start);
+    if (length == 0 || is_keyword(start, length)) {
+        parser->p = start;
+        return NULL;
+    }
+
+    char word[8];
+    if (length < sizeof(word)) {
+        memcpy(word, start, length);
+        word[length] = '\0';
+        if (strcasecmp(word, "true") == 0 || strcasecmp(word, "false") == 0 ||
+            strcasecmp(word, "yes") == 0 || strcasecmp(word, "no") == 0) {
+            condition_t *node = condition_node(CONDITION_LITERAL, start, length);
+            if (node) {
+                node->boolean = strcasecmp(word, "true") == 0 || strcasecmp(word, "yes") == 0;
+            }
+            return node;
+        }
+    }
+
+    // Numbers, then names
+    condition_t *node = condition_node(CONDITION_LITERAL, start, length);
+    if (!node || (node->is_integer = parse_integer(node->text, &node->integer))) {
+        return node;
+    }
+    condition_free(node);
+    return compile_name(start, length, parser->unset);
+}
+
+/**
+ * Compile a list of operands ([80, 443])
+ *
+ * @param parser Compiler state, at the '['
+ * @return Node, or NULL if the list is beyond the compiler
+ */
+static condition_t *compile_list(condition_parser_t *parser) {
+    condition_t *node = condition_node(CONDITION_LIST, NULL, 0);
+    if (!node) {
+        return NULL;
+    }
+
+    parser->p++;
+    condition_skip(parser);
+    while (parser->p < parser->end && *parser->p != ']') {
+        condition_t **items = realloc(node->items, (size_t)(node->count + 1) * sizeof(condition_t *));
+        if (!items) {
+            fprintf(stderr, "Error: Failed to allocate memory for condition\n");
+            condition_free(node);
+            return NULL;
+        }
+        node->items = items;
+
+        condition_t *item = compile_operand(parser);
+        if (!item) {
+            condition_free(node);
+            return NULL;
+        }
+        node->items[node->count++] = item;
+        condition_skip(parser);
+        if (!is_operand(item) || parser->p >= parser->end || (*parser->p != ',' && *parser->p != ']')) {
+            condition_free(node);
+            return NULL;
+        }
+        if (*parser->p == ',') {
+            parser->p++;
+            condition_skip(parser);
+        }
+    }
+
+    if (parser->p >= parser->end) {
+        condition_free(node);
+        return NULL;
+    }
+    parser->p++;
+    return node;
+}
+
+/**
+ * Compile the test after "is" (defined, match('^web'), ...)
+ *
+ * The pattern of match and search is compiled here, once.
+ *
+ * @param parser Compiler state
+ * @return Test node without its operand, or NULL if the test is beyond the compiler
+ */
+static condition_t *compile_test_name(condition_parser_t *parser) {
+    static const struct {
+        const char *name;
+        condition_test_t test;
+    } tests[] = {
+        { "defined", CONDITION_TEST_DEFINED }, { "undefined", CONDITION_TEST_UNDEFINED },
+        { "truthy", CONDITION_TEST_TRUTHY }, { "falsy", CONDITION_TEST_FALSY },
+        { "string", CONDITION_TEST_STRING }, { "number", CONDITION_TEST_NUMBER },
+        { "integer", CONDITION_TEST_NUMBER }, { "match", CONDITION_TEST_MATCH },
+        { "search", CONDITION_TEST_SEARCH }, { "regex", CONDITION_TEST_SEARCH },
+        { "failed", CONDITION_TEST_FAILED }, { "succeeded", CONDITION_TEST_SUCCEEDED },
+        { "success", CONDITION_TEST_SUCCEEDED }, { "changed", CONDITION_TEST_CHANGED },
+        { "skipped", CONDITION_TEST_SKIPPED }
+    };
+
+    condition_skip(parser);
+    const char *name = parser->p;
+    while (parser->p < parser->end && (isalpha((unsigned char)*parser->p) || *parser->p == '_')) {
+        parser->p++;
+    }
+    size_t length = (size_t)(parser->p - name);
+
+    size_t i = 0;
+    while (i < sizeof(tests) / sizeof(tests[0]) &&
+           (strlen(tests[i].name) != length || strncmp(name, tests[i].name, length) != 0)) {
+        i++;
+    }
+    if (i == sizeof(tests) / sizeof(tests[0])) {
+        return NULL;
+    }
+
+    condition_t *node = condition_node(CONDITION_TEST, NULL, 0);
+    if (!node) {
+        return NULL;
+    }
+    node->test = tests[i].test;
+    if (node->test != CONDITION_TEST_MATCH && node->test != CONDITION_TEST_SEARCH) {
+        return node;
+    }
+
+    // The pattern is a quoted string in parentheses
+    condition_skip(parser);
+    condition_t *pattern = NULL;
+    if (parser->p < parser->end && *parser->p == '(') {
+        parser->p++;
+        condition_skip(parser);
+        pattern = parser->p < parser->end && (*parser->p == '\'' || *parser->p == '"') ? compile_operand(parser) : NULL;
+        condition_skip(parser);
+    }
+    if (!pattern || parser->p >= parser->end || *parser->p != ')') {
+        condition_free(pattern);
+        condition_free(node);
+        return NULL;
+    }
+    parser->p++;
+
+    // match is anchored at the start, as in Ansible
+    char *text = malloc(pattern->length + 4);
+    node->regex = malloc(sizeof(regex_t));
+    if (!text || !node->regex) {
+        fprintf(stderr, "Error: Failed to allocate memory for condition\n");
+        free(text);
+        condition_free(pattern);
+        condition_free(node);
+        return NULL;
+    }
+    sprintf(text, node->test == CONDITION_TEST_MATCH ? "^(%s)" : "%s", pattern->text);
+
+    int rc = regcomp(node->regex, text, REG_EXTENDED | REG_NOSUB);
+    free(text);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Invalid regular expression in condition: %s\n", pattern->text);
+        free(node->regex);
+        node->regex = NULL;
+        condition_free(pattern);
+        condition_free(node);
+        return NULL;
+    }
+
+    condition_free(pattern);
+    return node;
+}
+
+/**
+ * Compile a comparison, membership test or test, or a parenthesized condition
+ *
+ * @param parser Compiler state
+ * @return Node, or NULL if the text is beyond the compiler
+ */
+static condition_t *compile_test(condition_parser_t *parser) {
+    static const struct {
+        const char *text;
+        condition_op_t op;
+    } operators[] = {
+        { "==", CONDITION_OP_EQ }, { "!=", CONDITION_OP_NE }, { ">=", CONDITION_OP_GE },
+        { "<=", CONDITION_OP_LE }, { ">", CONDITION_OP_GT }, { "<", CONDITION_OP_LT }
+    };
+
+    condition_skip(parser);
+    if (parser->p < parser->end && *parser->p == '(') {
+        parser->p++;
+        condition_t *node = compile_or(parser);
+        condition_skip(parser);
+        if (!node || parser->p >= parser->end || *parser->p != ')') {
+            condition_free(node);
+            return NULL;
+        }
+        parser->p++;
+        return node;
+    }
+
+    condition_t *left = compile_operand(parser);
+    if (!left) {
+        return NULL;
+    }
+    condition_skip(parser);
+
+    size_t i = 0;
+    while (i < sizeof(operators) / sizeof(operators[0]) &&
+           (parser->p >= parser->end || strncmp(parser->p, operators[i].text, strlen(operators[i].text)) != 0)) {
+        i++;
+    }
+
+    // "not in" is read ahead; a "not" on its own is left to the caller
+    const char *mark = parser->p;
+    int in = i == sizeof(operators) / sizeof(operators[0]) && condition_keyword(parser, "in");
+    int negate = 0;
+    if (i == sizeof(operators) / sizeof(operators[0]) && !in && condition_keyword(parser, "not")) {
+        in = negate = condition_keyword(parser, "in");
+        parser->p = in ? parser->p : mark;
+    }
+
+    condition_t *node;
+    if (i < sizeof(operators) / sizeof(operators[0])) {
+        parser->p += strlen(operators[i].text);
+        node = condition_node(CONDITION_COMPARE, NULL, 0);
+        if (node) {
+            node->op = operators[i].op;
+            node->right = compile_operand(parser);
+        }
+    } else if (in) {
+        node = condition_node(CONDITION_IN, NULL, 0);
+        condition_skip(parser);
+        if (node) {
+            node->right = parser->p < parser->end && *parser->p == '[' ? compile_list(parser) : compile_operand(parser);
+        }
+    } else if (condition_keyword(parser, "is")) {
+        negate = condition_keyword(parser, "not");
+        node = compile_test_name(parser);
+    } else {
+        return left;
+    }
+
+    if (!node) {
+        condition_free(left);
+        return NULL;
+    }
+    // Results are registered under a name, so only a name can be tested for them
+    node->left = left;
+    if (!is_operand(left) || (node->type != CONDITION_TEST && !node->right) ||
+        (node->type == CONDITION_TEST && node->test >= CONDITION_TEST_FAILED && left->type != CONDITION_VAR) ||
+        (node->right && !is_operand(node->right) && node->right->type != CONDITION_LIST)) {
+        condition_free(node);
+        return NULL;
+    }
+
+    return negate ? condition_negate(node) : node;
+}
+
+/**
+ * Compile a negation, or what it negates
+ *
+ * @param parser Compiler state
+ * @return Node, or NULL if the text is beyond the compiler
+ */
+static condition_t *compile_not(condition_parser_t *parser) {
+    if (condition_keyword(parser, "not")) {
+        return condition_negate(compile_not(parser));
+    }
+    return compile_test(parser);
+}
+
+/**
+ * Compile conditions joined with "and"
+ *
+ * @param parser Compiler state
+ * @return Node, or NULL if the text is beyond the compiler
+ */
+static condition_t *compile_and(condition_parser_t *parser) {
+    condition_t *node = compile_not(parser);
+    while (node && condition_keyword(parser, "and")) {
+        node = condition_join(CONDITION_AND, node, compile_not(parser));
+    }
+    return node;
+}
+
+/**
+ * Compile conditions joined with "or"
+ *
+ * @param parser Compiler state
+ * @return Node, or NULL if the text is beyond the compiler
+ */
+static condition_t *compile_or(condition_parser_t *parser) {
+    condition_t *node = compile_and(parser);
+    while (node && condition_keyword(parser, "or")) {
+        node = condition_join(CONDITION_OR, node, compile_and(parser));
+    }
+    return node;
+}
+
+/**
+ * Compile a condition
+ *
+ * @param source Condition text
+ * @return Compiled condition, or NULL if the text is beyond the compiler (or on error)
+ */
+condition_t *condition_compile(const char *source) {
+    if (!source) {
+        return NULL;
+    }
+
+    condition_parser_t parser = { source, source + strlen(source), CONDITION_UNSET_WORD };
+    condition_t *node = compile_or(&parser);
+    condition_skip(&parser);
+    if (node && parser.p != parser.end) {
+        condition_free(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+/**
+ * Look up a variable shared by every host of a play
+ *
+ * @param source Variables of the play
+ * @param key Symbol ID of the variable
+ * @param typed Pointer to receive the typed value, if any
+ * @param unknown Pointer set to 1 when the value depends on the host
+ * @return Value of the variable, or NULL
+ */
+static const char *fold_lookup(const condition_source_t *source, int key, const value_t **typed, int *unknown) {
+    const variable_t *var = scope_find(source->extra_vars, key);
+    if (!var && source->facts && !bitset_test(source->facts, key) &&
+        !(var = scope_find(source->task_vars, key))) {
+        var = scope_find(source->play_vars, key);
+    }
+
+    // Host and group variables, defaults and built-ins may differ from host to host
+    if (!var) {
+        *unknown = 1;
+        return NULL;
+    }
+    *typed = var->typed;
+    return var->value;
+}
+
+/**
+ * Read the value of an operand for a host
+ *
+ * @param node Operand node
+ * @param source Where variables are read from
+ * @param out Value to fill (text is NULL for a variable that is not set)
+ */
+static void operand_read(const condition_t *node, const condition_source_t *source, condition_value_t *out) {
+    memset(out, 0, sizeof(condition_value_t));
+    out->boolean = node->boolean;
+
+    if (node->type == CONDITION_LITERAL) {
+        out->text = node->text;
+        out->length = node->length;
+        out->defined = 1;
+        return;
+    }
+
+    if (node->type == CONDITION_VAR) {
+        out->text = source->context ? context_lookup_id(source->context, node->key, &out->typed) :
+                    fold_lookup(source, node->key, &out->typed, &out->unknown);
+        out->boolean = out->typed && out->typed->type == VALUE_BOOL ? (int)out->typed->integer : -1;
+    } else if (!source->context) {
+        out->unknown = 1;
+    } else {
+        registered_t *result = context_get_result(source->context, node->key);
+        switch (result ? node->field : RESULT_FIELD_NONE) {
+        case RESULT_FIELD_STDOUT:
+        case RESULT_FIELD_STDOUT_LINES:
+            out->text = result->stdout_data;
+            break;
+        case RESULT_FIELD_STDERR:
+            out->text = result->stderr_data;
+            break;
+        case RESULT_FIELD_RC:
+            out->text = result->rc[0] ? result->rc : NULL;
+            break;
+        case RESULT_FIELD_MSG:
+            out->text = result->msg;
+            break;
+        case RESULT_FIELD_CHANGED:
+        case RESULT_FIELD_FAILED:
+        case RESULT_FIELD_SKIPPED:
+            out->boolean = node->field == RESULT_FIELD_CHANGED ? result->changed :
+                           node->field == RESULT_FIELD_FAILED ? result->failed : result->skipped;
+            out->text = out->boolean ? "True" : "False";
+            break;
+        default:
+            break;
+        }
+    }
+
+    out->defined = out->text != NULL;
+    if (out->unknown) {
+        return;
+    } else if (out->text) {
+        out->length = out->typed ? out->typed->length : strlen(out->text);
+    } else if (node->unset == CONDITION_UNSET_WORD) {
+        out->text = node->text;
+        out->length = node->length;
+    } else if (node->unset == CONDITION_UNSET_EMPTY) {
+        out->text = "";
+    }
+}
+
+/**
+ * Get the integer value of an operand
+ *
+ * @param node Operand node
+ * @param value Value read for the host
+ * @param integer Pointer to receive the integer
+ * @return 1 if the operand is an integer, 0 otherwise
+ */
+static int operand_integer(const condition_t *node, const condition_value_t *value, long long *integer) {
+    if (node->type == CONDITION_LITERAL) {
+        *integer = node->integer;
+        return node->is_integer;
+    }
+    if (value->typed) {
+        *integer = value->typed->integer;
+        return value->typed->type == VALUE_INT;
+    }
+    return parse_integer(value->text, integer);
+}
+
+/**
+ * Get the truth value of an operand's text ("true", "yes", "1", or non-empty)
+ *
+ * @param value Value read for the host
+ * @return 1 or 0
+ */
+static int operand_truthy(const condition_value_t *value) {
+    if (value->boolean >= 0) {
+        return value->boolean;
+    }
+    if (value->typed && (value->typed->type == VALUE_LIST || value->typed->type == VALUE_MAP)) {
+        return value->typed->count > 0;
+    }
+
+    int boolean = is_boolean(value->text);
+    return boolean >= 0 ? boolean : value->length > 0;
+}
+
+/**
+ * Order two operands
+ *
+ * Integers compare as numbers, booleans as booleans (true == yes), and
+ * anything else as text.
+ *
+ * @param left_node Left operand node
+ * @param left Left value
+ * @param right_node Right operand node
+ * @param right Right value
+ * @return Negative, zero or positive as the left operand is below, equal to or above the right one
+ */
+static int operand_order(const condition_t *left_node, const condition_value_t *left,
+                         const condition_t *right_node, const condition_value_t *right) {
+    long long a;
+    long long b;
+    if (operand_integer(left_node, left, &a) && operand_integer(right_node, right, &b)) {
+        return (a > b) - (a < b);
+    }
+    if ((left->boolean >= 0 || right->boolean >= 0) &&
+        (left->boolean >= 0 || is_boolean(left->text) >= 0) && (right->boolean >= 0 || is_boolean(right->text) >= 0)) {
+        return operand_truthy(left) - operand_truthy(right);
+    }
+
+    size_t length = left->length < right->length ? left->length : right->length;
+    int order = memcmp(left->text, right->text, length);
+    return order ? order : (left->length > right->length) - (left->length < right->length);
+}
+
+/**
+ * Evaluate an operand on its own
+ *
+ * @param node Operand node
+ * @param source Where variables are read from
+ * @return 1 if true, 0 if false, -1 on error
+ */
+static int operand_eval(const condition_t *node, const condition_source_t *source) {
+    condition_value_t value;
+    operand_read(node, source, &value);
+    if (value.unknown) {
+        return CONDITION_UNKNOWN;
+    }
+
+    // A bare name on its own must be set
+    if (!value.text || (!value.defined && node->unset == CONDITION_UNSET_WORD)) {
+        return -1;
+    }
+    return operand_truthy(&value);
+}
+
+/**
+ * Evaluate a comparison
+ *
+ * @param node Comparison node
+ * @param source Where variables are read from
+ * @return 1 if true, 0 if false, -1 on error
+ */
+static int compare_eval(const condition_t *node, const condition_source_t *source) {
+    condition_value_t left;
+    condition_value_t right;
+    operand_read(node->left, source, &left);
+    operand_read(node->right, source, &right);
+    if (left.unknown || right.unknown) {
+        return CONDITION_UNKNOWN;
+    }
+    if (!left.text || !right.text) {
+        return -1;
+    }
+
+    // A name that is not set only stands for its own text in (in)equalities
+    if (node->op != CONDITION_OP_EQ && node->op != CONDITION_OP_NE && (!left.defined || !right.defined)) {
+        return -1;
+    }
+
+    int order = operand_order(node->left, &left, node->right, &right);
+    switch (node->op) {
+    case CONDITION_OP_EQ:
+        return order == 0;
+    case CONDITION_OP_NE:
+        return order != 0;
+    case CONDITION_OP_LT:
+        return order < 0;
+    case CONDITION_OP_LE:
+        return order <= 0;
+    case CONDITION_OP_GT:
+        return order > 0;
+    case CONDITION_OP_GE:
+        return order >= 0;
+    }
+
+    return -1;
+}
+
+/**
+ * Evaluate a membership test
+ *
+ * An item of a list or a key of a map must match whole; in text, any
+ * substring matches.
+ *
+ * @param node Membership node
+ * @param source Where variables are read from
+ * @return 1 if true, 0 if false, -1 on error
+ */
+static int in_eval(const condition_t *node, const condition_source_t *source) {
+    condition_value_t needle;
+    operand_read(node->left, source, &needle);
+    if (needle.unknown) {
+        return CONDITION_UNKNOWN;
+    }
+    if (!needle.text || !needle.defined) {
+        return -1;
+    }
+
+    const condition_t *list = node->right;
+    if (list->type == CONDITION_LIST) {
+        for (int i = 0; i < list->count; i++) {
+            condition_value_t item;
+            operand_read(list->items[i], source, &item);
+            if (item.unknown || !item.text) {
+                return item.unknown ? CONDITION_UNKNOWN : -1;
             }
-            
-            while (isspace(*right)) right++;
-            len = strlen(right);
-            while (len > 0 && isspace(right[len - 1])) {
-                right[--len] = '\0';
+            if (operand_order(node->left, &needle, list->items[i], &item) == 0) {
+                return 1;
             }
-            
-            // Check for variable references in operands
-            if (left[0] == '$' || left[0] == '{') {
-                char *var_name = left;
-                if (var_name[0] == '$') var_name++;
-                if (var_name[0] == '{') {
-                    var_name++;
-                    char *end = strchr(var_name, '}');
-                    if (end) *end = '\0';
-                }
-                
-                const char *var_value = context_get_var(context, var_name);
-                if (var_value) {
-                    left = (char *)var_value;
-                } else {
-                    left = "";
-                }
+        }
+        return 0;
+    }
+
+    // What is searched must exist, even for a bare name
+    condition_value_t haystack;
+    operand_read(list, source, &haystack);
+    if (haystack.unknown) {
+        return CONDITION_UNKNOWN;
+    }
+    if (!haystack.text || !haystack.defined) {
+        return -1;
+    }
+    if (haystack.typed) {
+        return value_contains(haystack.typed, needle.text, needle.length);
+    }
+    for (size_t i = 0; needle.length <= haystack.length && i <= haystack.length - needle.length; i++) {
+        if (memcmp(haystack.text + i, needle.text, needle.length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Evaluate a test (is defined, is match(...))
+ *
+ * @param node Test node
+ * @param source Where variables are read from
+ * @return 1 if true, 0 if false, -1 on error
+ */
+static int test_eval(const condition_t *node, const condition_source_t *source) {
+    // Result tests need a result registered on the host
+    if (node->test >= CONDITION_TEST_FAILED) {
+        const registered_t *result = source->context ? context_get_result(source->context, node->left->key) : NULL;
+        if (!source->context || !result) {
+            return source->context ? -1 : CONDITION_UNKNOWN;
+        }
+        return node->test == CONDITION_TEST_FAILED ? result->failed :
+               node->test == CONDITION_TEST_SUCCEEDED ? !result->failed :
+               node->test == CONDITION_TEST_CHANGED ? result->changed : result->skipped;
+    }
+
+    condition_value_t value;
+    operand_read(node->left, source, &value);
+    if (value.unknown) {
+        return CONDITION_UNKNOWN;
+    }
+
+    // Only definedness can be tested on a variable that is not set
+    if (node->test != CONDITION_TEST_DEFINED && node->test != CONDITION_TEST_UNDEFINED &&
+        (!value.text || !value.defined)) {
+        return -1;
+    }
+
+    long long integer;
+    switch (node->test) {
+    case CONDITION_TEST_DEFINED:
+        return value.defined;
+    case CONDITION_TEST_UNDEFINED:
+        return !value.defined;
+    case CONDITION_TEST_TRUTHY:
+        return operand_truthy(&value);
+    case CONDITION_TEST_FALSY:
+        return !operand_truthy(&value);
+    case CONDITION_TEST_STRING:
+        return value.boolean < 0 && !operand_integer(node->left, &value, &integer) &&
+               (!value.typed || value.typed->type == VALUE_STRING);
+    case CONDITION_TEST_NUMBER:
+        return operand_integer(node->left, &value, &integer);
+    case CONDITION_TEST_MATCH:
+    case CONDITION_TEST_SEARCH:
+        return regexec(node->regex, value.text, 0, NULL, 0) == 0;
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+/**
+ * Evaluate a node for a host, or for every host of a play
+ *
+ * and and or only go on to their right node once the left one is known to
+ * be true (false), so a host-dependent left side is never skipped over.
+ *
+ * @param node Node
+ * @param source Where variables are read from
+ * @return 1 if true, 0 if false, -1 on error, CONDITION_UNKNOWN if it depends on the host
+ */
+static int node_eval(const condition_t *node, const condition_source_t *source) {
+    int result;
+
+    switch (node->type) {
+    case CONDITION_LITERAL:
+    case CONDITION_VAR:
+    case CONDITION_FIELD:
+        return operand_eval(node, source);
+    case CONDITION_LIST:
+        return node->count > 0;
+    case CONDITION_COMPARE:
+        return compare_eval(node, source);
+    case CONDITION_IN:
+        return in_eval(node, source);
+    case CONDITION_TEST:
+        return test_eval(node, source);
+    case CONDITION_NOT:
+        result = node_eval(node->left, source);
+        return result < 0 ? result : !result;
+    case CONDITION_AND:
+        result = node_eval(node->left, source);
+        return result == 1 ? node_eval(node->right, source) : result;
+    case CONDITION_OR:
+        result = node_eval(node->left, source);
+        return result == 0 ? node_eval(node->right, source) : result;
+    }
+
+    return -1;
+}
+
+/**
+ * Evaluate a compiled condition for a host
+ *
+ * @param condition Compiled condition
+ * @param source Where variables are read from
+ * @return 1 if the condition is true, 0 if false, -1 on error
+ */
+int condition_eval(const condition_t *condition, const context_t *context) {
+    if (!condition || !context) {
+        return -1;
+    }
+
+    condition_source_t source = { context, NULL, NULL, NULL, NULL };
+    return node_eval(condition, &source);
+}
+
+/**
+ * Evaluate a compiled condition once for every host of a play
+ *
+ * @param condition Compiled condition
+ * @param extra_vars Extra variables (may be NULL)
+ * @param task_vars Variables of the task (may be NULL)
+ * @param play_vars Variables of the play (may be NULL)
+ * @param facts Symbol IDs of the variables hosts may set, or NULL if they may set any
+ * @return 1 if the condition holds on every host, 0 if on none, -1 if it depends on the host
+ */
+int condition_fold(const condition_t *condition, const scope_t *extra_vars, const scope_t *task_vars,
+                   const scope_t *play_vars, const bitset_t *facts) {
+    if (!condition) {
+        return -1;
+    }
+
+    condition_source_t source = { NULL, extra_vars, task_vars, play_vars, facts };
+    int result = node_eval(condition, &source);
+    return result >= 0 ? result : -1;
+}
+
+/**
+ * Make the names hosts may set errors, not words, when they are not set
+ *
+ * @param condition Compiled condition (may be NULL)
+ * @param declared Symbol IDs of the variables and results hosts may set
+ */
+void condition_declare(condition_t *condition, const bitset_t *declared) {
+    if (!condition) {
+        return;
+    }
+
+    if ((condition->type == CONDITION_VAR || condition->type == CONDITION_FIELD) &&
+        condition->unset == CONDITION_UNSET_WORD && bitset_test(declared, condition->key)) {
+        condition->unset = CONDITION_UNSET_ERROR;
+    }
+    condition_declare(condition->left, declared);
+    condition_declare(condition->right, declared);
+    for (int i = 0; i < condition->count; i++) {
+        condition_declare(condition->items[i], declared);
+    }
+}
+
+/**
+ * Scratch columns of a batch evaluation, one slot per host
+ *
+ * Sets of hosts are bitsets of host indexes, 64 hosts to a word.
+ */
+typedef struct {
+    const context_t *const *contexts; // Contexts of the hosts
+    int count;            // Number of hosts
+    int words;            // Number of bitset words that cover the hosts
+    long long *integers;  // Integer values of the operand being compared
+    unsigned char *known; // Whether the operand is an integer on the host
+    unsigned char *holds; // Whether the comparison holds on the host
+} condition_batch_t;
+
+/**
+ * Get the integer literal a comparison is made against, for the column path
+ *
+ * @param node Comparison node
+ * @return The literal operand, or NULL if neither side is an integer literal facing a variable
+ */
+static const condition_t *batch_literal(const condition_t *node) {
+    const condition_t *left = node->left;
+    const condition_t *right = node->right;
+
+    if (right->type == CONDITION_LITERAL && right->is_integer &&
+        (left->type == CONDITION_VAR || left->type == CONDITION_FIELD)) {
+        return right;
+    }
+    if (left->type == CONDITION_LITERAL && left->is_integer &&
+        (right->type == CONDITION_VAR || right->type == CONDITION_FIELD)) {
+        return left;
+    }
+    return NULL;
+}
+
+/**
+ * Evaluate a comparison of a variable with an integer for a batch of hosts
+ *
+ * The variable is read into a column first; the column is then compared
+ * in one pass. Hosts whose value is not an integer go through compare_eval.
+ *
+ * @param node Comparison node
+ * @param literal Integer literal operand of the node
+ * @param batch Batch state
+ * @param mask Hosts to evaluate
+ * @param holds Cleared bitset to fill with the hosts the comparison holds on
+ * @param fails Cleared bitset to fill with the hosts it does not hold on
+ */
+static void batch_compare(const condition_t *node, const condition_t *literal, condition_batch_t *batch,
+                          const bitset_t *mask, bitset_t *holds, bitset_t *fails) {
+    const condition_t *column = literal == node->right ? node->left : node->right;
+    condition_op_t op = node->op;
+
+    // Keep the variable on the left: 1024 < port is port > 1024
+    if (literal == node->left) {
+        op = op == CONDITION_OP_LT ? CONDITION_OP_GT : op == CONDITION_OP_GT ? CONDITION_OP_LT :
+             op == CONDITION_OP_LE ? CONDITION_OP_GE : op == CONDITION_OP_GE ? CONDITION_OP_LE : op;
+    }
+
+    for (int w = 0; w < batch->words; w++) {
+        uint64_t word = mask->words[w];
+        for (int bit = 0; bit < 64 && word >> bit; bit++) {
+            if (word >> bit & 1) {
+                int h = w * 64 + bit;
+                condition_source_t source = { batch->contexts[h], NULL, NULL, NULL, NULL };
+                condition_value_t value;
+                operand_read(column, &source, &value);
+                batch->known[h] = value.text && operand_integer(column, &value, &batch->integers[h]);
             }
-            
-            if (right[0] == '$' || right[0] == '{') {
-                char *var_name = right;
-                if (var_name[0] == '$') var_name++;
-                if (var_name[0] == '{') {
-                    var_name++;
-                    char *end = strchr(var_name, '}');
-                    if (end) *end = '\0';
-                }
-                
-                const char *var_value = context_get_var(context, var_name);
-                if (var_value) {
-                    right = (char *)var_value;
-                } else {
-                    right = "";
-                }
+        }
+    }
+
+    // Plain loops over the column: compilers vectorize these
+    const long long *values = batch->integers;
+    unsigned char *out = batch->holds;
+    long long integer = literal->integer;
+    int count = batch->count;
+    switch (op) {
+    case CONDITION_OP_EQ:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] == integer;
+        }
+        break;
+    case CONDITION_OP_NE:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] != integer;
+        }
+        break;
+    case CONDITION_OP_LT:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] < integer;
+        }
+        break;
+    case CONDITION_OP_LE:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] <= integer;
+        }
+        break;
+    case CONDITION_OP_GT:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] > integer;
+        }
+        break;
+    case CONDITION_OP_GE:
+        for (int h = 0; h < count; h++) {
+            out[h] = values[h] >= integer;
+        }
+        break;
+    }
+
+    for (int w = 0; w < batch->words; w++) {
+        uint64_t word = mask->words[w];
+        uint64_t hold = 0;
+        uint64_t fail = 0;
+        for (int bit = 0; bit < 64 && word >> bit; bit++) {
+            if (word >> bit & 1) {
+                int h = w * 64 + bit;
+                condition_source_t source = { batch->contexts[h], NULL, NULL, NULL, NULL };
+                int result = batch->known[h] ? out[h] : compare_eval(node, &source);
+                hold |= (uint64_t)(result == 1) << bit;
+                fail |= (uint64_t)(result == 0) << bit;
+            }
+        }
+        holds->words[w] = hold;
+        fails->words[w] = fail;
+    }
+}
+
+/**
+ * Evaluate a node for a batch of hosts
+ *
+ * not swaps the two sets, and and or combine them a word (64 hosts) at a
+ * time; their right node only sees the hosts the left one left undecided,
+ * as node_eval would.
+ *
+ * @param node Node
+ * @param batch Batch state
+ * @param mask Hosts to evaluate
+ * @param holds Bitset to fill with the hosts the node holds on
+ * @param fails Bitset to fill with the hosts it does not hold on (hosts in neither failed to evaluate)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int batch_eval(const condition_t *node, condition_batch_t *batch, const bitset_t *mask,
+                      bitset_t *holds, bitset_t *fails) {
+    if (bitset_reserve(holds, batch->count) != ANCIBLE_SUCCESS ||
+        bitset_reserve(fails, batch->count) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    bitset_clear(holds);
+    bitset_clear(fails);
+
+    if (node->type == CONDITION_NOT) {
+        return batch_eval(node->left, batch, mask, fails, holds);
+    }
+
+    if (node->type == CONDITION_AND || node->type == CONDITION_OR) {
+        bitset_t next;
+        bitset_t other;
+        bitset_init(&next);
+        bitset_init(&other);
+
+        int result;
+        if (node->type == CONDITION_AND) {
+            result = batch_eval(node->left, batch, mask, &next, fails);
+            if (result == ANCIBLE_SUCCESS) {
+                result = batch_eval(node->right, batch, &next, holds, &other);
             }
-            
-            // Remove surrounding quotes if present
-            if (left[0] == '"' && left[strlen(left)-1] == '"') {
-                left[strlen(left)-1] = '\0';
-                left++;
+            if (result == ANCIBLE_SUCCESS) {
+                result = bitset_or(fails, &other);
             }
-            if (right[0] == '"' && right[strlen(right)-1] == '"') {
-                right[strlen(right)-1] = '\0';
-                right++;
+        } else {
+            result = batch_eval(node->left, batch, mask, holds, &next);
+            if (result == ANCIBLE_SUCCESS) {
+                result = batch_eval(node->right, batch, &next, &other, fails);
+            }
+            if (result == ANCIBLE_SUCCESS) {
+                result = bitset_or(holds, &other);
             }
-            
-            // Debug print
-            // printf("Comparing: '%s' %s '%s'\n", left, operators[i], right);
-            
-            // Compare operands
-            result = compare_strings(left, right, operators[i]);
-            break;
         }
+
+        bitset_free(&next);
+        bitset_free(&other);
+        return result;
     }
-    
-    free(cond_copy);
+
+    // Literals and lists are the same on every host
+    if (node->type == CONDITION_LITERAL || node->type == CONDITION_LIST) {
+        condition_source_t source = { batch->contexts[0], NULL, NULL, NULL, NULL };
+        int result = node_eval(node, &source);
+        return result < 0 ? ANCIBLE_SUCCESS : bitset_or(result ? holds : fails, mask);
+    }
+
+    const condition_t *literal = node->type == CONDITION_COMPARE ? batch_literal(node) : NULL;
+    if (literal) {
+        batch_compare(node, literal, batch, mask, holds, fails);
+        return ANCIBLE_SUCCESS;
+    }
+
+    for (int w = 0; w < batch->words; w++) {
+        uint64_t word = mask->words[w];
+        uint64_t hold = 0;
+        uint64_t fail = 0;
+        for (int bit = 0; bit < 64 && word >> bit; bit++) {
+            if (word >> bit & 1) {
+                condition_source_t source = { batch->contexts[w * 64 + bit], NULL, NULL, NULL, NULL };
+                int result = node_eval(node, &source);
+                hold |= (uint64_t)(result == 1) << bit;
+                fail |= (uint64_t)(result == 0) << bit;
+            }
+        }
+        holds->words[w] = hold;
+        fails->words[w] = fail;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Evaluate a compiled condition for many hosts at once
+ *
+ * @param condition Compiled condition
+ * @param contexts Contexts of the hosts
+ * @param count Number of contexts
+ * @param holds Bitset to fill with the hosts (indexes into contexts) the condition holds on
+ * @param fails Bitset to fill with the hosts it does not hold on; on the others it failed to evaluate
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int condition_eval_batch(const condition_t *condition, const context_t *const *contexts, int count,
+                         bitset_t *holds, bitset_t *fails) {
+    if (!condition || !contexts || count <= 0 || !holds || !fails) {
+        return ANCIBLE_ERROR;
+    }
+
+    condition_batch_t batch;
+    batch.contexts = contexts;
+    batch.count = count;
+    batch.words = (count + 63) / 64;
+    batch.integers = calloc((size_t)count, sizeof(long long));
+    batch.known = calloc((size_t)count, sizeof(unsigned char));
+    batch.holds = calloc((size_t)count, sizeof(unsigned char));
+
+    bitset_t all;
+    bitset_init(&all);
+    int result = ANCIBLE_ERROR;
+    if (batch.integers && batch.known && batch.holds && bitset_reserve(&all, count) == ANCIBLE_SUCCESS) {
+        for (int h = 0; h < count; h++) {
+            bitset_set(&all, h);
+        }
+        result = batch_eval(condition, &batch, &all, holds, fails);
+    } else {
+        fprintf(stderr, "Error: Failed to allocate memory for condition batch\n");
+    }
+
+    bitset_free(&all);
+    free(batch.integers);
+    free(batch.known);
+    free(batch.holds);
     return result;
 }
+
+/**
+ * Free a compiled condition
+ *
+ * @param condition Compiled condition (may be NULL)
+ */
+void condition_free(condition_t *condition) {
+    if (!condition) {
+        return;
+    }
+
+    condition_free(condition->left);
+    condition_free(condition->right);
+    for (int i = 0; i < condition->count; i++) {
+        condition_free(condition->items[i]);
+    }
+    free(condition->items);
+    if (condition->regex) {
+        regfree(condition->regex);
+        free(condition->regex);
+    }
+    free(condition->text);
+    free(condition);
+}
@@ -1,92 +1,235 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "../include/ancible.h"
 #include "../include/core/context.h"
+#include "../include/core/symbol.h"
+
+#define CONTEXT_MIN_VARS 16
+
+static pthread_mutex_t lines_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- * Create a new variable
+ * Find the slot of a symbol, or the empty slot where it would go
  * 
- * @param name Variable name
- * @param value Variable value
- * @return Pointer to the new variable, or NULL on error
+ * Symbol IDs are dense, so a multiplicative hash spreads them well; the
+ * table is never more than three quarters full, so probing always ends.
+ * 
+ * @param vars Slot array
+ * @param capacity Number of slots (a power of two)
+ * @param key Symbol ID
+ * @return Pointer to the slot
  */
-static variable_t *variable_create(const char *name, const char *value) {
-    variable_t *var = malloc(sizeof(variable_t));
-    if (!var) {
-        fprintf(stderr, "Error: Failed to allocate memory for variable\n");
-        return NULL;
+static context_var_t *context_slot(context_var_t *vars, int capacity, int key) {
+    uint32_t mask = (uint32_t)capacity - 1;
+    uint32_t pos = ((uint32_t)key * 2654435761u) & mask;
+    
+    while (vars[pos].key >= 0 && vars[pos].key != key) {
+        pos = (pos + 1) & mask;
     }
     
-    var->name = strdup(name);
-    if (!var->name) {
-        fprintf(stderr, "Error: Failed to allocate memory for variable name\n");
-        free(var);
+    return &vars[pos];
+}
+
+/**
+ * Allocate an empty slot array
+ * 
+ * @param capacity Number of slots (a power of two)
+ * @return Pointer to the slots, or NULL on error
+ */
+static context_var_t *context_vars_alloc(int capacity) {
+    context_var_t *vars = malloc((size_t)capacity * sizeof(context_var_t));
+    if (!vars) {
+        fprintf(stderr, "Error: Failed to allocate memory for variables\n");
         return NULL;
     }
     
-    var->value = strdup(value);
-    if (!var->value) {
-        fprintf(stderr, "Error: Failed to allocate memory for variable value\n");
-        free(var->name);
-        free(var);
-        return NULL;
+    for (int i = 0; i < capacity; i++) {
+        vars[i].key = -1;
+        vars[i].value = NULL;
+        vars[i].typed = NULL;
+    }
+    
+    return vars;
+}
+
+/**
+ * Make room for at least count variables without exceeding the load factor
+ * 
+ * @param context Pointer to the context
+ * @param count Number of variables to make room for
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int context_reserve(context_t *context, int count) {
+    int capacity = context->var_capacity ? context->var_capacity : CONTEXT_MIN_VARS;
+    while (count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    if (capacity == context->var_capacity) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    context_var_t *vars = context_vars_alloc(capacity);
+    if (!vars) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // Values move over as they are; only the slots change
+    for (int i = 0; i < context->var_capacity; i++) {
+        if (context->vars[i].key >= 0) {
+            *context_slot(vars, capacity, context->vars[i].key) = context->vars[i];
+        }
     }
     
-    var->next = NULL;
+    free(context->vars);
+    context->vars = vars;
+    context->var_capacity = capacity;
     
-    return var;
+    return ANCIBLE_SUCCESS;
 }
 
 /**
- * Free a variable
+ * Index a variable list the parser did not index (plays built by hand)
  * 
- * @param var Pointer to variable to free
+ * @param context Pointer to the context owning the index
+ * @param slot Owned slot to use
+ * @param list Variable list
+ * @return Index, or NULL if the list is empty or on error
  */
-static void variable_free(variable_t *var) {
-    if (!var) {
-        return;
+static const scope_t *context_own_scope(context_t *context, int slot, const variable_t *list) {
+    if (!list) {
+        return NULL;
     }
     
-    free(var->name);
-    free(var->value);
-    free(var);
+    context->owned[slot] = scope_extend(NULL, list);
+    return context->owned[slot];
 }
 
 /**
  * Create a new execution context
  * 
+ * Nothing is copied: the context borrows the play's and the inventory's
+ * shared indexes and starts with an empty overlay.
+ * 
  * @param host Host to execute on
- * @param playbook Playbook to execute
+ * @param play Play being executed (its vars are visible through the context)
  * @param verbose Whether to be verbose
  * @return Pointer to the new context, or NULL on error
  */
-context_t *context_create(host_t *host, playbook_t *playbook, int verbose) {
-    if (!host || !playbook) {
-        fprintf(stderr, "Error: Host and playbook are required for context\n");
+context_t *context_create(host_t *host, play_t *play, int verbose) {
+    if (!host || !play) {
+        fprintf(stderr, "Error: Host and play are required for context\n");
         return NULL;
     }
     
-    context_t *context = malloc(sizeof(context_t));
+    context_t *context = calloc(1, sizeof(context_t));
     if (!context) {
         fprintf(stderr, "Error: Failed to allocate memory for context\n");
         return NULL;
     }
     
     context->host = host;
-    context->playbook = playbook;
-    context->vars = NULL;
+    context->play = play;
     context->verbose = verbose;
     
-    // Set default variables
-    context_set_var(context, "ansible_host", host->ansible_host ? host->ansible_host : host->name);
+    context->play_vars = play->var_scope ? play->var_scope : context_own_scope(context, 0, play->vars);
+    context->defaults = play->default_scope ? play->default_scope : context_own_scope(context, 1, play->defaults);
+    context->group_vars = host->group_scope;
+    if (!context->group_vars && host->var_count > 0) {
+        context->owned[2] = scope_create(host->vars, host->var_count);
+        context->group_vars = context->owned[2];
+    }
     
-    // Default connection type is ssh
-    context_set_var(context, "ansible_connection", "ssh");
+    if ((play->vars && !context->play_vars) || (play->defaults && !context->defaults) ||
+        (host->var_count > 0 && !context->group_vars)) {
+        context_free(context);
+        return NULL;
+    }
     
     return context;
 }
 
+/**
+ * Copy a context, with its own copy of the overlay
+ * 
+ * Used to give each worker of a parallel loop its own "item" variable.
+ * The copy borrows the original's layers, so it must not outlive it.
+ * 
+ * @param context Context to copy
+ * @return Pointer to the new context, or NULL on error
+ */
+context_t *context_clone(const context_t *context) {
+    if (!context) {
+        return NULL;
+    }
+    
+    context_t *clone = malloc(sizeof(context_t));
+    if (!clone) {
+        fprintf(stderr, "Error: Failed to allocate memory for context\n");
+        return NULL;
+    }
+    
+    *clone = *context;
+    memset(clone->owned, 0, sizeof(clone->owned));
+    clone->vars = NULL;
+    clone->var_count = 0;
+    clone->var_capacity = 0;
+    memset(&clone->render, 0, sizeof(clone->render));
+    memset(&clone->arena, 0, sizeof(clone->arena));
+    clone->results = NULL;
+    clone->result_count = 0;
+    clone->result_capacity = 0;
+    clone->parent = context;
+    clone->eligible = NULL;
+    
+    if (!context->var_capacity) {
+        return clone;
+    }
+    
+    // Same capacity, so every variable lands in the same slot
+    clone->vars = context_vars_alloc(context->var_capacity);
+    if (!clone->vars) {
+        free(clone);
+        return NULL;
+    }
+    clone->var_capacity = context->var_capacity;
+    
+    for (int i = 0; i < context->var_capacity; i++) {
+        if (context->vars[i].key < 0) {
+            continue;
+        }
+        
+        // Typed values stay in the original's arena, which outlives the copy
+        // A slot whose variable was taken out is copied empty (context_take_var)
+        const char *value = context->vars[i].value;
+        clone->vars[i].typed = context->vars[i].typed;
+        clone->vars[i].value = clone->vars[i].typed || !value ? (char *)value : strdup(value);
+        if (value && !clone->vars[i].value) {
+            fprintf(stderr, "Error: Failed to allocate memory for variable value\n");
+            context_free(clone);
+            return NULL;
+        }
+        clone->vars[i].key = context->vars[i].key;
+        clone->var_count++;
+    }
+    
+    return clone;
+}
+
+/**
+ * Free the buffers held by a registered result
+ * 
+ * @param result Registered result
+ */
+static void registered_free(registered_t *result) {
+    free(result->msg);
+    free(result->stdout_data);
+    free(result->stderr_data);
+    free(result->lines);
+}
+
 /**
  * Free resources used by a context
  * 
@@ -97,63 +240,256 @@ void context_free(context_t *context) {
         return;
     }
     
-    // Free variables
-    variable_t *var = context->vars;
-    while (var) {
-        variable_t *next = var->next;
-        variable_free(var);
-        var = next;
+    // Free the overlay, the registered results, the render buffer and the indexes the context built itself
+    for (int i = 0; i < context->var_capacity; i++) {
+        if (!context->vars[i].typed) {
+            free(context->vars[i].value);
+        }
+    }
+    free(context->vars);
+    arena_free(&context->arena);
+    for (int i = 0; i < context->result_count; i++) {
+        registered_free(&context->results[i]);
+    }
+    free(context->results);
+    free(context->render.data);
+    free(context->render.scratch);
+    for (size_t i = 0; i < sizeof(context->owned) / sizeof(context->owned[0]); i++) {
+        scope_release(context->owned[i]);
     }
     
-    // We don't free host or playbook, as they are owned by the inventory and parser
+    // We don't free host or play, as they are owned by the inventory and parser
     
     free(context);
 }
 
 /**
- * Set a variable in the context
+ * Set a variable in the context by symbol ID
  * 
  * @param context Pointer to the context
- * @param name Variable name
+ * @param key Symbol ID of the name (see symbol.h)
  * @param value Variable value
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
-int context_set_var(context_t *context, const char *name, const char *value) {
-    if (!context || !name || !value) {
+int context_set_var_id(context_t *context, int key, const char *value) {
+    if (!context || key < 0 || !value) {
         return ANCIBLE_ERROR;
     }
     
-    // Check if variable already exists
-    variable_t *var = context->vars;
-    while (var) {
-        if (strcmp(var->name, name) == 0) {
-            // Update existing variable
-            char *new_value = strdup(value);
-            if (!new_value) {
-                fprintf(stderr, "Error: Failed to allocate memory for variable value\n");
-                return ANCIBLE_ERROR;
-            }
-            
-            free(var->value);
-            var->value = new_value;
-            return ANCIBLE_SUCCESS;
-        }
-        var = var->next;
+    if (context_reserve(context, context->var_count + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
     }
     
-    // Create new variable
-    variable_t *new_var = variable_create(name, value);
-    if (!new_var) {
+    char *new_value = strdup(value);
+    if (!new_value) {
+        fprintf(stderr, "Error: Failed to allocate memory for variable value\n");
         return ANCIBLE_ERROR;
     }
     
-    // Add to the beginning of the list
-    new_var->next = context->vars;
-    context->vars = new_var;
+    context_var_t *slot = context_slot(context->vars, context->var_capacity, key);
+    if (slot->key < 0) {
+        slot->key = key;
+        context->var_count++;
+    }
+    if (!slot->typed) {
+        free(slot->value);
+    }
+    slot->value = new_value;
+    slot->typed = NULL;
     
     return ANCIBLE_SUCCESS;
 }
 
+/**
+ * Set a typed variable in the context's overlay by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param value Value, built in the context's arena (or living as long as the context)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int context_set_value_id(context_t *context, int key, const value_t *value) {
+    if (!context || key < 0 || !value) {
+        return ANCIBLE_ERROR;
+    }
+    
+    if (context_reserve(context, context->var_count + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // The text is the value's own, so nothing is copied
+    context_var_t *slot = context_slot(context->vars, context->var_capacity, key);
+    if (slot->key < 0) {
+        slot->key = key;
+        context->var_count++;
+    }
+    if (!slot->typed) {
+        free(slot->value);
+    }
+    slot->value = (char *)value->text;
+    slot->typed = value;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Take a variable out of the context's overlay, to be put back later
+ * 
+ * The slot keeps its key with no value, so the names probed past it are
+ * still found.
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param saved Pointer to receive the variable (its value is NULL if the overlay had none)
+ */
+void context_take_var(context_t *context, int key, context_var_t *saved) {
+    saved->key = key;
+    saved->value = NULL;
+    saved->typed = NULL;
+    if (!context || key < 0 || !context->var_capacity) {
+        return;
+    }
+    
+    context_var_t *slot = context_slot(context->vars, context->var_capacity, key);
+    if (slot->key == key) {
+        *saved = *slot;
+        slot->value = NULL;
+        slot->typed = NULL;
+    }
+}
+
+/**
+ * Put back a variable taken out with context_take_var
+ * 
+ * @param context Pointer to the context
+ * @param saved Variable taken out
+ */
+void context_restore_var(context_t *context, const context_var_t *saved) {
+    if (!context || saved->key < 0 || !context->var_capacity) {
+        return;
+    }
+    
+    // A value the overlay had was taken from its slot, so the slot is still there
+    context_var_t *slot = context_slot(context->vars, context->var_capacity, saved->key);
+    if (slot->key != saved->key) {
+        return;
+    }
+    if (!slot->typed) {
+        free(slot->value);
+    }
+    slot->value = saved->value;
+    slot->typed = saved->typed;
+}
+
+/**
+ * Find a variable through the layers of a context, with its typed value
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param typed Pointer to receive the typed value of the variable found (NULL for plain text)
+ * @return Variable value, or NULL if not found
+ */
+const char *context_lookup_id(const context_t *context, int key, const value_t **typed) {
+    *typed = NULL;
+    if (!context || key < 0) {
+        return NULL;
+    }
+    
+    const variable_t *var = scope_find(context->extra_vars, key);
+    if (var) {
+        *typed = var->typed;
+        return var->value;
+    }
+    
+    if (context->var_capacity) {
+        const context_var_t *slot = context_slot(context->vars, context->var_capacity, key);
+        if (slot->value) {
+            *typed = slot->typed;
+            return slot->value;
+        }
+    }
+    
+    // A registered result shadows task, play and host variables of its name;
+    // read on its own, it stands for its output
+    const registered_t *result = context_get_result(context, key);
+    if (result) {
+        return result->stdout_data ? result->stdout_data : "";
+    }
+    
+    if ((var = scope_find(context->task ? context->task->var_scope : NULL, key)) ||
+        (var = scope_find(context->play_vars, key))) {
+        *typed = var->typed;
+        return var->value;
+    }
+    
+    // Host variables; an ansible_host set directly on the host beats any group value
+    const host_t *host = context->host;
+    if (key == SYMBOL_ANSIBLE_HOST && host->ansible_host) {
+        return host->ansible_host;
+    }
+    for (int i = 0; host->host_vars && i < host->host_vars->count; i++) {
+        if (host->host_vars->entries[i].key == key) {
+            return host->host_vars->entries[i].value;
+        }
+    }
+    
+    if ((var = scope_find(context->group_vars, key)) || (var = scope_find(context->defaults, key))) {
+        *typed = var->typed;
+        return var->value;
+    }
+    
+    // Built-in defaults: connect over ssh, to the host's own name
+    if (key == SYMBOL_ANSIBLE_CONNECTION) {
+        return "ssh";
+    }
+    if (key == SYMBOL_ANSIBLE_HOST || key == SYMBOL_INVENTORY_HOSTNAME) {
+        return host->name;
+    }
+    
+    return NULL;
+}
+
+/**
+ * Get a variable from the context by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Variable value, or NULL if not found
+ */
+const char *context_get_var_id(const context_t *context, int key) {
+    const value_t *typed;
+    return context_lookup_id(context, key, &typed);
+}
+
+/**
+ * Get the typed value of a variable by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Typed value, or NULL if the variable is not set or only has text
+ */
+const value_t *context_get_value_id(const context_t *context, int key) {
+    const value_t *typed;
+    context_lookup_id(context, key, &typed);
+    return typed;
+}
+
+/**
+ * Set a variable in the context
+ * 
+ * @param context Pointer to the context
+ * @param name Variable name
+ * @param value Variable value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int context_set_var(context_t *context, const char *name, const char *value) {
+    if (!context || !name || !value) {
+        return ANCIBLE_ERROR;
+    }
+    
+    return context_set_var_id(context, symbol_intern(name), value);
+}
+
 /**
  * Get a variable from the context
  * 
@@ -166,17 +502,152 @@ const char *context_get_var(context_t *context, const char *name) {
         return NULL;
     }
     
-    variable_t *var = context->vars;
-    while (var) {
-        if (strcmp(var->name, name) == 0) {
-            return var->value;
+    // A name that was never interned cannot be set anywhere
+    return context_get_var_id(context, symbol_find(name));
+}
+
+/**
+ * Cut the trailing newline off an output buffer
+ * 
+ * @param data Output (may be NULL)
+ * @return Length of the output
+ */
+static size_t output_trim(char *data) {
+    size_t length = data ? strlen(data) : 0;
+    
+    if (length > 0 && data[length - 1] == '\n') {
+        data[--length] = '\0';
+        if (length > 0 && data[length - 1] == '\r') {
+            data[--length] = '\0';
+        }
+    }
+    
+    return length;
+}
+
+/**
+ * Register a task result under a name, replacing any result of the same name
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param result Result to register (its key is set)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (the buffers then stay with the caller)
+ */
+int context_register(context_t *context, int key, const registered_t *result) {
+    if (!context || key < 0 || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // A handful of names per play, so a plain array does
+    registered_t *slot = NULL;
+    for (int i = 0; i < context->result_count && !slot; i++) {
+        if (context->results[i].key == key) {
+            slot = &context->results[i];
+        }
+    }
+    
+    if (!slot) {
+        if (context->result_count == context->result_capacity) {
+            int capacity = context->result_capacity ? context->result_capacity * 2 : 4;
+            registered_t *results = realloc(context->results, (size_t)capacity * sizeof(registered_t));
+            if (!results) {
+                fprintf(stderr, "Error: Failed to allocate memory for registered result\n");
+                return ANCIBLE_ERROR;
+            }
+            context->results = results;
+            context->result_capacity = capacity;
+        }
+        slot = &context->results[context->result_count++];
+    } else {
+        registered_free(slot);
+    }
+    
+    *slot = *result;
+    slot->key = key;
+    slot->stdout_length = output_trim(slot->stdout_data);
+    output_trim(slot->stderr_data);
+    slot->line_count = -1;
+    slot->lines = NULL;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Get a registered result
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Result, or NULL if nothing was registered under the name
+ */
+registered_t *context_get_result(const context_t *context, int key) {
+    // A copy sees what the context it was cloned from registered
+    for (; context; context = context->parent) {
+        for (int i = 0; i < context->result_count; i++) {
+            if (context->results[i].key == key) {
+                return &context->results[i];
+            }
         }
-        var = var->next;
     }
     
     return NULL;
 }
 
+/**
+ * Index the lines of a registered result's standard output, on first use
+ * 
+ * @param result Registered result
+ * @return Number of lines (see registered_t.lines), or -1 on error
+ */
+int context_result_lines(registered_t *result) {
+    if (!result) {
+        return -1;
+    }
+    
+    // Workers of a parallel loop share the results of their host
+    pthread_mutex_lock(&lines_lock);
+    if (result->line_count < 0) {
+        int count = 0;
+        for (size_t i = 0; i < result->stdout_length; i++) {
+            count += result->stdout_data[i] == '\n';
+        }
+        count += result->stdout_length > 0;
+        
+        result->lines = malloc((size_t)(count + 1) * sizeof(size_t));
+        if (result->lines) {
+            int line = 0;
+            result->lines[line++] = 0;
+            for (size_t i = 0; i < result->stdout_length && line < count; i++) {
+                if (result->stdout_data[i] == '\n') {
+                    result->lines[line++] = i + 1;
+                }
+            }
+            result->lines[count] = result->stdout_length + 1;
+            result->line_count = count;
+        } else {
+            fprintf(stderr, "Error: Failed to allocate memory for line index\n");
+        }
+    }
+    int count = result->line_count;
+    pthread_mutex_unlock(&lines_lock);
+    
+    return count;
+}
+
+/**
+ * Print the variables of a layer that are not hidden by a higher one
+ * 
+ * @param context Pointer to the context
+ * @param scope Layer (may be NULL)
+ */
+static void context_print_scope(const context_t *context, const scope_t *scope) {
+    for (int i = 0; scope && i < scope->capacity; i++) {
+        const struct scope_slot *slot = &scope->slots[i];
+        if (slot->key >= 0 && context_get_var_id(context, slot->key) == slot->var->value) {
+            printf("    %s: %s\n", slot->var->name, slot->var->value);
+        }
+    }
+}
+
 /**
  * Print context (for debugging)
  * 
@@ -194,9 +665,20 @@ void context_print(const context_t *context) {
     }
     
     printf("  Variables:\n");
-    variable_t *var = context->vars;
-    while (var) {
-        printf("    %s: %s\n", var->name, var->value);
-        var = var->next;
+    context_print_scope(context, context->extra_vars);
+    for (int i = 0; i < context->var_capacity; i++) {
+        if (context->vars[i].value && context_get_var_id(context, context->vars[i].key) == context->vars[i].value) {
+            printf("    %s: %s\n", symbol_name(context->vars[i].key), context->vars[i].value);
+        }
+    }
+    context_print_scope(context, context->task ? context->task->var_scope : NULL);
+    context_print_scope(context, context->play_vars);
+    const var_table_t *table = context->host->host_vars;
+    for (int i = 0; table && i < table->count; i++) {
+        if (context_get_var_id(context, table->entries[i].key) == table->entries[i].value) {
+            printf("    %s: %s\n", symbol_name(table->entries[i].key), table->entries[i].value);
+        }
     }
+    context_print_scope(context, context->group_vars);
+    context_print_scope(context, context->defaults);
 }
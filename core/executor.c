@@ -1,17 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "../include/ancible.h"
 #include "../include/core/executor.h"
 #include "../include/core/condition.h"
 #include "../include/modules/command.h"
+#include "../include/modules/add_host.h"
+#include "../include/modules/group_by.h"
+#include "../include/modules/set_fact.h"
+#include "../include/core/yaml.h"
 
 #define MAX_MODULES 32
+#define DEFAULT_HOST_CONCURRENCY 10   // OpenSSH's default MaxSessions per connection
 
 // Module registry
 static module_registry_entry_t registry[MAX_MODULES];
 static int registry_count = 0;
 
+static int run_module(context_t *context, int task_idx, const template_t *args, module_result_t *result);
+
 /**
  * Initialize the module registry
  * 
@@ -22,12 +30,26 @@ int executor_init(void) {
     memset(registry, 0, sizeof(registry));
     registry_count = 0;
     
-    // Register built-in modules
-    if (executor_register_module("command", command_module_exec) != ANCIBLE_SUCCESS) {
+    // Register built-in modules (commands always run through a shell)
+    if (executor_register_module("command", command_module_exec) != ANCIBLE_SUCCESS ||
+        executor_register_module("shell", command_module_exec) != ANCIBLE_SUCCESS) {
         fprintf(stderr, "Error: Failed to register command module\n");
         return ANCIBLE_ERROR;
     }
     
+    // Inventory modules change the inventory for the plays that follow
+    if (executor_register_module("add_host", add_host_module_exec) != ANCIBLE_SUCCESS ||
+        executor_register_module("group_by", group_by_module_exec) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to register inventory modules\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    // Facts are set on the host's context, for the rest of the play
+    if (executor_register_module("set_fact", set_fact_module_exec) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to register set_fact module\n");
+        return ANCIBLE_ERROR;
+    }
+    
     return ANCIBLE_SUCCESS;
 }
 
@@ -70,12 +92,48 @@ int executor_register_module(const char *name, module_func_t func) {
     return ANCIBLE_SUCCESS;
 }
 
+/**
+ * Register the result of a task under its register name
+ * 
+ * The output buffers move to the context; the result keeps pointing at
+ * them, so it can still be printed, but no longer frees them.
+ * 
+ * @param context Execution context
+ * @param task Task that ran
+ * @param ret Return code of the task
+ * @param result Result of the task
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int register_result(context_t *context, const task_t *task, int ret, module_result_t *result) {
+    registered_t registered;
+    memset(&registered, 0, sizeof(registered));
+    
+    registered.changed = result->changed;
+    registered.failed = result->failed || ret != ANCIBLE_SUCCESS;
+    registered.skipped = result->skipped;
+    registered.msg = result->msg ? strdup(result->msg) : NULL;
+    registered.stdout_data = result->cmd_result.stdout_data;
+    registered.stderr_data = result->cmd_result.stderr_data;
+    if (registered.stdout_data || registered.stderr_data) {
+        snprintf(registered.rc, sizeof(registered.rc), "%d", result->cmd_result.exit_code);
+    }
+    
+    if ((result->msg && !registered.msg) || context_register(context, task->register_key, &registered) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to register the result of task '%s'\n", task->name ? task->name : "unnamed");
+        free(registered.msg);
+        return ANCIBLE_ERROR;
+    }
+    result->registered = 1;
+    
+    return ANCIBLE_SUCCESS;
+}
+
 /**
  * Execute a task
  * 
  * @param context Execution context
  * @param task_idx Task index
- * @param args Task arguments
+ * @param args Task arguments (NULL to use the task's own arguments)
  * @param result Pointer to result structure to fill
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
@@ -85,71 +143,589 @@ int executor_run_task(context_t *context, int task_idx, const char *args, module
     }
     
     // Get task from context
-    if (task_idx < 0 || task_idx >= context->playbook->task_count) {
+    if (task_idx < 0 || task_idx >= context->play->task_count) {
         fprintf(stderr, "Error: Invalid task index %d\n", task_idx);
         return ANCIBLE_ERROR;
     }
     
-    task_t *task = &context->playbook->tasks[task_idx];
+    task_t *task = &context->play->tasks[task_idx];
+    
+    // The task's variables (and its blocks') apply while it runs
+    const task_t *outer = context->task;
+    context->task = task;
     
-    // Handle different task types
+    int ret;
     if (task->type == TASK_TYPE_BLOCK) {
-        return executor_run_block(context, task_idx, args, result);
+        ret = executor_run_block(context, task_idx, args, result);
+    } else if (task->type == TASK_TYPE_INCLUDE && !task->loop_items && !task->loop_var) {
+        ret = executor_run_include(context, task_idx, result);
     } else if (task->type == TASK_TYPE_RESCUE || task->type == TASK_TYPE_ALWAYS) {
         // These should be handled by executor_run_block, not called directly
         fprintf(stderr, "Error: Rescue and Always blocks should not be executed directly\n");
-        return ANCIBLE_ERROR;
+        ret = ANCIBLE_ERROR;
+    } else if (task->loop_items || task->loop_var) {
+        // Loops run the task once per item
+        ret = executor_run_loop(context, task_idx, args, result);
+    } else {
+        // Explicit arguments override the task's own
+        template_t *own = args ? template_compile(args) : NULL;
+        ret = args && !own ? ANCIBLE_ERROR : run_module(context, task_idx, own, result);
+        template_free(own);
+    }
+    
+    context->task = outer;
+    if (context->eligible == task) {
+        context->eligible = NULL;
+    }
+    
+    if (task->register_var && task->type != TASK_TYPE_BLOCK) {
+        register_result(context, task, ret, result);
+    }
+    
+    return ret;
+}
+
+/**
+ * Find a module in the registry
+ * 
+ * @param name Module name
+ * @return Module function, or NULL if not registered
+ */
+static module_func_t find_module(const char *name) {
+    for (int i = 0; i < registry_count; i++) {
+        if (strcmp(registry[i].name, name) == 0) {
+            return registry[i].func;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Mark a task, block or include skipped because its condition does not hold
+ * 
+ * @param context Execution context
+ * @param task Task
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS
+ */
+static int skip_result(context_t *context, const task_t *task, module_result_t *result) {
+    if (context->verbose) {
+        const char *kind = task->type == TASK_TYPE_BLOCK ? "block" :
+                           task->type == TASK_TYPE_INCLUDE ? "include" : "task";
+        const char *name = task->name ? task->name :
+                           task->type == TASK_TYPE_INCLUDE ? task->args : "unnamed";
+        printf("Skipping %s '%s' due to condition: %s\n", kind, name, task->when);
     }
     
-    // This is a normal task, proceed with execution
+    result->changed = 0;
+    result->failed = 0;
+    result->skipped = 1;
+    result->msg = strdup("Skipped due to condition");
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Evaluate the when condition of a task, block or include for the context's host
+ * 
+ * Conditions folded for the play, or found to hold on the host by
+ * executor_batch_condition, are not evaluated again. Compiled
+ * conditions are evaluated in place; any other condition is rendered
+ * first, so it may hold {{ }} references, and parsed as text.
+ * 
+ * @param context Execution context
+ * @param task Task
+ * @return 1 if the condition holds (or there is none), 0 if not, -1 on error
+ */
+static int task_condition(context_t *context, const task_t *task) {
+    if (!task->when || task->when_static == TASK_WHEN_ALWAYS) {
+        return 1;
+    }
+    if (task->when_static == TASK_WHEN_NEVER) {
+        return 0;
+    }
+    if (task == context->eligible) {
+        return 1;
+    }
+    if (task->condition) {
+        return condition_eval(task->condition, context);
+    }
+    
+    // Tasks built by hand have no compiled condition
+    const char *when = task->when_template ?
+                       template_render(task->when_template, context, &context->render) : task->when;
+    if (!when) {
+        fprintf(stderr, "Error: %s in condition: %s\n",
+                context->render.data ? context->render.data : "Failed to render template", task->when);
+        return -1;
+    }
+    
+    return condition_evaluate(context, when);
+}
+
+/**
+ * Render the module arguments of a task for the context's host
+ * 
+ * @param context Execution context
+ * @param task Task
+ * @param args Compiled arguments given by the caller (NULL to use the task's own)
+ * @param result Pointer to result structure, marked failed on error
+ * @return Rendered arguments (NULL if there are none, or on error)
+ */
+static const char *render_args(context_t *context, const task_t *task, const template_t *args,
+                               module_result_t *result) {
+    const template_t *template = args ? args : task->args_template;
+    if (!template) {
+        return task->args;
+    }
+    
+    const char *text = template_render(template, context, &context->render);
+    if (!text) {
+        result->failed = 1;
+        result->msg = strdup(context->render.data ? context->render.data : "Failed to render arguments");
+        fprintf(stderr, "Error: %s in arguments of task '%s'\n",
+                result->msg ? result->msg : "Failed to render arguments", task->name ? task->name : "unnamed");
+    }
+    
+    return text;
+}
+
+/**
+ * Check a task's when condition and run its module
+ * 
+ * @param context Execution context
+ * @param task_idx Task index
+ * @param args Compiled module arguments (NULL to use the task's own)
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int run_module(context_t *context, int task_idx, const template_t *args, module_result_t *result) {
+    task_t *task = &context->play->tasks[task_idx];
     
     // Check if this task has a when condition
     if (task->when) {
-        int condition_result = condition_evaluate(context, task->when);
+        int condition_result = task_condition(context, task);
         
         // If condition is false, skip this task
         if (condition_result == 0) {
-            if (context->verbose) {
-                printf("Skipping task '%s' due to condition: %s\n", 
-                       task->name ? task->name : "unnamed",
-                       task->when);
-            }
-            
-            // Set result to indicate skipped task
-            result->changed = 0;
-            result->failed = 0;
-            result->skipped = 1;
-            result->msg = strdup("Skipped due to condition");
-            
-            return ANCIBLE_SUCCESS;
+            return skip_result(context, task, result);
         } else if (condition_result < 0) {
             fprintf(stderr, "Error: Failed to evaluate condition: %s\n", task->when);
             return ANCIBLE_ERROR;
         }
     }
     
-    task->module = context->playbook->tasks[task_idx].module;
     if (!task->module) {
         fprintf(stderr, "Error: No module specified for task %d - %s\n", task_idx, task->name ? task->name : "unnamed");
         return ANCIBLE_ERROR;
     }
     
     // Find module in registry
-    module_func_t module_func = NULL;
-    for (int i = 0; i < registry_count; i++) {
-        if (strcmp(registry[i].name, task->module) == 0) {
-            module_func = registry[i].func;
+    module_func_t module_func = find_module(task->module);
+    if (!module_func) {
+        fprintf(stderr, "Error: Module '%s' not found\n", task->module);
+        return ANCIBLE_ERROR;
+    }
+    
+    // Render the arguments for this host, then execute the module
+    const char *text = render_args(context, task, args, result);
+    if (!text && (args || task->args_template)) {
+        return ANCIBLE_ERROR;
+    }
+    
+    return module_func(context, text, result);
+}
+
+/**
+ * Resolve the items of a loop task
+ * 
+ * Literal items are used in place, and so are the items of a typed list
+ * (set_fact, -e); a loop over any other variable parses the variable's
+ * value (a flow-style list) into newly allocated items.
+ * 
+ * @param context Execution context
+ * @param task Loop task
+ * @param count Pointer to receive the number of items
+ * @param owned Pointer set to 1 when the items must be freed by the caller, 2 when only the array must
+ * @return Item array, or NULL on error (or when there are no items)
+ */
+static char **loop_resolve(context_t *context, const task_t *task, int *count, int *owned) {
+    *count = 0;
+    *owned = 0;
+    
+    if (task->loop_items) {
+        *count = task->loop_count;
+        return task->loop_items;
+    }
+    
+    const value_t *typed = NULL;
+    int key = symbol_find(task->loop_var);
+    const char *value = key >= 0 ? context_lookup_id(context, key, &typed) : NULL;
+    if (typed && typed->type == VALUE_LIST) {
+        char **items = calloc(typed->count > 0 ? (size_t)typed->count : 1, sizeof(char *));
+        if (!items) {
+            fprintf(stderr, "Error: Failed to allocate memory for loop items\n");
+            *count = -1;
+            return NULL;
+        }
+        for (int i = 0; i < typed->count; i++) {
+            items[i] = (char *)typed->items[i].text;
+        }
+        *count = typed->count;
+        *owned = 2;
+        return items;
+    }
+    
+    if (!value) {
+        fprintf(stderr, "Error: Loop variable '%s' is not defined\n", task->loop_var);
+        *count = -1;
+        return NULL;
+    }
+    
+    yaml_node_t *list = yaml_parse_string(value, task->loop_var);
+    if (!list || (list->type != YAML_SEQ && !(list->type == YAML_SCALAR && value[0] == '\0'))) {
+        fprintf(stderr, "Error: Loop variable '%s' is not a list\n", task->loop_var);
+        yaml_free(list);
+        *count = -1;
+        return NULL;
+    }
+    
+    char **items = calloc(list->child_count > 0 ? (size_t)list->child_count : 1, sizeof(char *));
+    if (!items) {
+        fprintf(stderr, "Error: Failed to allocate memory for loop items\n");
+        yaml_free(list);
+        *count = -1;
+        return NULL;
+    }
+    
+    for (const yaml_node_t *item = list->children; item; item = item->next) {
+        items[*count] = yaml_node_text(item);
+        if (!items[*count]) {
+            fprintf(stderr, "Error: Failed to allocate memory for loop items\n");
             break;
         }
+        (*count)++;
     }
     
-    if (!module_func) {
-        fprintf(stderr, "Error: Module '%s' not found\n", task->module);
+    yaml_free(list);
+    *owned = 1;
+    return items;
+}
+
+/**
+ * Free the items of a loop, as loop_resolve handed them out
+ * 
+ * @param items Item array
+ * @param count Number of items
+ * @param owned Ownership reported by loop_resolve
+ */
+static void loop_items_free(char **items, int count, int owned) {
+    for (int i = 0; owned == 1 && i < count; i++) {
+        free(items[i]);
+    }
+    if (owned) {
+        free(items);
+    }
+}
+
+/**
+ * Run every item of a command loop in one round trip
+ * 
+ * Items whose when condition is false are skipped up front; the rest are
+ * sent to the host as a single batch.
+ * 
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int run_loop_batch(context_t *context, task_t *task, char **items, int count,
+                          const template_t *args, module_result_t *results) {
+    char **item_args = calloc((size_t)count, sizeof(char *));
+    int *slots = calloc((size_t)count, sizeof(int));
+    module_result_t *batch = calloc((size_t)count, sizeof(module_result_t));
+    int batched = 0;
+    int ret = ANCIBLE_SUCCESS;
+    
+    if (!item_args || !slots || !batch) {
+        fprintf(stderr, "Error: Failed to allocate memory for loop batch\n");
+        free(item_args);
+        free(slots);
+        free(batch);
         return ANCIBLE_ERROR;
     }
     
-    // Execute module
-    return module_func(context, args, result);
+    for (int i = 0; i < count; i++) {
+        context_set_var_id(context, SYMBOL_ITEM, items[i]);
+        
+        int condition_result = task_condition(context, task);
+        if (condition_result == 0) {
+            results[i].skipped = 1;
+            results[i].msg = strdup("Skipped due to condition");
+        } else if (condition_result < 0) {
+            fprintf(stderr, "Error: Failed to evaluate condition: %s\n", task->when);
+            results[i].failed = 1;
+            ret = ANCIBLE_ERROR;
+        } else {
+            // The batch needs every item's arguments at once, so each is copied out of the buffer
+            const char *text = render_args(context, task, args, &results[i]);
+            if (text && !(item_args[batched] = strdup(text))) {
+                fprintf(stderr, "Error: Failed to allocate memory for loop arguments\n");
+                results[i].failed = 1;
+            }
+            if (item_args[batched]) {
+                slots[batched++] = i;
+            } else {
+                ret = ANCIBLE_ERROR;
+            }
+        }
+    }
+    
+    // An item that failed above does not take the ones that ran down with it
+    int sent = batched > 0 ? command_module_exec_batch(context, (const char **)item_args, batched, batch) :
+               ANCIBLE_SUCCESS;
+    
+    for (int j = 0; j < batched; j++) {
+        results[slots[j]] = batch[j];
+        if (sent != ANCIBLE_SUCCESS) {
+            results[slots[j]].failed = 1;
+        }
+        free(item_args[j]);
+    }
+    
+    if (sent != ANCIBLE_SUCCESS) {
+        ret = ANCIBLE_ERROR;
+    }
+    
+    free(item_args);
+    free(slots);
+    free(batch);
+    
+    return ret;
+}
+
+/**
+ * Run one item of a loop task
+ * 
+ * @param context Execution context (its "item" variable is set)
+ * @param task_idx Task index
+ * @param args Compiled arguments (NULL to use the task's own)
+ * @param item Value of the item
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int run_loop_item(context_t *context, int task_idx, const template_t *args, const char *item,
+                         module_result_t *result) {
+    task_t *task = &context->play->tasks[task_idx];
+    int ret = ANCIBLE_ERROR;
+    
+    // Templates read the item like any other variable
+    if (context_set_var_id(context, SYMBOL_ITEM, item) == ANCIBLE_SUCCESS) {
+        ret = task->type == TASK_TYPE_INCLUDE ?
+              executor_run_include(context, task_idx, result) :
+              run_module(context, task_idx, args, result);
+    }
+    
+    if (ret != ANCIBLE_SUCCESS) {
+        result->failed = 1;
+    }
+    
+    return ret;
+}
+
+/**
+ * Structure shared by the workers of a parallel loop
+ */
+typedef struct {
+    context_t *context;       // Context of the host (each worker runs on a copy)
+    int task_idx;             // Loop task index
+    const template_t *args;   // Compiled arguments (NULL to use the task's own)
+    char **items;             // Loop items
+    int count;                // Number of items
+    module_result_t *results; // Per-item results, filled in item order
+    int next;                 // Next item to hand out
+    int ret;                  // ANCIBLE_ERROR once any item failed to run
+    pthread_mutex_t lock;     // Protects next and ret
+} loop_workers_t;
+
+/**
+ * Worker of a parallel loop: run items until none are left
+ */
+static void *loop_worker(void *arg) {
+    loop_workers_t *workers = arg;
+    context_t *context = context_clone(workers->context);
+    
+    for (;;) {
+        pthread_mutex_lock(&workers->lock);
+        int i = workers->next++;
+        pthread_mutex_unlock(&workers->lock);
+        
+        if (i >= workers->count) {
+            break;
+        }
+        
+        module_result_t *result = &workers->results[i];
+        if (!context ||
+            run_loop_item(context, workers->task_idx, workers->args, workers->items[i], result) != ANCIBLE_SUCCESS) {
+            result->failed = 1;
+            pthread_mutex_lock(&workers->lock);
+            workers->ret = ANCIBLE_ERROR;
+            pthread_mutex_unlock(&workers->lock);
+        }
+    }
+    
+    context_free(context);
+    return NULL;
+}
+
+/**
+ * Get the maximum number of commands run at once on the context's host
+ * 
+ * @return Value of ancible_host_concurrency, or DEFAULT_HOST_CONCURRENCY
+ */
+static int host_concurrency(context_t *context) {
+    const char *value = context_get_var_id(context, SYMBOL_ANCIBLE_HOST_CONCURRENCY);
+    int limit = value ? atoi(value) : 0;
+    return limit > 0 ? limit : DEFAULT_HOST_CONCURRENCY;
+}
+
+/**
+ * Run the items of a loop on several threads (loop_control.parallel)
+ * 
+ * The width is capped by the host's concurrency limit; the global fork
+ * limit is enforced by the runner for every command started.
+ * 
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int run_loop_parallel(context_t *context, int task_idx, const template_t *args, char **items, int count,
+                             module_result_t *results) {
+    task_t *task = &context->play->tasks[task_idx];
+    loop_workers_t workers = { context, task_idx, args, items, count, results, 0, ANCIBLE_SUCCESS,
+                               PTHREAD_MUTEX_INITIALIZER };
+    
+    int width = task->loop_parallel;
+    if (width > host_concurrency(context)) {
+        width = host_concurrency(context);
+    }
+    if (width > count) {
+        width = count;
+    }
+    
+    pthread_t *threads = calloc((size_t)width, sizeof(pthread_t));
+    int started = 0;
+    
+    // The calling thread is one of the workers
+    while (threads && started < width - 1 &&
+           pthread_create(&threads[started], NULL, loop_worker, &workers) == 0) {
+        started++;
+    }
+    loop_worker(&workers);
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&workers.lock);
+    
+    return workers.ret;
+}
+
+/**
+ * Execute a loop task, once per item
+ * 
+ * @param context Execution context
+ * @param task_idx Task index
+ * @param args Task arguments (NULL to use the task's own arguments)
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_run_loop(context_t *context, int task_idx, const char *args, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    if (task_idx < 0 || task_idx >= context->play->task_count) {
+        fprintf(stderr, "Error: Invalid task index %d\n", task_idx);
+        return ANCIBLE_ERROR;
+    }
+    
+    task_t *task = &context->play->tasks[task_idx];
+    
+    module_result_init(result);
+    
+    // Explicit arguments are compiled once for all items
+    template_t *template = args ? template_compile(args) : NULL;
+    if (args && !template) {
+        result->failed = 1;
+        result->msg = strdup("Invalid loop arguments");
+        return ANCIBLE_ERROR;
+    }
+    
+    int count;
+    int owned;
+    char **items = loop_resolve(context, task, &count, &owned);
+    if (count < 0) {
+        template_free(template);
+        result->failed = 1;
+        result->msg = strdup("Invalid loop data");
+        return ANCIBLE_ERROR;
+    }
+    
+    result->items = calloc(count > 0 ? (size_t)count : 1, sizeof(module_result_t));
+    if (!result->items) {
+        fprintf(stderr, "Error: Failed to allocate memory for loop results\n");
+        template_free(template);
+        loop_items_free(items, count, owned);
+        return ANCIBLE_ERROR;
+    }
+    result->item_count = count;
+    
+    // The item is only set while the loop runs; an enclosing loop's item comes back after it
+    context_var_t outer_item;
+    context_take_var(context, SYMBOL_ITEM, &outer_item);
+    int ret = ANCIBLE_SUCCESS;
+    
+    if (task->loop_batch && task->module &&
+        (strcmp(task->module, "command") == 0 || strcmp(task->module, "shell") == 0)) {
+        ret = run_loop_batch(context, task, items, count, template, result->items);
+    } else if (task->loop_parallel > 1 && count > 1) {
+        ret = run_loop_parallel(context, task_idx, template, items, count, result->items);
+    } else {
+        for (int i = 0; i < count; i++) {
+            if (run_loop_item(context, task_idx, template, items[i], &result->items[i]) != ANCIBLE_SUCCESS) {
+                ret = ANCIBLE_ERROR;
+            }
+        }
+    }
+    context_restore_var(context, &outer_item);
+    
+    // The module resets its result, so the item is recorded afterwards
+    int skipped = 0;
+    for (int i = 0; i < count; i++) {
+        module_result_t *item = &result->items[i];
+        item->item = strdup(items[i]);
+        
+        if (item->changed) {
+            result->changed = 1;
+        }
+        if (item->failed) {
+            result->failed = 1;
+        }
+        if (item->skipped) {
+            skipped++;
+        }
+    }
+    result->skipped = (skipped == count);
+    
+    if (result->failed) {
+        result->msg = strdup("One or more items failed");
+    } else if (count == 0) {
+        result->msg = strdup("No items in loop");
+    } else {
+        result->msg = strdup("All items completed");
+    }
+    
+    loop_items_free(items, count, owned);
+    template_free(template);
+    
+    return ret;
 }
 
 /**
@@ -168,12 +744,12 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     }
     
     // Get block task from context
-    if (block_idx < 0 || block_idx >= context->playbook->task_count) {
+    if (block_idx < 0 || block_idx >= context->play->task_count) {
         fprintf(stderr, "Error: Invalid block index %d\n", block_idx);
         return ANCIBLE_ERROR;
     }
     
-    task_t *block = &context->playbook->tasks[block_idx];
+    task_t *block = &context->play->tasks[block_idx];
     
     // Check if this is actually a block
     if (block->type != TASK_TYPE_BLOCK) {
@@ -183,23 +759,11 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     
     // Check if this block has a when condition
     if (block->when) {
-        int condition_result = condition_evaluate(context, block->when);
+        int condition_result = task_condition(context, block);
         
         // If condition is false, skip this block
         if (condition_result == 0) {
-            if (context->verbose) {
-                printf("Skipping block '%s' due to condition: %s\n", 
-                       block->name ? block->name : "unnamed",
-                       block->when);
-            }
-            
-            // Set result to indicate skipped block
-            result->changed = 0;
-            result->failed = 0;
-            result->skipped = 1;
-            result->msg = strdup("Skipped due to condition");
-            
-            return ANCIBLE_SUCCESS;
+            return skip_result(context, block, result);
         } else if (condition_result < 0) {
             fprintf(stderr, "Error: Failed to evaluate condition: %s\n", block->when);
             return ANCIBLE_ERROR;
@@ -214,8 +778,8 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     int rescue_idx = -1;
     int always_idx = -1;
     
-    for (int i = 0; i < context->playbook->task_count; i++) {
-        task_t *task = &context->playbook->tasks[i];
+    for (int i = 0; i < context->play->task_count; i++) {
+        task_t *task = &context->play->tasks[i];
         
         if (task->parent_idx == block_idx) {
             if (task->type == TASK_TYPE_RESCUE) {
@@ -230,27 +794,15 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     for (int i = 0; i < block->subtask_count; i++) {
         int subtask_idx = block->subtask_indices[i];
         module_result_t subtask_result;
+        if (context->play->tasks[subtask_idx].when_static == TASK_WHEN_NEVER) {
+            continue;
+        }
         
         // Initialize result
         module_result_init(&subtask_result);
         
-        // Extract command arguments for this subtask from the playbook file
-        char subtask_args[1024] = {0};
-        task_t *subtask = &context->playbook->tasks[subtask_idx];
-        
-        if (subtask->module && strcmp(subtask->module, "command") == 0) {
-            // For command module, we need to extract the actual command
-            // This is a simplified approach - in a real implementation, we'd parse the YAML properly
-            if (subtask->name) {
-                // For now, create a simple command based on the task name
-                snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing %s'", subtask->name);
-            } else {
-                snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing unnamed task'");
-            }
-        }
-        
-        // Execute subtask
-        int subtask_res = executor_run_task(context, subtask_idx, subtask_args, &subtask_result);
+        // Execute subtask with its own arguments
+        int subtask_res = executor_run_task(context, subtask_idx, NULL, &subtask_result);
         
         // Print subtask output in verbose mode
         if (context->verbose) {
@@ -281,7 +833,7 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     
     // Handle rescue block if there was a failure
     if (any_failed && rescue_idx >= 0) {
-        task_t *rescue = &context->playbook->tasks[rescue_idx];
+        task_t *rescue = &context->play->tasks[rescue_idx];
         
         if (context->verbose) {
             printf("Executing rescue block for '%s'\n", 
@@ -292,24 +844,15 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
         for (int i = 0; i < rescue->subtask_count; i++) {
             int subtask_idx = rescue->subtask_indices[i];
             module_result_t subtask_result;
+            if (context->play->tasks[subtask_idx].when_static == TASK_WHEN_NEVER) {
+                continue;
+            }
             
             // Initialize result
             module_result_init(&subtask_result);
             
-            // Extract command arguments for this subtask
-            char subtask_args[1024] = {0};
-            task_t *subtask = &context->playbook->tasks[subtask_idx];
-            
-            if (subtask->module && strcmp(subtask->module, "command") == 0) {
-                if (subtask->name) {
-                    snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing %s'", subtask->name);
-                } else {
-                    snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing unnamed task'");
-                }
-            }
-            
-            // Execute subtask
-            executor_run_task(context, subtask_idx, subtask_args, &subtask_result);
+            // Execute subtask with its own arguments
+            executor_run_task(context, subtask_idx, NULL, &subtask_result);
             
             // Print subtask output in verbose mode
             if (context->verbose) {
@@ -334,7 +877,7 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     
     // Handle always block if it exists
     if (always_idx >= 0) {
-        task_t *always = &context->playbook->tasks[always_idx];
+        task_t *always = &context->play->tasks[always_idx];
         
         if (context->verbose) {
             printf("Executing always block for '%s'\n", 
@@ -345,24 +888,15 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
         for (int i = 0; i < always->subtask_count; i++) {
             int subtask_idx = always->subtask_indices[i];
             module_result_t subtask_result;
+            if (context->play->tasks[subtask_idx].when_static == TASK_WHEN_NEVER) {
+                continue;
+            }
             
             // Initialize result
             module_result_init(&subtask_result);
             
-            // Extract command arguments for this subtask
-            char subtask_args[1024] = {0};
-            task_t *subtask = &context->playbook->tasks[subtask_idx];
-            
-            if (subtask->module && strcmp(subtask->module, "command") == 0) {
-                if (subtask->name) {
-                    snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing %s'", subtask->name);
-                } else {
-                    snprintf(subtask_args, sizeof(subtask_args), "echo 'Executing unnamed task'");
-                }
-            }
-            
-            // Execute subtask
-            executor_run_task(context, subtask_idx, subtask_args, &subtask_result);
+            // Execute subtask with its own arguments
+            executor_run_task(context, subtask_idx, NULL, &subtask_result);
             
             // Print subtask output in verbose mode
             if (context->verbose) {
@@ -396,6 +930,244 @@ int executor_run_block(context_t *context, int block_idx, const char *args, modu
     return block_result;
 }
 
+/**
+ * Execute the tasks of an included file
+ *
+ * The file is loaded through the parser's cache, so including it again (on
+ * another host or loop item) reuses the compiled tasks.
+ *
+ * @param context Execution context
+ * @param include_idx Include task index
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_run_include(context_t *context, int include_idx, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+
+    if (include_idx < 0 || include_idx >= context->play->task_count) {
+        fprintf(stderr, "Error: Invalid include index %d\n", include_idx);
+        return ANCIBLE_ERROR;
+    }
+
+    task_t *include = &context->play->tasks[include_idx];
+
+    if (include->when) {
+        int condition_result = task_condition(context, include);
+
+        if (condition_result == 0) {
+            return skip_result(context, include, result);
+        } else if (condition_result < 0) {
+            fprintf(stderr, "Error: Failed to evaluate condition: %s\n", include->when);
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    play_t *included = parse_task_file(include->args);
+    if (!included) {
+        result->failed = 1;
+        result->msg = strdup("Failed to load included tasks");
+        return ANCIBLE_ERROR;
+    }
+
+    // Task indices of the included file refer to its own task array
+    play_t *play = context->play;
+    context->play = included;
+
+    int include_result = ANCIBLE_SUCCESS;
+    int any_changed = 0;
+
+    for (int i = 0; i < included->task_count; i++) {
+        if (included->tasks[i].parent_idx >= 0) {
+            continue;
+        }
+
+        module_result_t subtask_result;
+        module_result_init(&subtask_result);
+
+        int subtask_res = executor_run_task(context, i, NULL, &subtask_result);
+
+        if (context->verbose) {
+            if (subtask_result.msg) {
+                printf("  Message: %s\n", subtask_result.msg);
+            }
+            if (subtask_result.cmd_result.stdout_data && strlen(subtask_result.cmd_result.stdout_data) > 0) {
+                printf("  Stdout: %s", subtask_result.cmd_result.stdout_data);
+            }
+            if (subtask_result.cmd_result.stderr_data && strlen(subtask_result.cmd_result.stderr_data) > 0) {
+                printf("  Stderr: %s", subtask_result.cmd_result.stderr_data);
+            }
+        }
+
+        if (subtask_result.changed) {
+            any_changed = 1;
+        }
+
+        if (subtask_res != ANCIBLE_SUCCESS || subtask_result.failed) {
+            include_result = ANCIBLE_ERROR;
+            module_result_free(&subtask_result);
+            break;
+        }
+
+        module_result_free(&subtask_result);
+    }
+
+    context->play = play;
+
+    result->changed = any_changed;
+    result->failed = (include_result != ANCIBLE_SUCCESS);
+    result->skipped = 0;
+    result->msg = strdup(result->failed ? "Included tasks failed" : "Included tasks executed successfully");
+
+    return include_result;
+}
+
+/**
+ * Collect the variables hosts may set while a play runs
+ *
+ * Loop items, registered results and the facts of set_fact tasks are set
+ * per host, over the play's variables. The facts of included files are
+ * only known at run time, and templated fact names only once rendered.
+ *
+ * @param play Play
+ * @param facts Bitset to fill with symbol IDs
+ * @return ANCIBLE_SUCCESS if every such variable is known, ANCIBLE_ERROR otherwise
+ */
+static int play_facts(const play_t *play, bitset_t *facts) {
+    if (bitset_set(facts, SYMBOL_ITEM) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    
+    for (int i = 0; i < play->task_count; i++) {
+        const task_t *task = &play->tasks[i];
+        if (task->type == TASK_TYPE_INCLUDE) {
+            return ANCIBLE_ERROR;
+        }
+        if (task->register_var && bitset_set(facts, task->register_key) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (!task->module || strcmp(task->module, "set_fact") != 0) {
+            continue;
+        }
+        
+        module_args_t parsed;
+        if (module_args_parse(task->args, &parsed) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        for (int j = 0; j < parsed.count; j++) {
+            if (strchr(parsed.keys[j], '{') || bitset_set(facts, symbol_intern(parsed.keys[j])) != ANCIBLE_SUCCESS) {
+                module_args_free(&parsed);
+                return ANCIBLE_ERROR;
+            }
+        }
+        module_args_free(&parsed);
+    }
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Fold the when conditions of a play's tasks that every host shares
+ * 
+ * The names hosts may set are marked in every condition on the way, so
+ * they are errors rather than words while not set (condition_declare).
+ * 
+ * @param play Play about to run
+ * @param extra_vars Extra variables (may be NULL)
+ */
+void executor_fold_play(play_t *play, const scope_t *extra_vars) {
+    if (!play) {
+        return;
+    }
+    
+    // When any variable may be set per host, only extra variables are shared for sure
+    bitset_t facts;
+    bitset_init(&facts);
+    int known = play_facts(play, &facts) == ANCIBLE_SUCCESS;
+    
+    for (int i = 0; i < play->task_count; i++) {
+        task_t *task = &play->tasks[i];
+        condition_declare(task->condition, &facts);
+        int result = task->condition ? condition_fold(task->condition, extra_vars, task->var_scope, play->var_scope,
+                                                      known ? &facts : NULL) : -1;
+        
+        // A skipped task still registers its result, so it must run on each host
+        task->when_static = result == 1 ? TASK_WHEN_ALWAYS :
+                            result == 0 && !task->register_var ? TASK_WHEN_NEVER : TASK_WHEN_DYNAMIC;
+    }
+    
+    bitset_free(&facts);
+}
+
+/**
+ * Evaluate a top-level task's when condition for every host at once
+ * 
+ * @param contexts Contexts of the hosts
+ * @param count Number of contexts
+ * @param task_idx Index of the task
+ * @param fails Bitset to fill with the hosts (indexes into contexts) the condition does not hold on
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR if the task is not batched (or on error)
+ */
+int executor_batch_condition(context_t **contexts, int count, int task_idx, bitset_t *fails) {
+    if (!contexts || count <= 0 || !fails || task_idx < 0 || task_idx >= contexts[0]->play->task_count) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // A loop's condition reads the item, so it is evaluated per item
+    const task_t *task = &contexts[0]->play->tasks[task_idx];
+    if (!task->condition || task->when_static != TASK_WHEN_DYNAMIC || task->loop_items || task->loop_var) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // The task's variables apply while its condition is evaluated
+    for (int h = 0; h < count; h++) {
+        contexts[h]->task = task;
+    }
+    
+    bitset_t holds;
+    bitset_init(&holds);
+    int ret = condition_eval_batch(task->condition, (const context_t *const *)contexts, count, &holds, fails);
+    
+    // Hosts the condition failed to evaluate on report it when the task runs
+    for (int h = 0; h < count; h++) {
+        contexts[h]->task = NULL;
+        contexts[h]->eligible = ret == ANCIBLE_SUCCESS && bitset_test(&holds, h) ? task : NULL;
+    }
+    
+    bitset_free(&holds);
+    return ret;
+}
+
+/**
+ * Mark a task skipped on a host its condition does not hold on, without running it
+ * 
+ * @param context Execution context
+ * @param task_idx Task index
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_skip_task(context_t *context, int task_idx, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    if (task_idx < 0 || task_idx >= context->play->task_count) {
+        fprintf(stderr, "Error: Invalid task index %d\n", task_idx);
+        return ANCIBLE_ERROR;
+    }
+    
+    task_t *task = &context->play->tasks[task_idx];
+    int ret = skip_result(context, task, result);
+    
+    // As if the task had run: a skipped result is registered too
+    if (task->register_var && task->type != TASK_TYPE_BLOCK) {
+        register_result(context, task, ret, result);
+    }
+    
+    return ret;
+}
+
 /**
  * Clean up the module registry
  */
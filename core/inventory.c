@@ -2,188 +2,1993 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "../include/ancible.h"
 #include "../include/core/inventory.h"
+#include "../include/core/snapshot.h"
+#include "../include/core/symbol.h"
+
+// Serialises runtime changes (add_host, group_by) made by concurrent tasks
+static pthread_mutex_t runtime_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int group_precedence_cmp(const void *a, const void *b);
 
 #define MAX_LINE_LENGTH 1024
 
 /**
- * Trim whitespace from a string (in-place)
- * 
- * @param str String to trim
- * @return Pointer to the trimmed string
+ * Trim whitespace from a string (in-place)
+ * 
+ * @param str String to trim
+ * @return Pointer to the trimmed string
+ */
+static char *trim(char *str) {
+    if (!str) return NULL;
+    
+    // Trim leading space
+    while(isspace((unsigned char)*str)) str++;
+    
+    if(*str == 0) return str;  // All spaces
+    
+    // Trim trailing space
+    char *end = str + strlen(str) - 1;
+    while(end > str && isspace((unsigned char)*end)) end--;
+    
+    // Write new null terminator
+    *(end + 1) = '\0';
+    
+    return str;
+}
+
+/**
+ * Hash a name (FNV-1a)
+ *
+ * @param name Name to hash
+ * @return 32-bit hash
+ */
+uint32_t inventory_name_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    
+    return hash;
+}
+
+/**
+ * Grow a name index to the given capacity, rehashing every entry
+ *
+ * @param index Pointer to the index
+ * @param capacity New capacity (power of two)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int name_index_resize(name_index_t *index, int capacity) {
+    struct name_slot *slots = calloc((size_t)capacity, sizeof(struct name_slot));
+    if (!slots) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory index\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    uint32_t mask = (uint32_t)capacity - 1;
+    for (int i = 0; i < index->capacity; i++) {
+        if (!index->slots[i].name) {
+            continue;
+        }
+        
+        uint32_t pos = index->slots[i].hash & mask;
+        while (slots[pos].name) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = index->slots[i];
+    }
+    
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Look up a name in an index
+ *
+ * @param index Pointer to the index
+ * @param name Name to look up
+ * @return Dense ID, or -1 if not found
+ */
+static int name_index_get(const name_index_t *index, const char *name) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    
+    uint32_t hash = inventory_name_hash(name);
+    uint32_t mask = (uint32_t)index->capacity - 1;
+    
+    // Linear probing; the load factor stays under 1/2 so runs are short
+    for (uint32_t pos = hash & mask; index->slots[pos].name; pos = (pos + 1) & mask) {
+        if (index->slots[pos].hash == hash && strcmp(index->slots[pos].name, name) == 0) {
+            return index->slots[pos].id;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * Add a name to an index
+ *
+ * @param index Pointer to the index
+ * @param name Name to add (must outlive the index entry)
+ * @param id Dense ID the name maps to
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int name_index_put(name_index_t *index, const char *name, int id) {
+    if ((index->count + 1) * 2 > index->capacity) {
+        if (name_index_resize(index, index->capacity ? index->capacity * 2 : 64) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+    
+    uint32_t hash = inventory_name_hash(name);
+    uint32_t mask = (uint32_t)index->capacity - 1;
+    uint32_t pos = hash & mask;
+    while (index->slots[pos].name) {
+        pos = (pos + 1) & mask;
+    }
+    
+    index->slots[pos].name = name;
+    index->slots[pos].hash = hash;
+    index->slots[pos].id = id;
+    index->count++;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Build a variable table in a single allocation
+ *
+ * Later entries override earlier ones with the same key.
+ *
+ * @param count Number of entries
+ * @param keys Symbol IDs of the names
+ * @param values Values
+ * @return New table (one reference), or NULL on error
+ */
+static var_table_t *var_table_create(int count, const int *keys, const char *const *values) {
+    size_t strings = 0;
+    for (int i = 0; i < count; i++) {
+        strings += strlen(values[i]) + 1;
+    }
+    
+    var_table_t *table = malloc(sizeof(var_table_t) + (size_t)count * sizeof(struct host_var) + strings);
+    if (!table) {
+        fprintf(stderr, "Error: Failed to allocate memory for host variables\n");
+        return NULL;
+    }
+    
+    table->refs = 1;
+    table->count = 0;
+    char *text = (char *)&table->entries[count];
+    
+    for (int i = 0; i < count; i++) {
+        int slot = 0;
+        while (slot < table->count && table->entries[slot].key != keys[i]) {
+            slot++;
+        }
+        if (slot == table->count) {
+            table->count++;
+        }
+        
+        size_t len = strlen(values[i]) + 1;
+        memcpy(text, values[i], len);
+        table->entries[slot].key = keys[i];
+        table->entries[slot].value = text;
+        text += len;
+    }
+    
+    return table;
+}
+
+/**
+ * Drop a reference to a variable table
+ *
+ * @param table Table to release (may be NULL)
+ */
+static void var_table_release(var_table_t *table) {
+    if (table && --table->refs == 0) {
+        free(table);
+    }
+}
+
+/**
+ * Get a variable from a table
+ *
+ * @param table Table to search (may be NULL)
+ * @param key Symbol ID of the name
+ * @return Value, or NULL if not set
+ */
+static const char *var_table_get(const var_table_t *table, int key) {
+    for (int i = 0; table && i < table->count; i++) {
+        if (table->entries[i].key == key) {
+            return table->entries[i].value;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Get a variable set on a host's inventory line
+ *
+ * @param host Pointer to the host
+ * @param name Variable name
+ * @return Variable value, or NULL if not set
+ */
+const char *host_get_var(const host_t *host, const char *name) {
+    int key = symbol_find(name);
+    return host && key >= 0 ? var_table_get(host->host_vars, key) : NULL;
+}
+
+/**
+ * Set a host's variable table, keeping ansible_host in sync with it
+ *
+ * @param host Pointer to the host
+ * @param table Table to use (the host takes one reference)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int host_set_vars(host_t *host, var_table_t *table) {
+    var_table_release(host->host_vars);
+    host->host_vars = table;
+    
+    const char *ansible_host = host_get_var(host, "ansible_host");
+    if (ansible_host) {
+        char *copy = strdup(ansible_host);
+        if (!copy) {
+            fprintf(stderr, "Error: Failed to allocate memory for ansible_host\n");
+            return ANCIBLE_ERROR;
+        }
+        free(host->ansible_host);
+        host->ansible_host = copy;
+    }
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Create a new host
+ * 
+ * @param name Host name
+ * @return Pointer to the new host, or NULL on error
+ */
+static host_t *host_create(const char *name) {
+    host_t *host = malloc(sizeof(host_t));
+    if (!host) {
+        fprintf(stderr, "Error: Failed to allocate memory for host\n");
+        return NULL;
+    }
+    
+    host->name = strdup(name);
+    if (!host->name) {
+        fprintf(stderr, "Error: Failed to allocate memory for host name\n");
+        free(host);
+        return NULL;
+    }
+    
+    host->ansible_host = NULL;
+    host->id = -1;
+    host->host_vars = NULL;
+    host->vars = NULL;
+    host->var_count = 0;
+    host->group_scope = NULL;
+    
+    return host;
+}
+
+/**
+ * Free a host
+ *
+ * @param host Host to free
+ */
+static void host_free(host_t *host) {
+    var_table_release(host->host_vars);
+    free(host->vars);
+    free(host->name);
+    free(host->ansible_host);
+    free(host);
+}
+
+/**
+ * Create a new group
+ * 
+ * @param name Group name
+ * @return Pointer to the new group, or NULL on error
+ */
+static group_t *group_create(const char *name) {
+    group_t *group = malloc(sizeof(group_t));
+    if (!group) {
+        fprintf(stderr, "Error: Failed to allocate memory for group\n");
+        return NULL;
+    }
+    
+    group->name = strdup(name);
+    if (!group->name) {
+        fprintf(stderr, "Error: Failed to allocate memory for group name\n");
+        free(group);
+        return NULL;
+    }
+    
+    group->id = -1;
+    group->host_ids = NULL;
+    group->host_count = 0;
+    group->host_capacity = 0;
+    group->child_ids = NULL;
+    group->child_count = 0;
+    group->child_capacity = 0;
+    group->vars = NULL;
+    group->depth = 0;
+    bitset_init(&group->members);
+    
+    return group;
+}
+
+/**
+ * Free a group
+ *
+ * @param group Group to free
+ */
+static void group_free(group_t *group) {
+    variable_t *var = group->vars;
+    while (var) {
+        variable_t *next = var->next;
+        free(var->name);
+        free(var->value);
+        free(var);
+        var = next;
+    }
+    
+    bitset_free(&group->members);
+    free(group->host_ids);
+    free(group->child_ids);
+    free(group->name);
+    free(group);
+}
+
+/**
+ * Append an ID to a growable array
+ *
+ * @param ids Pointer to the array
+ * @param count Pointer to the number of IDs
+ * @param capacity Pointer to the allocated size
+ * @param id ID to append
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int id_array_append(int **ids, int *count, int *capacity, int id) {
+    if (*count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 8;
+        int *new_ids = realloc(*ids, (size_t)new_capacity * sizeof(int));
+        if (!new_ids) {
+            fprintf(stderr, "Error: Failed to allocate memory for inventory IDs\n");
+            return ANCIBLE_ERROR;
+        }
+        *ids = new_ids;
+        *capacity = new_capacity;
+    }
+    
+    (*ids)[(*count)++] = id;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Check whether a group holds a host directly
+ *
+ * While loading, a group's members bitset holds its own hosts only.
+ *
+ * @param group Pointer to the group
+ * @param host_id Host ID
+ * @return 1 if the host is in the group, 0 otherwise
+ */
+static int group_has_host(const group_t *group, int host_id) {
+    return bitset_test(&group->members, host_id);
+}
+
+/**
+ * Add a host to a group, unless it is already there
+ * 
+ * @param group Pointer to the group
+ * @param host_id Host ID
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int group_add_host(group_t *group, int host_id) {
+    if (!group || host_id < 0) {
+        return ANCIBLE_ERROR;
+    }
+    if (group_has_host(group, host_id)) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    if (bitset_set(&group->members, host_id) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    return id_array_append(&group->host_ids, &group->host_count, &group->host_capacity, host_id);
+}
+
+/**
+ * Add a child group to a group
+ *
+ * @param group Pointer to the parent group
+ * @param child Pointer to the child group
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int group_add_child(group_t *group, group_t *child) {
+    for (int i = 0; i < group->child_count; i++) {
+        if (group->child_ids[i] == child->id) {
+            return ANCIBLE_SUCCESS;
+        }
+    }
+    
+    return id_array_append(&group->child_ids, &group->child_count, &group->child_capacity, child->id);
+}
+
+/**
+ * Set a group variable, replacing an earlier value for the same name
+ *
+ * @param group Pointer to the group
+ * @param name Variable name
+ * @param value Variable value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int group_set_var(group_t *group, const char *name, const char *value) {
+    variable_t **tail = &group->vars;
+    
+    for (variable_t *var = group->vars; var; var = var->next) {
+        if (strcmp(var->name, name) == 0) {
+            char *new_value = strdup(value);
+            if (!new_value) {
+                fprintf(stderr, "Error: Failed to allocate memory for variable value\n");
+                return ANCIBLE_ERROR;
+            }
+            free(var->value);
+            var->value = new_value;
+            return ANCIBLE_SUCCESS;
+        }
+        tail = &var->next;
+    }
+    
+    variable_t *var = malloc(sizeof(variable_t));
+    if (!var) {
+        fprintf(stderr, "Error: Failed to allocate memory for variable\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    var->name = strdup(name);
+    var->value = strdup(value);
+    var->next = NULL;
+    var->typed = NULL;
+    if (!var->name || !var->value) {
+        fprintf(stderr, "Error: Failed to allocate memory for variable\n");
+        free(var->name);
+        free(var->value);
+        free(var);
+        return ANCIBLE_ERROR;
+    }
+    
+    *tail = var;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Make room for more host IDs
+ *
+ * @param inventory Pointer to the inventory
+ * @param extra Number of hosts about to be added
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int inventory_reserve_hosts(inventory_t *inventory, int extra) {
+    if (inventory->host_count + extra <= inventory->host_capacity) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    int capacity = inventory->host_capacity ? inventory->host_capacity : 64;
+    while (capacity < inventory->host_count + extra) {
+        capacity *= 2;
+    }
+    
+    host_t **hosts = realloc(inventory->hosts, (size_t)capacity * sizeof(host_t *));
+    if (!hosts) {
+        fprintf(stderr, "Error: Failed to allocate memory for hosts\n");
+        return ANCIBLE_ERROR;
+    }
+    inventory->hosts = hosts;
+    inventory->host_capacity = capacity;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Create a host, give it the next host ID and index it
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Host name
+ * @return Pointer to the new host, or NULL on error
+ */
+static host_t *inventory_add_host(inventory_t *inventory, const char *name) {
+    if (inventory_reserve_hosts(inventory, 1) != ANCIBLE_SUCCESS) {
+        return NULL;
+    }
+    
+    host_t *host = host_create(name);
+    if (!host) {
+        return NULL;
+    }
+    
+    host->id = inventory->host_count;
+    if (name_index_put(&inventory->host_index, host->name, host->id) != ANCIBLE_SUCCESS) {
+        host_free(host);
+        return NULL;
+    }
+    inventory->hosts[inventory->host_count++] = host;
+    
+    return host;
+}
+
+/**
+ * Move a group to its place in the precedence order after its depth changed
+ *
+ * @param inventory Pointer to the inventory (groups resolved)
+ * @param group Group to move
+ */
+static void group_order_place(inventory_t *inventory, const group_t *group) {
+    int *order = inventory->group_order;
+    int count = inventory->group_count;
+    int pos = 0;
+    
+    while (order[pos] != group->id) {
+        pos++;
+    }
+    memmove(&order[pos], &order[pos + 1], (size_t)(count - pos - 1) * sizeof(int));
+    
+    // The rest of the order is sorted: insert before the first group that sorts after
+    pos = 0;
+    while (pos < count - 1 && group_precedence_cmp(&inventory->groups[order[pos]], &group) <= 0) {
+        pos++;
+    }
+    memmove(&order[pos + 1], &order[pos], (size_t)(count - pos - 1) * sizeof(int));
+    order[pos] = group->id;
+}
+
+/**
+ * Create a group, give it the next group ID and index it
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Group name
+ * @return Pointer to the new group, or NULL on error
+ */
+static group_t *inventory_add_group(inventory_t *inventory, const char *name) {
+    if (inventory->group_count == inventory->group_capacity) {
+        int capacity = inventory->group_capacity ? inventory->group_capacity * 2 : 16;
+        group_t **groups = realloc(inventory->groups, (size_t)capacity * sizeof(group_t *));
+        if (!groups) {
+            fprintf(stderr, "Error: Failed to allocate memory for groups\n");
+            return NULL;
+        }
+        inventory->groups = groups;
+        
+        // Once groups are resolved, the precedence order grows with them
+        if (inventory->group_order) {
+            int *group_order = realloc(inventory->group_order, (size_t)capacity * sizeof(int));
+            if (!group_order) {
+                fprintf(stderr, "Error: Failed to allocate memory for groups\n");
+                return NULL;
+            }
+            inventory->group_order = group_order;
+        }
+        inventory->group_capacity = capacity;
+    }
+    
+    group_t *group = group_create(name);
+    if (!group) {
+        return NULL;
+    }
+    
+    group->id = inventory->group_count;
+    if (name_index_put(&inventory->group_index, group->name, group->id) != ANCIBLE_SUCCESS) {
+        group_free(group);
+        return NULL;
+    }
+    inventory->groups[inventory->group_count++] = group;
+    
+    // Once groups are resolved, a new group is a top-level group and takes
+    // its place in the precedence order right away
+    if (inventory->group_order) {
+        group->depth = 1;
+        inventory->group_order[group->id] = group->id;
+        group_order_place(inventory, group);
+    }
+    
+    return group;
+}
+
+/**
+ * Find a group by name
+ * 
+ * @param inventory Pointer to the inventory
+ * @param name Group name
+ * @return Pointer to the group, or NULL if not found
+ */
+group_t *inventory_find_group(const inventory_t *inventory, const char *name) {
+    if (!inventory || !name) {
+        return NULL;
+    }
+    
+    int id = name_index_get(&inventory->group_index, name);
+    return id >= 0 ? inventory->groups[id] : NULL;
+}
+
+/**
+ * Set an effective variable on a host, overriding a lower-precedence one
+ *
+ * @param host Pointer to the host
+ * @param var Variable (owned by a group)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int host_merge_var(host_t *host, const variable_t *var) {
+    // The shared index no longer matches; host_share_group_vars() finds the new one
+    host->group_scope = NULL;
+    
+    for (int i = 0; i < host->var_count; i++) {
+        if (strcmp(host->vars[i]->name, var->name) == 0) {
+            host->vars[i] = var;
+            return ANCIBLE_SUCCESS;
+        }
+    }
+    
+    const variable_t **vars = realloc(host->vars, (size_t)(host->var_count + 1) * sizeof(variable_t *));
+    if (!vars) {
+        fprintf(stderr, "Error: Failed to allocate memory for host variables\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    vars[host->var_count++] = var;
+    host->vars = vars;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Write the name of a range host
+ *
+ * @param range Range descriptor
+ * @param index Position of the host in the range
+ * @param buffer Buffer receiving the name
+ * @param size Size of the buffer
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR if the name does not fit
+ */
+static int range_format(const host_range_t *range, int index, char *buffer, size_t size) {
+    long value = range->start + (long)index * range->step;
+    int length;
+    
+    if (range->alpha) {
+        length = snprintf(buffer, size, "%s%c%s", range->prefix, (char)value, range->suffix);
+    } else {
+        length = snprintf(buffer, size, "%s%0*ld%s", range->prefix, range->width, value, range->suffix);
+    }
+    
+    return length >= 0 && (size_t)length < size ? ANCIBLE_SUCCESS : ANCIBLE_ERROR;
+}
+
+/**
+ * Find the range host a name refers to
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Host name
+ * @return Host ID, or -1 if no range holds the name
+ */
+static int range_lookup(const inventory_t *inventory, const char *name) {
+    size_t len = strlen(name);
+    
+    for (int i = 0; i < inventory->range_count; i++) {
+        const host_range_t *range = &inventory->ranges[i];
+        size_t prefix_len = strlen(range->prefix);
+        size_t suffix_len = strlen(range->suffix);
+        
+        if (len <= prefix_len + suffix_len ||
+            strncmp(name, range->prefix, prefix_len) != 0 ||
+            strcmp(name + len - suffix_len, range->suffix) != 0) {
+            continue;
+        }
+        
+        const char *middle = name + prefix_len;
+        size_t middle_len = len - prefix_len - suffix_len;
+        long value = 0;
+        
+        if (range->alpha) {
+            if (middle_len != 1) {
+                continue;
+            }
+            value = (unsigned char)middle[0];
+        } else {
+            if (middle_len > 18) {
+                continue;
+            }
+            
+            size_t i = 0;
+            while (i < middle_len && isdigit((unsigned char)middle[i])) {
+                value = value * 10 + (middle[i++] - '0');
+            }
+            
+            // "%0*ld" output is exactly max(width, number of digits) long
+            int digits = 1;
+            for (long v = value; v >= 10; v /= 10) {
+                digits++;
+            }
+            if (i != middle_len || middle_len != (size_t)(digits > range->width ? digits : range->width)) {
+                continue;
+            }
+        }
+        
+        long offset = value - range->start;
+        if (offset < 0 || offset % range->step != 0 || offset / range->step >= range->count) {
+            continue;
+        }
+        
+        return range->first_id + (int)(offset / range->step);
+    }
+    
+    return -1;
+}
+
+/**
+ * Find the range descriptor holding a host ID
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @return Range descriptor, or NULL if the host was not declared by a range
+ */
+static const host_range_t *range_for_id(const inventory_t *inventory, int id) {
+    int low = 0;
+    int high = inventory->range_count - 1;
+    
+    // Descriptors are created in host ID order
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        const host_range_t *range = &inventory->ranges[mid];
+        if (id < range->first_id) {
+            high = mid - 1;
+        } else if (id >= range->first_id + range->count) {
+            low = mid + 1;
+        } else {
+            return range;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Find a snapshot host by name
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Host name
+ * @return Host ID, or -1 if no snapshot host has the name
+ */
+static int mapped_lookup(const inventory_t *inventory, const char *name) {
+    const mapped_hosts_t *mapped = &inventory->mapped;
+    if (mapped->index_capacity == 0) {
+        return -1;
+    }
+    
+    uint32_t hash = inventory_name_hash(name);
+    uint32_t mask = mapped->index_capacity - 1;
+    for (uint32_t probe = 0, i = hash & mask; probe < mapped->index_capacity; probe++, i = (i + 1) & mask) {
+        const snapshot_slot_t *slot = &mapped->index[i];
+        if (slot->id == 0) {
+            break;
+        }
+        if (slot->hash == hash && slot->id <= (uint32_t)mapped->host_count &&
+            strcmp(mapped->strings + mapped->hosts[slot->id - 1].name, name) == 0) {
+            return (int)slot->id - 1;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * Get the ID of a host by name, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param name Host name
+ * @return Host ID, or -1 if not found
+ */
+int inventory_host_id(const inventory_t *inventory, const char *name) {
+    if (!inventory || !name) {
+        return -1;
+    }
+    
+    int id = name_index_get(&inventory->host_index, name);
+    if (id < 0) {
+        id = range_lookup(inventory, name);
+    }
+    return id >= 0 ? id : mapped_lookup(inventory, name);
+}
+
+/**
+ * Get the name of a host by ID, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @param buffer Buffer for generated names
+ * @param size Size of the buffer
+ * @return Host name (the host's own string or buffer)
+ */
+const char *inventory_host_name(const inventory_t *inventory, int id, char *buffer, size_t size) {
+    if (inventory->hosts[id]) {
+        return inventory->hosts[id]->name;
+    }
+    if (id < inventory->mapped.host_count) {
+        return inventory->mapped.strings + inventory->mapped.hosts[id].name;
+    }
+    
+    // Ranges are only declared when their names fit in MAX_LINE_LENGTH, the size callers pass
+    const host_range_t *range = range_for_id(inventory, id);
+    range_format(range, id - range->first_id, buffer, size);
+    return buffer;
+}
+
+/**
+ * Hash a merged variable array by the identity of its variables
+ *
+ * @param vars Variables
+ * @param count Number of variables
+ * @return 32-bit hash (FNV-1a over the pointers)
+ */
+static uint32_t group_vars_hash(const variable_t *const *vars, int count) {
+    uint32_t hash = 2166136261u;
+    
+    for (int i = 0; i < count; i++) {
+        uintptr_t value = (uintptr_t)vars[i];
+        for (size_t byte = 0; byte < sizeof(value); byte++) {
+            hash ^= (uint32_t)(value & 0xff);
+            hash *= 16777619u;
+            value >>= 8;
+        }
+    }
+    
+    return hash;
+}
+
+/**
+ * Find the slot of a merged variable array, or the empty slot where it would go
+ *
+ * @param scopes Shared scopes (with at least one empty slot)
+ * @param hash Hash of the array
+ * @param vars Variables
+ * @param count Number of variables
+ * @return Pointer to the slot
+ */
+static struct group_scope *group_scopes_slot(const group_scopes_t *scopes, uint32_t hash,
+                                             const variable_t *const *vars, int count) {
+    uint32_t mask = (uint32_t)scopes->capacity - 1;
+    uint32_t pos = hash & mask;
+    
+    while (scopes->slots[pos].vars) {
+        const struct group_scope *slot = &scopes->slots[pos];
+        if (slot->hash == hash && slot->count == count &&
+            memcmp(slot->vars, vars, (size_t)count * sizeof(variable_t *)) == 0) {
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+    
+    return &scopes->slots[pos];
+}
+
+/**
+ * Free every shared group scope (hosts must not refer to them anymore)
+ *
+ * @param scopes Shared scopes
+ */
+static void group_scopes_free(group_scopes_t *scopes) {
+    for (int i = 0; i < scopes->capacity; i++) {
+        free(scopes->slots[i].vars);
+        scope_release(scopes->slots[i].scope);
+    }
+    free(scopes->slots);
+    memset(scopes, 0, sizeof(group_scopes_t));
+}
+
+/**
+ * Point a host at the shared index of its merged group variables
+ *
+ * The index is built the first time a host with these variables asks.
+ *
+ * @param inventory Pointer to the inventory
+ * @param host Host record
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int host_share_group_vars(inventory_t *inventory, host_t *host) {
+    group_scopes_t *scopes = &inventory->group_scopes;
+    
+    host->group_scope = NULL;
+    if (host->var_count == 0) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    if ((scopes->count + 1) * 2 > scopes->capacity) {
+        int capacity = scopes->capacity ? scopes->capacity * 2 : 64;
+        struct group_scope *slots = calloc((size_t)capacity, sizeof(struct group_scope));
+        if (!slots) {
+            fprintf(stderr, "Error: Failed to allocate memory for group variables\n");
+            return ANCIBLE_ERROR;
+        }
+        
+        group_scopes_t grown = { slots, capacity, scopes->count };
+        for (int i = 0; i < scopes->capacity; i++) {
+            const struct group_scope *slot = &scopes->slots[i];
+            if (slot->vars) {
+                *group_scopes_slot(&grown, slot->hash, slot->vars, slot->count) = *slot;
+            }
+        }
+        free(scopes->slots);
+        *scopes = grown;
+    }
+    
+    uint32_t hash = group_vars_hash(host->vars, host->var_count);
+    struct group_scope *slot = group_scopes_slot(scopes, hash, host->vars, host->var_count);
+    if (!slot->vars) {
+        const variable_t **vars = malloc((size_t)host->var_count * sizeof(variable_t *));
+        scope_t *scope = vars ? scope_create(host->vars, host->var_count) : NULL;
+        if (!scope) {
+            fprintf(stderr, "Error: Failed to allocate memory for group variables\n");
+            free(vars);
+            return ANCIBLE_ERROR;
+        }
+        memcpy(vars, host->vars, (size_t)host->var_count * sizeof(variable_t *));
+        slot->hash = hash;
+        slot->count = host->var_count;
+        slot->vars = vars;
+        slot->scope = scope;
+        scopes->count++;
+    }
+    
+    host->group_scope = slot->scope;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Merge the variables of a host's groups into its record, in precedence order
+ *
+ * Does nothing until groups are resolved. Merging again after the host
+ * joined a group gives the same result as merging once. The host is then
+ * pointed at the shared index of its merged variables.
+ *
+ * @param inventory Pointer to the inventory
+ * @param host Host record
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int host_apply_group_vars(inventory_t *inventory, host_t *host) {
+    for (int i = 0; inventory->group_order && i < inventory->group_count; i++) {
+        const group_t *group = inventory->groups[inventory->group_order[i]];
+        if (!group->vars || !bitset_test(&group->members, host->id)) {
+            continue;
+        }
+        for (const variable_t *var = group->vars; var; var = var->next) {
+            if (host_merge_var(host, var) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        }
+    }
+    
+    return host_share_group_vars(inventory, host);
+}
+
+/**
+ * Give a snapshot host its variables from the snapshot's records
+ *
+ * @param inventory Pointer to the inventory
+ * @param host Host being created
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int mapped_set_vars(const inventory_t *inventory, host_t *host) {
+    const mapped_hosts_t *mapped = &inventory->mapped;
+    const snapshot_host_t *record = &mapped->hosts[host->id];
+    if (record->var_count == 0) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    int keys[record->var_count];
+    const char *values[record->var_count];
+    for (uint32_t i = 0; i < record->var_count; i++) {
+        const snapshot_var_t *var = &mapped->vars[record->vars + i];
+        keys[i] = symbol_intern(mapped->strings + var->name);
+        values[i] = mapped->strings + var->value;
+        if (keys[i] < 0) {
+            return ANCIBLE_ERROR;
+        }
+    }
+    
+    var_table_t *table = var_table_create((int)record->var_count, keys, values);
+    return table ? host_set_vars(host, table) : ANCIBLE_ERROR;
+}
+
+/**
+ * Get a host by ID, creating the record of a range host on first use
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @return Pointer to the host, or NULL on error
+ */
+host_t *inventory_host(inventory_t *inventory, int id) {
+    if (!inventory || id < 0 || id >= inventory->host_count) {
+        return NULL;
+    }
+    if (inventory->hosts[id]) {
+        return inventory->hosts[id];
+    }
+    
+    char name[MAX_LINE_LENGTH];
+    host_t *host = host_create(inventory_host_name(inventory, id, name, sizeof(name)));
+    if (!host) {
+        return NULL;
+    }
+    host->id = id;
+    
+    if (id < inventory->mapped.host_count) {
+        if (mapped_set_vars(inventory, host) != ANCIBLE_SUCCESS) {
+            host_free(host);
+            return NULL;
+        }
+    } else {
+        // The range's variables are shared, not copied
+        const host_range_t *range = range_for_id(inventory, id);
+        if (range->vars) {
+            range->vars->refs++;
+            if (host_set_vars(host, range->vars) != ANCIBLE_SUCCESS) {
+                host_free(host);
+                return NULL;
+            }
+        }
+    }
+    
+    // Once groups are resolved, merge their variables like for any other host
+    if (host_apply_group_vars(inventory, host) != ANCIBLE_SUCCESS) {
+        host_free(host);
+        return NULL;
+    }
+    
+    inventory->hosts[id] = host;
+    return host;
+}
+
+/**
+ * Find a host by name
+ * 
+ * @param inventory Pointer to the inventory
+ * @param name Host name
+ * @return Pointer to the host, or NULL if not found
+ */
+host_t *inventory_find_host(inventory_t *inventory, const char *name) {
+    int id = inventory_host_id(inventory, name);
+    return id >= 0 ? inventory_host(inventory, id) : NULL;
+}
+
+/**
+ * Split a line into words like a shell: quotes group, backslashes escape
+ *
+ * Unquoted '#' at the start of a word starts a comment.
+ *
+ * @param line Line to split (rewritten in place)
+ * @param words Array receiving the words (at least strlen(line) / 2 + 1 entries)
+ * @return Number of words, or -1 on an unterminated quote
+ */
+static int split_words(char *line, char **words) {
+    int count = 0;
+    char *in = line;
+    
+    for (;;) {
+        while (isspace((unsigned char)*in)) in++;
+        if (!*in || *in == '#') {
+            break;
+        }
+        
+        char *out = in;
+        words[count++] = out;
+        char quote = '\0';
+        
+        while (*in && (quote || !isspace((unsigned char)*in))) {
+            if (quote) {
+                if (*in == quote) {
+                    quote = '\0';
+                } else if (*in == '\\' && quote == '"' && (in[1] == '"' || in[1] == '\\')) {
+                    *out++ = *++in;
+                } else {
+                    *out++ = *in;
+                }
+            } else if (*in == '"' || *in == '\'') {
+                quote = *in;
+            } else if (*in == '\\' && in[1]) {
+                *out++ = *++in;
+            } else {
+                *out++ = *in;
+            }
+            in++;
+        }
+        
+        if (quote) {
+            return -1;
+        }
+        
+        // The word may end at the terminator itself
+        int end = *in == '\0';
+        *out = '\0';
+        if (end) {
+            break;
+        }
+        in++;
+    }
+    
+    return count;
+}
+
+/**
+ * Parse the variables of a host line (e.g., "ansible_host=10.0.0.1 motd='hello world'")
+ * 
+ * The variables are merged over the existing table, if any.
+ * 
+ * @param line Rest of the host line (not modified)
+ * @param table Pointer to the host's (or range's) table to replace
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int parse_host_vars(const char *line, var_table_t **table) {
+    int result = ANCIBLE_ERROR;
+    size_t len = strlen(line);
+    char *copy = strdup(line);
+    char **words = malloc((len / 2 + 1) * sizeof(char *));
+    int base = *table ? (*table)->count : 0;
+    int *keys = malloc((len / 2 + 1 + (size_t)base) * sizeof(int));
+    const char **values = malloc((len / 2 + 1 + (size_t)base) * sizeof(char *));
+    if (!copy || !words || !keys || !values) {
+        fprintf(stderr, "Error: Failed to allocate memory for host variables\n");
+        goto cleanup;
+    }
+    
+    int count = split_words(copy, words);
+    if (count < 0) {
+        fprintf(stderr, "Error: Unterminated quote in host variables: %s\n", line);
+        goto cleanup;
+    }
+    if (count == 0) {
+        result = ANCIBLE_SUCCESS;
+        goto cleanup;
+    }
+    
+    // Existing variables first, so the new ones override them
+    for (int i = 0; i < base; i++) {
+        keys[i] = (*table)->entries[i].key;
+        values[i] = (*table)->entries[i].value;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        char *equals = strchr(words[i], '=');
+        if (!equals || equals == words[i]) {
+            fprintf(stderr, "Error: Expected key=value host variable, got '%s'\n", words[i]);
+            goto cleanup;
+        }
+        *equals = '\0';
+        
+        keys[base + i] = symbol_intern(words[i]);
+        values[base + i] = equals + 1;
+        if (keys[base + i] < 0) {
+            goto cleanup;
+        }
+    }
+    
+    var_table_t *merged = var_table_create(base + count, keys, values);
+    if (merged) {
+        var_table_release(*table);
+        *table = merged;
+        result = ANCIBLE_SUCCESS;
+    }
+    
+cleanup:
+    free(copy);
+    free(words);
+    free(keys);
+    free(values);
+    return result;
+}
+
+/**
+ * Find a group by name, creating it if needed
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Group name
+ * @return Pointer to the group, or NULL on error
+ */
+group_t *inventory_get_group(inventory_t *inventory, const char *name) {
+    group_t *group = inventory_find_group(inventory, name);
+    return group ? group : inventory_add_group(inventory, name);
+}
+
+/**
+ * Parse a group variable line (e.g., "http_port = 80" or "motd='hello world'")
+ *
+ * @param line Line to parse (modified in place)
+ * @param group Pointer to the group to update
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int parse_group_var(char *line, group_t *group) {
+    char *equals = strchr(line, '=');
+    if (!equals) {
+        fprintf(stderr, "Error: Invalid variable in [%s:vars]: %s\n", group->name, line);
+        return ANCIBLE_ERROR;
+    }
+    
+    *equals = '\0';
+    char *name = trim(line);
+    char *value = trim(equals + 1);
+    if (!*name) {
+        fprintf(stderr, "Error: Missing variable name in [%s:vars]\n", group->name);
+        return ANCIBLE_ERROR;
+    }
+    
+    // Strip matching quotes around the value
+    size_t len = strlen(value);
+    if (len >= 2 && (value[0] == '"' || value[0] == '\'') && value[len - 1] == value[0]) {
+        value[len - 1] = '\0';
+        value++;
+    }
+    
+    return group_set_var(group, name, value);
+}
+
+/**
+ * Range found in a host name
+ */
+typedef struct {
+    size_t open;          // Offset of '['
+    size_t close;         // Offset of ']'
+    long start;           // First value
+    long end;             // Last value
+    long step;            // Distance between values
+    int width;            // Zero-padded width (0 for none)
+    int alpha;            // Whether values are letters
+} range_spec_t;
+
+/**
+ * Parse one bound of a range
+ *
+ * @param text Bound text
+ * @param len Length of the bound
+ * @param value Pointer to receive the value
+ * @param alpha Pointer to receive whether the bound is a letter
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR if it is neither digits nor one letter
+ */
+static int parse_range_bound(const char *text, size_t len, long *value, int *alpha) {
+    if (len == 1 && isalpha((unsigned char)text[0])) {
+        *value = (unsigned char)text[0];
+        *alpha = 1;
+        return ANCIBLE_SUCCESS;
+    }
+    
+    if (len == 0 || len > 18) {
+        return ANCIBLE_ERROR;
+    }
+    
+    *value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)text[i])) {
+            return ANCIBLE_ERROR;
+        }
+        *value = *value * 10 + (text[i] - '0');
+    }
+    *alpha = 0;
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Find the first range ("[beg:end]" or "[beg:end:step]") in a host name
+ *
+ * @param name Host name
+ * @param spec Pointer to receive the range
+ * @return 1 if a range was found, 0 if there is none, -1 if a range is malformed
+ */
+static int find_range(const char *name, range_spec_t *spec) {
+    const char *open = strchr(name, '[');
+    if (!open) {
+        return 0;
+    }
+    
+    const char *close = strchr(open, ']');
+    const char *colon = close ? memchr(open, ':', (size_t)(close - open)) : NULL;
+    if (!colon) {
+        return -1;
+    }
+    
+    const char *colon2 = memchr(colon + 1, ':', (size_t)(close - colon - 1));
+    const char *end_stop = colon2 ? colon2 : close;
+    int alpha_start, alpha_end;
+    
+    if (parse_range_bound(open + 1, (size_t)(colon - open - 1), &spec->start, &alpha_start) != ANCIBLE_SUCCESS ||
+        parse_range_bound(colon + 1, (size_t)(end_stop - colon - 1), &spec->end, &alpha_end) != ANCIBLE_SUCCESS ||
+        alpha_start != alpha_end || spec->end < spec->start) {
+        return -1;
+    }
+    
+    spec->step = 1;
+    if (colon2) {
+        int alpha_step;
+        if (parse_range_bound(colon2 + 1, (size_t)(close - colon2 - 1), &spec->step, &alpha_step) != ANCIBLE_SUCCESS ||
+            alpha_step || spec->step < 1) {
+            return -1;
+        }
+    }
+    
+    // A leading zero sets the width of every generated value, as in Ansible
+    size_t start_len = (size_t)(colon - open - 1);
+    spec->width = (!alpha_start && start_len > 1 && open[1] == '0') ? (int)start_len : 0;
+    spec->alpha = alpha_start;
+    spec->open = (size_t)(open - name);
+    spec->close = (size_t)(close - name);
+    
+    return 1;
+}
+
+/**
+ * Add a range descriptor for new consecutive hosts
+ *
+ * @param inventory Pointer to the inventory
+ * @param template Range the descriptor is cut from (its prefix/suffix are copied)
+ * @param start First value of the run
+ * @param count Number of hosts in the run
+ * @param vars Variables of the range line (shared with the descriptor), or NULL
+ * @return First host ID of the run, or -1 on error
+ */
+static int inventory_add_range(inventory_t *inventory, const host_range_t *template,
+                               long start, int count, var_table_t *vars) {
+    if (inventory->range_count == inventory->range_capacity) {
+        int capacity = inventory->range_capacity ? inventory->range_capacity * 2 : 8;
+        host_range_t *ranges = realloc(inventory->ranges, (size_t)capacity * sizeof(host_range_t));
+        if (!ranges) {
+            fprintf(stderr, "Error: Failed to allocate memory for host ranges\n");
+            return -1;
+        }
+        inventory->ranges = ranges;
+        inventory->range_capacity = capacity;
+    }
+    
+    if (inventory_reserve_hosts(inventory, count) != ANCIBLE_SUCCESS) {
+        return -1;
+    }
+    
+    host_range_t *range = &inventory->ranges[inventory->range_count];
+    *range = *template;
+    range->start = start;
+    range->count = count;
+    range->first_id = inventory->host_count;
+    range->prefix = strdup(template->prefix);
+    range->suffix = strdup(template->suffix);
+    range->vars = vars;
+    if (!range->prefix || !range->suffix) {
+        fprintf(stderr, "Error: Failed to allocate memory for host range\n");
+        free(range->prefix);
+        free(range->suffix);
+        return -1;
+    }
+    if (vars) {
+        vars->refs++;
+    }
+    
+    // Range hosts get their IDs now and their records on first use
+    for (int i = 0; i < count; i++) {
+        inventory->hosts[inventory->host_count++] = NULL;
+    }
+    inventory->range_count++;
+    
+    return range->first_id;
+}
+
+/**
+ * Add a host to a group (and to "all"), creating the host if needed
+ *
+ * The name is used as-is: ranges are not expanded.
+ *
+ * @param inventory Pointer to the inventory
+ * @param group Group to add the host to
+ * @param name Host name
+ * @return Host ID, or -1 on error
+ */
+int inventory_add_group_host(inventory_t *inventory, group_t *group, const char *name) {
+    // Every group shares the same host record
+    int id = inventory_host_id(inventory, name);
+    if (id < 0) {
+        host_t *host = inventory_add_host(inventory, name);
+        if (!host) {
+            return -1;
+        }
+        id = host->id;
+    }
+    
+    // Every host belongs to "all"
+    if (group_add_host(inventory->groups[0], id) != ANCIBLE_SUCCESS ||
+        group_add_host(group, id) != ANCIBLE_SUCCESS) {
+        return -1;
+    }
+    
+    return id;
+}
+
+/**
+ * Set variables on a host, over the ones it already has
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @param count Number of variables
+ * @param keys Symbol IDs of the names
+ * @param values Values
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_set_host_vars(inventory_t *inventory, int id, int count, const int *keys, const char *const *values) {
+    host_t *host = inventory_host(inventory, id);
+    if (!host) {
+        return ANCIBLE_ERROR;
+    }
+    if (count == 0) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    int base = host->host_vars ? host->host_vars->count : 0;
+    int *all_keys = malloc((size_t)(base + count) * sizeof(int));
+    const char **all_values = malloc((size_t)(base + count) * sizeof(char *));
+    var_table_t *table = NULL;
+    if (all_keys && all_values) {
+        for (int i = 0; i < base; i++) {
+            all_keys[i] = host->host_vars->entries[i].key;
+            all_values[i] = host->host_vars->entries[i].value;
+        }
+        memcpy(all_keys + base, keys, (size_t)count * sizeof(int));
+        memcpy(all_values + base, values, (size_t)count * sizeof(char *));
+        table = var_table_create(base + count, all_keys, all_values);
+    } else {
+        fprintf(stderr, "Error: Failed to allocate memory for host variables\n");
+    }
+    
+    free(all_keys);
+    free(all_values);
+    return table ? host_set_vars(host, table) : ANCIBLE_ERROR;
+}
+
+/**
+ * Get the number of variables set on a host, without creating its record
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @return Number of variables
+ */
+int inventory_host_var_count(const inventory_t *inventory, int id) {
+    if (inventory->hosts[id]) {
+        return inventory->hosts[id]->host_vars ? inventory->hosts[id]->host_vars->count : 0;
+    }
+    if (id < inventory->mapped.host_count) {
+        return (int)inventory->mapped.hosts[id].var_count;
+    }
+    
+    const host_range_t *range = range_for_id(inventory, id);
+    return range->vars ? range->vars->count : 0;
+}
+
+/**
+ * Get a variable set on a host, without creating its record
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @param index Variable index (below inventory_host_var_count())
+ * @param name Receives the variable name
+ * @param value Receives the variable value
+ */
+void inventory_host_var(const inventory_t *inventory, int id, int index, const char **name, const char **value) {
+    const var_table_t *table;
+    
+    if (inventory->hosts[id]) {
+        table = inventory->hosts[id]->host_vars;
+    } else if (id < inventory->mapped.host_count) {
+        const mapped_hosts_t *mapped = &inventory->mapped;
+        const snapshot_var_t *var = &mapped->vars[mapped->hosts[id].vars + (uint32_t)index];
+        *name = mapped->strings + var->name;
+        *value = mapped->strings + var->value;
+        return;
+    } else {
+        table = range_for_id(inventory, id)->vars;
+    }
+    
+    *name = symbol_name(table->entries[index].key);
+    *value = table->entries[index].value;
+}
+
+/**
+ * Make a group the child of another
+ *
+ * @param inventory Pointer to the inventory
+ * @param parent Parent group
+ * @param child Child group
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_add_child(inventory_t *inventory, group_t *parent, group_t *child) {
+    if (child == inventory->groups[0]) {
+        fprintf(stderr, "Error: Group 'all' cannot be a child of '%s'\n", parent->name);
+        return ANCIBLE_ERROR;
+    }
+    
+    return group_add_child(parent, child);
+}
+
+/**
+ * Declare a single host (no range) in a group
+ *
+ * @param inventory Pointer to the inventory
+ * @param group Group the host line belongs to
+ * @param name Host name
+ * @param vars Rest of the host line, or NULL
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int declare_host(inventory_t *inventory, group_t *group, const char *name, const char *vars) {
+    int id = inventory_add_group_host(inventory, group, name);
+    if (id < 0) {
+        return ANCIBLE_ERROR;
+    }
+    
+    if (vars) {
+        host_t *host = inventory_host(inventory, id);
+        var_table_t *table = NULL;
+        if (!host) {
+            return ANCIBLE_ERROR;
+        }
+        
+        // A shared range table is copied before this host's variables go on top
+        if (host->host_vars) {
+            table = host->host_vars;
+            table->refs++;
+        }
+        if (parse_host_vars(vars, &table) != ANCIBLE_SUCCESS) {
+            var_table_release(table);
+            return ANCIBLE_ERROR;
+        }
+        if (table == host->host_vars) {
+            var_table_release(table);  // Nothing was parsed
+        } else if (host_set_vars(host, table) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Declare the hosts of a host line, expanding ranges
+ *
+ * The last range of a name becomes compact descriptors (split around hosts
+ * that already exist); any range before it is expanded into one name per value.
+ *
+ * @param inventory Pointer to the inventory
+ * @param group Group the host line belongs to
+ * @param name Host name, possibly with ranges
+ * @param vars Rest of the host line, or NULL
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
-static char *trim(char *str) {
-    if (!str) return NULL;
+static int declare_hosts(inventory_t *inventory, group_t *group, const char *name, const char *vars) {
+    range_spec_t spec;
+    int found = find_range(name, &spec);
+    if (found < 0) {
+        fprintf(stderr, "Error: Invalid host range in '%s'\n", name);
+        return ANCIBLE_ERROR;
+    }
+    if (found == 0) {
+        return declare_host(inventory, group, name, vars);
+    }
     
-    // Trim leading space
-    while(isspace((unsigned char)*str)) str++;
+    char expanded[MAX_LINE_LENGTH];
+    const char *suffix = name + spec.close + 1;
+    long count = (spec.end - spec.start) / spec.step + 1;
     
-    if(*str == 0) return str;  // All spaces
+    range_spec_t next;
+    if (find_range(suffix, &next) != 0) {
+        // More ranges follow: expand this one and recurse
+        for (long i = 0; i < count; i++) {
+            long value = spec.start + i * spec.step;
+            int length;
+            if (spec.alpha) {
+                length = snprintf(expanded, sizeof(expanded), "%.*s%c%s", (int)spec.open, name, (char)value, suffix);
+            } else {
+                length = snprintf(expanded, sizeof(expanded), "%.*s%0*ld%s", (int)spec.open, name, spec.width, value,
+                                  suffix);
+            }
+            if (length < 0 || (size_t)length >= sizeof(expanded)) {
+                fprintf(stderr, "Error: Host names too long in '%s'\n", name);
+                return ANCIBLE_ERROR;
+            }
+            if (declare_hosts(inventory, group, expanded, vars) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        }
+        return ANCIBLE_SUCCESS;
+    }
     
-    // Trim trailing space
-    char *end = str + strlen(str) - 1;
-    while(end > str && isspace((unsigned char)*end)) end--;
+    if (count > 10000000) {
+        fprintf(stderr, "Error: Host range too large in '%s'\n", name);
+        return ANCIBLE_ERROR;
+    }
     
-    // Write new null terminator
-    *(end + 1) = '\0';
+    char prefix[MAX_LINE_LENGTH];
+    snprintf(prefix, sizeof(prefix), "%.*s", (int)spec.open, name);
+    host_range_t template = {prefix, (char *)suffix, spec.start, spec.step, (int)count,
+                             spec.width, spec.alpha, 0, NULL};
     
-    return str;
+    // Values only grow, so the last name is the longest; a truncated name would be another host's
+    if (range_format(&template, (int)count - 1, expanded, sizeof(expanded)) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Host names too long in '%s'\n", name);
+        return ANCIBLE_ERROR;
+    }
+    
+    var_table_t *table = NULL;
+    if (vars && parse_host_vars(vars, &table) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    
+    // Only ranges of the same shape whose values overlap can hold these names;
+    // when there is none, the host index alone tells which names already exist
+    int check_ranges = 0;
+    for (int i = 0; i < inventory->range_count && !check_ranges; i++) {
+        const host_range_t *range = &inventory->ranges[i];
+        long last = range->start + (long)(range->count - 1) * range->step;
+        check_ranges = range->alpha == spec.alpha && range->start <= spec.end && last >= spec.start &&
+                       strcmp(range->prefix, prefix) == 0 && strcmp(range->suffix, suffix) == 0;
+    }
+    
+    // Values naming existing hosts join the group as they are; every run of
+    // new values becomes one descriptor
+    int result = ANCIBLE_SUCCESS;
+    int run_start = -1;
+    for (int i = 0; i <= (int)count && result == ANCIBLE_SUCCESS; i++) {
+        int id = -1;
+        if (i < (int)count) {
+            range_format(&template, i, expanded, sizeof(expanded));
+            id = name_index_get(&inventory->host_index, expanded);
+            if (id < 0 && check_ranges) {
+                id = range_lookup(inventory, expanded);
+            }
+            if (id < 0) {
+                if (run_start < 0) {
+                    run_start = i;
+                }
+                continue;
+            }
+        }
+        
+        if (run_start >= 0) {
+            int first_id = inventory_add_range(inventory, &template, spec.start + run_start * spec.step,
+                                               i - run_start, table);
+            for (int j = 0; first_id >= 0 && j < i - run_start && result == ANCIBLE_SUCCESS; j++) {
+                result = group_add_host(inventory->groups[0], first_id + j);
+                if (result == ANCIBLE_SUCCESS) {
+                    result = group_add_host(group, first_id + j);
+                }
+            }
+            if (first_id < 0) {
+                result = ANCIBLE_ERROR;
+            }
+            run_start = -1;
+        }
+        
+        if (id >= 0 && result == ANCIBLE_SUCCESS) {
+            result = declare_host(inventory, group, expanded, vars);
+        }
+    }
+    
+    var_table_release(table);
+    return result;
 }
 
 /**
- * Create a new host
- * 
- * @param name Host name
- * @return Pointer to the new host, or NULL on error
+ * Compute the flattened membership of a group and its descendants
+ *
+ * @param inventory Pointer to the inventory
+ * @param group Group to flatten
+ * @param state Per-group state: 0 unvisited, 1 in progress, 2 done
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on a cycle or allocation error
  */
-static host_t *host_create(const char *name) {
-    host_t *host = malloc(sizeof(host_t));
-    if (!host) {
-        fprintf(stderr, "Error: Failed to allocate memory for host\n");
-        return NULL;
+static int group_flatten(inventory_t *inventory, group_t *group, char *state) {
+    if (state[group->id] == 2) {
+        return ANCIBLE_SUCCESS;
+    }
+    if (state[group->id] == 1) {
+        fprintf(stderr, "Error: Group '%s' is a child of itself\n", group->name);
+        return ANCIBLE_ERROR;
     }
+    state[group->id] = 1;
     
-    host->name = strdup(name);
-    if (!host->name) {
-        fprintf(stderr, "Error: Failed to allocate memory for host name\n");
-        free(host);
-        return NULL;
+    if (bitset_reserve(&group->members, inventory->host_count) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    for (int i = 0; i < group->host_count; i++) {
+        bitset_set(&group->members, group->host_ids[i]);
     }
     
-    host->ansible_host = NULL;
-    host->next = NULL;
+    for (int i = 0; i < group->child_count; i++) {
+        group_t *child = inventory->groups[group->child_ids[i]];
+        if (group_flatten(inventory, child, state) != ANCIBLE_SUCCESS ||
+            bitset_or(&group->members, &child->members) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
     
-    return host;
+    state[group->id] = 2;
+    return ANCIBLE_SUCCESS;
 }
 
 /**
- * Create a new group
- * 
- * @param name Group name
- * @return Pointer to the new group, or NULL on error
+ * Push a depth down to a group and its descendants, keeping the longest path
+ *
+ * @param inventory Pointer to the inventory
+ * @param group Group to update
+ * @param depth Depth reached through the current parent
  */
-static group_t *group_create(const char *name) {
-    group_t *group = malloc(sizeof(group_t));
-    if (!group) {
-        fprintf(stderr, "Error: Failed to allocate memory for group\n");
-        return NULL;
+static void group_set_depth(inventory_t *inventory, group_t *group, int depth) {
+    if (depth <= group->depth) {
+        return;
     }
     
-    group->name = strdup(name);
-    if (!group->name) {
-        fprintf(stderr, "Error: Failed to allocate memory for group name\n");
-        free(group);
-        return NULL;
+    group->depth = depth;
+    for (int i = 0; i < group->child_count; i++) {
+        group_set_depth(inventory, inventory->groups[group->child_ids[i]], depth + 1);
     }
+}
+
+/**
+ * Order groups by variable precedence: shallower first, then by name
+ */
+static int group_precedence_cmp(const void *a, const void *b) {
+    const group_t *ga = *(const group_t *const *)a;
+    const group_t *gb = *(const group_t *const *)b;
     
-    group->hosts = NULL;
-    group->next = NULL;
-    
-    return group;
+    if (ga->depth != gb->depth) {
+        return ga->depth - gb->depth;
+    }
+    return strcmp(ga->name, gb->name);
 }
 
 /**
- * Add a host to a group
- * 
- * @param group Pointer to the group
- * @param host Pointer to the host
+ * Resolve the group hierarchy once the whole file is read
+ *
+ * Flattens every group's membership into a bitset and merges group
+ * variables into each member host, from "all" down to the deepest groups
+ * (groups at the same depth apply in name order, so the last one wins).
+ *
+ * @param inventory Pointer to the inventory
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
-static int group_add_host(group_t *group, host_t *host) {
-    if (!group || !host) {
-        return ANCIBLE_ERROR;
+int inventory_resolve_groups(inventory_t *inventory) {
+    int result = ANCIBLE_ERROR;
+    char *state = calloc((size_t)inventory->group_count, 1);
+    group_t **order = malloc((size_t)inventory->group_count * sizeof(group_t *));
+    int *group_order = malloc((size_t)inventory->group_capacity * sizeof(int));
+    if (!state || !order || !group_order) {
+        fprintf(stderr, "Error: Failed to allocate memory for group resolution\n");
+        goto cleanup;
+    }
+    
+    for (int i = 0; i < inventory->group_count; i++) {
+        if (group_flatten(inventory, inventory->groups[i], state) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
     }
     
-    // Add host to the beginning of the list
-    host->next = group->hosts;
-    group->hosts = host;
+    // Every group other than "all" is at least one level below it
+    for (int i = 1; i < inventory->group_count; i++) {
+        group_set_depth(inventory, inventory->groups[i], 1);
+    }
     
-    return ANCIBLE_SUCCESS;
+    memcpy(order, inventory->groups, (size_t)inventory->group_count * sizeof(group_t *));
+    qsort(order, (size_t)inventory->group_count, sizeof(group_t *), group_precedence_cmp);
+    
+    // Merged variables are rebuilt from scratch, so are their shared indexes
+    for (int id = 0; id < inventory->host_count; id++) {
+        if (inventory->hosts[id]) {
+            inventory->hosts[id]->group_scope = NULL;
+        }
+    }
+    group_scopes_free(&inventory->group_scopes);
+    
+    for (int i = 0; i < inventory->group_count; i++) {
+        const group_t *group = order[i];
+        group_order[i] = group->id;
+        if (!group->vars) {
+            continue;
+        }
+        
+        // Range hosts without a record yet get theirs merged when created
+        for (int id = bitset_next(&group->members, 0); id >= 0; id = bitset_next(&group->members, id + 1)) {
+            for (const variable_t *var = group->vars; inventory->hosts[id] && var; var = var->next) {
+                if (host_merge_var(inventory->hosts[id], var) != ANCIBLE_SUCCESS) {
+                    goto cleanup;
+                }
+            }
+        }
+    }
+    
+    for (int id = 0; id < inventory->host_count; id++) {
+        if (inventory->hosts[id] && host_share_group_vars(inventory, inventory->hosts[id]) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+    
+    free(inventory->group_order);
+    inventory->group_order = group_order;
+    group_order = NULL;
+    result = ANCIBLE_SUCCESS;
+    
+cleanup:
+    free(state);
+    free(order);
+    free(group_order);
+    return result;
 }
 
 /**
- * Find a group by name
- * 
+ * Make a host a member of a group and of every group above it
+ *
+ * Keeps flattened membership current without resolving the hierarchy again.
+ *
  * @param inventory Pointer to the inventory
- * @param name Group name
- * @return Pointer to the group, or NULL if not found
+ * @param group Group the host joins
+ * @param id Host ID
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
-static group_t *inventory_find_group(inventory_t *inventory, const char *name) {
-    if (!inventory || !name) {
-        return NULL;
+static int group_add_member(inventory_t *inventory, group_t *group, int id) {
+    if (bitset_set(&group->members, id) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
     }
     
-    group_t *group = inventory->groups;
-    while (group) {
-        if (strcmp(group->name, name) == 0) {
-            return group;
+    // A parent that already has the host has it in all its own parents too
+    for (int i = 0; i < inventory->group_count; i++) {
+        group_t *parent = inventory->groups[i];
+        if (bitset_test(&parent->members, id)) {
+            continue;
+        }
+        for (int j = 0; j < parent->child_count; j++) {
+            if (parent->child_ids[j] == group->id) {
+                if (group_add_member(inventory, parent, id) != ANCIBLE_SUCCESS) {
+                    return ANCIBLE_ERROR;
+                }
+                break;
+            }
         }
-        group = group->next;
     }
     
-    return NULL;
+    return ANCIBLE_SUCCESS;
 }
 
 /**
- * Find a host by name
- * 
+ * Add a host at runtime (add_host), or update it if it exists
+ *
  * @param inventory Pointer to the inventory
  * @param name Host name
- * @return Pointer to the host, or NULL if not found
+ * @param count Number of variables
+ * @param keys Symbol IDs of the variable names
+ * @param values Variable values
+ * @param created Set to 1 if the host is new, 0 otherwise
+ * @return Host ID, or -1 on error
  */
-static host_t *inventory_find_host(inventory_t *inventory, const char *name) {
-    if (!inventory || !name) {
-        return NULL;
+int inventory_runtime_add_host(inventory_t *inventory, const char *name, int count,
+                               const int *keys, const char *const *values, int *created) {
+    pthread_mutex_lock(&runtime_lock);
+    
+    *created = 0;
+    int id = inventory_host_id(inventory, name);
+    if (id < 0) {
+        id = inventory_add_group_host(inventory, inventory->groups[0], name);
+        *created = id >= 0;
     }
     
-    host_t *host = inventory->all_hosts;
-    while (host) {
-        if (strcmp(host->name, name) == 0) {
-            return host;
-        }
-        host = host->next;
+    // A new host gets "all"'s variables like any other
+    host_t *host = id >= 0 ? inventory_host(inventory, id) : NULL;
+    if (!host || (*created && host_apply_group_vars(inventory, host) != ANCIBLE_SUCCESS) ||
+        inventory_set_host_vars(inventory, id, count, keys, values) != ANCIBLE_SUCCESS) {
+        id = -1;
     }
     
-    return NULL;
+    pthread_mutex_unlock(&runtime_lock);
+    return id;
 }
 
 /**
- * Parse a host variable line (e.g., "web01 ansible_host=192.168.1.10 ansible_connection=local")
- * 
- * @param line Line to parse
- * @param host Pointer to the host to update
- * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ * Add a host to a group at runtime (add_host, group_by)
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @param name Group name (created if needed)
+ * @param parent Parent group name (created if needed), or NULL
+ * @return 1 if the host or the group changed, 0 if nothing changed, -1 on error
  */
-static int parse_host_vars(char *line, host_t *host) {
-    if (!line || !host) {
-        return ANCIBLE_ERROR;
+int inventory_runtime_add_group_host(inventory_t *inventory, int id, const char *name, const char *parent) {
+    int result = -1;
+    
+    pthread_mutex_lock(&runtime_lock);
+    
+    int created = inventory_find_group(inventory, name) == NULL;
+    group_t *group = inventory_get_group(inventory, name);
+    host_t *host = inventory_host(inventory, id);
+    if (!group || !host) {
+        goto cleanup;
     }
+    result = 0;
     
-    // Find ansible_host variable
-    char *var = strstr(line, "ansible_host=");
-    if (var) {
-        var += strlen("ansible_host=");
-        
-        // Find end of value (space or end of string)
-        char *end = strchr(var, ' ');
-        if (end) {
-            *end = '\0';  // Temporarily terminate string
+    if (parent && strcmp(parent, "all") != 0) {
+        group_t *above = inventory_get_group(inventory, parent);
+        if (!above || above == group) {
+            fprintf(stderr, "Error: Invalid parent group '%s' for '%s'\n", parent, name);
+            result = -1;
+            goto cleanup;
         }
         
-        host->ansible_host = strdup(var);
-        if (!host->ansible_host) {
-            fprintf(stderr, "Error: Failed to allocate memory for ansible_host\n");
-            return ANCIBLE_ERROR;
+        int linked = 0;
+        for (int i = 0; i < above->child_count; i++) {
+            linked |= above->child_ids[i] == group->id;
         }
-        
-        if (end) {
-            *end = ' ';  // Restore space
+        if (!linked) {
+            // The parent (and its parents) get the group's existing members
+            if (inventory_add_child(inventory, above, group) != ANCIBLE_SUCCESS) {
+                result = -1;
+                goto cleanup;
+            }
+            for (int member = bitset_next(&group->members, 0); member >= 0;
+                 member = bitset_next(&group->members, member + 1)) {
+                if (group_add_member(inventory, above, member) != ANCIBLE_SUCCESS) {
+                    result = -1;
+                    goto cleanup;
+                }
+            }
+            
+            // Only a new group moves down; existing groups keep their precedence
+            if (created && inventory->group_order && group->depth <= above->depth) {
+                group->depth = above->depth + 1;
+                group_order_place(inventory, group);
+            }
+            result = 1;
+        }
+    }
+    
+    if (!bitset_test(&group->members, id)) {
+        if (id_array_append(&group->host_ids, &group->host_count, &group->host_capacity, id) != ANCIBLE_SUCCESS ||
+            group_add_member(inventory, group, id) != ANCIBLE_SUCCESS ||
+            host_apply_group_vars(inventory, host) != ANCIBLE_SUCCESS) {
+            result = -1;
+            goto cleanup;
         }
+        result = 1;
     }
     
-    // Find ansible_connection variable (we don't store this in the host struct,
-    // but we'll handle it in the context)
+cleanup:
+    pthread_mutex_unlock(&runtime_lock);
+    return result;
+}
+
+/**
+ * Initialize an empty inventory holding only the "all" group
+ *
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_init(inventory_t *inventory) {
+    memset(inventory, 0, sizeof(inventory_t));
+    
+    // The "all" group is group ID 0
+    if (!inventory_add_group(inventory, "all")) {
+        inventory_free(inventory);
+        return ANCIBLE_ERROR;
+    }
     
     return ANCIBLE_SUCCESS;
 }
@@ -200,6 +2005,7 @@ int inventory_load(const char *filename, inventory_t *inventory) {
     char line[MAX_LINE_LENGTH];
     int result = ANCIBLE_ERROR;
     group_t *current_group = NULL;
+    enum { SECTION_HOSTS, SECTION_CHILDREN, SECTION_VARS } section = SECTION_HOSTS;
     
     // Initialize inventory structure
     memset(inventory, 0, sizeof(inventory_t));
@@ -211,16 +2017,10 @@ int inventory_load(const char *filename, inventory_t *inventory) {
         return ANCIBLE_ERROR;
     }
     
-    // Create the "all" group
-    group_t *all_group = group_create("all");
-    if (!all_group) {
+    if (inventory_init(inventory) != ANCIBLE_SUCCESS) {
         goto cleanup;
     }
-    
-    // Add the "all" group to the inventory
-    all_group->next = inventory->groups;
-    inventory->groups = all_group;
-    current_group = all_group;
+    current_group = inventory->groups[0];
     
     // Parse file line by line
     while (fgets(line, sizeof(line), file)) {
@@ -237,76 +2037,66 @@ int inventory_load(const char *filename, inventory_t *inventory) {
         
         // Trim whitespace
         char *trimmed = trim(line);
+        len = strlen(trimmed);
+        if (len == 0) {
+            continue;
+        }
         
-        // Check for group header [group_name]
+        // Check for section header [group], [group:children] or [group:vars]
         if (trimmed[0] == '[' && trimmed[len-1] == ']') {
             // Extract group name
             trimmed[len-1] = '\0';
             char *group_name = trimmed + 1;
             
-            // Create new group
-            group_t *group = group_create(group_name);
-            if (!group) {
-                goto cleanup;
+            section = SECTION_HOSTS;
+            char *colon = strchr(group_name, ':');
+            if (colon) {
+                *colon = '\0';
+                if (strcmp(colon + 1, "children") == 0) {
+                    section = SECTION_CHILDREN;
+                } else if (strcmp(colon + 1, "vars") == 0) {
+                    section = SECTION_VARS;
+                } else {
+                    fprintf(stderr, "Error: Invalid section [%s:%s] in %s\n", group_name, colon + 1, filename);
+                    goto cleanup;
+                }
             }
             
-            // Add group to inventory
-            group->next = inventory->groups;
-            inventory->groups = group;
-            current_group = group;
+            // Reuse the group if it was already declared
+            current_group = inventory_get_group(inventory, group_name);
+            if (!current_group) {
+                goto cleanup;
+            }
+        } else if (section == SECTION_CHILDREN) {
+            group_t *child = inventory_get_group(inventory, trimmed);
+            if (!child) {
+                goto cleanup;
+            }
+            if (inventory_add_child(inventory, current_group, child) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+        } else if (section == SECTION_VARS) {
+            if (parse_group_var(trimmed, current_group) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
         } else {
-            // This is a host line
+            // This is a host line, possibly with ranges and variables
             char *host_name = trimmed;
-            
-            // Check for ansible_host variable
-            char *space = strchr(host_name, ' ');
+            char *space = strpbrk(host_name, " \t");
             if (space) {
                 *space = '\0';
             }
             
-            // Create or find host
-            host_t *host = inventory_find_host(inventory, host_name);
-            if (!host) {
-                host = host_create(host_name);
-                if (!host) {
-                    goto cleanup;
-                }
-                
-                // Add host to all_hosts list
-                host->next = inventory->all_hosts;
-                inventory->all_hosts = host;
-                
-                // Add host to current group
-                if (current_group) {
-                    if (group_add_host(current_group, host) != ANCIBLE_SUCCESS) {
-                        goto cleanup;
-                    }
-                }
-                
-                // Also add to "all" group if not already there
-                if (current_group != all_group) {
-                    // Create a copy of the host for the "all" group
-                    host_t *all_host = host_create(host_name);
-                    if (!all_host) {
-                        goto cleanup;
-                    }
-                    
-                    if (group_add_host(all_group, all_host) != ANCIBLE_SUCCESS) {
-                        free(all_host);
-                        goto cleanup;
-                    }
-                }
-            }
-            
-            // Parse host variables if present
-            if (space) {
-                if (parse_host_vars(space + 1, host) != ANCIBLE_SUCCESS) {
-                    goto cleanup;
-                }
+            if (declare_hosts(inventory, current_group, host_name, space ? space + 1 : NULL) != ANCIBLE_SUCCESS) {
+                goto cleanup;
             }
         }
     }
     
+    if (inventory_resolve_groups(inventory) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+    
     result = ANCIBLE_SUCCESS;
     
 cleanup:
@@ -331,49 +2121,45 @@ void inventory_free(inventory_t *inventory) {
         return;
     }
     
-    // Free groups
-    group_t *group = inventory->groups;
-    while (group) {
-        group_t *next_group = group->next;
-        
-        // Free hosts in group
-        host_t *host = group->hosts;
-        while (host) {
-            host_t *next_host = host->next;
-            free(host->name);
-            free(host->ansible_host);
-            free(host);
-            host = next_host;
+    for (int i = 0; i < inventory->group_count; i++) {
+        group_free(inventory->groups[i]);
+    }
+    
+    for (int i = 0; i < inventory->host_count; i++) {
+        if (inventory->hosts[i]) {
+            host_free(inventory->hosts[i]);
         }
-        
-        free(group->name);
-        free(group);
-        group = next_group;
     }
     
-    // Free all_hosts (these are duplicates, so we've already freed the memory above)
-    inventory->all_hosts = NULL;
-    inventory->groups = NULL;
+    for (int i = 0; i < inventory->range_count; i++) {
+        free(inventory->ranges[i].prefix);
+        free(inventory->ranges[i].suffix);
+        var_table_release(inventory->ranges[i].vars);
+    }
+    
+    free(inventory->ranges);
+    free(inventory->group_order);
+    free(inventory->hosts);
+    free(inventory->groups);
+    free(inventory->host_index.slots);
+    free(inventory->group_index.slots);
+    group_scopes_free(&inventory->group_scopes);
+    if (inventory->mapped.map) {
+        munmap(inventory->mapped.map, inventory->mapped.size);
+    }
+    memset(inventory, 0, sizeof(inventory_t));
 }
 
 /**
- * Get hosts in a group
+ * Get hosts in a group, including the hosts of its descendants
  * 
  * @param inventory Pointer to inventory structure
  * @param group_name Name of the group to get hosts for
- * @return Pointer to the first host in the group, or NULL if group not found
+ * @return Set of host IDs (index inventory->hosts), or NULL if group not found
  */
-host_t *inventory_get_hosts(inventory_t *inventory, const char *group_name) {
-    if (!inventory || !group_name) {
-        return NULL;
-    }
-    
+const bitset_t *inventory_get_hosts(const inventory_t *inventory, const char *group_name) {
     group_t *group = inventory_find_group(inventory, group_name);
-    if (!group) {
-        return NULL;
-    }
-    
-    return group->hosts;
+    return group ? &group->members : NULL;
 }
 
 /**
@@ -388,20 +2174,26 @@ void inventory_print(const inventory_t *inventory) {
     
     printf("Inventory:\n");
     
-    group_t *group = inventory->groups;
-    while (group) {
+    for (int i = 0; i < inventory->group_count; i++) {
+        const group_t *group = inventory->groups[i];
         printf("  Group: %s\n", group->name);
         
-        host_t *host = group->hosts;
-        while (host) {
-            printf("    Host: %s", host->name);
-            if (host->ansible_host) {
+        for (int j = 0; j < group->child_count; j++) {
+            printf("    Child: %s\n", inventory->groups[group->child_ids[j]]->name);
+        }
+        
+        for (const variable_t *var = group->vars; var; var = var->next) {
+            printf("    Var: %s=%s\n", var->name, var->value);
+        }
+        
+        for (int j = 0; j < group->host_count; j++) {
+            char name[MAX_LINE_LENGTH];
+            const host_t *host = inventory->hosts[group->host_ids[j]];
+            printf("    Host: %s", inventory_host_name(inventory, group->host_ids[j], name, sizeof(name)));
+            if (host && host->ansible_host) {
                 printf(" (ansible_host=%s)", host->ansible_host);
             }
             printf("\n");
-            host = host->next;
         }
-        
-        group = group->next;
     }
 }
@@ -0,0 +1,765 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "../include/ancible.h"
+#include "../include/core/inventory_source.h"
+#include "../include/core/snapshot.h"
+#include "../include/core/symbol.h"
+#include "../include/core/yaml.h"
+#include "../include/transport/runner.h"
+
+#define MAX_LOAD_THREADS 8      // Threads used to load several inventory sources
+
+// Whether cached inventories are ignored (--flush-cache)
+static int cache_flushed = 0;
+
+/**
+ * Ignore cached inventories for the rest of the run (they are still refreshed)
+ */
+void inventory_cache_flush(void) {
+    cache_flushed = 1;
+}
+
+/**
+ * Check whether a scalar node stands for "no value"
+ */
+static int is_null(const yaml_node_t *node) {
+    return node->type == YAML_SCALAR &&
+           (node->value[0] == '\0' || strcmp(node->value, "null") == 0 || strcmp(node->value, "~") == 0);
+}
+
+/**
+ * Get the text of a variable value: scalars as-is, collections in flow style
+ *
+ * @param node Value node
+ * @param owned Receives the allocated text to free, or NULL for scalars
+ * @return Value text, or NULL on error
+ */
+static const char *value_text(const yaml_node_t *node, char **owned) {
+    *owned = NULL;
+    if (node->type == YAML_SCALAR) {
+        return node->value;
+    }
+
+    *owned = yaml_node_text(node);
+    return *owned;
+}
+
+/**
+ * Set the variables of a mapping node on a host
+ *
+ * @param inventory Pointer to the inventory
+ * @param id Host ID
+ * @param vars Mapping of variables (a null scalar means none)
+ * @param source Inventory source, for error messages
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int import_host_vars(inventory_t *inventory, int id, const yaml_node_t *vars, const char *source) {
+    if (is_null(vars)) {
+        return ANCIBLE_SUCCESS;
+    }
+    if (vars->type != YAML_MAP) {
+        fprintf(stderr, "Error: %s:%d: Host variables must be a mapping\n", source, vars->line);
+        return ANCIBLE_ERROR;
+    }
+
+    int result = ANCIBLE_ERROR;
+    int count = 0;
+    int *keys = malloc((size_t)(vars->child_count + 1) * sizeof(int));
+    const char **values = malloc((size_t)(vars->child_count + 1) * sizeof(char *));
+    char **owned = calloc((size_t)vars->child_count + 1, sizeof(char *));
+    if (!keys || !values || !owned) {
+        fprintf(stderr, "Error: Failed to allocate memory for host variables\n");
+        goto cleanup;
+    }
+
+    for (const yaml_node_t *var = vars->children; var; var = var->next, count++) {
+        keys[count] = symbol_intern(var->key);
+        values[count] = value_text(var, &owned[count]);
+        if (keys[count] < 0 || !values[count]) {
+            goto cleanup;
+        }
+    }
+
+    result = inventory_set_host_vars(inventory, id, count, keys, values);
+
+cleanup:
+    for (int i = 0; owned && i < count; i++) {
+        free(owned[i]);
+    }
+    free(keys);
+    free(values);
+    free(owned);
+    return result;
+}
+
+/**
+ * Import a group and, recursively, the groups nested under its children
+ *
+ * A group is either a list of host names or a mapping with optional
+ * "hosts" (list of names, or mapping of names to variables), "vars" and
+ * "children" (list of names, or mapping of names to nested groups).
+ * Host names are taken literally: ranges are not expanded.
+ *
+ * @param inventory Pointer to the inventory
+ * @param name Group name
+ * @param node Group node
+ * @param source Inventory source, for error messages
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int import_group(inventory_t *inventory, const char *name, const yaml_node_t *node, const char *source) {
+    group_t *group = inventory_get_group(inventory, name);
+    if (!group) {
+        return ANCIBLE_ERROR;
+    }
+
+    if (node->type == YAML_SEQ) {
+        for (const yaml_node_t *host = node->children; host; host = host->next) {
+            if (host->type != YAML_SCALAR || inventory_add_group_host(inventory, group, host->value) < 0) {
+                fprintf(stderr, "Error: %s:%d: Invalid host in group '%s'\n", source, host->line, name);
+                return ANCIBLE_ERROR;
+            }
+        }
+        return ANCIBLE_SUCCESS;
+    }
+    if (is_null(node)) {
+        return ANCIBLE_SUCCESS;
+    }
+    if (node->type != YAML_MAP) {
+        fprintf(stderr, "Error: %s:%d: Group '%s' must be a list of hosts or a mapping\n", source, node->line, name);
+        return ANCIBLE_ERROR;
+    }
+
+    for (const yaml_node_t *entry = node->children; entry; entry = entry->next) {
+        if (strcmp(entry->key, "hosts") == 0 && entry->type != YAML_SCALAR) {
+            for (const yaml_node_t *host = entry->children; host; host = host->next) {
+                const char *host_name = entry->type == YAML_MAP ? host->key : host->value;
+                int id = host_name ? inventory_add_group_host(inventory, group, host_name) : -1;
+                if (id < 0) {
+                    fprintf(stderr, "Error: %s:%d: Invalid host in group '%s'\n", source, host->line, name);
+                    return ANCIBLE_ERROR;
+                }
+                if (entry->type == YAML_MAP && import_host_vars(inventory, id, host, source) != ANCIBLE_SUCCESS) {
+                    return ANCIBLE_ERROR;
+                }
+            }
+        } else if (strcmp(entry->key, "vars") == 0 && entry->type == YAML_MAP) {
+            for (const yaml_node_t *var = entry->children; var; var = var->next) {
+                char *owned;
+                const char *value = value_text(var, &owned);
+                int result = value ? group_set_var(group, var->key, value) : ANCIBLE_ERROR;
+                free(owned);
+                if (result != ANCIBLE_SUCCESS) {
+                    return ANCIBLE_ERROR;
+                }
+            }
+        } else if (strcmp(entry->key, "children") == 0 && entry->type != YAML_SCALAR) {
+            for (const yaml_node_t *child = entry->children; child; child = child->next) {
+                const char *child_name = entry->type == YAML_MAP ? child->key : child->value;
+                group_t *child_group = child_name ? inventory_get_group(inventory, child_name) : NULL;
+                if (!child_group || inventory_add_child(inventory, group, child_group) != ANCIBLE_SUCCESS) {
+                    fprintf(stderr, "Error: %s:%d: Invalid child of group '%s'\n", source, child->line, name);
+                    return ANCIBLE_ERROR;
+                }
+                if (entry->type == YAML_MAP && import_group(inventory, child_name, child, source) != ANCIBLE_SUCCESS) {
+                    return ANCIBLE_ERROR;
+                }
+            }
+        } else if (!is_null(entry)) {
+            fprintf(stderr, "Error: %s:%d: Unexpected '%s' in group '%s'\n", source, entry->line, entry->key, name);
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Build an inventory from a parsed JSON or YAML document
+ *
+ * Accepts both the dynamic inventory script format (top-level groups plus
+ * "_meta.hostvars") and the nested YAML inventory format (all: children: ...).
+ *
+ * @param root Document root
+ * @param source Inventory source, for error messages
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int import_document(const yaml_node_t *root, const char *source, inventory_t *inventory) {
+    if (root->type != YAML_MAP) {
+        fprintf(stderr, "Error: %s: Inventory must be a mapping of groups\n", source);
+        return ANCIBLE_ERROR;
+    }
+    if (inventory_init(inventory) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (const yaml_node_t *entry = root->children; entry; entry = entry->next) {
+        if (strcmp(entry->key, "_meta") != 0 && import_group(inventory, entry->key, entry, source) != ANCIBLE_SUCCESS) {
+            goto error;
+        }
+    }
+
+    // Host variables last, so host IDs follow the order of the groups
+    const yaml_node_t *hostvars = yaml_map_get(yaml_map_get(root, "_meta"), "hostvars");
+    for (const yaml_node_t *host = hostvars ? hostvars->children : NULL; host; host = host->next) {
+        int id = host->key ? inventory_host_id(inventory, host->key) : -1;
+        if (id < 0 && host->key) {
+            id = inventory_add_group_host(inventory, inventory->groups[0], host->key);
+        }
+        if (id < 0 || import_host_vars(inventory, id, host, source) != ANCIBLE_SUCCESS) {
+            goto error;
+        }
+    }
+
+    if (inventory_resolve_groups(inventory) == ANCIBLE_SUCCESS) {
+        return ANCIBLE_SUCCESS;
+    }
+
+error:
+    inventory_free(inventory);
+    return ANCIBLE_ERROR;
+}
+
+/**
+ * Run a dynamic inventory script and parse its output
+ *
+ * @param script Path to the script
+ * @return Document root, or NULL on error
+ */
+static yaml_node_t *run_script(const char *script) {
+    char *quoted = shell_quote(script);
+    if (!quoted) {
+        return NULL;
+    }
+
+    size_t size = strlen(quoted) + sizeof(" --list");
+    char *cmd = malloc(size);
+    if (!cmd) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory command\n");
+        free(quoted);
+        return NULL;
+    }
+    snprintf(cmd, size, "%s --list", quoted);
+    free(quoted);
+
+    command_result_t result;
+    yaml_node_t *root = NULL;
+    if (run_local(cmd, &result) == ANCIBLE_SUCCESS) {
+        if (result.exit_code != 0) {
+            fprintf(stderr, "Error: Inventory script %s failed with exit code %d\n", script, result.exit_code);
+            if (result.stderr_data && result.stderr_data[0]) {
+                fprintf(stderr, "%s", result.stderr_data);
+            }
+        } else {
+            root = yaml_parse_string(result.stdout_data ? result.stdout_data : "", script);
+        }
+        command_result_free(&result);
+    }
+
+    free(cmd);
+    return root;
+}
+
+/**
+ * Get the cache lifetime from the environment
+ *
+ * @return Lifetime in seconds (0 when caching is disabled)
+ */
+static long cache_ttl(void) {
+    const char *value = getenv("ANCIBLE_INVENTORY_CACHE_TTL");
+    if (!value || !*value) {
+        return INVENTORY_CACHE_TTL;
+    }
+
+    char *end;
+    long ttl = strtol(value, &end, 10);
+    return *end == '\0' && ttl > 0 ? ttl : 0;
+}
+
+/**
+ * Create a directory and its missing parents
+ *
+ * @param path Directory path
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int make_dirs(const char *path) {
+    char buffer[PATH_MAX];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+
+    for (char *p = buffer + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char saved = *p;
+            *p = '\0';
+            if (mkdir(buffer, 0700) != 0 && errno != EEXIST) {
+                return ANCIBLE_ERROR;
+            }
+            *p = saved;
+            if (saved == '\0') {
+                break;
+            }
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Get the cache file of an inventory source
+ *
+ * The file name is a hash of the source's absolute path.
+ *
+ * @param source Inventory source
+ * @param path Buffer receiving the cache path
+ * @param size Size of the buffer
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR if there is no cache directory
+ */
+static int cache_path(const char *source, char *path, size_t size) {
+    char dir[PATH_MAX];
+    const char *env = getenv("ANCIBLE_CACHE_DIR");
+    if (env && *env) {
+        snprintf(dir, sizeof(dir), "%s", env);
+    } else if ((env = getenv("XDG_CACHE_HOME")) && *env) {
+        snprintf(dir, sizeof(dir), "%s/ancible", env);
+    } else if ((env = getenv("HOME")) && *env) {
+        snprintf(dir, sizeof(dir), "%s/.cache/ancible", env);
+    } else {
+        return ANCIBLE_ERROR;
+    }
+
+    char resolved[PATH_MAX];
+    if (!realpath(source, resolved)) {
+        snprintf(resolved, sizeof(resolved), "%s", source);
+    }
+
+    // FNV-1a, 64 bits
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = resolved; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+
+    if (make_dirs(dir) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    snprintf(path, size, "%s/inventory-%016llx.snap", dir, (unsigned long long)hash);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Check whether a modification time is strictly after another
+ */
+static int is_newer(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec > b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec > b->tv_nsec);
+}
+
+/**
+ * Load a script or JSON/YAML inventory, going through the cache
+ *
+ * A cached snapshot is used while it is younger than the TTL and newer
+ * than the source itself.
+ *
+ * @param source Inventory source
+ * @param script Whether the source is an executable to run
+ * @param info Status of the source
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int load_cached(const char *source, int script, const struct stat *info, inventory_t *inventory) {
+    char path[PATH_MAX + 64];
+    long ttl = cache_ttl();
+    int cached = ttl > 0 && cache_path(source, path, sizeof(path)) == ANCIBLE_SUCCESS;
+
+    struct stat cache_info;
+    if (cached && !cache_flushed && stat(path, &cache_info) == 0 &&
+        is_newer(&cache_info.st_mtim, &info->st_mtim) && time(NULL) - cache_info.st_mtime < ttl &&
+        snapshot_load(path, inventory) == ANCIBLE_SUCCESS) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    yaml_node_t *root = script ? run_script(source) : yaml_parse_file(source);
+    if (!root) {
+        return ANCIBLE_ERROR;
+    }
+    int result = import_document(root, source, inventory);
+    yaml_free(root);
+
+    // A cache that cannot be written only costs the next run some time
+    if (result == ANCIBLE_SUCCESS && cached) {
+        snapshot_save(inventory, path);
+    }
+
+    return result;
+}
+
+/**
+ * Check whether a path names a JSON or YAML file
+ */
+static int is_structured(const char *path) {
+    const char *dot = strrchr(path, '.');
+    return dot && (strcmp(dot, ".json") == 0 || strcmp(dot, ".yml") == 0 || strcmp(dot, ".yaml") == 0);
+}
+
+/**
+ * Load inventory from any supported source
+ *
+ * @param source Inventory path
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_load_source(const char *source, inventory_t *inventory) {
+    struct stat info;
+
+    memset(inventory, 0, sizeof(inventory_t));
+
+    if (stat(source, &info) == 0 && S_ISDIR(info.st_mode)) {
+        return inventory_load_sources(&source, 1, inventory);
+    }
+    if (stat(source, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (snapshot_detect(source)) {
+            if (snapshot_load(source, inventory) != ANCIBLE_SUCCESS) {
+                fprintf(stderr, "Error: Failed to load inventory snapshot: %s (recompile it with ancible-inventory)\n", source);
+                return ANCIBLE_ERROR;
+            }
+            return ANCIBLE_SUCCESS;
+        }
+        if (access(source, X_OK) == 0) {
+            return load_cached(source, 1, &info, inventory);
+        }
+        if (is_structured(source)) {
+            return load_cached(source, 0, &info, inventory);
+        }
+    }
+
+    return inventory_load(source, inventory);
+}
+
+/**
+ * Append a copy of a path to a growing list
+ *
+ * @param paths Growing list of newly allocated paths
+ * @param count Number of paths
+ * @param capacity Allocated size of paths
+ * @param path Path to append
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int path_append(char ***paths, int *count, int *capacity, const char *path) {
+    if (*count == *capacity) {
+        int grown_capacity = *capacity ? *capacity * 2 : 8;
+        char **grown = realloc(*paths, (size_t)grown_capacity * sizeof(char *));
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for inventory sources\n");
+            return ANCIBLE_ERROR;
+        }
+        *paths = grown;
+        *capacity = grown_capacity;
+    }
+
+    (*paths)[*count] = strdup(path);
+    if (!(*paths)[*count]) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory sources\n");
+        return ANCIBLE_ERROR;
+    }
+    (*count)++;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Check whether a file in an inventory directory is skipped (hidden files,
+ * backups and documentation, like Ansible's ignored extensions)
+ */
+static int is_ignored(const char *name) {
+    static const char *const ignored[] = {
+        "~", ".bak", ".orig", ".retry", ".swp", ".pyc", ".md", ".txt", ".rst", ".cfg", NULL
+    };
+    size_t len = strlen(name);
+
+    if (name[0] == '.') {
+        return 1;
+    }
+    for (int i = 0; ignored[i]; i++) {
+        size_t suffix = strlen(ignored[i]);
+        if (len >= suffix && strcmp(name + len - suffix, ignored[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Compare two paths for qsort
+ */
+static int path_cmp(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Add a source to the list of files to load, expanding a directory into
+ * its files in name order (subdirectories such as group_vars are skipped)
+ *
+ * @param source Inventory path
+ * @param paths Growing list of newly allocated paths
+ * @param count Number of paths
+ * @param capacity Allocated size of paths
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int expand_source(const char *source, char ***paths, int *count, int *capacity) {
+    struct stat info;
+    int first = *count;
+
+    if (stat(source, &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return path_append(paths, count, capacity, source);
+    }
+
+    DIR *dir = opendir(source);
+    if (!dir) {
+        fprintf(stderr, "Error: Failed to open inventory directory: %s\n", source);
+        return ANCIBLE_ERROR;
+    }
+
+    int result = ANCIBLE_SUCCESS;
+    char path[PATH_MAX];
+    for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+        if (is_ignored(entry->d_name)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", source, entry->d_name);
+        if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        if (path_append(paths, count, capacity, path) != ANCIBLE_SUCCESS) {
+            result = ANCIBLE_ERROR;
+            break;
+        }
+    }
+    closedir(dir);
+
+    if (result == ANCIBLE_SUCCESS && *count == first) {
+        fprintf(stderr, "Error: No inventory files in directory: %s\n", source);
+        return ANCIBLE_ERROR;
+    }
+
+    // readdir order depends on the filesystem; precedence must not
+    qsort(*paths + first, (size_t)(*count - first), sizeof(char *), path_cmp);
+    return result;
+}
+
+/**
+ * Structure to hold the work queue of inventory loading threads
+ */
+typedef struct {
+    char **paths;             // Files to load
+    inventory_t *inventories; // One inventory per file
+    int *results;             // Load result of each file
+    int count;                // Number of files
+    int next;                 // Next file to hand out
+    pthread_mutex_t lock;     // Protects next
+} load_queue_t;
+
+/**
+ * Loading thread: load files from the queue until it is empty
+ */
+static void *load_worker(void *arg) {
+    load_queue_t *queue = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (i >= queue->count) {
+            break;
+        }
+        queue->results[i] = inventory_load_source(queue->paths[i], &queue->inventories[i]);
+    }
+
+    return NULL;
+}
+
+/**
+ * Merge an inventory into another
+ *
+ * Hosts and groups are matched by name. The merged inventory's variables
+ * win over the ones already set, for hosts as well as groups.
+ *
+ * @param inventory Inventory to merge into
+ * @param source Inventory to merge
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int inventory_merge(inventory_t *inventory, const inventory_t *source) {
+    char name[1024];
+    int *ids = malloc(((size_t)source->host_count + 1) * sizeof(int));
+    int *groups = malloc((size_t)source->group_count * sizeof(int));
+    int result = ANCIBLE_ERROR;
+
+    if (!ids || !groups) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory merge\n");
+        goto cleanup;
+    }
+
+    // Groups first, so hosts and children can be added by ID
+    for (int i = 0; i < source->group_count; i++) {
+        group_t *group = inventory_get_group(inventory, source->groups[i]->name);
+        if (!group) {
+            goto cleanup;
+        }
+        groups[i] = group->id;
+    }
+
+    // Every host is in "all", in host ID order, so IDs stay in source order
+    for (int id = 0; id < source->host_count; id++) {
+        ids[id] = inventory_add_group_host(inventory, inventory->groups[0],
+                                           inventory_host_name(source, id, name, sizeof(name)));
+        if (ids[id] < 0) {
+            goto cleanup;
+        }
+
+        int count = inventory_host_var_count(source, id);
+        if (count == 0) {
+            continue;
+        }
+        int keys[count];
+        const char *values[count];
+        for (int i = 0; i < count; i++) {
+            const char *key;
+            inventory_host_var(source, id, i, &key, &values[i]);
+            keys[i] = symbol_intern(key);
+            if (keys[i] < 0) {
+                goto cleanup;
+            }
+        }
+        if (inventory_set_host_vars(inventory, ids[id], count, keys, values) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+
+    for (int i = 0; i < source->group_count; i++) {
+        const group_t *from = source->groups[i];
+        group_t *group = inventory->groups[groups[i]];
+
+        for (int j = 0; j < from->host_count; j++) {
+            if (inventory_add_group_host(inventory, group,
+                                         inventory_host_name(source, from->host_ids[j], name, sizeof(name))) < 0) {
+                goto cleanup;
+            }
+        }
+        for (int j = 0; j < from->child_count; j++) {
+            if (inventory_add_child(inventory, group, inventory->groups[groups[from->child_ids[j]]]) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+        }
+        for (const variable_t *var = from->vars; var; var = var->next) {
+            if (group_set_var(group, var->name, var->value) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+        }
+    }
+
+    result = ANCIBLE_SUCCESS;
+
+cleanup:
+    free(ids);
+    free(groups);
+    return result;
+}
+
+/**
+ * Load inventory from several sources, merged into one
+ *
+ * @param sources Inventory paths, lowest precedence first
+ * @param count Number of paths
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_load_sources(const char *const *sources, int count, inventory_t *inventory) {
+    char **paths = NULL;
+    int path_count = 0;
+    int path_capacity = 0;
+    inventory_t *inventories = NULL;
+    int *results = NULL;
+    int result = ANCIBLE_ERROR;
+
+    memset(inventory, 0, sizeof(inventory_t));
+
+    for (int i = 0; i < count; i++) {
+        if (expand_source(sources[i], &paths, &path_count, &path_capacity) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+    if (path_count == 1) {
+        result = inventory_load_source(paths[0], inventory);
+        if (result != ANCIBLE_SUCCESS) {
+            fprintf(stderr, "Error loading inventory: %s\n", paths[0]);
+        }
+        goto cleanup;
+    }
+
+    inventories = calloc((size_t)path_count, sizeof(inventory_t));
+    results = malloc((size_t)path_count * sizeof(int));
+    if (!inventories || !results) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory sources\n");
+        goto cleanup;
+    }
+
+    // Sources are independent: parse (or run) them in parallel
+    load_queue_t queue = { paths, inventories, results, path_count, 0, PTHREAD_MUTEX_INITIALIZER };
+    pthread_t threads[MAX_LOAD_THREADS];
+    int started = 0;
+    int wanted = path_count < MAX_LOAD_THREADS ? path_count : MAX_LOAD_THREADS;
+    while (started < wanted && pthread_create(&threads[started], NULL, load_worker, &queue) == 0) {
+        started++;
+    }
+    load_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+
+    // Every source that failed is reported, not only the first
+    int failed = 0;
+    for (int i = 0; i < path_count; i++) {
+        if (results[i] != ANCIBLE_SUCCESS) {
+            fprintf(stderr, "Error loading inventory: %s\n", paths[i]);
+            failed = 1;
+        }
+    }
+    if (failed) {
+        goto cleanup;
+    }
+
+    // Merge in command-line order, so precedence does not depend on timing:
+    // the first inventory is kept as is and later ones win over it
+    *inventory = inventories[0];
+    memset(&inventories[0], 0, sizeof(inventory_t));
+    for (int i = 1; i < path_count; i++) {
+        if (inventory_merge(inventory, &inventories[i]) != ANCIBLE_SUCCESS) {
+            fprintf(stderr, "Error loading inventory: %s\n", paths[i]);
+            goto cleanup;
+        }
+    }
+    result = inventory_resolve_groups(inventory);
+
+cleanup:
+    if (result != ANCIBLE_SUCCESS) {
+        inventory_free(inventory);
+    }
+    for (int i = 0; inventories && results && i < path_count; i++) {
+        if (results[i] == ANCIBLE_SUCCESS) {
+            inventory_free(&inventories[i]);
+        }
+    }
+    for (int i = 0; i < path_count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(inventories);
+    free(results);
+    return result;
+}
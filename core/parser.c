@@ -2,445 +2,1505 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "../include/ancible.h"
 #include "../include/core/parser.h"
+#include "../include/core/condition.h"
+#include "../include/core/symbol.h"
+#include "../include/core/yaml.h"
 
-#define MAX_LINE_LENGTH 1024
-#define MAX_TASKS 100
-#define MAX_SUBTASKS 50
+/**
+ * Playbook compiler
+ *
+ * The playbook is read into a YAML node tree (see yaml.c) and every play is
+ * compiled into a flat task array. Blocks reference their children by index,
+ * and rescue/always sections are stored as pseudo-tasks whose parent is the
+ * block, with the section's tasks as their subtasks.
+ *
+ * import_tasks and roles are inlined at compile time. include_tasks entries
+ * keep their resolved path and are compiled on first use. Every file goes
+ * through one cache, so a task file is parsed once however often it is used.
+ */
+
+#define MAX_PRELOAD_THREADS 8   // Threads used to parse role files at startup
+#define MAX_IMPORT_DEPTH 32     // Guards against import cycles
+#define MAX_LOOP_PARALLEL 256   // Upper bound for loop_control.parallel
+
+/**
+ * Task keywords that are never module names
+ */
+static const char *task_keywords[] = {
+    "name", "when", "block", "rescue", "always", "register", "loop", "with_items",
+    "loop_control", "vars", "args", "tags", "become", "become_user", "ignore_errors",
+    "changed_when", "failed_when", "notify", "delegate_to", "environment", "no_log",
+    NULL
+};
+
+/**
+ * Check if a key is a task keyword
+ */
+static int is_task_keyword(const char *key) {
+    for (int i = 0; task_keywords[i]; i++) {
+        if (strcmp(task_keywords[i], key) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Append a string to a growable buffer
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int text_append(char **out, size_t *len, size_t *cap, const char *str) {
+    size_t n = strlen(str);
+
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = (*cap ? *cap * 2 : 64) + n;
+        char *grown = realloc(*out, new_cap);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for value\n");
+            return ANCIBLE_ERROR;
+        }
+        *out = grown;
+        *cap = new_cap;
+    }
+
+    memcpy(*out + *len, str, n + 1);
+    *len += n;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Convert a module's value to its argument string
+ *
+ * Scalars are used as-is ("command: uname -a"). Mappings use their "cmd"
+ * entry when present, otherwise they are flattened to "key=value" pairs.
+ *
+ * @param node Module value node
+ * @param args Pointer to receive the argument string (NULL if empty)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int node_to_args(const yaml_node_t *node, char **args) {
+    *args = NULL;
+
+    if (node->type == YAML_SCALAR) {
+        if (node->value[0] == '\0') {
+            return ANCIBLE_SUCCESS;
+        }
+        *args = strdup(node->value);
+    } else if (node->type == YAML_MAP && yaml_map_get(node, "cmd")) {
+        *args = yaml_node_text(yaml_map_get(node, "cmd"));
+    } else if (node->type == YAML_MAP) {
+        char *out = NULL;
+        size_t len = 0;
+        size_t cap = 0;
+
+        for (const yaml_node_t *child = node->children; child; child = child->next) {
+            char *value = yaml_node_text(child);
+            if (!value ||
+                (child != node->children && text_append(&out, &len, &cap, " ") != ANCIBLE_SUCCESS) ||
+                text_append(&out, &len, &cap, child->key) != ANCIBLE_SUCCESS ||
+                text_append(&out, &len, &cap, "=") != ANCIBLE_SUCCESS ||
+                text_append(&out, &len, &cap, value) != ANCIBLE_SUCCESS) {
+                free(value);
+                free(out);
+                return ANCIBLE_ERROR;
+            }
+            free(value);
+        }
+        *args = out;
+        return ANCIBLE_SUCCESS;
+    } else {
+        *args = yaml_node_text(node);
+    }
+
+    if (!*args) {
+        fprintf(stderr, "Error: Failed to allocate memory for task arguments\n");
+        return ANCIBLE_ERROR;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Structure to hold the state of a compilation
+ */
+typedef struct {
+    play_t *play;         // Play (or task file) being compiled
+    int capacity;         // Allocated capacity of play->tasks
+    char *base_dir;       // Directory relative include paths are resolved against
+    int depth;            // Nesting depth of imported files
+} compiler_t;
+
+/**
+ * Structure to hold a cached task or vars file
+ */
+typedef struct parsed_file {
+    char *path;               // Resolved path of the file
+    yaml_node_t *root;        // Parsed document (NULL if the file failed to parse)
+    play_t *tasks;            // Compiled tasks for dynamic includes (NULL until first include)
+    struct parsed_file *next; // Next file in the cache
+} parsed_file_t;
+
+// Files parsed so far, shared between plays, includes and preload threads
+static parsed_file_t *file_cache = NULL;
+static pthread_mutex_t file_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int compile_task_list(compiler_t *c, const yaml_node_t *list, int parent_idx);
+static int compile_task(compiler_t *c, const yaml_node_t *node, int parent_idx);
+static int compile_vars(const yaml_node_t *vars, variable_t **list);
+static int play_build_scopes(play_t *play);
+static void play_free(play_t *play);
+
+/**
+ * Join a directory and a path (absolute paths are returned unchanged)
+ *
+ * @return Newly allocated path, or NULL on error
+ */
+static char *path_join(const char *dir, const char *path) {
+    if (path[0] == '/' || !dir || !dir[0]) {
+        return strdup(path);
+    }
+
+    size_t len = strlen(dir) + strlen(path) + 2;
+    char *joined = malloc(len);
+    if (joined) {
+        snprintf(joined, len, "%s/%s", dir, path);
+    }
+    return joined;
+}
+
+/**
+ * Get the directory part of a path
+ *
+ * @return Newly allocated directory, or NULL on error
+ */
+static char *path_dirname(const char *path) {
+    const char *slash = strrchr(path, '/');
+
+    if (!slash) {
+        return strdup(".");
+    }
+    if (slash == path) {
+        return strdup("/");
+    }
+
+    char *dir = malloc((size_t)(slash - path) + 1);
+    if (dir) {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    }
+    return dir;
+}
+
+/**
+ * Check if a regular file exists
+ */
+static int file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+/**
+ * Load a file through the cache, parsing it on first use
+ *
+ * Parsing happens outside the lock so that preload threads work in parallel;
+ * if two threads race on the same file the first result is kept.
+ *
+ * @param filename Path to the file
+ * @return Cache entry (check root for parse errors), or NULL on allocation error
+ */
+static parsed_file_t *file_cache_load(const char *filename) {
+    char resolved[PATH_MAX];
+    const char *key = realpath(filename, resolved) ? resolved : filename;
+
+    pthread_mutex_lock(&file_cache_lock);
+    for (parsed_file_t *file = file_cache; file; file = file->next) {
+        if (strcmp(file->path, key) == 0) {
+            pthread_mutex_unlock(&file_cache_lock);
+            return file;
+        }
+    }
+    pthread_mutex_unlock(&file_cache_lock);
+
+    parsed_file_t *entry = calloc(1, sizeof(parsed_file_t));
+    if (!entry || !(entry->path = strdup(key))) {
+        fprintf(stderr, "Error: Failed to allocate memory for file cache\n");
+        free(entry);
+        return NULL;
+    }
+    entry->root = yaml_parse_file(filename);
+
+    pthread_mutex_lock(&file_cache_lock);
+    for (parsed_file_t *file = file_cache; file; file = file->next) {
+        if (strcmp(file->path, key) == 0) {
+            pthread_mutex_unlock(&file_cache_lock);
+            yaml_free(entry->root);
+            free(entry->path);
+            free(entry);
+            return file;
+        }
+    }
+    entry->next = file_cache;
+    file_cache = entry;
+    pthread_mutex_unlock(&file_cache_lock);
+
+    return entry;
+}
+
+/**
+ * Structure to hold the work queue of preload threads
+ */
+typedef struct {
+    char **paths;             // Files to parse
+    int count;                // Number of files
+    int next;                 // Next file to hand out
+    pthread_mutex_t lock;     // Protects next
+} preload_queue_t;
+
+/**
+ * Preload thread: parse files from the queue until it is empty
+ */
+static void *preload_worker(void *arg) {
+    preload_queue_t *queue = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (i >= queue->count) {
+            break;
+        }
+        file_cache_load(queue->paths[i]);
+    }
+
+    return NULL;
+}
+
+/**
+ * Parse independent files in parallel, filling the cache
+ *
+ * Errors are not reported here; they surface when the files are compiled.
+ *
+ * @param paths Files to parse
+ * @param count Number of files
+ */
+static void preload_files(char **paths, int count) {
+    preload_queue_t queue = { paths, count, 0, PTHREAD_MUTEX_INITIALIZER };
+    pthread_t threads[MAX_PRELOAD_THREADS];
+    int started = 0;
+
+    if (count > 1) {
+        int wanted = count < MAX_PRELOAD_THREADS ? count : MAX_PRELOAD_THREADS;
+        while (started < wanted && pthread_create(&threads[started], NULL, preload_worker, &queue) == 0) {
+            started++;
+        }
+    }
+
+    // Whatever was not picked up by a thread is parsed here
+    preload_worker(&queue);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+}
+
+/**
+ * Append an empty task to the play being compiled
+ *
+ * @param c Compiler state
+ * @param parent_idx Index of the parent block (-1 if top-level)
+ * @return Index of the new task, or -1 on error
+ */
+static int play_add_task(compiler_t *c, int parent_idx) {
+    play_t *play = c->play;
+
+    if (play->task_count >= c->capacity) {
+        int new_capacity = c->capacity ? c->capacity * 2 : 16;
+        task_t *tasks = realloc(play->tasks, (size_t)new_capacity * sizeof(task_t));
+        if (!tasks) {
+            fprintf(stderr, "Error: Failed to allocate memory for tasks\n");
+            return -1;
+        }
+        play->tasks = tasks;
+        c->capacity = new_capacity;
+    }
+
+    int idx = play->task_count++;
+    task_t *task = &play->tasks[idx];
+    memset(task, 0, sizeof(task_t));
+    task->type = TASK_TYPE_NORMAL;
+    task->parent_idx = parent_idx;
+
+    return idx;
+}
+
+/**
+ * Add a task to the subtask list of its parent
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int task_link(play_t *play, int parent_idx, int idx) {
+    if (parent_idx < 0) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    task_t *parent = &play->tasks[parent_idx];
+    int *indices = realloc(parent->subtask_indices, (size_t)(parent->subtask_count + 1) * sizeof(int));
+    if (!indices) {
+        fprintf(stderr, "Error: Failed to allocate memory for subtasks\n");
+        return ANCIBLE_ERROR;
+    }
+
+    indices[parent->subtask_count++] = idx;
+    parent->subtask_indices = indices;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile the tasks of another file in place (import_tasks and roles)
+ *
+ * @param c Compiler state
+ * @param filename Path to the task file
+ * @param parent_idx Index of the parent entry (-1 if top-level)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_import(compiler_t *c, const char *filename, int parent_idx) {
+    if (c->depth >= MAX_IMPORT_DEPTH) {
+        fprintf(stderr, "Error: Too many nested imports at %s\n", filename);
+        return ANCIBLE_ERROR;
+    }
+
+    parsed_file_t *file = file_cache_load(filename);
+    if (!file || !file->root) {
+        fprintf(stderr, "Error: Failed to import tasks from %s\n", filename);
+        return ANCIBLE_ERROR;
+    }
+
+    char *saved_dir = c->base_dir;
+    c->base_dir = path_dirname(filename);
+    if (!c->base_dir) {
+        fprintf(stderr, "Error: Failed to allocate memory for path\n");
+        c->base_dir = saved_dir;
+        return ANCIBLE_ERROR;
+    }
+
+    c->depth++;
+    int result = compile_task_list(c, file->root, parent_idx);
+    c->depth--;
+
+    free(c->base_dir);
+    c->base_dir = saved_dir;
+    return result;
+}
+
+/**
+ * Compile a list of tasks into subtasks of a block, rescue or always entry
+ *
+ * @param c Compiler state
+ * @param list Sequence node holding the tasks
+ * @param parent_idx Index of the parent entry (-1 if top-level)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_task_list(compiler_t *c, const yaml_node_t *list, int parent_idx) {
+    if (list->type == YAML_SCALAR && list->value[0] == '\0') {
+        return ANCIBLE_SUCCESS;
+    }
+
+    if (list->type != YAML_SEQ) {
+        fprintf(stderr, "Error: line %d: Expected a list of tasks\n", list->line);
+        return ANCIBLE_ERROR;
+    }
+
+    for (const yaml_node_t *item = list->children; item; item = item->next) {
+        if (compile_task(c, item, parent_idx) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile a rescue or always section of a block
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_section(compiler_t *c, const yaml_node_t *list, int block_idx, task_type_t type) {
+    int idx = play_add_task(c, block_idx);
+    if (idx < 0) {
+        return ANCIBLE_ERROR;
+    }
+
+    c->play->tasks[idx].type = type;
+    return compile_task_list(c, list, idx);
+}
+
+/**
+ * Compile the register keyword of a task
+ *
+ * @param task Task
+ * @param entry "register" entry
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_register(task_t *task, const yaml_node_t *entry) {
+    const char *name = entry->type == YAML_SCALAR ? entry->value : "";
+    int valid = isalpha((unsigned char)name[0]) || name[0] == '_';
+    for (const char *p = name; valid && *p; p++) {
+        valid = isalnum((unsigned char)*p) || *p == '_';
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: line %d: register expects a variable name\n", entry->line);
+        return ANCIBLE_ERROR;
+    }
+
+    // Resolved now, so results are stored by symbol ID
+    task->register_var = strdup(name);
+    task->register_key = task->register_var ? symbol_intern(name) : -1;
+    if (task->register_key < 0) {
+        fprintf(stderr, "Error: Failed to allocate memory for register name\n");
+        return ANCIBLE_ERROR;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Get the text of a when condition
+ *
+ * A list of conditions must all hold, so it is joined into a single
+ * condition with "and".
+ *
+ * @param node Value of the when key
+ * @return Newly allocated condition text, or NULL on error
+ */
+static char *when_text(const yaml_node_t *node) {
+    if (node->type != YAML_SEQ) {
+        return yaml_node_text(node);
+    }
+    if (!node->children) {
+        return strdup("true");
+    }
+    if (!node->children->next) {
+        return yaml_node_text(node->children);
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    for (const yaml_node_t *child = node->children; child; child = child->next) {
+        char *item = yaml_node_text(child);
+        char *grown = item ? realloc(text, length + strlen(item) + 8) : NULL;
+        if (!grown) {
+            free(item);
+            free(text);
+            return NULL;
+        }
+        text = grown;
+        length += (size_t)sprintf(text + length, "%s(%s)", length > 0 ? " and " : "", item);
+        free(item);
+    }
+
+    return text;
+}
+
+/**
+ * Compile the templates of a task (name, when condition, module arguments)
+ *
+ * The path of an include is used as written. A when condition is compiled
+ * into a condition tree when the condition compiler handles it; one with
+ * {{ }} expressions beyond it (filters) is kept as a template (rendered,
+ * then compiled as text), and anything else is an error.
+ *
+ * @param task Task whose text fields are set
+ * @param line Line of the task, for errors
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_templates(task_t *task, int line) {
+    if (task->when && !(task->condition = condition_compile(task->when)) && !strstr(task->when, "{{")) {
+        fprintf(stderr, "Error: line %d: Invalid condition in task '%s': %s\n", line,
+                task->name ? task->name : "unnamed", task->when);
+        return ANCIBLE_ERROR;
+    }
+    if ((task->name && !(task->name_template = template_compile(task->name))) ||
+        (task->when && !task->condition && !(task->when_template = template_compile(task->when))) ||
+        (task->args && task->type != TASK_TYPE_INCLUDE && !(task->args_template = template_compile(task->args)))) {
+        fprintf(stderr, "Error: line %d: Invalid template in task '%s'\n", line, task->name ? task->name : "unnamed");
+        return ANCIBLE_ERROR;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile an import_tasks entry
+ *
+ * The imported tasks are inlined; a "when" on the import wraps them in a
+ * block so the condition guards all of them.
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_import_entry(compiler_t *c, const yaml_node_t *node, const yaml_node_t *import, int parent_idx) {
+    if (import->type != YAML_SCALAR || import->value[0] == '\0') {
+        fprintf(stderr, "Error: line %d: import_tasks expects a file name\n", import->line);
+        return ANCIBLE_ERROR;
+    }
+
+    char *path = path_join(c->base_dir, import->value);
+    if (!path) {
+        fprintf(stderr, "Error: Failed to allocate memory for path\n");
+        return ANCIBLE_ERROR;
+    }
+
+    const yaml_node_t *when = yaml_map_get(node, "when");
+    if (when) {
+        int idx = play_add_task(c, parent_idx);
+        if (idx < 0 || task_link(c->play, parent_idx, idx) != ANCIBLE_SUCCESS) {
+            free(path);
+            return ANCIBLE_ERROR;
+        }
+
+        task_t *block = &c->play->tasks[idx];
+        block->type = TASK_TYPE_BLOCK;
+        block->name = yaml_node_text(yaml_map_get(node, "name") ? yaml_map_get(node, "name") : import);
+        block->when = when_text(when);
+        if (!block->name || !block->when) {
+            fprintf(stderr, "Error: Failed to allocate memory for import\n");
+            free(path);
+            return ANCIBLE_ERROR;
+        }
+        if (compile_templates(block, when->line) != ANCIBLE_SUCCESS) {
+            free(path);
+            return ANCIBLE_ERROR;
+        }
+        parent_idx = idx;
+    }
+
+    int result = compile_import(c, path, parent_idx);
+    free(path);
+    return result;
+}
+
+/**
+ * Compile the loop of a task (loop: or with_items:)
+ *
+ * A list is stored item by item; a scalar names the variable holding the
+ * list ("{{ packages }}" or a bare name) and is resolved when the task runs.
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_loop(task_t *task, const yaml_node_t *loop) {
+    if (task->loop_items || task->loop_var) {
+        fprintf(stderr, "Error: line %d: A task can only have one loop\n", loop->line);
+        return ANCIBLE_ERROR;
+    }
+
+    if (loop->type == YAML_SEQ) {
+        task->loop_items = calloc(loop->child_count > 0 ? (size_t)loop->child_count : 1, sizeof(char *));
+        if (!task->loop_items) {
+            fprintf(stderr, "Error: Failed to allocate memory for loop items\n");
+            return ANCIBLE_ERROR;
+        }
+
+        for (const yaml_node_t *item = loop->children; item; item = item->next) {
+            task->loop_items[task->loop_count] = yaml_node_text(item);
+            if (!task->loop_items[task->loop_count]) {
+                fprintf(stderr, "Error: Failed to allocate memory for loop items\n");
+                return ANCIBLE_ERROR;
+            }
+            task->loop_count++;
+        }
+        return ANCIBLE_SUCCESS;
+    }
+
+    if (loop->type != YAML_SCALAR || loop->value[0] == '\0') {
+        fprintf(stderr, "Error: line %d: Loop must be a list or a variable\n", loop->line);
+        return ANCIBLE_ERROR;
+    }
+
+    const char *start = loop->value;
+    const char *end = start + strlen(start);
+    if (strncmp(start, "{{", 2) == 0 && end - start >= 4 && strncmp(end - 2, "}}", 2) == 0) {
+        start += 2;
+        end -= 2;
+    }
+    while (start < end && isspace((unsigned char)*start)) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+
+    if (start == end) {
+        fprintf(stderr, "Error: line %d: Loop variable is empty\n", loop->line);
+        return ANCIBLE_ERROR;
+    }
+
+    task->loop_var = malloc((size_t)(end - start) + 1);
+    if (!task->loop_var) {
+        fprintf(stderr, "Error: Failed to allocate memory for loop variable\n");
+        return ANCIBLE_ERROR;
+    }
+    memcpy(task->loop_var, start, (size_t)(end - start));
+    task->loop_var[end - start] = '\0';
+
+    return ANCIBLE_SUCCESS;
+}
 
 /**
- * Simple YAML parser for playbooks
- * 
- * This is a very simplified parser that only extracts hosts and task names/modules
- * from a playbook. It does not handle complex YAML structures.
+ * Compile the loop_control of a task
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
+static int compile_loop_control(task_t *task, const yaml_node_t *control) {
+    if (control->type != YAML_MAP) {
+        fprintf(stderr, "Error: line %d: loop_control must be a mapping\n", control->line);
+        return ANCIBLE_ERROR;
+    }
+
+    const yaml_node_t *batch = yaml_map_get(control, "batch");
+    if (batch) {
+        task->loop_batch = batch->type == YAML_SCALAR &&
+                           (strcasecmp(batch->value, "true") == 0 || strcasecmp(batch->value, "yes") == 0 ||
+                            strcmp(batch->value, "1") == 0);
+    }
+
+    const yaml_node_t *parallel = yaml_map_get(control, "parallel");
+    if (parallel) {
+        char *end;
+        long width = parallel->type == YAML_SCALAR ? strtol(parallel->value, &end, 10) : 0;
+        if (parallel->type != YAML_SCALAR || *end != '\0' || width < 1 || width > MAX_LOOP_PARALLEL) {
+            fprintf(stderr, "Error: line %d: loop_control.parallel must be between 1 and %d\n",
+                    parallel->line, MAX_LOOP_PARALLEL);
+            return ANCIBLE_ERROR;
+        }
+        task->loop_parallel = (int)width;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile a single task (or block) mapping
+ *
+ * @param c Compiler state
+ * @param node Mapping node of the task
+ * @param parent_idx Index of the parent entry (-1 if top-level)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_task(compiler_t *c, const yaml_node_t *node, int parent_idx) {
+    if (node->type != YAML_MAP) {
+        fprintf(stderr, "Error: line %d: Task must be a mapping\n", node->line);
+        return ANCIBLE_ERROR;
+    }
+
+    const yaml_node_t *import = yaml_map_get(node, "import_tasks");
+    if (import) {
+        return compile_import_entry(c, node, import, parent_idx);
+    }
+
+    int idx = play_add_task(c, parent_idx);
+    if (idx < 0 || task_link(c->play, parent_idx, idx) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    const yaml_node_t *block = NULL;
+    const yaml_node_t *rescue = NULL;
+    const yaml_node_t *always = NULL;
+
+    for (const yaml_node_t *entry = node->children; entry; entry = entry->next) {
+        task_t *task = &c->play->tasks[idx];
+
+        if (strcmp(entry->key, "name") == 0) {
+            task->name = yaml_node_text(entry);
+            if (!task->name) {
+                fprintf(stderr, "Error: Failed to allocate memory for task name\n");
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "when") == 0) {
+            task->when = when_text(entry);
+            if (!task->when) {
+                fprintf(stderr, "Error: Failed to allocate memory for task when condition\n");
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "register") == 0) {
+            if (compile_register(task, entry) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "loop") == 0 || strcmp(entry->key, "with_items") == 0) {
+            if (compile_loop(task, entry) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "loop_control") == 0) {
+            if (compile_loop_control(task, entry) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "vars") == 0) {
+            if (compile_vars(entry, &task->vars) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        } else if (strcmp(entry->key, "block") == 0) {
+            block = entry;
+        } else if (strcmp(entry->key, "rescue") == 0) {
+            rescue = entry;
+        } else if (strcmp(entry->key, "always") == 0) {
+            always = entry;
+        } else if (strcmp(entry->key, "include_tasks") == 0) {
+            // Resolved now, loaded through the cache when the task runs
+            if (entry->type != YAML_SCALAR || entry->value[0] == '\0') {
+                fprintf(stderr, "Error: line %d: include_tasks expects a file name\n", entry->line);
+                return ANCIBLE_ERROR;
+            }
+            task->type = TASK_TYPE_INCLUDE;
+            task->args = path_join(c->base_dir, entry->value);
+            if (!task->name && !yaml_map_get(node, "name")) {
+                task->name = strdup(entry->value);
+            }
+            if (!task->args || (!task->name && !yaml_map_get(node, "name"))) {
+                fprintf(stderr, "Error: Failed to allocate memory for include path\n");
+                return ANCIBLE_ERROR;
+            }
+        } else if (!is_task_keyword(entry->key) && !task->module) {
+            task->module = strdup(entry->key);
+            if (!task->module) {
+                fprintf(stderr, "Error: Failed to allocate memory for task module\n");
+                return ANCIBLE_ERROR;
+            }
+            if (node_to_args(entry, &task->args) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        }
+    }
+
+    if ((rescue || always) && !block) {
+        fprintf(stderr, "Error: line %d: 'rescue' and 'always' are only valid in a block\n", node->line);
+        return ANCIBLE_ERROR;
+    }
+
+    // Parallel items run on copies of the host's context, so facts they set would be lost
+    const task_t *task = &c->play->tasks[idx];
+    int sets_facts = task->type == TASK_TYPE_INCLUDE || (task->module && strcmp(task->module, "set_fact") == 0);
+    if (task->loop_parallel > 1 && sets_facts) {
+        fprintf(stderr, "Error: line %d: loop_control.parallel cannot be used with %s, as facts set by its items "
+                "would be lost\n", node->line, task->type == TASK_TYPE_INCLUDE ? "include_tasks" : "set_fact");
+        return ANCIBLE_ERROR;
+    }
+
+    if (compile_templates(&c->play->tasks[idx], node->line) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    if (block) {
+        c->play->tasks[idx].type = TASK_TYPE_BLOCK;
+        if (compile_task_list(c, block, idx) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (rescue && compile_section(c, rescue, idx, TASK_TYPE_RESCUE) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (always && compile_section(c, always, idx, TASK_TYPE_ALWAYS) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile a vars mapping into a variable list
+ *
+ * @param vars Mapping node
+ * @param list Pointer to the head of the list to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_vars(const yaml_node_t *vars, variable_t **list) {
+    if (vars->type == YAML_SCALAR && vars->value[0] == '\0') {
+        return ANCIBLE_SUCCESS;
+    }
+
+    if (vars->type != YAML_MAP) {
+        fprintf(stderr, "Error: line %d: Vars must be a mapping\n", vars->line);
+        return ANCIBLE_ERROR;
+    }
+
+    variable_t **tail = list;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+
+    for (const yaml_node_t *entry = vars->children; entry; entry = entry->next) {
+        variable_t *var = calloc(1, sizeof(variable_t));
+        if (!var) {
+            fprintf(stderr, "Error: Failed to allocate memory for variable\n");
+            return ANCIBLE_ERROR;
+        }
+        *tail = var;
+        tail = &var->next;
+
+        var->name = strdup(entry->key);
+        var->value = yaml_node_text(entry);
+        if (!var->name || !var->value) {
+            fprintf(stderr, "Error: Failed to allocate memory for variable\n");
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile the vars file of a role into a variable list, if it exists
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_vars_file(const char *filename, variable_t **list) {
+    if (!file_exists(filename)) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    parsed_file_t *file = file_cache_load(filename);
+    if (!file || !file->root) {
+        fprintf(stderr, "Error: Failed to load variables from %s\n", filename);
+        return ANCIBLE_ERROR;
+    }
+
+    return compile_vars(file->root, list);
+}
+
+/**
+ * Get the name of a role entry ("- common" or "- role: common")
+ *
+ * @return Role name, or NULL if the entry is invalid
+ */
+static const char *role_name(const yaml_node_t *entry) {
+    if (entry->type == YAML_SCALAR) {
+        return entry->value[0] ? entry->value : NULL;
+    }
+
+    const yaml_node_t *name = yaml_map_get(entry, "role");
+    if (!name) {
+        name = yaml_map_get(entry, "name");
+    }
+    return name && name->type == YAML_SCALAR && name->value[0] ? name->value : NULL;
+}
 
 /**
- * Parse a YAML playbook file
- * 
- * @param filename Path to the YAML playbook file
- * @param playbook Pointer to playbook structure to fill
+ * Compile the roles of a play
+ *
+ * Role tasks run before the play's own tasks. Role defaults are kept apart,
+ * below every other variable; role vars come after the play vars, so they win.
+ *
+ * @param c Compiler state
+ * @param roles Sequence node of the roles
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
-int parse_playbook(const char *filename, playbook_t *playbook) {
-    FILE *file = NULL;
-    char line[MAX_LINE_LENGTH];
+static int compile_roles(compiler_t *c, const yaml_node_t *roles) {
+    variable_t *defaults = NULL;
+    variable_t *vars = NULL;
     int result = ANCIBLE_ERROR;
-    int in_tasks = 0;
-    int current_task = -1;
-    int in_block = 0;
-    int in_rescue = 0;
-    int in_always = 0;
-    int current_block = -1;
-    int current_indent = 0;
-    int block_indent = 0;
-    
-    // Initialize playbook structure
-    memset(playbook, 0, sizeof(playbook_t));
-    
-    // Allocate memory for tasks
-    playbook->tasks = malloc(MAX_TASKS * sizeof(task_t));
-    if (!playbook->tasks) {
-        fprintf(stderr, "Error: Failed to allocate memory for tasks\n");
-        return ANCIBLE_ERROR;
-    }
-    
-    // Initialize tasks
-    for (int i = 0; i < MAX_TASKS; i++) {
-        playbook->tasks[i].name = NULL;
-        playbook->tasks[i].module = NULL;
-        playbook->tasks[i].when = NULL;
-        playbook->tasks[i].type = TASK_TYPE_NORMAL;
-        playbook->tasks[i].parent_idx = -1;
-        playbook->tasks[i].subtask_count = 0;
-        playbook->tasks[i].subtask_indices = NULL;
-    }
-    
-    // Open file
-    file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Failed to open file: %s\n", filename);
+
+    if (roles->type == YAML_SCALAR && roles->value[0] == '\0') {
+        return ANCIBLE_SUCCESS;
+    }
+
+    if (roles->type != YAML_SEQ) {
+        fprintf(stderr, "Error: line %d: Roles must be a list\n", roles->line);
         return ANCIBLE_ERROR;
     }
-    
-    // Parse file line by line
-    while (fgets(line, sizeof(line), file)) {
-        // Remove trailing newline
-        size_t len = strlen(line);
-        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) {
-            line[--len] = '\0';
+
+    for (const yaml_node_t *entry = roles->children; entry; entry = entry->next) {
+        const char *name = role_name(entry);
+        if (!name) {
+            fprintf(stderr, "Error: line %d: Role without a name\n", entry->line);
+            goto cleanup;
         }
-        
-        // Skip empty lines and comments
-        if (len == 0 || line[0] == '#' || (line[0] == ' ' && line[1] == '#')) {
-            continue;
+
+        char path[PATH_MAX];
+        char *role_dir = path_join(c->base_dir, "roles");
+        if (!role_dir) {
+            fprintf(stderr, "Error: Failed to allocate memory for path\n");
+            goto cleanup;
         }
-        
-        // Calculate indentation
-        current_indent = 0;
-        while (current_indent < (int)len && line[current_indent] == ' ') {
-            current_indent++;
-        }
-        
-        // Extract hosts (handle both "hosts: all" and "- hosts: all" formats)
-        if (strstr(line, "hosts:")) {
-            char *hosts_start = strchr(line, ':') + 1;
-            while (isspace(*hosts_start)) hosts_start++;
-            
-            playbook->hosts = strdup(hosts_start);
-            if (!playbook->hosts) {
-                fprintf(stderr, "Error: Failed to allocate memory for hosts\n");
-                goto cleanup;
-            }
+        snprintf(path, sizeof(path), "%s/%s", role_dir, name);
+        free(role_dir);
+
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            fprintf(stderr, "Error: line %d: Role '%s' not found in %s\n", entry->line, name, path);
+            goto cleanup;
         }
-        
-        // Check if we're in the tasks section
-        if (strstr(line, "tasks:")) {
-            in_tasks = 1;
-            continue;
+
+        size_t dir_len = strlen(path);
+        snprintf(path + dir_len, sizeof(path) - dir_len, "/defaults/main.yml");
+        if (compile_vars_file(path, &defaults) != ANCIBLE_SUCCESS) {
+            goto cleanup;
         }
-        
-        // Parse tasks
-        if (in_tasks) {
-            // Check for block start
-            if (strstr(line, "block:")) {
-                // Convert the current task to a block (if it exists)
-                if (current_task >= 0) {
-                    playbook->tasks[current_task].type = TASK_TYPE_BLOCK;
-                    playbook->tasks[current_task].subtask_indices = malloc(MAX_SUBTASKS * sizeof(int));
-                    if (!playbook->tasks[current_task].subtask_indices) {
-                        fprintf(stderr, "Error: Failed to allocate memory for subtasks\n");
-                        goto cleanup;
-                    }
-                    
-                    // Update state
-                    current_block = current_task;
-                    in_block = 1;
-                    block_indent = current_indent;
-                } else {
-                    // Create a new block task if no current task
-                    current_task++;
-                    if (current_task >= MAX_TASKS) {
-                        fprintf(stderr, "Error: Too many tasks (max %d)\n", MAX_TASKS);
-                        goto cleanup;
-                    }
-                    
-                    // Set block properties
-                    playbook->tasks[current_task].type = TASK_TYPE_BLOCK;
-                    playbook->tasks[current_task].subtask_indices = malloc(MAX_SUBTASKS * sizeof(int));
-                    if (!playbook->tasks[current_task].subtask_indices) {
-                        fprintf(stderr, "Error: Failed to allocate memory for subtasks\n");
+
+        snprintf(path + dir_len, sizeof(path) - dir_len, "/vars/main.yml");
+        if (compile_vars_file(path, &vars) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+
+        // Parameters given with the role ("- role: web, port: 80")
+        if (entry->type == YAML_MAP) {
+            for (const yaml_node_t *param = entry->children; param; param = param->next) {
+                if (strcmp(param->key, "role") == 0 || strcmp(param->key, "name") == 0) {
+                    continue;
+                }
+                if (strcmp(param->key, "vars") == 0) {
+                    if (compile_vars(param, &vars) != ANCIBLE_SUCCESS) {
                         goto cleanup;
                     }
-                    
-                    // Update state
-                    current_block = current_task;
-                    in_block = 1;
-                    block_indent = current_indent;
-                    
-                    // Update task count
-                    playbook->task_count = current_task + 1;
-                }
-                continue;
-            }
-            
-            // Check for rescue block
-            if (strstr(line, "rescue:")) {
-                if (!in_block || current_block < 0) {
-                    fprintf(stderr, "Error: 'rescue' outside of a block\n");
-                    goto cleanup;
+                    continue;
                 }
-                
-                // Create a new task for the rescue block
-                current_task++;
-                if (current_task >= MAX_TASKS) {
-                    fprintf(stderr, "Error: Too many tasks (max %d)\n", MAX_TASKS);
+
+                variable_t *var = calloc(1, sizeof(variable_t));
+                if (!var || !(var->name = strdup(param->key)) || !(var->value = yaml_node_text(param))) {
+                    fprintf(stderr, "Error: Failed to allocate memory for variable\n");
+                    if (var) {
+                        free(var->name);
+                        free(var);
+                    }
                     goto cleanup;
                 }
-                
-                // Set rescue block properties
-                playbook->tasks[current_task].type = TASK_TYPE_RESCUE;
-                playbook->tasks[current_task].parent_idx = current_block;
-                playbook->tasks[current_task].subtask_indices = malloc(MAX_SUBTASKS * sizeof(int));
-                if (!playbook->tasks[current_task].subtask_indices) {
-                    fprintf(stderr, "Error: Failed to allocate memory for subtasks\n");
-                    goto cleanup;
+                variable_t **tail = &vars;
+                while (*tail) {
+                    tail = &(*tail)->next;
                 }
-                
-                // Update state
-                in_block = 0;
-                in_rescue = 1;
-                
-                // Update task count
-                playbook->task_count = current_task + 1;
-                continue;
+                *tail = var;
             }
-            
-            // Check for always block
-            if (strstr(line, "always:")) {
-                if (!in_block && !in_rescue) {
-                    fprintf(stderr, "Error: 'always' outside of a block or rescue\n");
-                    goto cleanup;
-                }
-                
-                // Create a new task for the always block
-                current_task++;
-                if (current_task >= MAX_TASKS) {
-                    fprintf(stderr, "Error: Too many tasks (max %d)\n", MAX_TASKS);
-                    goto cleanup;
-                }
-                
-                // Set always block properties
-                playbook->tasks[current_task].type = TASK_TYPE_ALWAYS;
-                playbook->tasks[current_task].parent_idx = current_block;
-                playbook->tasks[current_task].subtask_indices = malloc(MAX_SUBTASKS * sizeof(int));
-                if (!playbook->tasks[current_task].subtask_indices) {
-                    fprintf(stderr, "Error: Failed to allocate memory for subtasks\n");
-                    goto cleanup;
-                }
-                
-                // Update state
-                in_block = 0;
-                in_rescue = 0;
-                in_always = 1;
-                
-                // Update task count
-                playbook->task_count = current_task + 1;
+        }
+
+        snprintf(path + dir_len, sizeof(path) - dir_len, "/tasks/main.yml");
+        if (file_exists(path) && compile_import(c, path, -1) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+
+    result = ANCIBLE_SUCCESS;
+
+cleanup:
+    // Defaults of later roles win over those of earlier ones
+    if (defaults) {
+        variable_t **tail = &c->play->defaults;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+        *tail = defaults;
+    }
+    if (vars) {
+        variable_t **tail = &c->play->vars;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+        *tail = vars;
+    }
+
+    return result;
+}
+
+/**
+ * Collect the role files of a play so they can be parsed in parallel
+ *
+ * @param play Mapping node of the play
+ * @param base_dir Directory of the playbook
+ * @param paths Pointer to the growable list of paths
+ * @param count Pointer to the number of paths
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int collect_role_files(const yaml_node_t *play, const char *base_dir, char ***paths, int *count) {
+    static const char *role_files[] = { "tasks/main.yml", "defaults/main.yml", "vars/main.yml" };
+    const yaml_node_t *roles = play->type == YAML_MAP ? yaml_map_get(play, "roles") : NULL;
+
+    if (!roles || roles->type != YAML_SEQ) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    for (const yaml_node_t *entry = roles->children; entry; entry = entry->next) {
+        const char *name = role_name(entry);
+        if (!name) {
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(role_files) / sizeof(role_files[0]); i++) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/roles/%s/%s", base_dir, name, role_files[i]);
+            if (!file_exists(path)) {
                 continue;
             }
-            
-            // Check for task name (handle "- name:" format)
-            if (strstr(line, "name:")) {
-                // Check if we're exiting a block based on indentation
-                if ((in_block || in_rescue || in_always) && current_indent <= block_indent) {
-                    in_block = 0;
-                    in_rescue = 0;
-                    in_always = 0;
-                    current_block = -1;
-                }
-                
-                // Create a new task
-                current_task++;
-                if (current_task >= MAX_TASKS) {
-                    fprintf(stderr, "Error: Too many tasks (max %d)\n", MAX_TASKS);
-                    goto cleanup;
-                }
-                
-                // Extract task name
-                char *name_start = strchr(line, ':') + 1;
-                while (isspace(*name_start)) name_start++;
-                
-                playbook->tasks[current_task].name = strdup(name_start);
-                if (!playbook->tasks[current_task].name) {
-                    fprintf(stderr, "Error: Failed to allocate memory for task name\n");
-                    goto cleanup;
-                }
-                
-                // Set parent if inside a block
-                if (in_block) {
-                    playbook->tasks[current_task].parent_idx = current_block;
-                    
-                    // Add this task to the block's subtasks
-                    int subtask_idx = playbook->tasks[current_block].subtask_count;
-                    if (subtask_idx >= MAX_SUBTASKS) {
-                        fprintf(stderr, "Error: Too many subtasks in block (max %d)\n", MAX_SUBTASKS);
-                        goto cleanup;
-                    }
-                    
-                    playbook->tasks[current_block].subtask_indices[subtask_idx] = current_task;
-                    playbook->tasks[current_block].subtask_count++;
-                } else if (in_rescue) {
-                    playbook->tasks[current_task].parent_idx = current_task - 1; // Rescue block
-                    
-                    // Add this task to the rescue block's subtasks
-                    int rescue_block = current_task - 1;
-                    int subtask_idx = playbook->tasks[rescue_block].subtask_count;
-                    if (subtask_idx >= MAX_SUBTASKS) {
-                        fprintf(stderr, "Error: Too many subtasks in rescue block (max %d)\n", MAX_SUBTASKS);
-                        goto cleanup;
-                    }
-                    
-                    playbook->tasks[rescue_block].subtask_indices[subtask_idx] = current_task;
-                    playbook->tasks[rescue_block].subtask_count++;
-                } else if (in_always) {
-                    playbook->tasks[current_task].parent_idx = current_task - 1; // Always block
-                    
-                    // Add this task to the always block's subtasks
-                    int always_block = current_task - 1;
-                    int subtask_idx = playbook->tasks[always_block].subtask_count;
-                    if (subtask_idx >= MAX_SUBTASKS) {
-                        fprintf(stderr, "Error: Too many subtasks in always block (max %d)\n", MAX_SUBTASKS);
-                        goto cleanup;
-                    }
-                    
-                    playbook->tasks[always_block].subtask_indices[subtask_idx] = current_task;
-                    playbook->tasks[always_block].subtask_count++;
-                }
-                
-                // Update task count
-                playbook->task_count = current_task + 1;
-            }
-            // Check for module name (first indented key after a name)
-            else if (current_task >= 0 && strchr(line, ':') && !playbook->tasks[current_task].module) {
-                // Skip lines that are too indented (like cmd: inside command:)
-                if (current_indent > 12) continue;
-                
-                // Skip if this is a block, rescue, or always
-                if (strstr(line, "block:") || strstr(line, "rescue:") || strstr(line, "always:")) {
-                    continue;
-                }
-                
-                char *module_end = strchr(line, ':');
-                *module_end = '\0';
-                
-                // Find the start of the module name (after spaces)
-                char *module_start = line;
-                while (isspace(*module_start)) module_start++;
-                
-                playbook->tasks[current_task].module = strdup(module_start);
-                if (!playbook->tasks[current_task].module) {
-                    fprintf(stderr, "Error: Failed to allocate memory for task module\n");
-                    goto cleanup;
+
+            char **grown = realloc(*paths, (size_t)(*count + 1) * sizeof(char *));
+            if (!grown || !(grown[*count] = strdup(path))) {
+                fprintf(stderr, "Error: Failed to allocate memory for role files\n");
+                if (grown) {
+                    *paths = grown;
                 }
+                return ANCIBLE_ERROR;
             }
-            // Check for when condition
-            else if (current_task >= 0 && strstr(line, "when:") && !playbook->tasks[current_task].when) {
-                // Extract when condition
-                char *when_start = strchr(line, ':') + 1;
-                while (isspace(*when_start)) when_start++;
-                
-                playbook->tasks[current_task].when = strdup(when_start);
-                if (!playbook->tasks[current_task].when) {
-                    fprintf(stderr, "Error: Failed to allocate memory for task when condition\n");
-                    goto cleanup;
-                }
+            *paths = grown;
+            (*count)++;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Compile a single play mapping
+ *
+ * @param node Mapping node of the play
+ * @param play Pointer to play structure to fill
+ * @param base_dir Directory of the playbook
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_play(const yaml_node_t *node, play_t *play, const char *base_dir) {
+    compiler_t c = { play, 0, NULL, 0 };
+    int result = ANCIBLE_ERROR;
+
+    if (node->type != YAML_MAP) {
+        fprintf(stderr, "Error: line %d: Play must be a mapping\n", node->line);
+        return ANCIBLE_ERROR;
+    }
+
+    const yaml_node_t *name = yaml_map_get(node, "name");
+    const yaml_node_t *hosts = yaml_map_get(node, "hosts");
+    const yaml_node_t *vars = yaml_map_get(node, "vars");
+    const yaml_node_t *roles = yaml_map_get(node, "roles");
+    const yaml_node_t *tasks = yaml_map_get(node, "tasks");
+
+    if (name) {
+        play->name = yaml_node_text(name);
+        if (!play->name) {
+            fprintf(stderr, "Error: Failed to allocate memory for play name\n");
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    if (!hosts || (hosts->type == YAML_SCALAR && hosts->value[0] == '\0')) {
+        fprintf(stderr, "Error: line %d: No hosts specified in play\n", node->line);
+        return ANCIBLE_ERROR;
+    }
+
+    if (hosts->type == YAML_SEQ) {
+        // A list of patterns is the union of its entries
+        size_t len = 1;
+        for (const yaml_node_t *item = hosts->children; item; item = item->next) {
+            len += strlen(item->value ? item->value : "") + 1;
+        }
+        play->hosts = calloc(1, len);
+        for (const yaml_node_t *item = hosts->children; play->hosts && item; item = item->next) {
+            if (item != hosts->children) {
+                strcat(play->hosts, ":");
             }
+            strcat(play->hosts, item->value ? item->value : "");
+        }
+    } else {
+        play->hosts = yaml_node_text(hosts);
+    }
+    if (!play->hosts) {
+        fprintf(stderr, "Error: Failed to allocate memory for hosts\n");
+        return ANCIBLE_ERROR;
+    }
+
+    c.base_dir = strdup(base_dir);
+    if (!c.base_dir) {
+        fprintf(stderr, "Error: Failed to allocate memory for path\n");
+        return ANCIBLE_ERROR;
+    }
+
+    if (vars && compile_vars(vars, &play->vars) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    if (roles && compile_roles(&c, roles) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    if (tasks && compile_task_list(&c, tasks, -1) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    if (play_build_scopes(play) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    result = ANCIBLE_SUCCESS;
+
+cleanup:
+    free(c.base_dir);
+    return result;
+}
+
+/**
+ * Index the variables of a compiled play or task file
+ *
+ * A task's scope holds its own variables over those of its enclosing
+ * blocks; tasks without variables of their own share their block's scope.
+ * Parents always come before their subtasks in the task array.
+ *
+ * @param play Compiled play
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int play_build_scopes(play_t *play) {
+    if ((play->vars && !(play->var_scope = scope_extend(NULL, play->vars))) ||
+        (play->defaults && !(play->default_scope = scope_extend(NULL, play->defaults)))) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (int i = 0; i < play->task_count; i++) {
+        task_t *task = &play->tasks[i];
+        scope_t *parent = task->parent_idx >= 0 ? play->tasks[task->parent_idx].var_scope : NULL;
+
+        if (!task->vars) {
+            task->var_scope = scope_retain(parent);
+        } else if (!(task->var_scope = scope_extend(parent, task->vars))) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Free a variable list
+ *
+ * @param var First variable
+ */
+static void variables_free(variable_t *var) {
+    while (var) {
+        variable_t *next = var->next;
+        free(var->name);
+        free(var->value);
+        free(var);
+        var = next;
+    }
+}
+
+/**
+ * Free resources used by a play
+ *
+ * @param play Pointer to play structure to free
+ */
+static void play_free(play_t *play) {
+    free(play->name);
+    free(play->hosts);
+
+    variables_free(play->vars);
+    variables_free(play->defaults);
+    scope_release(play->var_scope);
+    scope_release(play->default_scope);
+
+    for (int i = 0; i < play->task_count; i++) {
+        variables_free(play->tasks[i].vars);
+        scope_release(play->tasks[i].var_scope);
+        free(play->tasks[i].name);
+        free(play->tasks[i].module);
+        free(play->tasks[i].args);
+        free(play->tasks[i].when);
+        free(play->tasks[i].register_var);
+        template_free(play->tasks[i].name_template);
+        template_free(play->tasks[i].args_template);
+        template_free(play->tasks[i].when_template);
+        condition_free(play->tasks[i].condition);
+        for (int j = 0; j < play->tasks[i].loop_count; j++) {
+            free(play->tasks[i].loop_items[j]);
+        }
+        free(play->tasks[i].loop_items);
+        free(play->tasks[i].loop_var);
+        free(play->tasks[i].subtask_indices);
+    }
+    free(play->tasks);
+
+    memset(play, 0, sizeof(play_t));
+}
+
+/**
+ * Parse a YAML playbook file
+ *
+ * @param filename Path to the YAML playbook file
+ * @param playbook Pointer to playbook structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int parse_playbook(const char *filename, playbook_t *playbook) {
+    int result = ANCIBLE_ERROR;
+    int task_count = 0;
+    char **role_files = NULL;
+    int role_file_count = 0;
+
+    // Initialize playbook structure
+    memset(playbook, 0, sizeof(playbook_t));
+
+    yaml_node_t *root = yaml_parse_file(filename);
+    if (!root) {
+        return ANCIBLE_ERROR;
+    }
+
+    char *base_dir = path_dirname(filename);
+    if (!base_dir) {
+        fprintf(stderr, "Error: Failed to allocate memory for path\n");
+        yaml_free(root);
+        return ANCIBLE_ERROR;
+    }
+
+    // A playbook is a list of plays; a bare mapping is accepted as a single play
+    const yaml_node_t *first = root;
+    int count = 1;
+    if (root->type == YAML_SEQ) {
+        first = root->children;
+        count = root->child_count;
+    }
+
+    if (count == 0 || (root->type == YAML_SCALAR)) {
+        fprintf(stderr, "Error: No plays found in playbook: %s\n", filename);
+        goto cleanup;
+    }
+
+    // Role files do not depend on each other, parse them all up front
+    for (const yaml_node_t *node = first; node; node = root->type == YAML_SEQ ? node->next : NULL) {
+        if (collect_role_files(node, base_dir, &role_files, &role_file_count) != ANCIBLE_SUCCESS) {
+            goto cleanup;
         }
     }
-    
-    // Validate that we found hosts and tasks
-    if (!playbook->hosts) {
-        fprintf(stderr, "Error: No hosts specified in playbook\n");
+    preload_files(role_files, role_file_count);
+
+    playbook->plays = calloc((size_t)count, sizeof(play_t));
+    if (!playbook->plays) {
+        fprintf(stderr, "Error: Failed to allocate memory for plays\n");
         goto cleanup;
     }
-    
-    if (playbook->task_count == 0) {
+
+    for (const yaml_node_t *node = first; node; node = node->next) {
+        play_t *play = &playbook->plays[playbook->play_count++];
+        if (compile_play(node, play, base_dir) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+        task_count += play->task_count;
+
+        if (root->type != YAML_SEQ) {
+            break;
+        }
+    }
+
+    if (task_count == 0) {
         fprintf(stderr, "Error: No tasks found in playbook\n");
         goto cleanup;
     }
-    
+
     result = ANCIBLE_SUCCESS;
-    
+
 cleanup:
-    if (file) {
-        fclose(file);
+    yaml_free(root);
+    free(base_dir);
+
+    for (int i = 0; i < role_file_count; i++) {
+        free(role_files[i]);
     }
-    
+    free(role_files);
+
     if (result != ANCIBLE_SUCCESS) {
         playbook_free(playbook);
     }
-    
+
     return result;
 }
 
+/**
+ * Parse a task file (a YAML list of tasks) through the shared cache
+ *
+ * @param filename Path to the task file
+ * @return Compiled tasks (owned by the cache), or NULL on error
+ */
+play_t *parse_task_file(const char *filename) {
+    parsed_file_t *file = file_cache_load(filename);
+    if (!file) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&file_cache_lock);
+
+    if (!file->tasks && file->root) {
+        play_t *tasks = calloc(1, sizeof(play_t));
+        compiler_t c = { tasks, 0, path_dirname(filename), 0 };
+
+        if (!tasks || !c.base_dir) {
+            fprintf(stderr, "Error: Failed to allocate memory for task file\n");
+            free(tasks);
+        } else {
+            // Unlocked so that nested imports can use the cache
+            pthread_mutex_unlock(&file_cache_lock);
+            int rc = compile_task_list(&c, file->root, -1);
+            if (rc == ANCIBLE_SUCCESS) {
+                rc = play_build_scopes(tasks);
+            }
+            pthread_mutex_lock(&file_cache_lock);
+
+            if (rc != ANCIBLE_SUCCESS || file->tasks) {
+                play_free(tasks);
+                free(tasks);
+            } else {
+                file->tasks = tasks;
+            }
+        }
+        free(c.base_dir);
+    }
+
+    play_t *tasks = file->tasks;
+    pthread_mutex_unlock(&file_cache_lock);
+
+    if (!tasks) {
+        fprintf(stderr, "Error: Failed to load tasks from %s\n", filename);
+    }
+    return tasks;
+}
+
+/**
+ * Free all files held by the parsed-file cache
+ */
+void parser_cache_cleanup(void) {
+    pthread_mutex_lock(&file_cache_lock);
+
+    parsed_file_t *file = file_cache;
+    while (file) {
+        parsed_file_t *next = file->next;
+        yaml_free(file->root);
+        if (file->tasks) {
+            play_free(file->tasks);
+            free(file->tasks);
+        }
+        free(file->path);
+        free(file);
+        file = next;
+    }
+    file_cache = NULL;
+
+    pthread_mutex_unlock(&file_cache_lock);
+}
+
 /**
  * Free resources used by a playbook
- * 
+ *
  * @param playbook Pointer to playbook structure to free
  */
 void playbook_free(playbook_t *playbook) {
     if (!playbook) {
         return;
     }
-    
-    if (playbook->hosts) {
-        free(playbook->hosts);
-        playbook->hosts = NULL;
-    }
-    
-    if (playbook->tasks) {
-        for (int i = 0; i < playbook->task_count; i++) {
-            if (playbook->tasks[i].name) {
-                free(playbook->tasks[i].name);
-            }
-            
-            if (playbook->tasks[i].module) {
-                free(playbook->tasks[i].module);
-            }
-            
-            if (playbook->tasks[i].when) {
-                free(playbook->tasks[i].when);
-            }
-            
-            if (playbook->tasks[i].subtask_indices) {
-                free(playbook->tasks[i].subtask_indices);
-            }
+
+    if (playbook->plays) {
+        for (int i = 0; i < playbook->play_count; i++) {
+            play_free(&playbook->plays[i]);
         }
-        
-        free(playbook->tasks);
-        playbook->tasks = NULL;
+
+        free(playbook->plays);
+        playbook->plays = NULL;
     }
-    
-    playbook->task_count = 0;
+
+    playbook->play_count = 0;
 }
 
 /**
  * Print playbook structure (for debugging)
- * 
+ *
  * @param playbook Pointer to playbook structure to print
  */
 void playbook_print(const playbook_t *playbook) {
     if (!playbook) {
         return;
     }
-    
+
     printf("Playbook:\n");
-    printf("  Hosts: %s\n", playbook->hosts ? playbook->hosts : "NULL");
-    printf("  Tasks: %d\n", playbook->task_count);
-    
-    for (int i = 0; i < playbook->task_count; i++) {
-        printf("    Task %d:\n", i + 1);
-        
-        // Print task type
-        const char *type_str = "Normal";
-        if (playbook->tasks[i].type == TASK_TYPE_BLOCK) {
-            type_str = "Block";
-        } else if (playbook->tasks[i].type == TASK_TYPE_RESCUE) {
-            type_str = "Rescue";
-        } else if (playbook->tasks[i].type == TASK_TYPE_ALWAYS) {
-            type_str = "Always";
-        }
-        
-        printf("      Type: %s\n", type_str);
-        
-        // Print task name if available
-        if (playbook->tasks[i].name) {
-            printf("      Name: %s\n", playbook->tasks[i].name);
-        }
-        
-        // Print module if available
-        if (playbook->tasks[i].module) {
-            printf("      Module: %s\n", playbook->tasks[i].module);
-        }
-        
-        // Print when condition if available
-        if (playbook->tasks[i].when) {
-            printf("      When: %s\n", playbook->tasks[i].when);
-        }
-        
-        // Print parent index if not top-level
-        if (playbook->tasks[i].parent_idx >= 0) {
-            printf("      Parent: %d\n", playbook->tasks[i].parent_idx + 1);
-        }
-        
-        // Print subtasks if any
-        if (playbook->tasks[i].subtask_count > 0) {
-            printf("      Subtasks (%d):", playbook->tasks[i].subtask_count);
-            for (int j = 0; j < playbook->tasks[i].subtask_count; j++) {
-                printf(" %d", playbook->tasks[i].subtask_indices[j] + 1);
+    printf("  Plays: %d\n", playbook->play_count);
+
+    for (int p = 0; p < playbook->play_count; p++) {
+        const play_t *play = &playbook->plays[p];
+
+        printf("  Play %d:\n", p + 1);
+        if (play->name) {
+            printf("    Name: %s\n", play->name);
+        }
+        printf("    Hosts: %s\n", play->hosts ? play->hosts : "NULL");
+
+        for (const variable_t *var = play->vars; var; var = var->next) {
+            printf("    Var: %s = %s\n", var->name, var->value);
+        }
+
+        printf("    Tasks: %d\n", play->task_count);
+
+        for (int i = 0; i < play->task_count; i++) {
+            const task_t *task = &play->tasks[i];
+            printf("      Task %d:\n", i + 1);
+
+            // Print task type
+            const char *type_str = "Normal";
+            if (task->type == TASK_TYPE_BLOCK) {
+                type_str = "Block";
+            } else if (task->type == TASK_TYPE_RESCUE) {
+                type_str = "Rescue";
+            } else if (task->type == TASK_TYPE_ALWAYS) {
+                type_str = "Always";
+            } else if (task->type == TASK_TYPE_INCLUDE) {
+                type_str = "Include";
+            }
+
+            printf("        Type: %s\n", type_str);
+
+            // Print task name if available
+            if (task->name) {
+                printf("        Name: %s\n", task->name);
+            }
+
+            // Print module and arguments if available
+            if (task->module) {
+                printf("        Module: %s\n", task->module);
+            }
+            if (task->args) {
+                printf("        Args: %s\n", task->args);
+            }
+
+            // Print when condition if available
+            if (task->when) {
+                printf("        When: %s\n", task->when);
+            }
+            if (task->register_var) {
+                printf("        Register: %s\n", task->register_var);
+            }
+
+            // Print loop if available
+            if (task->loop_items) {
+                printf("        Loop:");
+                for (int j = 0; j < task->loop_count; j++) {
+                    printf(" %s", task->loop_items[j]);
+                }
+                printf("\n");
+            } else if (task->loop_var) {
+                printf("        Loop: {{ %s }}\n", task->loop_var);
+            }
+            if (task->loop_batch) {
+                printf("        Batch: yes\n");
+            }
+            if (task->loop_parallel > 1) {
+                printf("        Parallel: %d\n", task->loop_parallel);
+            }
+
+            // Print parent index if not top-level
+            if (task->parent_idx >= 0) {
+                printf("        Parent: %d\n", task->parent_idx + 1);
+            }
+
+            // Print subtasks if any
+            if (task->subtask_count > 0) {
+                printf("        Subtasks (%d):", task->subtask_count);
+                for (int j = 0; j < task->subtask_count; j++) {
+                    printf(" %d", task->subtask_indices[j] + 1);
+                }
+                printf("\n");
             }
-            printf("\n");
         }
     }
 }
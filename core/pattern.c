@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include "../include/ancible.h"
+#include "../include/core/pattern.h"
+
+#define SLICE_OPEN (-1000000000)
+
+/**
+ * Kind of a pattern term
+ */
+typedef enum {
+    TERM_UNION,
+    TERM_INTERSECT,
+    TERM_EXCLUDE
+} term_kind_t;
+
+/**
+ * Split a subscript off a term (e.g. "web[0:9]")
+ *
+ * @param term Term to split; the subscript is cut off in place when found
+ * @param start Pointer to receive the first index (SLICE_OPEN if omitted)
+ * @param end Pointer to receive the last index, inclusive (SLICE_OPEN if omitted)
+ * @return 1 if the term had a subscript, 0 otherwise
+ */
+static int split_subscript(char *term, long *start, long *end) {
+    size_t len = strlen(term);
+    char *open = strrchr(term, '[');
+    if (term[0] == '~' || len < 3 || term[len - 1] != ']' || !open || open == term) {
+        return 0;
+    }
+
+    char *p = open + 1;
+    char *stop = NULL;
+    *start = SLICE_OPEN;
+    *end = SLICE_OPEN;
+
+    if (*p != ':' && *p != '-') {
+        *start = strtol(p, &stop, 10);
+        if (stop == p) {
+            return 0;  // Not numeric: a wildcard character class
+        }
+        p = stop;
+    } else if (*p == '-' && p[1] >= '0' && p[1] <= '9') {
+        // A single negative index
+        *start = strtol(p, &stop, 10);
+        p = stop;
+    }
+
+    if (*p == ']') {
+        if (*start == SLICE_OPEN) {
+            return 0;
+        }
+        *end = *start;
+    } else if (*p == ':' || *p == '-') {
+        p++;
+        if (*p != ']') {
+            *end = strtol(p, &stop, 10);
+            if (stop == p) {
+                return 0;
+            }
+            p = stop;
+        }
+        if (*p != ']') {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+
+    if (p != term + len - 1) {
+        return 0;
+    }
+
+    *open = '\0';
+    return 1;
+}
+
+/**
+ * Keep only the hosts at positions [start, end] of a set, in host ID order
+ *
+ * @param set Set to slice
+ * @param start First position (negative counts from the end, SLICE_OPEN for 0)
+ * @param end Last position, inclusive (negative counts from the end, SLICE_OPEN for the last)
+ */
+static void apply_slice(bitset_t *set, long start, long end) {
+    long count = bitset_count(set);
+
+    if (start == SLICE_OPEN) {
+        start = 0;
+    } else if (start < 0) {
+        start += count;
+    }
+    if (end == SLICE_OPEN) {
+        end = count - 1;
+    } else if (end < 0) {
+        end += count;
+    }
+
+    long position = 0;
+    for (int id = bitset_next(set, 0); id >= 0; id = bitset_next(set, id + 1), position++) {
+        if (position < start || position > end) {
+            bitset_unset(set, id);
+        }
+    }
+}
+
+/**
+ * Compile a pattern regex, translating the \d \w \s shorthands POSIX lacks
+ *
+ * The expression is anchored at the start, like Ansible's re.match.
+ *
+ * @param source Regex text (without the leading ~)
+ * @param regex Regex to compile into
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int compile_regex(const char *source, regex_t *regex) {
+    size_t len = strlen(source);
+    char *text = malloc(len * 12 + 4);
+    if (!text) {
+        fprintf(stderr, "Error: Failed to allocate memory for host pattern\n");
+        return ANCIBLE_ERROR;
+    }
+
+    char *out = text;
+    *out++ = '^';
+    *out++ = '(';
+    for (const char *p = source; *p; p++) {
+        if (p[0] == '\\' && p[1] == 'd') {
+            out += sprintf(out, "[0-9]");
+            p++;
+        } else if (p[0] == '\\' && p[1] == 'w') {
+            out += sprintf(out, "[[:alnum:]_]");
+            p++;
+        } else if (p[0] == '\\' && p[1] == 's') {
+            out += sprintf(out, "[[:space:]]");
+            p++;
+        } else {
+            *out++ = *p;
+            if (p[0] == '\\' && p[1]) {
+                *out++ = *++p;
+            }
+        }
+    }
+    *out++ = ')';
+    *out = '\0';
+
+    int rc = regcomp(regex, text, REG_EXTENDED | REG_NOSUB);
+    free(text);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Invalid regular expression in host pattern: ~%s\n", source);
+        return ANCIBLE_ERROR;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Resolve a single term (without its & or ! prefix)
+ *
+ * @param inventory Inventory to resolve against
+ * @param term Term text (modified in place)
+ * @param set Empty bitset receiving the matching hosts
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int resolve_term(const inventory_t *inventory, char *term, bitset_t *set) {
+    long start = 0, end = 0;
+    int sliced = split_subscript(term, &start, &end);
+
+    if (strcmp(term, "all") == 0 || strcmp(term, "*") == 0) {
+        if (inventory->group_count > 0 && bitset_or(set, &inventory->groups[0]->members) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    } else if (term[0] == '~' || strpbrk(term, "*?[")) {
+        regex_t regex;
+        int is_regex = term[0] == '~';
+        if (is_regex && compile_regex(term + 1, &regex) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+
+        // Match group names first, then host names
+        for (int i = 0; i < inventory->group_count; i++) {
+            const char *name = inventory->groups[i]->name;
+            int match = is_regex ? regexec(&regex, name, 0, NULL, 0) == 0 : fnmatch(term, name, 0) == 0;
+            if (match && bitset_or(set, &inventory->groups[i]->members) != ANCIBLE_SUCCESS) {
+                if (is_regex) regfree(&regex);
+                return ANCIBLE_ERROR;
+            }
+        }
+        char buffer[1024];
+        for (int i = 0; i < inventory->host_count; i++) {
+            // Range hosts are matched by their generated name, without creating a record
+            const char *name = inventory_host_name(inventory, i, buffer, sizeof(buffer));
+            int match = is_regex ? regexec(&regex, name, 0, NULL, 0) == 0 : fnmatch(term, name, 0) == 0;
+            if (match && bitset_set(set, i) != ANCIBLE_SUCCESS) {
+                if (is_regex) regfree(&regex);
+                return ANCIBLE_ERROR;
+            }
+        }
+
+        if (is_regex) {
+            regfree(&regex);
+        }
+    } else {
+        const group_t *group = inventory_find_group(inventory, term);
+        int host_id = group ? -1 : inventory_host_id(inventory, term);
+        if (group && bitset_or(set, &group->members) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (host_id >= 0 && bitset_set(set, host_id) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    if (sliced) {
+        apply_slice(set, start, end);
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Split a pattern into terms, ignoring separators inside [...]
+ *
+ * @param text Pattern copy to split in place
+ * @param terms Array receiving the terms (at least strlen(text) / 2 + 1 entries)
+ * @return Number of terms
+ */
+static int split_terms(char *text, char **terms) {
+    int depth = 0;
+    char separator = ':';
+    for (const char *p = text; *p; p++) {
+        depth += (*p == '[') - (*p == ']');
+        if (*p == ',' && depth == 0) {
+            separator = ',';
+            break;
+        }
+    }
+
+    int count = 0;
+    char *term = text;
+    depth = 0;
+    for (char *p = text; ; p++) {
+        depth += (*p == '[') - (*p == ']');
+        if (*p == '\0' || (*p == separator && depth <= 0)) {
+            int last = *p == '\0';
+            *p = '\0';
+
+            // Trim spaces around the term
+            while (*term == ' ') term++;
+            for (char *e = p - 1; e >= term && *e == ' '; e--) *e = '\0';
+
+            if (*term) {
+                terms[count++] = term;
+            }
+            if (last) {
+                break;
+            }
+            term = p + 1;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Resolve a host pattern against an inventory
+ *
+ * @param inventory Inventory to resolve against
+ * @param pattern Host pattern
+ * @param result Initialized bitset receiving the matching host IDs
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on an invalid pattern
+ */
+int pattern_resolve(const inventory_t *inventory, const char *pattern, bitset_t *result) {
+    if (!inventory || !pattern || !result) {
+        return ANCIBLE_ERROR;
+    }
+
+    bitset_clear(result);
+    if (bitset_reserve(result, inventory->host_count) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    char *text = strdup(pattern);
+    char **terms = malloc((strlen(pattern) / 2 + 1) * sizeof(char *));
+    if (!text || !terms) {
+        fprintf(stderr, "Error: Failed to allocate memory for host pattern\n");
+        free(text);
+        free(terms);
+        return ANCIBLE_ERROR;
+    }
+
+    int count = split_terms(text, terms);
+    int status = ANCIBLE_SUCCESS;
+    bitset_t term_set;
+    bitset_init(&term_set);
+
+    // Three passes: unions, then intersections, then exclusions
+    for (term_kind_t kind = TERM_UNION; kind <= TERM_EXCLUDE && status == ANCIBLE_SUCCESS; kind++) {
+        for (int i = 0; i < count; i++) {
+            char *term = terms[i];
+            term_kind_t term_kind = TERM_UNION;
+            if (term[0] == '&') {
+                term_kind = TERM_INTERSECT;
+                term++;
+            } else if (term[0] == '!') {
+                term_kind = TERM_EXCLUDE;
+                term++;
+            }
+            if (term_kind != kind) {
+                continue;
+            }
+
+            // A pattern made only of intersections/exclusions starts from nothing,
+            // as in Ansible
+            bitset_clear(&term_set);
+            if (resolve_term(inventory, term, &term_set) != ANCIBLE_SUCCESS) {
+                status = ANCIBLE_ERROR;
+                break;
+            }
+
+            if (kind == TERM_UNION) {
+                status = bitset_or(result, &term_set);
+            } else if (kind == TERM_INTERSECT) {
+                bitset_and(result, &term_set);
+            } else {
+                bitset_andnot(result, &term_set);
+            }
+        }
+    }
+
+    bitset_free(&term_set);
+    free(terms);
+    free(text);
+    return status;
+}
+
+/**
+ * Resolve the hosts of a play, restricted by an optional --limit pattern
+ *
+ * @param inventory Inventory to resolve against
+ * @param pattern Play host pattern
+ * @param limit Limit pattern, or NULL for no limit
+ * @param result Initialized bitset receiving the matching host IDs
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on an invalid pattern
+ */
+int pattern_resolve_limited(const inventory_t *inventory, const char *pattern,
+                            const char *limit, bitset_t *result) {
+    if (pattern_resolve(inventory, pattern, result) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    if (!limit) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    bitset_t limit_set;
+    bitset_init(&limit_set);
+    int status = pattern_resolve(inventory, limit, &limit_set);
+    if (status == ANCIBLE_SUCCESS) {
+        bitset_and(result, &limit_set);
+    }
+    bitset_free(&limit_set);
+
+    return status;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../include/ancible.h"
+#include "../include/core/scope.h"
+#include "../include/core/symbol.h"
+
+#define SCOPE_MIN_SLOTS 8
+
+/**
+ * Find the slot of a symbol, or the empty slot where it would go
+ *
+ * @param scope Scope with at least one empty slot
+ * @param key Symbol ID
+ * @return Pointer to the slot
+ */
+static struct scope_slot *scope_slot(const scope_t *scope, int key) {
+    uint32_t mask = (uint32_t)scope->capacity - 1;
+    uint32_t pos = ((uint32_t)key * 2654435761u) & mask;
+
+    while (scope->slots[pos].key >= 0 && scope->slots[pos].key != key) {
+        pos = (pos + 1) & mask;
+    }
+
+    return (struct scope_slot *)&scope->slots[pos];
+}
+
+/**
+ * Allocate an empty scope with room for count variables
+ *
+ * @param count Number of variables the scope will hold at most
+ * @return New scope, or NULL on error
+ */
+static scope_t *scope_alloc(int count) {
+    int capacity = SCOPE_MIN_SLOTS;
+    while (count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+
+    scope_t *scope = malloc(sizeof(scope_t) + (size_t)capacity * sizeof(struct scope_slot));
+    if (!scope) {
+        fprintf(stderr, "Error: Failed to allocate memory for variable scope\n");
+        return NULL;
+    }
+
+    scope->refs = 1;
+    scope->count = 0;
+    scope->capacity = capacity;
+    for (int i = 0; i < capacity; i++) {
+        scope->slots[i].key = -1;
+        scope->slots[i].var = NULL;
+    }
+
+    return scope;
+}
+
+/**
+ * Add a variable to a scope being built, replacing one of the same name
+ *
+ * @param scope Scope being built
+ * @param key Symbol ID of the name
+ * @param var Variable
+ */
+static void scope_put(scope_t *scope, int key, const variable_t *var) {
+    struct scope_slot *slot = scope_slot(scope, key);
+
+    if (slot->key < 0) {
+        slot->key = key;
+        scope->count++;
+    }
+    slot->var = var;
+}
+
+/**
+ * Build a scope from an array of variables
+ *
+ * @param vars Variables (a later one wins over an earlier one of the same name)
+ * @param count Number of variables
+ * @return New scope, or NULL on error
+ */
+scope_t *scope_create(const variable_t *const *vars, int count) {
+    scope_t *scope = scope_alloc(count);
+    if (!scope) {
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int key = symbol_intern(vars[i]->name);
+        if (key < 0) {
+            scope_release(scope);
+            return NULL;
+        }
+        scope_put(scope, key, vars[i]);
+    }
+
+    return scope;
+}
+
+/**
+ * Build a scope holding a base scope's variables overridden by a list
+ *
+ * @param base Base scope (may be NULL)
+ * @param list Variable list taking precedence over the base (may be NULL)
+ * @return New scope, or NULL on error
+ */
+scope_t *scope_extend(const scope_t *base, const variable_t *list) {
+    int count = base ? base->count : 0;
+    for (const variable_t *var = list; var; var = var->next) {
+        count++;
+    }
+
+    scope_t *scope = scope_alloc(count);
+    if (!scope) {
+        return NULL;
+    }
+
+    for (int i = 0; base && i < base->capacity; i++) {
+        if (base->slots[i].key >= 0) {
+            scope_put(scope, base->slots[i].key, base->slots[i].var);
+        }
+    }
+
+    for (const variable_t *var = list; var; var = var->next) {
+        int key = symbol_intern(var->name);
+        if (key < 0) {
+            scope_release(scope);
+            return NULL;
+        }
+        scope_put(scope, key, var);
+    }
+
+    return scope;
+}
+
+/**
+ * Find a variable in a scope
+ *
+ * @param scope Scope (may be NULL)
+ * @param key Symbol ID of the name
+ * @return Variable, or NULL if the scope does not hold it
+ */
+const variable_t *scope_find(const scope_t *scope, int key) {
+    if (!scope || key < 0) {
+        return NULL;
+    }
+
+    return scope_slot(scope, key)->var;
+}
+
+/**
+ * Add an owner to a scope
+ *
+ * @param scope Scope (may be NULL)
+ * @return The scope
+ */
+scope_t *scope_retain(scope_t *scope) {
+    if (scope) {
+        scope->refs++;
+    }
+
+    return scope;
+}
+
+/**
+ * Drop an owner of a scope, freeing it with the last one
+ *
+ * @param scope Scope (may be NULL)
+ */
+void scope_release(scope_t *scope) {
+    if (scope && --scope->refs == 0) {
+        free(scope);
+    }
+}
@@ -0,0 +1,634 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/ancible.h"
+#include "../include/core/snapshot.h"
+#include "../include/core/symbol.h"
+
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+/**
+ * Snapshot file header (all offsets are from the start of the file)
+ */
+typedef struct {
+    char magic[8];            // SNAPSHOT_MAGIC
+    uint32_t version;         // SNAPSHOT_VERSION
+    uint32_t byte_order;      // SNAPSHOT_BYTE_ORDER as written by the producer
+    uint32_t host_count;      // Number of host records
+    uint32_t group_count;     // Number of group records
+    uint32_t var_count;       // Number of variable records
+    uint32_t id_count;        // Number of entries in the ID array
+    uint32_t index_capacity;  // Number of host name index slots (power of two)
+    uint32_t member_words;    // Number of membership words per group
+    uint64_t strings_offset;  // String table (NUL-terminated strings)
+    uint64_t strings_size;    // Size of the string table
+    uint64_t hosts_offset;    // Host records, by host ID
+    uint64_t groups_offset;   // Group records, by group ID
+    uint64_t vars_offset;     // Variable records
+    uint64_t ids_offset;      // Host and group IDs referenced by the group records
+    uint64_t index_offset;    // Host name index
+    uint64_t words_offset;    // Flattened membership of each group, by group ID
+    uint64_t order_offset;    // Group IDs in variable precedence order
+} snapshot_header_t;
+
+/**
+ * Group record
+ */
+typedef struct {
+    uint32_t name;            // String offset of the group name
+    uint32_t hosts;           // First direct member in the ID array
+    uint32_t host_count;      // Number of direct members
+    uint32_t children;        // First child group in the ID array
+    uint32_t child_count;     // Number of child groups
+    uint32_t vars;            // First variable record
+    uint32_t var_count;       // Number of variable records
+    uint32_t depth;           // Distance from "all"
+} snapshot_group_t;
+
+/**
+ * Growable byte buffer used to build each section
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+/**
+ * State used while writing a snapshot
+ */
+typedef struct {
+    buffer_t strings;         // String table
+    buffer_t hosts;           // Host records
+    buffer_t groups;          // Group records
+    buffer_t vars;            // Variable records
+    buffer_t ids;             // ID array
+    buffer_t index;           // Host name index
+    buffer_t words;           // Group membership words
+    buffer_t order;           // Group precedence order
+    uint32_t *key_offsets;    // String offset of each symbol already written (0 = not yet)
+    int key_capacity;         // Number of entries in key_offsets
+} writer_t;
+
+/**
+ * Append bytes to a buffer
+ *
+ * @param buffer Buffer to append to
+ * @param data Bytes to append
+ * @param len Number of bytes
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int buffer_append(buffer_t *buffer, const void *data, size_t len) {
+    if (buffer->len + len > buffer->cap) {
+        size_t cap = buffer->cap ? buffer->cap * 2 : 4096;
+        while (cap < buffer->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(buffer->data, cap);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for inventory snapshot\n");
+            return ANCIBLE_ERROR;
+        }
+        buffer->data = grown;
+        buffer->cap = cap;
+    }
+
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Add a string to the string table
+ *
+ * @param writer Writer state
+ * @param str String to add
+ * @param offset Receives the string's offset
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_string(writer_t *writer, const char *str, uint32_t *offset) {
+    size_t len = strlen(str) + 1;
+    if (writer->strings.len + len > UINT32_MAX) {
+        fprintf(stderr, "Error: Inventory too large for a snapshot\n");
+        return ANCIBLE_ERROR;
+    }
+
+    *offset = (uint32_t)writer->strings.len;
+    return buffer_append(&writer->strings, str, len);
+}
+
+/**
+ * Add a variable name to the string table, once per symbol
+ *
+ * @param writer Writer state
+ * @param key Symbol ID of the name
+ * @param offset Receives the string's offset
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_key(writer_t *writer, int key, uint32_t *offset) {
+    if (key >= writer->key_capacity) {
+        int capacity = writer->key_capacity ? writer->key_capacity : 64;
+        while (capacity <= key) {
+            capacity *= 2;
+        }
+        uint32_t *grown = realloc(writer->key_offsets, (size_t)capacity * sizeof(uint32_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for inventory snapshot\n");
+            return ANCIBLE_ERROR;
+        }
+        memset(grown + writer->key_capacity, 0, (size_t)(capacity - writer->key_capacity) * sizeof(uint32_t));
+        writer->key_offsets = grown;
+        writer->key_capacity = capacity;
+    }
+
+    // Offset 0 is always the first host's or group's name, never a key
+    if (writer->key_offsets[key] == 0 &&
+        write_string(writer, symbol_name(key), &writer->key_offsets[key]) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    *offset = writer->key_offsets[key];
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append IDs to the ID array
+ *
+ * @param writer Writer state
+ * @param ids IDs to append
+ * @param count Number of IDs
+ * @param first Receives the index of the first ID
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_ids(writer_t *writer, const int *ids, int count, uint32_t *first) {
+    *first = (uint32_t)(writer->ids.len / sizeof(uint32_t));
+    for (int i = 0; i < count; i++) {
+        uint32_t id = (uint32_t)ids[i];
+        if (buffer_append(&writer->ids, &id, sizeof(id)) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append one section to the snapshot file, padded to 8 bytes
+ *
+ * @param file File to write to
+ * @param buffer Section contents
+ * @param offset Running file offset, updated past the section
+ * @return Offset of the section
+ */
+static uint64_t write_section(FILE *file, const buffer_t *buffer, uint64_t *offset) {
+    static const char padding[8] = {0};
+    uint64_t start = *offset;
+    size_t pad = (8 - buffer->len % 8) % 8;
+
+    if (buffer->len) {
+        fwrite(buffer->data, 1, buffer->len, file);
+    }
+    fwrite(padding, 1, pad, file);
+    *offset += buffer->len + pad;
+
+    return start;
+}
+
+/**
+ * Build the host name index, probed like the inventory's own name index
+ *
+ * @param writer Writer state
+ * @param inventory Inventory being written
+ * @param capacity Number of slots (power of two, above the host count)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_index(writer_t *writer, const inventory_t *inventory, uint32_t capacity) {
+    snapshot_slot_t *slots = calloc(capacity, sizeof(snapshot_slot_t));
+    if (!slots) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory snapshot\n");
+        return ANCIBLE_ERROR;
+    }
+
+    const snapshot_host_t *hosts = (const snapshot_host_t *)writer->hosts.data;
+    for (int id = 0; id < inventory->host_count; id++) {
+        uint32_t hash = inventory_name_hash(writer->strings.data + hosts[id].name);
+        uint32_t i = hash & (capacity - 1);
+        while (slots[i].id != 0) {
+            i = (i + 1) & (capacity - 1);
+        }
+        slots[i].hash = hash;
+        slots[i].id = (uint32_t)id + 1;
+    }
+
+    int result = buffer_append(&writer->index, slots, capacity * sizeof(snapshot_slot_t));
+    free(slots);
+    return result;
+}
+
+/**
+ * Write an inventory to a snapshot file
+ *
+ * The file is written next to its final path and renamed into place, so
+ * concurrent readers never see a partial snapshot.
+ *
+ * @param inventory Resolved inventory
+ * @param path Snapshot path
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int snapshot_save(const inventory_t *inventory, const char *path) {
+    writer_t writer;
+    int result = ANCIBLE_ERROR;
+    FILE *file = NULL;
+    char name[1024];
+    char temp_path[4096];
+
+    memset(&writer, 0, sizeof(writer));
+
+    for (int id = 0; id < inventory->host_count; id++) {
+        snapshot_host_t record;
+
+        record.vars = (uint32_t)(writer.vars.len / sizeof(snapshot_var_t));
+        record.var_count = (uint32_t)inventory_host_var_count(inventory, id);
+        if (write_string(&writer, inventory_host_name(inventory, id, name, sizeof(name)), &record.name) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+
+        for (uint32_t i = 0; i < record.var_count; i++) {
+            snapshot_var_t var;
+            const char *var_name;
+            const char *value;
+            inventory_host_var(inventory, id, (int)i, &var_name, &value);
+            int key = symbol_intern(var_name);
+            if (key < 0 ||
+                write_key(&writer, key, &var.name) != ANCIBLE_SUCCESS ||
+                write_string(&writer, value, &var.value) != ANCIBLE_SUCCESS ||
+                buffer_append(&writer.vars, &var, sizeof(var)) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+        }
+
+        if (buffer_append(&writer.hosts, &record, sizeof(record)) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+
+    // At most half full, so lookups stay short
+    uint32_t index_capacity = 8;
+    while (index_capacity < (uint32_t)inventory->host_count * 2) {
+        index_capacity *= 2;
+    }
+    if (write_index(&writer, inventory, index_capacity) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    uint32_t member_words = (uint32_t)(inventory->host_count + 63) / 64;
+    for (int id = 0; id < inventory->group_count; id++) {
+        const group_t *group = inventory->groups[id];
+        snapshot_group_t record;
+
+        record.host_count = (uint32_t)group->host_count;
+        record.child_count = (uint32_t)group->child_count;
+        record.vars = (uint32_t)(writer.vars.len / sizeof(snapshot_var_t));
+        record.var_count = 0;
+        record.depth = (uint32_t)group->depth;
+        if (write_string(&writer, group->name, &record.name) != ANCIBLE_SUCCESS ||
+            write_ids(&writer, group->host_ids, group->host_count, &record.hosts) != ANCIBLE_SUCCESS ||
+            write_ids(&writer, group->child_ids, group->child_count, &record.children) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+
+        for (const variable_t *var = group->vars; var; var = var->next) {
+            snapshot_var_t entry;
+            if (write_string(&writer, var->name, &entry.name) != ANCIBLE_SUCCESS ||
+                write_string(&writer, var->value, &entry.value) != ANCIBLE_SUCCESS ||
+                buffer_append(&writer.vars, &entry, sizeof(entry)) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+            record.var_count++;
+        }
+
+        if (buffer_append(&writer.groups, &record, sizeof(record)) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+
+        // Membership is stored flattened, padded with zero words to the host count
+        for (uint32_t i = 0; i < member_words; i++) {
+            uint64_t word = (int)i < group->members.word_count ? group->members.words[i] : 0;
+            if (buffer_append(&writer.words, &word, sizeof(word)) != ANCIBLE_SUCCESS) {
+                goto cleanup;
+            }
+        }
+
+        uint32_t order = (uint32_t)(inventory->group_order ? inventory->group_order[id] : id);
+        if (buffer_append(&writer.order, &order, sizeof(order)) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    file = fopen(temp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to create inventory snapshot: %s\n", temp_path);
+        goto cleanup;
+    }
+
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.host_count = (uint32_t)inventory->host_count;
+    header.group_count = (uint32_t)inventory->group_count;
+    header.var_count = (uint32_t)(writer.vars.len / sizeof(snapshot_var_t));
+    header.id_count = (uint32_t)(writer.ids.len / sizeof(uint32_t));
+    header.index_capacity = index_capacity;
+    header.member_words = member_words;
+    header.strings_size = writer.strings.len;
+
+    // The header goes first but is only complete once the sections are laid out
+    uint64_t offset = sizeof(header);
+    fwrite(&header, 1, sizeof(header), file);
+    header.strings_offset = write_section(file, &writer.strings, &offset);
+    header.hosts_offset = write_section(file, &writer.hosts, &offset);
+    header.groups_offset = write_section(file, &writer.groups, &offset);
+    header.vars_offset = write_section(file, &writer.vars, &offset);
+    header.ids_offset = write_section(file, &writer.ids, &offset);
+    header.index_offset = write_section(file, &writer.index, &offset);
+    header.words_offset = write_section(file, &writer.words, &offset);
+    header.order_offset = write_section(file, &writer.order, &offset);
+
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), file) != sizeof(header) ||
+        ferror(file) || fclose(file) != 0) {
+        fprintf(stderr, "Error: Failed to write inventory snapshot: %s\n", temp_path);
+        file = NULL;
+        remove(temp_path);
+        goto cleanup;
+    }
+    file = NULL;
+
+    if (rename(temp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write inventory snapshot: %s\n", path);
+        remove(temp_path);
+        goto cleanup;
+    }
+
+    result = ANCIBLE_SUCCESS;
+
+cleanup:
+    if (file) {
+        fclose(file);
+        remove(temp_path);
+    }
+    free(writer.strings.data);
+    free(writer.hosts.data);
+    free(writer.groups.data);
+    free(writer.vars.data);
+    free(writer.ids.data);
+    free(writer.index.data);
+    free(writer.words.data);
+    free(writer.order.data);
+    free(writer.key_offsets);
+    return result;
+}
+
+/**
+ * Check that a section of records lies inside the file
+ */
+static int section_valid(uint64_t offset, uint64_t count, size_t record_size, size_t size) {
+    return offset % 8 == 0 && offset <= size && count <= (size - offset) / record_size;
+}
+
+/**
+ * Create a group from its record, copying the small per-group arrays
+ *
+ * @param inventory Inventory being filled
+ * @param record Group record
+ * @param header Snapshot header
+ * @param data Start of the mapping
+ * @param id Expected group ID
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int load_group(inventory_t *inventory, const snapshot_group_t *record,
+                      const snapshot_header_t *header, const char *data, int id) {
+    const char *strings = data + header->strings_offset;
+    const snapshot_var_t *vars = (const snapshot_var_t *)(data + header->vars_offset);
+    const uint32_t *ids = (const uint32_t *)(data + header->ids_offset);
+    const uint64_t *words = (const uint64_t *)(data + header->words_offset);
+
+    group_t *group = inventory_get_group(inventory, strings + record->name);
+    if (!group) {
+        return ANCIBLE_ERROR;
+    }
+    if (group->id != id) {
+        fprintf(stderr, "Error: Duplicate group in inventory snapshot: %s\n", group->name);
+        return ANCIBLE_ERROR;
+    }
+
+    group->host_ids = malloc(((size_t)record->host_count + 1) * sizeof(int));
+    group->child_ids = malloc(((size_t)record->child_count + 1) * sizeof(int));
+    if (!group->host_ids || !group->child_ids ||
+        bitset_reserve(&group->members, (int)header->member_words * 64) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory snapshot\n");
+        return ANCIBLE_ERROR;
+    }
+    for (uint32_t i = 0; i < record->host_count; i++) {
+        group->host_ids[i] = (int)ids[record->hosts + i];
+    }
+    for (uint32_t i = 0; i < record->child_count; i++) {
+        group->child_ids[i] = (int)ids[record->children + i];
+    }
+    group->host_count = group->host_capacity = (int)record->host_count;
+    group->child_count = group->child_capacity = (int)record->child_count;
+    group->depth = (int)record->depth;
+    if (header->member_words) {
+        memcpy(group->members.words, words + (size_t)id * header->member_words,
+               header->member_words * sizeof(uint64_t));
+    }
+
+    for (uint32_t i = 0; i < record->var_count; i++) {
+        const snapshot_var_t *var = &vars[record->vars + i];
+        if (group_set_var(group, strings + var->name, strings + var->value) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Load an inventory from a snapshot file
+ *
+ * The file is mapped and its hosts are used in place: a host only gets a
+ * record (and its own strings) when it is first used.
+ *
+ * @param path Snapshot path
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (missing, corrupt or stale format)
+ */
+int snapshot_load(const char *path, inventory_t *inventory) {
+    int result = ANCIBLE_ERROR;
+    char *data = MAP_FAILED;
+    size_t size = 0;
+
+    memset(inventory, 0, sizeof(inventory_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ANCIBLE_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = (size_t)st.st_size;
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return ANCIBLE_ERROR;
+    }
+
+    // Every offset is checked before use, so a corrupt file fails cleanly
+    snapshot_header_t header;
+    if (size < sizeof(header)) {
+        goto corrupt;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        goto corrupt;
+    }
+    if (header.version != SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        // Written by another build: not an error, callers just rebuild it
+        goto cleanup;
+    }
+    if (!section_valid(header.strings_offset, header.strings_size, 1, size) || header.strings_size == 0 ||
+        !section_valid(header.hosts_offset, header.host_count, sizeof(snapshot_host_t), size) ||
+        !section_valid(header.groups_offset, header.group_count, sizeof(snapshot_group_t), size) ||
+        !section_valid(header.vars_offset, header.var_count, sizeof(snapshot_var_t), size) ||
+        !section_valid(header.ids_offset, header.id_count, sizeof(uint32_t), size) ||
+        !section_valid(header.index_offset, header.index_capacity, sizeof(snapshot_slot_t), size) ||
+        !section_valid(header.words_offset, (uint64_t)header.group_count * header.member_words, sizeof(uint64_t), size) ||
+        !section_valid(header.order_offset, header.group_count, sizeof(uint32_t), size) ||
+        header.group_count == 0 || header.host_count > INT32_MAX / 2 ||
+        header.member_words != (header.host_count + 63) / 64 ||
+        header.index_capacity < header.host_count || (header.index_capacity & (header.index_capacity - 1)) != 0) {
+        goto corrupt;
+    }
+
+    const char *strings = data + header.strings_offset;
+    const snapshot_host_t *hosts = (const snapshot_host_t *)(data + header.hosts_offset);
+    const snapshot_group_t *groups = (const snapshot_group_t *)(data + header.groups_offset);
+    const snapshot_var_t *vars = (const snapshot_var_t *)(data + header.vars_offset);
+    const uint32_t *ids = (const uint32_t *)(data + header.ids_offset);
+    const uint32_t *order = (const uint32_t *)(data + header.order_offset);
+    if (strings[header.strings_size - 1] != '\0') {
+        goto corrupt;
+    }
+
+    // Check every reference once, so records can be used in place without checks
+    for (uint32_t i = 0; i < header.var_count; i++) {
+        if (vars[i].name >= header.strings_size || vars[i].value >= header.strings_size) {
+            goto corrupt;
+        }
+    }
+    for (uint32_t i = 0; i < header.host_count; i++) {
+        if (hosts[i].name >= header.strings_size || hosts[i].vars > header.var_count ||
+            hosts[i].var_count > header.var_count - hosts[i].vars) {
+            goto corrupt;
+        }
+    }
+    for (uint32_t i = 0; i < header.group_count; i++) {
+        const snapshot_group_t *group = &groups[i];
+        if (group->name >= header.strings_size || group->vars > header.var_count ||
+            group->var_count > header.var_count - group->vars ||
+            group->hosts > header.id_count || group->host_count > header.id_count - group->hosts ||
+            group->children > header.id_count || group->child_count > header.id_count - group->children ||
+            order[i] >= header.group_count) {
+            goto corrupt;
+        }
+        for (uint32_t j = 0; j < group->host_count; j++) {
+            if (ids[group->hosts + j] >= header.host_count) {
+                goto corrupt;
+            }
+        }
+        for (uint32_t j = 0; j < group->child_count; j++) {
+            if (ids[group->children + j] >= header.group_count) {
+                goto corrupt;
+            }
+        }
+    }
+    if (strcmp(strings + groups[0].name, "all") != 0) {
+        goto corrupt;
+    }
+
+    if (inventory_init(inventory) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+
+    // Groups are small: they are copied, and get their IDs back by creation order
+    for (uint32_t i = 0; i < header.group_count; i++) {
+        if (load_group(inventory, &groups[i], &header, data, (int)i) != ANCIBLE_SUCCESS) {
+            goto cleanup;
+        }
+    }
+    inventory->group_order = malloc((size_t)inventory->group_capacity * sizeof(int));
+    inventory->hosts = calloc((size_t)header.host_count + 1, sizeof(host_t *));
+    if (!inventory->group_order || !inventory->hosts) {
+        fprintf(stderr, "Error: Failed to allocate memory for inventory snapshot\n");
+        goto cleanup;
+    }
+    for (uint32_t i = 0; i < header.group_count; i++) {
+        inventory->group_order[i] = (int)order[i];
+    }
+
+    // Hosts stay in the mapping until used
+    inventory->host_count = (int)header.host_count;
+    inventory->host_capacity = (int)header.host_count + 1;
+    inventory->mapped.map = data;
+    inventory->mapped.size = size;
+    inventory->mapped.strings = strings;
+    inventory->mapped.strings_size = header.strings_size;
+    inventory->mapped.hosts = hosts;
+    inventory->mapped.host_count = (int)header.host_count;
+    inventory->mapped.vars = vars;
+    inventory->mapped.index = (const snapshot_slot_t *)(data + header.index_offset);
+    inventory->mapped.index_capacity = header.index_capacity;
+    data = MAP_FAILED;
+
+    result = ANCIBLE_SUCCESS;
+    goto cleanup;
+
+corrupt:
+    fprintf(stderr, "Error: Invalid inventory snapshot: %s\n", path);
+
+cleanup:
+    if (result != ANCIBLE_SUCCESS) {
+        inventory_free(inventory);
+    }
+    if (data != MAP_FAILED) {
+        munmap(data, size);
+    }
+    return result;
+}
+
+/**
+ * Check whether a file is a snapshot
+ *
+ * @param path File path
+ * @return 1 if the file starts with the snapshot magic, 0 otherwise
+ */
+int snapshot_detect(const char *path) {
+    char magic[8];
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    int found = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return found;
+}
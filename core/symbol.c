@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../include/ancible.h"
+#include "../include/core/symbol.h"
+
+#define SYMBOL_PAGE_SIZE 1024
+#define SYMBOL_MAX_PAGES 4096
+
+// Names live in fixed pages that never move, so readers need no lock
+static char **pages[SYMBOL_MAX_PAGES];
+static int symbol_count = 0;
+
+// Open-addressing index from name to ID (slots hold ID + 1, 0 when empty)
+static int *slots = NULL;
+static int slot_capacity = 0;
+
+static pthread_mutex_t symbol_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Names of the well-known symbols, in ID order
+static const char *const builtin_names[SYMBOL_BUILTIN_COUNT] = {
+    "ansible_connection",
+    "ansible_host",
+    "ansible_user",
+    "ansible_port",
+    "ancible_host_concurrency",
+    "item",
+    "inventory_hostname"
+};
+
+/**
+ * Hash a name (FNV-1a)
+ *
+ * @param name Name to hash
+ * @return 32-bit hash
+ */
+static uint32_t symbol_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Find the slot of a name, or the empty slot where it would go
+ *
+ * @param name Name to look up
+ * @return Slot index (slots must be allocated)
+ */
+static uint32_t symbol_slot(const char *name) {
+    uint32_t mask = (uint32_t)slot_capacity - 1;
+    uint32_t pos = symbol_hash(name) & mask;
+
+    while (slots[pos] && strcmp(pages[(slots[pos] - 1) / SYMBOL_PAGE_SIZE][(slots[pos] - 1) % SYMBOL_PAGE_SIZE], name) != 0) {
+        pos = (pos + 1) & mask;
+    }
+
+    return pos;
+}
+
+/**
+ * Double the index, rehashing every symbol
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int symbol_grow(void) {
+    int capacity = slot_capacity ? slot_capacity * 2 : 256;
+    int *new_slots = calloc((size_t)capacity, sizeof(int));
+    if (!new_slots) {
+        fprintf(stderr, "Error: Failed to allocate memory for symbols\n");
+        return ANCIBLE_ERROR;
+    }
+
+    free(slots);
+    slots = new_slots;
+    slot_capacity = capacity;
+
+    for (int id = 0; id < symbol_count; id++) {
+        slots[symbol_slot(pages[id / SYMBOL_PAGE_SIZE][id % SYMBOL_PAGE_SIZE])] = id + 1;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Intern a name (symbol_lock must be held)
+ *
+ * @param name Name to intern
+ * @return Symbol ID, or -1 on error
+ */
+static int symbol_intern_locked(const char *name) {
+    if ((symbol_count + 1) * 2 > slot_capacity && symbol_grow() != ANCIBLE_SUCCESS) {
+        return -1;
+    }
+
+    uint32_t pos = symbol_slot(name);
+    if (slots[pos]) {
+        return slots[pos] - 1;
+    }
+
+    int page = symbol_count / SYMBOL_PAGE_SIZE;
+    char *copy = strdup(name);
+    if (page >= SYMBOL_MAX_PAGES || !copy ||
+        (!pages[page] && !(pages[page] = calloc(SYMBOL_PAGE_SIZE, sizeof(char *))))) {
+        fprintf(stderr, "Error: Failed to allocate memory for symbol %s\n", name);
+        free(copy);
+        return -1;
+    }
+
+    int id = symbol_count;
+    pages[page][id % SYMBOL_PAGE_SIZE] = copy;
+    slots[pos] = id + 1;
+    symbol_count++;
+
+    return id;
+}
+
+/**
+ * Intern the well-known names if the table is empty (symbol_lock must be held)
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int symbol_seed_locked(void) {
+    for (int id = symbol_count; id < SYMBOL_BUILTIN_COUNT; id++) {
+        if (symbol_intern_locked(builtin_names[id]) != id) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Intern a name
+ *
+ * @param name Name to intern
+ * @return Symbol ID, or -1 on error
+ */
+int symbol_intern(const char *name) {
+    if (!name) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&symbol_lock);
+    int id = symbol_seed_locked() == ANCIBLE_SUCCESS ? symbol_intern_locked(name) : -1;
+    pthread_mutex_unlock(&symbol_lock);
+
+    return id;
+}
+
+/**
+ * Look up a name without interning it
+ *
+ * @param name Name to look up
+ * @return Symbol ID, or -1 if the name was never interned
+ */
+int symbol_find(const char *name) {
+    if (!name) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&symbol_lock);
+    int id = symbol_seed_locked() == ANCIBLE_SUCCESS ? slots[symbol_slot(name)] - 1 : -1;
+    pthread_mutex_unlock(&symbol_lock);
+
+    return id;
+}
+
+/**
+ * Get the name of a symbol
+ *
+ * @param id Symbol ID
+ * @return Interned name, or NULL if the ID is unknown
+ */
+const char *symbol_name(int id) {
+    if (id >= 0 && id < SYMBOL_BUILTIN_COUNT) {
+        return builtin_names[id];
+    }
+    if (id < 0 || id / SYMBOL_PAGE_SIZE >= SYMBOL_MAX_PAGES || !pages[id / SYMBOL_PAGE_SIZE]) {
+        return NULL;
+    }
+
+    return pages[id / SYMBOL_PAGE_SIZE][id % SYMBOL_PAGE_SIZE];
+}
+
+/**
+ * Free every interned name (IDs become invalid)
+ */
+void symbol_cleanup(void) {
+    pthread_mutex_lock(&symbol_lock);
+
+    for (int page = 0; page < SYMBOL_MAX_PAGES && pages[page]; page++) {
+        for (int i = 0; i < SYMBOL_PAGE_SIZE; i++) {
+            free(pages[page][i]);
+        }
+        free(pages[page]);
+        pages[page] = NULL;
+    }
+
+    free(slots);
+    slots = NULL;
+    slot_capacity = 0;
+    symbol_count = 0;
+
+    pthread_mutex_unlock(&symbol_lock);
+}
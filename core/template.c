@@ -0,0 +1,1592 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "../include/ancible.h"
+#include "../include/core/template.h"
+#include "../include/core/context.h"
+#include "../include/core/symbol.h"
+
+#define REGEX_MAX_GROUPS 10
+
+/**
+ * Filters, with the number of arguments each accepts
+ */
+static const struct {
+    const char *name;
+    template_filter_t filter;
+    int min_args;
+    int max_args;
+} filters[] = {
+    { "default", TEMPLATE_FILTER_DEFAULT, 1, 2 },
+    { "lower", TEMPLATE_FILTER_LOWER, 0, 0 },
+    { "upper", TEMPLATE_FILTER_UPPER, 0, 0 },
+    { "replace", TEMPLATE_FILTER_REPLACE, 2, 2 },
+    { "regex_replace", TEMPLATE_FILTER_REGEX_REPLACE, 1, 2 },
+    { "join", TEMPLATE_FILTER_JOIN, 0, 1 },
+    { "split", TEMPLATE_FILTER_SPLIT, 0, 1 },
+    { "int", TEMPLATE_FILTER_INT, 0, 1 },
+    { "length", TEMPLATE_FILTER_LENGTH, 0, 0 },
+    { "b64encode", TEMPLATE_FILTER_B64ENCODE, 0, 0 },
+    { "to_json", TEMPLATE_FILTER_TO_JSON, 0, 0 }
+};
+
+/**
+ * Fields of registered results
+ */
+static const struct {
+    const char *name;
+    result_field_t field;
+} fields[] = {
+    { "stdout", RESULT_FIELD_STDOUT },
+    { "stderr", RESULT_FIELD_STDERR },
+    { "rc", RESULT_FIELD_RC },
+    { "changed", RESULT_FIELD_CHANGED },
+    { "failed", RESULT_FIELD_FAILED },
+    { "skipped", RESULT_FIELD_SKIPPED },
+    { "msg", RESULT_FIELD_MSG },
+    { "stdout_lines", RESULT_FIELD_STDOUT_LINES }
+};
+
+/**
+ * Kinds of values an expression evaluates to
+ */
+typedef enum {
+    OPERAND_UNDEFINED,      // Variable that is not set
+    OPERAND_STRING,         // Text
+    OPERAND_NUMBER,         // Number (from a literal, int or length)
+    OPERAND_BOOL,           // True or False
+    OPERAND_LIST            // List: flow-style text ("[a, b]"), output lines or a typed list or map
+} operand_kind_t;
+
+/**
+ * Value of an expression while rendering
+ *
+ * Values are held elsewhere (variables, literals) or in the buffer's
+ * scratch area, by offset since the area may move as it grows. Every value
+ * is NUL-terminated, except the list items handed out by operand_next.
+ */
+typedef struct {
+    operand_kind_t kind;    // Kind of value
+    const char *text;     // Text held elsewhere, or NULL when it is in the scratch area
+    size_t offset;        // Start in the scratch area
+    size_t length;        // Length of the text
+    const template_expr_t *source; // Variable that is not set (OPERAND_UNDEFINED)
+    registered_t *lines;  // Result whose output lines make up the list (stdout_lines), or NULL
+    const value_t *typed; // Typed value the text belongs to, or NULL
+} operand_t;
+
+/**
+ * State of the expression parser
+ */
+typedef struct {
+    const char *p;        // Next character
+    const char *end;      // End of the expression
+} expr_parser_t;
+
+static template_expr_t *parse_expr(expr_parser_t *parser);
+static void expr_free(template_expr_t *expr);
+
+/**
+ * Find the end of a {{ }} block, skipping quoted strings
+ *
+ * @param p First character after "{{"
+ * @return Pointer to the closing "}}", or NULL if there is none
+ */
+static const char *expr_end(const char *p) {
+    char quote = 0;
+
+    for (; *p; p++) {
+        if (quote && p[0] == '\\' && p[1]) {
+            p++;
+        } else if (quote) {
+            quote = *p == quote ? 0 : quote;
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+        } else if (p[0] == '}' && p[1] == '}') {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Skip spaces
+ *
+ * @param parser Parser state
+ */
+static void parser_skip(expr_parser_t *parser) {
+    while (parser->p < parser->end && isspace((unsigned char)*parser->p)) {
+        parser->p++;
+    }
+}
+
+/**
+ * Allocate an expression node
+ *
+ * @param type Expression type
+ * @return New node, or NULL on error
+ */
+static template_expr_t *expr_new(template_expr_type_t type) {
+    template_expr_t *expr = calloc(1, sizeof(template_expr_t));
+    if (!expr) {
+        fprintf(stderr, "Error: Failed to allocate memory for template expression\n");
+        return NULL;
+    }
+
+    expr->type = type;
+    expr->key = -1;
+    return expr;
+}
+
+/**
+ * Copy part of a string
+ *
+ * @param start First character
+ * @param length Number of characters
+ * @return NUL-terminated copy, or NULL on error
+ */
+static char *text_copy(const char *start, size_t length) {
+    char *text = malloc(length + 1);
+    if (text) {
+        memcpy(text, start, length);
+        text[length] = '\0';
+    }
+
+    return text;
+}
+
+/**
+ * Parse a quoted string literal, with Python's \\ \' \" \n \t escapes
+ *
+ * Other backslashes are kept, so regexes read as written.
+ *
+ * @param parser Parser state, at the opening quote
+ * @return String node, or NULL on error
+ */
+static template_expr_t *parse_string(expr_parser_t *parser) {
+    char quote = *parser->p++;
+    const char *start = parser->p;
+
+    while (parser->p < parser->end && *parser->p != quote) {
+        parser->p += (*parser->p == '\\' && parser->p + 1 < parser->end) ? 2 : 1;
+    }
+    if (parser->p >= parser->end) {
+        return NULL;
+    }
+
+    template_expr_t *expr = expr_new(TEMPLATE_EXPR_STRING);
+    if (!expr || !(expr->text = malloc((size_t)(parser->p - start) + 1))) {
+        free(expr);
+        return NULL;
+    }
+
+    char *out = expr->text;
+    for (const char *c = start; c < parser->p; c++) {
+        if (*c == '\\' && c + 1 < parser->p && strchr("\\'\"nt", c[1])) {
+            c++;
+            *out++ = *c == 'n' ? '\n' : *c == 't' ? '\t' : *c;
+        } else {
+            *out++ = *c;
+        }
+    }
+    *out = '\0';
+    parser->p++;
+
+    return expr;
+}
+
+/**
+ * Find a field of registered results by name
+ *
+ * @param name Field name (not NUL-terminated)
+ * @param length Length of the name
+ * @return Field, or RESULT_FIELD_NONE if there is no such field
+ */
+result_field_t template_field_find(const char *name, size_t length) {
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (strlen(fields[i].name) == length && strncmp(fields[i].name, name, length) == 0) {
+            return fields[i].field;
+        }
+    }
+
+    return RESULT_FIELD_NONE;
+}
+
+/**
+ * Parse a field of a registered result (out.stdout)
+ *
+ * @param parser Parser state, at the '.'
+ * @param start Start of the variable name
+ * @param length Length of the variable name
+ * @return Variable node, or NULL on error
+ */
+static template_expr_t *parse_field(expr_parser_t *parser, const char *start, size_t length) {
+    const char *name = ++parser->p;
+    while (parser->p < parser->end && (isalnum((unsigned char)*parser->p) || *parser->p == '_')) {
+        parser->p++;
+    }
+    size_t name_length = (size_t)(parser->p - name);
+
+    result_field_t field = template_field_find(name, name_length);
+    if (field == RESULT_FIELD_NONE) {
+        if (name_length > 0) {
+            fprintf(stderr, "Error: Unknown field '%.*s' of registered result '%.*s'\n",
+                    (int)name_length, name, (int)length, start);
+        }
+        return NULL;
+    }
+
+    // The full name is kept for messages; the variable is resolved now
+    template_expr_t *expr = expr_new(TEMPLATE_EXPR_VAR);
+    char *var = text_copy(start, length);
+    if (!expr || !var || !(expr->text = text_copy(start, (size_t)(parser->p - start))) ||
+        (expr->key = symbol_intern(var)) < 0) {
+        free(var);
+        expr_free(expr);
+        return NULL;
+    }
+    expr->field = field;
+    free(var);
+
+    return expr;
+}
+
+/**
+ * Parse a literal or a variable name
+ *
+ * @param parser Parser state
+ * @return Expression node, or NULL on error
+ */
+static template_expr_t *parse_primary(expr_parser_t *parser) {
+    parser_skip(parser);
+    const char *start = parser->p;
+    if (start >= parser->end) {
+        return NULL;
+    }
+
+    if (*start == '\'' || *start == '"') {
+        return parse_string(parser);
+    }
+
+    if (isdigit((unsigned char)*start) ||
+        (*start == '-' && start + 1 < parser->end && isdigit((unsigned char)start[1]))) {
+        // Number, rendered as written
+        parser->p++;
+        while (parser->p < parser->end && (isdigit((unsigned char)*parser->p) || *parser->p == '.')) {
+            parser->p++;
+        }
+        template_expr_t *expr = expr_new(TEMPLATE_EXPR_NUMBER);
+        if (expr && !(expr->text = text_copy(start, (size_t)(parser->p - start)))) {
+            free(expr);
+            return NULL;
+        }
+        return expr;
+    }
+
+    if (!isalpha((unsigned char)*start) && *start != '_') {
+        return NULL;
+    }
+    while (parser->p < parser->end && (isalnum((unsigned char)*parser->p) || *parser->p == '_')) {
+        parser->p++;
+    }
+    size_t length = (size_t)(parser->p - start);
+    if (parser->p < parser->end && *parser->p == '.') {
+        return parse_field(parser, start, length);
+    }
+
+    // true and false are literals; any other name is a variable, resolved now
+    int boolean = (length == 4 && (strncmp(start, "true", 4) == 0 || strncmp(start, "True", 4) == 0)) ? 1 :
+                  (length == 5 && (strncmp(start, "false", 5) == 0 || strncmp(start, "False", 5) == 0)) ? 0 : -1;
+    template_expr_t *expr = expr_new(boolean >= 0 ? TEMPLATE_EXPR_BOOL : TEMPLATE_EXPR_VAR);
+    if (!expr) {
+        return NULL;
+    }
+    expr->text = boolean >= 0 ? strdup(boolean ? "True" : "False") : text_copy(start, length);
+    if (expr->text && boolean < 0) {
+        expr->key = symbol_intern(expr->text);
+    }
+    if (!expr->text || (boolean < 0 && expr->key < 0)) {
+        expr_free(expr);
+        return NULL;
+    }
+
+    return expr;
+}
+
+/**
+ * Compile the pattern of regex_replace, translating the \d \w \s shorthands POSIX lacks
+ *
+ * @param source Python-style regex
+ * @return Compiled regex, or NULL on error
+ */
+static regex_t *regex_compile(const char *source) {
+    static const struct {
+        char escape;
+        const char *text;
+    } classes[] = {
+        { 'd', "[0-9]" }, { 'D', "[^0-9]" },
+        { 'w', "[[:alnum:]_]" }, { 'W', "[^[:alnum:]_]" },
+        { 's', "[[:space:]]" }, { 'S', "[^[:space:]]" }
+    };
+
+    char *text = malloc(strlen(source) * 7 + 1);
+    regex_t *regex = malloc(sizeof(regex_t));
+    if (!text || !regex) {
+        fprintf(stderr, "Error: Failed to allocate memory for regex\n");
+        free(text);
+        free(regex);
+        return NULL;
+    }
+
+    char *out = text;
+    for (const char *p = source; *p; p++) {
+        size_t i = 0;
+        while (p[0] == '\\' && i < sizeof(classes) / sizeof(classes[0]) && classes[i].escape != p[1]) {
+            i++;
+        }
+        if (p[0] == '\\' && i < sizeof(classes) / sizeof(classes[0])) {
+            out += sprintf(out, "%s", classes[i].text);
+            p++;
+        } else {
+            *out++ = *p;
+            if (p[0] == '\\' && p[1]) {
+                *out++ = *++p;
+            }
+        }
+    }
+    *out = '\0';
+
+    int rc = regcomp(regex, text, REG_EXTENDED);
+    free(text);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Invalid regular expression in regex_replace: %s\n", source);
+        free(regex);
+        return NULL;
+    }
+
+    return regex;
+}
+
+/**
+ * Parse a filter name and its arguments
+ *
+ * @param parser Parser state, after the '|'
+ * @param expr Filter node (its input is set)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int parse_filter(expr_parser_t *parser, template_expr_t *expr) {
+    parser_skip(parser);
+    const char *name = parser->p;
+    while (parser->p < parser->end && (isalnum((unsigned char)*parser->p) || *parser->p == '_')) {
+        parser->p++;
+    }
+    size_t length = (size_t)(parser->p - name);
+
+    size_t i = 0;
+    while (i < sizeof(filters) / sizeof(filters[0]) &&
+           (strlen(filters[i].name) != length || strncmp(filters[i].name, name, length) != 0)) {
+        i++;
+    }
+    if (length == 0) {
+        return ANCIBLE_ERROR;
+    }
+    if (i == sizeof(filters) / sizeof(filters[0])) {
+        fprintf(stderr, "Error: Unknown filter '%.*s'\n", (int)length, name);
+        return ANCIBLE_ERROR;
+    }
+    expr->filter = filters[i].filter;
+    expr->text = strdup(filters[i].name);
+    if (!expr->text) {
+        return ANCIBLE_ERROR;
+    }
+
+    parser_skip(parser);
+    if (parser->p < parser->end && *parser->p == '(') {
+        parser->p++;
+        parser_skip(parser);
+        while (parser->p < parser->end && *parser->p != ')') {
+            template_expr_t *arg = parse_expr(parser);
+            if (!arg) {
+                return ANCIBLE_ERROR;
+            }
+            if (expr->arg_count == TEMPLATE_MAX_FILTER_ARGS) {
+                expr_free(arg);
+                expr->arg_count++;
+                break;
+            }
+            expr->args[expr->arg_count++] = arg;
+
+            parser_skip(parser);
+            if (parser->p < parser->end && *parser->p == ',') {
+                parser->p++;
+                parser_skip(parser);
+            } else if (parser->p >= parser->end || *parser->p != ')') {
+                return ANCIBLE_ERROR;
+            }
+        }
+        if (parser->p >= parser->end || *parser->p != ')') {
+            return ANCIBLE_ERROR;
+        }
+        parser->p++;
+    }
+
+    if (expr->arg_count < filters[i].min_args || expr->arg_count > filters[i].max_args) {
+        if (filters[i].min_args == filters[i].max_args) {
+            fprintf(stderr, "Error: Filter '%s' takes %d arguments\n", filters[i].name, filters[i].min_args);
+        } else {
+            fprintf(stderr, "Error: Filter '%s' takes %d to %d arguments\n",
+                    filters[i].name, filters[i].min_args, filters[i].max_args);
+        }
+        return ANCIBLE_ERROR;
+    }
+
+    // The pattern is compiled once, with the template
+    if (expr->filter == TEMPLATE_FILTER_REGEX_REPLACE) {
+        if (expr->args[0]->type != TEMPLATE_EXPR_STRING) {
+            fprintf(stderr, "Error: The pattern of regex_replace must be a string literal\n");
+            return ANCIBLE_ERROR;
+        }
+        expr->regex = regex_compile(expr->args[0]->text);
+        if (!expr->regex) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Parse an expression: a literal or variable followed by filters
+ *
+ * @param parser Parser state
+ * @return Expression tree, or NULL on error
+ */
+static template_expr_t *parse_expr(expr_parser_t *parser) {
+    template_expr_t *expr = parse_primary(parser);
+
+    for (;;) {
+        parser_skip(parser);
+        if (!expr || parser->p >= parser->end || *parser->p != '|') {
+            return expr;
+        }
+        parser->p++;
+
+        template_expr_t *filter = expr_new(TEMPLATE_EXPR_FILTER);
+        if (!filter) {
+            expr_free(expr);
+            return NULL;
+        }
+        filter->input = expr;
+        expr = filter;
+        if (parse_filter(parser, filter) != ANCIBLE_SUCCESS) {
+            expr_free(filter);
+            return NULL;
+        }
+    }
+}
+
+/**
+ * Compile the text of a {{ }} block
+ *
+ * @param start First character of the expression
+ * @param end Character after the last one
+ * @return Compiled expression, or NULL on error
+ */
+static template_expr_t *expr_compile(const char *start, const char *end) {
+    expr_parser_t parser = { start, end };
+    template_expr_t *expr = parse_expr(&parser);
+
+    parser_skip(&parser);
+    if (!expr || parser.p != end) {
+        parser = (expr_parser_t){ start, end };
+        parser_skip(&parser);
+        while (end > parser.p && isspace((unsigned char)end[-1])) {
+            end--;
+        }
+        fprintf(stderr, "Error: Invalid template expression '{{ %.*s }}'\n", (int)(end - parser.p), parser.p);
+        expr_free(expr);
+        return NULL;
+    }
+
+    return expr;
+}
+
+/**
+ * Compile a template
+ *
+ * @param source Template text
+ * @return Compiled template, or NULL on error (syntax errors are reported)
+ */
+template_t *template_compile(const char *source) {
+    if (!source) {
+        return NULL;
+    }
+
+    template_t *template = calloc(1, sizeof(template_t));
+    if (!template || !(template->source = strdup(source))) {
+        fprintf(stderr, "Error: Failed to allocate memory for template\n");
+        free(template);
+        return NULL;
+    }
+
+    // Every "{{" adds at most two segments
+    int capacity = 1;
+    for (const char *p = strstr(source, "{{"); p; p = strstr(p + 2, "{{")) {
+        capacity += 2;
+    }
+    template->segments = calloc((size_t)capacity, sizeof(template_segment_t));
+    if (!template->segments) {
+        fprintf(stderr, "Error: Failed to allocate memory for template\n");
+        template_free(template);
+        return NULL;
+    }
+
+    const char *p = template->source;
+    while (*p) {
+        const char *open = strstr(p, "{{");
+        const char *stop = open ? open : p + strlen(p);
+
+        if (stop > p) {
+            template_segment_t *segment = &template->segments[template->segment_count++];
+            segment->text = p;
+            segment->length = (size_t)(stop - p);
+        }
+        if (!open) {
+            break;
+        }
+
+        const char *close = expr_end(open + 2);
+        if (!close) {
+            fprintf(stderr, "Error: Unterminated '{{' in template: %s\n", source);
+            template_free(template);
+            return NULL;
+        }
+
+        template_segment_t *segment = &template->segments[template->segment_count];
+        segment->expr = expr_compile(open + 2, close);
+        if (!segment->expr) {
+            template_free(template);
+            return NULL;
+        }
+        template->segment_count++;
+        p = close + 2;
+    }
+
+    return template;
+}
+
+/**
+ * Check whether a template holds any expression
+ *
+ * @param template Compiled template (may be NULL)
+ * @return 1 if rendering can give something other than the source, 0 otherwise
+ */
+int template_is_dynamic(const template_t *template) {
+    // Without expressions the whole source is a single literal run
+    return template && (template->segment_count > 1 ||
+                        (template->segment_count == 1 && template->segments[0].expr));
+}
+
+/**
+ * Grow a text area to hold at least a given size
+ *
+ * @param data Pointer to the area
+ * @param capacity Pointer to its allocated size
+ * @param needed Size needed
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int area_reserve(char **data, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    size_t grown = *capacity ? *capacity : 64;
+    while (grown < needed) {
+        grown *= 2;
+    }
+
+    char *area = realloc(*data, grown);
+    if (!area) {
+        fprintf(stderr, "Error: Failed to allocate memory for rendered template\n");
+        return ANCIBLE_ERROR;
+    }
+    *data = area;
+    *capacity = grown;
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append text to a buffer
+ *
+ * @param buffer Buffer
+ * @param text Text to append
+ * @param length Length of the text
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int buffer_append(template_buffer_t *buffer, const char *text, size_t length) {
+    if (area_reserve(&buffer->data, &buffer->capacity, buffer->length + length + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Get the text of a value
+ *
+ * @param buffer Buffer holding the scratch area
+ * @param value Value
+ * @return Text (only valid until the scratch area grows)
+ */
+static const char *operand_text(const template_buffer_t *buffer, const operand_t *value) {
+    return value->text ? value->text : buffer->scratch + value->offset;
+}
+
+/**
+ * Start a value at the end of the scratch area
+ *
+ * The terminator of the value before is kept, so it stays readable.
+ *
+ * @param buffer Buffer
+ * @param value Value to start
+ * @param kind Kind of the value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int scratch_begin(template_buffer_t *buffer, operand_t *value, operand_kind_t kind) {
+    if (area_reserve(&buffer->scratch, &buffer->scratch_capacity, buffer->scratch_length + 2) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    buffer->scratch[buffer->scratch_length++] = '\0';
+    memset(value, 0, sizeof(operand_t));
+    value->kind = kind;
+    value->offset = buffer->scratch_length;
+    buffer->scratch[buffer->scratch_length] = '\0';
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Finish the value at the end of the scratch area
+ *
+ * @param buffer Buffer
+ * @param value Value started with scratch_begin
+ */
+static void scratch_end(const template_buffer_t *buffer, operand_t *value) {
+    value->length = buffer->scratch_length - value->offset;
+}
+
+/**
+ * Append text to the value at the end of the scratch area
+ *
+ * @param buffer Buffer
+ * @param text Text (not in the scratch area)
+ * @param length Length of the text
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int scratch_put(template_buffer_t *buffer, const char *text, size_t length) {
+    if (area_reserve(&buffer->scratch, &buffer->scratch_capacity,
+                     buffer->scratch_length + length + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    memcpy(buffer->scratch + buffer->scratch_length, text, length);
+    buffer->scratch_length += length;
+    buffer->scratch[buffer->scratch_length] = '\0';
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append part of another value to the value at the end of the scratch area
+ *
+ * @param buffer Buffer
+ * @param value Value to copy from (may be in the scratch area)
+ * @param from Offset of the part in the value
+ * @param length Length of the part
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int scratch_copy(template_buffer_t *buffer, const operand_t *value, size_t from, size_t length) {
+    if (area_reserve(&buffer->scratch, &buffer->scratch_capacity,
+                     buffer->scratch_length + length + 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    // The source is read after growing, as it may have moved
+    memcpy(buffer->scratch + buffer->scratch_length, operand_text(buffer, value) + from, length);
+    buffer->scratch_length += length;
+    buffer->scratch[buffer->scratch_length] = '\0';
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Find the next item of a flow-style list ("[a, 'b c', d]")
+ *
+ * @param text List text
+ * @param length Length of the text
+ * @param pos Position to scan from (0 at the start), updated
+ * @param start Pointer to receive the offset of the item
+ * @param size Pointer to receive the length of the item
+ * @return 1 if an item was found, 0 at the end of the list
+ */
+static int list_next(const char *text, size_t length, size_t *pos, size_t *start, size_t *size) {
+    size_t p = *pos;
+    while (p < length && (text[p] == '[' || text[p] == ',' || isspace((unsigned char)text[p]))) {
+        p++;
+    }
+    if (p >= length || text[p] == ']') {
+        *pos = length;
+        return 0;
+    }
+
+    if (text[p] == '\'' || text[p] == '"') {
+        const char *close = memchr(text + p + 1, text[p], length - p - 1);
+        size_t end = close ? (size_t)(close - text) : length;
+        *start = p + 1;
+        *size = end - p - 1;
+        *pos = end + 1;
+        return 1;
+    }
+
+    size_t end = p;
+    while (end < length && text[end] != ',' && text[end] != ']') {
+        end++;
+    }
+    *pos = end;
+    while (end > p && isspace((unsigned char)text[end - 1])) {
+        end--;
+    }
+    *start = p;
+    *size = end - p;
+    return 1;
+}
+
+/**
+ * Wrap a typed value into an operand
+ *
+ * @param typed Typed value
+ * @param out Operand to fill
+ */
+static void operand_typed(const value_t *typed, operand_t *out) {
+    memset(out, 0, sizeof(operand_t));
+    out->kind = typed->type == VALUE_INT ? OPERAND_NUMBER :
+                typed->type == VALUE_BOOL ? OPERAND_BOOL :
+                typed->type == VALUE_STRING ? OPERAND_STRING : OPERAND_LIST;
+    out->text = typed->text;
+    out->length = typed->length;
+    out->typed = typed;
+}
+
+/**
+ * Find the next item of a list value
+ *
+ * Typed lists hand out their items as they are, maps their keys; text
+ * lists are scanned, and items point into the list's own text.
+ *
+ * @param buffer Buffer holding the scratch area
+ * @param value List value
+ * @param pos Position to scan from (0 at the start), updated
+ * @param item Operand to receive the item (not NUL-terminated unless typed)
+ * @return 1 if an item was found, 0 at the end of the list
+ */
+static int operand_next(const template_buffer_t *buffer, const operand_t *value, size_t *pos, operand_t *item) {
+    size_t start;
+    size_t size;
+
+    if (value->typed && (value->typed->type == VALUE_LIST || value->typed->type == VALUE_MAP)) {
+        if (*pos >= (size_t)value->typed->count) {
+            return 0;
+        }
+        if (value->typed->type == VALUE_LIST) {
+            operand_typed(&value->typed->items[*pos], item);
+        } else {
+            memset(item, 0, sizeof(operand_t));
+            item->kind = OPERAND_STRING;
+            item->text = value->typed->keys[*pos];
+            item->length = strlen(item->text);
+        }
+        (*pos)++;
+        return 1;
+    }
+
+    memset(item, 0, sizeof(operand_t));
+    item->kind = OPERAND_STRING;
+
+    if (!value->lines) {
+        if (!list_next(operand_text(buffer, value), value->length, pos, &start, &size)) {
+            return 0;
+        }
+        item->text = value->text ? value->text + start : NULL;
+        item->offset = value->offset + start;
+        item->length = size;
+        return 1;
+    }
+
+    // Lines of registered output, read through its index
+    const registered_t *result = value->lines;
+    if (*pos >= (size_t)result->line_count) {
+        return 0;
+    }
+    start = result->lines[*pos];
+    size = result->lines[*pos + 1] - 1 - start;
+    if (size > 0 && result->stdout_data[start + size - 1] == '\r') {
+        size--;
+    }
+    item->text = result->stdout_data + start;
+    item->length = size;
+    (*pos)++;
+
+    return 1;
+}
+
+/**
+ * Check whether a value is true, as Jinja sees it
+ *
+ * @param buffer Buffer holding the scratch area
+ * @param value Value
+ * @return 1 if true, 0 otherwise
+ */
+static int operand_truthy(const template_buffer_t *buffer, const operand_t *value) {
+    const char *text = operand_text(buffer, value);
+    size_t pos = 0;
+    operand_t item;
+
+    switch (value->kind) {
+    case OPERAND_UNDEFINED:
+        return 0;
+    case OPERAND_BOOL:
+        return strcmp(text, "True") == 0;
+    case OPERAND_NUMBER:
+        return strtod(text, NULL) != 0;
+    case OPERAND_LIST:
+        return operand_next(buffer, value, &pos, &item);
+    default:
+        return value->length > 0;
+    }
+}
+
+/**
+ * Append a list item to the value at the end of the scratch area, quoted as Python prints it
+ *
+ * @param buffer Buffer
+ * @param value Value holding the item
+ * @param from Offset of the item in the value
+ * @param length Length of the item
+ * @param first Whether this is the first item
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int put_list_item(template_buffer_t *buffer, const operand_t *value, size_t from, size_t length, int first) {
+    const char *text = operand_text(buffer, value) + from;
+    const char *quote = memchr(text, '\'', length) && !memchr(text, '"', length) ? "\"" : "'";
+
+    if (scratch_put(buffer, first ? "" : ", ", first ? 0 : 2) != ANCIBLE_SUCCESS ||
+        scratch_put(buffer, quote, 1) != ANCIBLE_SUCCESS ||
+        scratch_copy(buffer, value, from, length) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    return scratch_put(buffer, quote, 1);
+}
+
+/**
+ * Turn a list of output lines into list text, for filters that work on text
+ *
+ * @param buffer Buffer
+ * @param value Value, replaced by the text when it is a list of lines
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int operand_flatten(template_buffer_t *buffer, operand_t *value) {
+    if (!value->lines) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    operand_t text;
+    operand_t item;
+    size_t pos = 0;
+    if (scratch_begin(buffer, &text, OPERAND_LIST) != ANCIBLE_SUCCESS || scratch_put(buffer, "[", 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    for (int first = 1; operand_next(buffer, value, &pos, &item); first = 0) {
+        if (put_list_item(buffer, &item, 0, item.length, first) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+    if (scratch_put(buffer, "]", 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    scratch_end(buffer, &text);
+    *value = text;
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append a value as a JSON string to the value at the end of the scratch area
+ *
+ * @param buffer Buffer
+ * @param value Value holding the text
+ * @param from Offset of the text in the value
+ * @param length Length of the text
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int put_json_string(template_buffer_t *buffer, const operand_t *value, size_t from, size_t length) {
+    if (scratch_put(buffer, "\"", 1) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)operand_text(buffer, value)[from + i];
+        char escaped[8];
+        int size = 0;
+
+        if (c == '"' || c == '\\') {
+            size = snprintf(escaped, sizeof(escaped), "\\%c", c);
+        } else if (c == '\n') {
+            size = snprintf(escaped, sizeof(escaped), "\\n");
+        } else if (c == '\t') {
+            size = snprintf(escaped, sizeof(escaped), "\\t");
+        } else if (c == '\r') {
+            size = snprintf(escaped, sizeof(escaped), "\\r");
+        } else if (c < 0x20) {
+            size = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        }
+
+        int rc = size > 0 ? scratch_put(buffer, escaped, (size_t)size) : scratch_copy(buffer, value, from + i, 1);
+        if (rc != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return scratch_put(buffer, "\"", 1);
+}
+
+/**
+ * Append a typed value as JSON to the value at the end of the scratch area
+ *
+ * @param buffer Buffer
+ * @param typed Typed value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int put_json_value(template_buffer_t *buffer, const value_t *typed) {
+    operand_t text;
+    int rc;
+
+    switch (typed->type) {
+    case VALUE_INT:
+        return scratch_put(buffer, typed->text, typed->length);
+    case VALUE_BOOL:
+        return scratch_put(buffer, typed->integer ? "true" : "false", typed->integer ? 4 : 5);
+    case VALUE_STRING:
+        operand_typed(typed, &text);
+        return put_json_string(buffer, &text, 0, text.length);
+    default:
+        break;
+    }
+
+    rc = scratch_put(buffer, typed->type == VALUE_LIST ? "[" : "{", 1);
+    for (int i = 0; rc == ANCIBLE_SUCCESS && i < typed->count; i++) {
+        rc = i > 0 ? scratch_put(buffer, ", ", 2) : ANCIBLE_SUCCESS;
+        if (rc == ANCIBLE_SUCCESS && typed->type == VALUE_MAP) {
+            memset(&text, 0, sizeof(text));
+            text.text = typed->keys[i];
+            text.length = strlen(text.text);
+            rc = put_json_string(buffer, &text, 0, text.length);
+            if (rc == ANCIBLE_SUCCESS) {
+                rc = scratch_put(buffer, ": ", 2);
+            }
+        }
+        if (rc == ANCIBLE_SUCCESS) {
+            rc = put_json_value(buffer, &typed->items[i]);
+        }
+    }
+
+    return rc == ANCIBLE_SUCCESS ? scratch_put(buffer, typed->type == VALUE_LIST ? "]" : "}", 1) : rc;
+}
+
+/**
+ * Append flow-style text ("{a: 1, b: two}", "[1, x]") as JSON to the value at the end of the scratch area
+ *
+ * The text is read as set_fact would read it, so numbers and booleans keep
+ * their type; text that is not a list or map is written as a JSON string.
+ *
+ * @param buffer Buffer
+ * @param value Value holding the text
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int put_json_flow(template_buffer_t *buffer, const operand_t *value) {
+    arena_t arena;
+    memset(&arena, 0, sizeof(arena));
+
+    // Copied first: the text may sit in the scratch area the object is written to
+    const char *text = arena_strndup(&arena, operand_text(buffer, value), value->length);
+    const value_t *typed = text ? value_parse(&arena, text) : NULL;
+    int rc = typed && (typed->type == VALUE_LIST || typed->type == VALUE_MAP) ? put_json_value(buffer, typed) :
+             put_json_string(buffer, value, 0, value->length);
+
+    arena_free(&arena);
+    return rc;
+}
+
+/**
+ * Replace every match of a precompiled regex, with \1 to \9 back references
+ *
+ * @param buffer Buffer
+ * @param regex Compiled pattern
+ * @param in Input value
+ * @param replacement Replacement value (NULL for an empty replacement)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int regex_substitute(template_buffer_t *buffer, const regex_t *regex, const operand_t *in,
+                            const operand_t *replacement) {
+    regmatch_t match[REGEX_MAX_GROUPS];
+    size_t pos = 0;
+    int flags = 0;
+
+    while (pos <= in->length && regexec(regex, operand_text(buffer, in) + pos, REGEX_MAX_GROUPS, match, flags) == 0) {
+        size_t so = (size_t)match[0].rm_so;
+        size_t eo = (size_t)match[0].rm_eo;
+        if (scratch_copy(buffer, in, pos, so) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+
+        for (size_t i = 0; replacement && i < replacement->length; i++) {
+            char c = operand_text(buffer, replacement)[i];
+            char next = i + 1 < replacement->length ? operand_text(buffer, replacement)[i + 1] : '\0';
+            int rc;
+
+            if (c == '\\' && isdigit((unsigned char)next)) {
+                const regmatch_t *group = &match[next - '0'];
+                rc = group->rm_so < 0 ? ANCIBLE_SUCCESS :
+                     scratch_copy(buffer, in, pos + (size_t)group->rm_so, (size_t)(group->rm_eo - group->rm_so));
+                i++;
+            } else if (c == '\\' && next == '\\') {
+                rc = scratch_put(buffer, "\\", 1);
+                i++;
+            } else {
+                rc = scratch_copy(buffer, replacement, i, 1);
+            }
+            if (rc != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+        }
+
+        // An empty match moves on by one character
+        if (eo == so) {
+            if (pos + eo < in->length && scratch_copy(buffer, in, pos + eo, 1) != ANCIBLE_SUCCESS) {
+                return ANCIBLE_ERROR;
+            }
+            eo++;
+        }
+        pos += eo;
+        flags = REG_NOTBOL;
+    }
+
+    return pos < in->length ? scratch_copy(buffer, in, pos, in->length - pos) : ANCIBLE_SUCCESS;
+}
+
+/**
+ * Apply a filter
+ *
+ * @param expr Filter node
+ * @param in Input value (defined unless the filter is default)
+ * @param args Argument values
+ * @param buffer Buffer holding the scratch area
+ * @param out Value to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int filter_apply(const template_expr_t *expr, const operand_t *in, const operand_t *args,
+                        template_buffer_t *buffer, operand_t *out) {
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char number[32];
+    size_t pos = 0;
+    operand_t item;
+    int rc = ANCIBLE_SUCCESS;
+
+    if (expr->filter == TEMPLATE_FILTER_DEFAULT) {
+        int replace = in->kind == OPERAND_UNDEFINED ||
+                      (expr->arg_count > 1 && operand_truthy(buffer, &args[1]) && !operand_truthy(buffer, in));
+        *out = replace ? args[0] : *in;
+        return ANCIBLE_SUCCESS;
+    }
+
+    if (expr->filter == TEMPLATE_FILTER_INT || expr->filter == TEMPLATE_FILTER_LENGTH) {
+        // Both give a number, formatted before the scratch area is touched
+        if (expr->filter == TEMPLATE_FILTER_INT) {
+            const char *text = operand_text(buffer, in);
+            char *end;
+            long value = strtol(text, &end, 10);
+            if (end == text || (*end && *end != '.' && !isspace((unsigned char)*end))) {
+                value = expr->arg_count > 0 ? strtol(operand_text(buffer, &args[0]), NULL, 10) : 0;
+            }
+            snprintf(number, sizeof(number), "%ld", value);
+        } else {
+            long count = 0;
+            const char *text = operand_text(buffer, in);
+            if (in->kind == OPERAND_LIST) {
+                while (operand_next(buffer, in, &pos, &item)) {
+                    count++;
+                }
+            } else {
+                // Characters, not bytes
+                for (size_t i = 0; i < in->length; i++) {
+                    count += ((unsigned char)text[i] & 0xc0) != 0x80;
+                }
+            }
+            snprintf(number, sizeof(number), "%ld", count);
+        }
+
+        if (scratch_begin(buffer, out, OPERAND_NUMBER) != ANCIBLE_SUCCESS ||
+            scratch_put(buffer, number, strlen(number)) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        scratch_end(buffer, out);
+        return ANCIBLE_SUCCESS;
+    }
+
+    operand_kind_t kind = expr->filter == TEMPLATE_FILTER_SPLIT ? OPERAND_LIST : OPERAND_STRING;
+    if (scratch_begin(buffer, out, kind) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    switch (expr->filter) {
+    case TEMPLATE_FILTER_LOWER:
+    case TEMPLATE_FILTER_UPPER:
+        rc = scratch_copy(buffer, in, 0, in->length);
+        for (size_t i = out->offset; rc == ANCIBLE_SUCCESS && i < buffer->scratch_length; i++) {
+            unsigned char c = (unsigned char)buffer->scratch[i];
+            buffer->scratch[i] = (char)(expr->filter == TEMPLATE_FILTER_LOWER ? tolower(c) : toupper(c));
+        }
+        break;
+
+    case TEMPLATE_FILTER_REPLACE:
+        while (rc == ANCIBLE_SUCCESS && pos < in->length) {
+            // Offset of the next occurrence, or the end
+            size_t hit = pos;
+            while (args[0].length > 0 && hit + args[0].length <= in->length &&
+                   memcmp(operand_text(buffer, in) + hit, operand_text(buffer, &args[0]), args[0].length) != 0) {
+                hit++;
+            }
+            if (args[0].length == 0 || hit + args[0].length > in->length) {
+                hit = in->length;
+            }
+
+            rc = scratch_copy(buffer, in, pos, hit - pos);
+            if (rc == ANCIBLE_SUCCESS && hit < in->length) {
+                rc = scratch_copy(buffer, &args[1], 0, args[1].length);
+            }
+            pos = hit < in->length ? hit + args[0].length : in->length;
+        }
+        break;
+
+    case TEMPLATE_FILTER_REGEX_REPLACE:
+        rc = regex_substitute(buffer, expr->regex, in, expr->arg_count > 1 ? &args[1] : NULL);
+        break;
+
+    case TEMPLATE_FILTER_JOIN:
+        if (in->kind == OPERAND_LIST) {
+            for (int first = 1; rc == ANCIBLE_SUCCESS &&
+                 operand_next(buffer, in, &pos, &item); first = 0) {
+                if (!first && expr->arg_count > 0) {
+                    rc = scratch_copy(buffer, &args[0], 0, args[0].length);
+                }
+                if (rc == ANCIBLE_SUCCESS) {
+                    rc = scratch_copy(buffer, &item, 0, item.length);
+                }
+            }
+        } else {
+            // A string is a sequence of characters
+            for (size_t i = 0; rc == ANCIBLE_SUCCESS && i < in->length; i++) {
+                if (i > 0 && expr->arg_count > 0) {
+                    rc = scratch_copy(buffer, &args[0], 0, args[0].length);
+                }
+                if (rc == ANCIBLE_SUCCESS) {
+                    rc = scratch_copy(buffer, in, i, 1);
+                }
+            }
+        }
+        break;
+
+    case TEMPLATE_FILTER_SPLIT:
+        // Python's str.split: on a separator, or on runs of spaces without one
+        rc = scratch_put(buffer, "[", 1);
+        for (int first = 1; rc == ANCIBLE_SUCCESS && pos <= in->length; first = 0) {
+            const char *text = operand_text(buffer, in);
+            size_t end = pos;
+
+            if (expr->arg_count > 0 && args[0].length > 0) {
+                const char *sep = operand_text(buffer, &args[0]);
+                while (end < in->length &&
+                       (end + args[0].length > in->length || memcmp(text + end, sep, args[0].length) != 0)) {
+                    end++;
+                }
+                rc = put_list_item(buffer, in, pos, end - pos, first);
+                pos = end + args[0].length;
+                if (end >= in->length) {
+                    break;
+                }
+            } else {
+                while (pos < in->length && isspace((unsigned char)text[pos])) {
+                    pos++;
+                }
+                if (pos >= in->length) {
+                    break;
+                }
+                end = pos;
+                while (end < in->length && !isspace((unsigned char)text[end])) {
+                    end++;
+                }
+                rc = put_list_item(buffer, in, pos, end - pos, first);
+                pos = end;
+            }
+        }
+        if (rc == ANCIBLE_SUCCESS) {
+            rc = scratch_put(buffer, "]", 1);
+        }
+        break;
+
+    case TEMPLATE_FILTER_B64ENCODE:
+        for (size_t i = 0; rc == ANCIBLE_SUCCESS && i < in->length; i += 3) {
+            const unsigned char *text = (const unsigned char *)operand_text(buffer, in) + i;
+            size_t left = in->length - i;
+            uint32_t bits = (uint32_t)text[0] << 16 | (uint32_t)(left > 1 ? text[1] : 0) << 8 | (left > 2 ? text[2] : 0);
+            char quad[4] = {
+                base64[bits >> 18 & 63], base64[bits >> 12 & 63],
+                left > 1 ? base64[bits >> 6 & 63] : '=', left > 2 ? base64[bits & 63] : '='
+            };
+            rc = scratch_put(buffer, quad, 4);
+        }
+        break;
+
+    case TEMPLATE_FILTER_TO_JSON:
+        if (in->typed) {
+            rc = put_json_value(buffer, in->typed);
+        } else if (in->kind == OPERAND_NUMBER) {
+            rc = scratch_copy(buffer, in, 0, in->length);
+        } else if (in->kind == OPERAND_BOOL) {
+            rc = scratch_put(buffer, operand_truthy(buffer, in) ? "true" : "false", operand_truthy(buffer, in) ? 4 : 5);
+        } else if (!in->lines && in->length > 0 &&
+                   (operand_text(buffer, in)[0] == '{' || operand_text(buffer, in)[0] == '[')) {
+            rc = put_json_flow(buffer, in);
+        } else if (in->kind == OPERAND_LIST) {
+            rc = scratch_put(buffer, "[", 1);
+            for (int first = 1; rc == ANCIBLE_SUCCESS &&
+                 operand_next(buffer, in, &pos, &item); first = 0) {
+                rc = first ? ANCIBLE_SUCCESS : scratch_put(buffer, ", ", 2);
+                if (rc == ANCIBLE_SUCCESS) {
+                    rc = put_json_string(buffer, &item, 0, item.length);
+                }
+            }
+            if (rc == ANCIBLE_SUCCESS) {
+                rc = scratch_put(buffer, "]", 1);
+            }
+        } else {
+            rc = put_json_string(buffer, in, 0, in->length);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    scratch_end(buffer, out);
+    return rc;
+}
+
+/**
+ * Leave an error message in a buffer
+ *
+ * @param buffer Buffer
+ * @param expr Variable that is not set
+ * @return NULL
+ */
+static const char *render_error(template_buffer_t *buffer, const template_expr_t *expr) {
+    static const char prefix[] = "Undefined variable '";
+
+    buffer->length = 0;
+    if (buffer_append(buffer, prefix, sizeof(prefix) - 1) == ANCIBLE_SUCCESS &&
+        buffer_append(buffer, expr->text, strlen(expr->text)) == ANCIBLE_SUCCESS) {
+        buffer_append(buffer, "'", 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Read a field of a registered result
+ *
+ * Output is used in place; stdout_lines walks the output through its line index.
+ *
+ * @param expr Variable node with a field
+ * @param context Context of the host
+ * @param buffer Buffer holding the scratch area
+ * @param out Value to fill (OPERAND_UNDEFINED if nothing was registered or the field is not set)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (the message is left in the buffer)
+ */
+static int field_eval(const template_expr_t *expr, const context_t *context, template_buffer_t *buffer,
+                      operand_t *out) {
+    registered_t *result = context_get_result(context, expr->key);
+    out->kind = OPERAND_STRING;
+
+    switch (result ? expr->field : RESULT_FIELD_NONE) {
+    case RESULT_FIELD_STDOUT:
+        out->text = result->stdout_data;
+        out->length = result->stdout_length;
+        break;
+    case RESULT_FIELD_STDERR:
+        out->text = result->stderr_data;
+        break;
+    case RESULT_FIELD_RC:
+        out->text = result->rc[0] ? result->rc : NULL;
+        out->kind = OPERAND_NUMBER;
+        break;
+    case RESULT_FIELD_CHANGED:
+    case RESULT_FIELD_FAILED:
+    case RESULT_FIELD_SKIPPED:
+        out->text = (expr->field == RESULT_FIELD_CHANGED ? result->changed :
+                     expr->field == RESULT_FIELD_FAILED ? result->failed : result->skipped) ? "True" : "False";
+        out->kind = OPERAND_BOOL;
+        break;
+    case RESULT_FIELD_MSG:
+        out->text = result->msg;
+        break;
+    case RESULT_FIELD_STDOUT_LINES:
+        if (result->stdout_data && context_result_lines(result) < 0) {
+            buffer->length = 0;
+            buffer_append(buffer, "Failed to index output lines", 28);
+            return ANCIBLE_ERROR;
+        }
+        out->text = result->stdout_data;
+        out->length = result->stdout_length;
+        out->kind = OPERAND_LIST;
+        out->lines = result;
+        break;
+    default:
+        break;
+    }
+
+    if (!out->text) {
+        memset(out, 0, sizeof(operand_t));
+        out->kind = OPERAND_UNDEFINED;
+        out->source = expr;
+    } else if (expr->field != RESULT_FIELD_STDOUT && expr->field != RESULT_FIELD_STDOUT_LINES) {
+        out->length = strlen(out->text);
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Evaluate an expression for a host
+ *
+ * @param expr Compiled expression
+ * @param context Context of the host
+ * @param buffer Buffer holding the scratch area
+ * @param out Value to fill (OPERAND_UNDEFINED for a variable that is not set)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (the message is left in the buffer)
+ */
+static int expr_eval(const template_expr_t *expr, const context_t *context, template_buffer_t *buffer,
+                     operand_t *out) {
+    memset(out, 0, sizeof(operand_t));
+
+    if (expr->field != RESULT_FIELD_NONE) {
+        return field_eval(expr, context, buffer, out);
+    }
+
+    if (expr->type == TEMPLATE_EXPR_VAR) {
+        // Typed variables keep their type; text is sniffed for lists
+        const value_t *typed;
+        out->text = context_lookup_id(context, expr->key, &typed);
+        if (typed) {
+            operand_typed(typed, out);
+            return ANCIBLE_SUCCESS;
+        }
+    }
+
+    if (expr->type != TEMPLATE_EXPR_FILTER) {
+        out->text = expr->type == TEMPLATE_EXPR_VAR ? out->text : expr->text;
+        out->kind = expr->type == TEMPLATE_EXPR_NUMBER ? OPERAND_NUMBER :
+                    expr->type == TEMPLATE_EXPR_BOOL ? OPERAND_BOOL : OPERAND_STRING;
+        if (!out->text) {
+            out->kind = OPERAND_UNDEFINED;
+            out->source = expr;
+            return ANCIBLE_SUCCESS;
+        }
+        out->length = strlen(out->text);
+
+        // Variables hold lists in flow style
+        if (expr->type == TEMPLATE_EXPR_VAR && out->length >= 2 && out->text[0] == '[' &&
+            out->text[out->length - 1] == ']') {
+            out->kind = OPERAND_LIST;
+        }
+        return ANCIBLE_SUCCESS;
+    }
+
+    operand_t in;
+    operand_t args[TEMPLATE_MAX_FILTER_ARGS];
+    if (expr_eval(expr->input, context, buffer, &in) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    for (int i = 0; i < expr->arg_count; i++) {
+        if (expr_eval(expr->args[i], context, buffer, &args[i]) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (args[i].kind == OPERAND_UNDEFINED) {
+            render_error(buffer, args[i].source);
+            return ANCIBLE_ERROR;
+        }
+        if (operand_flatten(buffer, &args[i]) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    // Output lines are walked in place by the filters that iterate lists
+    if (expr->filter != TEMPLATE_FILTER_DEFAULT && expr->filter != TEMPLATE_FILTER_JOIN &&
+        expr->filter != TEMPLATE_FILTER_LENGTH && expr->filter != TEMPLATE_FILTER_TO_JSON &&
+        operand_flatten(buffer, &in) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    // Only default accepts an undefined input
+    if (in.kind == OPERAND_UNDEFINED && expr->filter != TEMPLATE_FILTER_DEFAULT) {
+        render_error(buffer, in.source);
+        return ANCIBLE_ERROR;
+    }
+
+    return filter_apply(expr, &in, args, buffer, out);
+}
+
+/**
+ * Evaluate the expression of a segment, failing on an undefined result
+ *
+ * @param expr Compiled expression
+ * @param context Context of the host
+ * @param buffer Buffer holding the scratch area
+ * @param out Value to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (the message is left in the buffer)
+ */
+static int segment_eval(const template_expr_t *expr, const context_t *context, template_buffer_t *buffer,
+                        operand_t *out) {
+    buffer->scratch_length = 0;
+    if (expr_eval(expr, context, buffer, out) != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+    if (out->kind == OPERAND_UNDEFINED) {
+        render_error(buffer, out->source);
+        return ANCIBLE_ERROR;
+    }
+
+    return operand_flatten(buffer, out);
+}
+
+/**
+ * Render a template for a host
+ *
+ * @param template Compiled template
+ * @param context Context of the host (variables are looked up through it)
+ * @param buffer Buffer to render into
+ * @return Rendered text, or NULL on error (the buffer then holds the error message)
+ */
+const char *template_render(const template_t *template, const context_t *context, template_buffer_t *buffer) {
+    if (!template || !context || !buffer) {
+        return NULL;
+    }
+
+    // Nothing to substitute, or a lone expression whose value is used in place
+    if (!template_is_dynamic(template)) {
+        return template->source;
+    }
+    operand_t value;
+    if (template->segment_count == 1) {
+        return segment_eval(template->segments[0].expr, context, buffer, &value) == ANCIBLE_SUCCESS ?
+               operand_text(buffer, &value) : NULL;
+    }
+
+    buffer->length = 0;
+    if (buffer_append(buffer, "", 0) != ANCIBLE_SUCCESS) {
+        return NULL;
+    }
+
+    for (int i = 0; i < template->segment_count; i++) {
+        const template_segment_t *segment = &template->segments[i];
+        const char *text = segment->text;
+        size_t length = segment->length;
+
+        if (segment->expr) {
+            if (segment_eval(segment->expr, context, buffer, &value) != ANCIBLE_SUCCESS) {
+                return NULL;
+            }
+            text = operand_text(buffer, &value);
+            length = value.length;
+        }
+
+        if (buffer_append(buffer, text, length) != ANCIBLE_SUCCESS) {
+            return NULL;
+        }
+    }
+
+    return buffer->data;
+}
+
+/**
+ * Free the memory held by a template buffer
+ *
+ * @param buffer Buffer (may be NULL)
+ */
+void template_buffer_free(template_buffer_t *buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    free(buffer->data);
+    free(buffer->scratch);
+    memset(buffer, 0, sizeof(template_buffer_t));
+}
+
+/**
+ * Free an expression tree
+ *
+ * @param expr Expression (may be NULL)
+ */
+static void expr_free(template_expr_t *expr) {
+    if (!expr) {
+        return;
+    }
+
+    expr_free(expr->input);
+    for (int i = 0; i < expr->arg_count && i < TEMPLATE_MAX_FILTER_ARGS; i++) {
+        expr_free(expr->args[i]);
+    }
+    if (expr->regex) {
+        regfree(expr->regex);
+        free(expr->regex);
+    }
+    free(expr->text);
+    free(expr);
+}
+
+/**
+ * Free a compiled template
+ *
+ * @param template Compiled template (may be NULL)
+ */
+void template_free(template_t *template) {
+    if (!template) {
+        return;
+    }
+
+    for (int i = 0; template->segments && i < template->segment_count; i++) {
+        expr_free(template->segments[i].expr);
+    }
+    free(template->segments);
+    free(template->source);
+    free(template);
+}
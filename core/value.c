@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include "../include/ancible.h"
+#include "../include/core/value.h"
+
+/**
+ * Check whether an item needs quotes in the flow-style text of its list or map
+ *
+ * @param item Item
+ * @return Quote character to use, or 0 if the text is used as it is
+ */
+static char item_quote(const value_t *item) {
+    if (item->type != VALUE_STRING) {
+        return 0;
+    }
+
+    int quote = item->length == 0 || isspace((unsigned char)item->text[0]) ||
+                isspace((unsigned char)item->text[item->length - 1]) ||
+                strpbrk(item->text, ",[]{}'\"") != NULL;
+    if (!quote) {
+        return 0;
+    }
+    return strchr(item->text, '\'') ? '"' : '\'';
+}
+
+/**
+ * Write the flow-style text form of a list or map, once its items are built
+ *
+ * @param arena Arena
+ * @param value List or map value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int value_collection_text(arena_t *arena, value_t *value) {
+    // Sized first, so the text is a single allocation
+    size_t length = 2;
+    for (int i = 0; i < value->count; i++) {
+        length += (i > 0 ? 2 : 0) + value->items[i].length + (item_quote(&value->items[i]) ? 2 : 0);
+        length += value->type == VALUE_MAP ? strlen(value->keys[i]) + 2 : 0;
+    }
+
+    char *text = arena_alloc(arena, length + 1);
+    if (!text) {
+        return ANCIBLE_ERROR;
+    }
+
+    char *out = text;
+    *out++ = value->type == VALUE_LIST ? '[' : '{';
+    for (int i = 0; i < value->count; i++) {
+        const value_t *item = &value->items[i];
+        char quote = item_quote(item);
+
+        if (i > 0) {
+            *out++ = ',';
+            *out++ = ' ';
+        }
+        if (value->type == VALUE_MAP) {
+            out += sprintf(out, "%s: ", value->keys[i]);
+        }
+        if (quote) {
+            *out++ = quote;
+        }
+        memcpy(out, item->text, item->length);
+        out += item->length;
+        if (quote) {
+            *out++ = quote;
+        }
+    }
+    *out++ = value->type == VALUE_LIST ? ']' : '}';
+    *out = '\0';
+
+    value->text = text;
+    value->length = length;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Fill a scalar value, inferring its type from its text
+ *
+ * @param arena Arena
+ * @param value Value to fill
+ * @param text Text of the value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int value_scalar(arena_t *arena, value_t *value, const char *text) {
+    const char *digits = text + (text[0] == '-' || text[0] == '+');
+    char *end = NULL;
+
+    if (isdigit((unsigned char)*digits)) {
+        errno = 0;
+        long long integer = strtoll(text, &end, 10);
+        if (*end == '\0' && errno == 0) {
+            value->type = VALUE_INT;
+            value->integer = integer;
+        }
+    }
+
+    if (strcasecmp(text, "true") == 0 || strcasecmp(text, "yes") == 0 ||
+        strcasecmp(text, "false") == 0 || strcasecmp(text, "no") == 0) {
+        value->type = VALUE_BOOL;
+        value->integer = strcasecmp(text, "true") == 0 || strcasecmp(text, "yes") == 0;
+        text = value->integer ? "True" : "False";
+    }
+
+    value->length = strlen(text);
+    value->text = arena_strndup(arena, text, value->length);
+    return value->text ? ANCIBLE_SUCCESS : ANCIBLE_ERROR;
+}
+
+/**
+ * Fill a value from a YAML node
+ *
+ * @param arena Arena
+ * @param value Value to fill
+ * @param node Node
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int value_fill(arena_t *arena, value_t *value, const yaml_node_t *node) {
+    if (node->type == YAML_SCALAR) {
+        return value_scalar(arena, value, node->value);
+    }
+
+    value->type = node->type == YAML_SEQ ? VALUE_LIST : VALUE_MAP;
+    for (const yaml_node_t *child = node->children; child; child = child->next) {
+        value->count++;
+    }
+
+    value->items = arena_alloc(arena, (size_t)value->count * sizeof(value_t) + 1);
+    if (!value->items) {
+        return ANCIBLE_ERROR;
+    }
+    if (value->type == VALUE_MAP) {
+        value->keys = arena_alloc(arena, (size_t)value->count * sizeof(char *) + 1);
+        if (!value->keys) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    int i = 0;
+    for (const yaml_node_t *child = node->children; child; child = child->next, i++) {
+        if (value_fill(arena, &value->items[i], child) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (value->type == VALUE_MAP &&
+            !(value->keys[i] = arena_strndup(arena, child->key, strlen(child->key)))) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return value_collection_text(arena, value);
+}
+
+/**
+ * Build a value from a YAML (or JSON) node
+ *
+ * @param arena Arena the value is built in
+ * @param node Node
+ * @return Value, or NULL on error
+ */
+const value_t *value_from_yaml(arena_t *arena, const yaml_node_t *node) {
+    if (!arena || !node) {
+        return NULL;
+    }
+
+    value_t *value = arena_alloc(arena, sizeof(value_t));
+    if (!value || value_fill(arena, value, node) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to allocate memory for value\n");
+        return NULL;
+    }
+
+    return value;
+}
+
+/**
+ * Build a value from text, inferring its type
+ *
+ * @param arena Arena the value is built in
+ * @param text Text of the value
+ * @return Value, or NULL on error
+ */
+const value_t *value_parse(arena_t *arena, const char *text) {
+    if (!arena || !text) {
+        return NULL;
+    }
+
+    // Flow collections go through the YAML reader; text that does not parse stays a string
+    if (text[0] == '[' || text[0] == '{') {
+        yaml_node_t *root = yaml_parse_string(text, "value");
+        if (root && root->type != YAML_SCALAR) {
+            const value_t *value = value_from_yaml(arena, root);
+            yaml_free(root);
+            return value;
+        }
+        yaml_free(root);
+    }
+
+    value_t *value = arena_alloc(arena, sizeof(value_t));
+    if (!value || value_scalar(arena, value, text) != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to allocate memory for value\n");
+        return NULL;
+    }
+
+    return value;
+}
+
+/**
+ * Look up an entry of a map
+ *
+ * @param map Map value
+ * @param key Key of the entry
+ * @return Value of the entry, or NULL if the value is not a map or has no such entry
+ */
+const value_t *value_map_get(const value_t *map, const char *key) {
+    for (int i = 0; map && key && map->type == VALUE_MAP && i < map->count; i++) {
+        if (strcmp(map->keys[i], key) == 0) {
+            return &map->items[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Check whether a value contains a text
+ *
+ * @param value Container
+ * @param text Text to look for
+ * @param length Length of the text
+ * @return 1 if it does, 0 otherwise
+ */
+int value_contains(const value_t *value, const char *text, size_t length) {
+    if (!value || !text) {
+        return 0;
+    }
+
+    for (int i = 0; value->type == VALUE_LIST && i < value->count; i++) {
+        if (value->items[i].length == length && memcmp(value->items[i].text, text, length) == 0) {
+            return 1;
+        }
+    }
+    for (int i = 0; value->type == VALUE_MAP && i < value->count; i++) {
+        if (strlen(value->keys[i]) == length && memcmp(value->keys[i], text, length) == 0) {
+            return 1;
+        }
+    }
+
+    if (value->type == VALUE_LIST || value->type == VALUE_MAP) {
+        return 0;
+    }
+    for (size_t i = 0; length <= value->length && i <= value->length - length; i++) {
+        if (memcmp(value->text + i, text, length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,948 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/ancible.h"
+#include "../include/core/yaml.h"
+
+/**
+ * Minimal YAML reader
+ *
+ * The document is first split into logical lines (blank lines and full-line
+ * comments are dropped, but remembered for block scalars), then parsed
+ * recursively by indentation. Flow collections ([a, b] and { k: v }) may span
+ * several lines. Anchors, tags and multiple documents are not supported.
+ */
+
+/**
+ * Structure to hold a logical line of the document
+ */
+typedef struct {
+    int indent;           // Number of leading spaces
+    char *text;           // Content after the indentation
+    int line_no;          // 1-based line number in the source
+    int blank_before;     // Number of blank lines preceding this line
+} yaml_line_t;
+
+/**
+ * Structure to hold the reader state
+ */
+typedef struct {
+    yaml_line_t *lines;   // Logical lines
+    int count;            // Number of logical lines
+    int pos;              // Current line
+    const char *source;   // Source name for error messages
+} yaml_reader_t;
+
+/**
+ * Growable string buffer used for joined and block scalars
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} strbuf_t;
+
+static yaml_node_t *parse_block(yaml_reader_t *r, int indent);
+static yaml_node_t *parse_flow(yaml_reader_t *r, const char **pp, int line_no);
+
+/**
+ * Append bytes to a string buffer
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int strbuf_append(strbuf_t *buf, const char *data, size_t len) {
+    if (buf->len + len + 1 > buf->cap) {
+        size_t cap = buf->cap ? buf->cap * 2 : 64;
+        while (cap < buf->len + len + 1) {
+            cap *= 2;
+        }
+        char *data_new = realloc(buf->data, cap);
+        if (!data_new) {
+            fprintf(stderr, "Error: Failed to allocate memory for YAML scalar\n");
+            return ANCIBLE_ERROR;
+        }
+        buf->data = data_new;
+        buf->cap = cap;
+    }
+
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Create a new node
+ */
+static yaml_node_t *node_create(yaml_type_t type, int line_no) {
+    yaml_node_t *node = calloc(1, sizeof(yaml_node_t));
+    if (!node) {
+        fprintf(stderr, "Error: Failed to allocate memory for YAML node\n");
+        return NULL;
+    }
+
+    node->type = type;
+    node->line = line_no;
+    return node;
+}
+
+/**
+ * Append a child to a mapping or sequence, tracking the tail for O(1) appends
+ */
+static void node_append(yaml_node_t *parent, yaml_node_t **tail, yaml_node_t *child) {
+    if (*tail) {
+        (*tail)->next = child;
+    } else {
+        parent->children = child;
+    }
+    *tail = child;
+    parent->child_count++;
+}
+
+/**
+ * Check whether a line starts a sequence item ("- " or a lone "-")
+ */
+static int is_seq_item(const char *text) {
+    return text[0] == '-' && (text[1] == ' ' || text[1] == '\0');
+}
+
+/**
+ * Check whether a quote character at position p opens a quoted scalar
+ */
+static int opens_quote(const char *start, const char *p) {
+    return (*p == '"' || *p == '\'') && (p == start || strchr(" \t[{,:", p[-1]) != NULL);
+}
+
+/**
+ * Strip a trailing comment and trailing whitespace (in-place)
+ */
+static void strip_comment(char *s) {
+    char quote = 0;
+
+    for (char *p = s; *p; p++) {
+        if (quote) {
+            if (quote == '"' && *p == '\\' && p[1]) {
+                p++;
+            } else if (*p == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (opens_quote(s, p)) {
+            quote = *p;
+        } else if (*p == '#' && (p == s || p[-1] == ' ' || p[-1] == '\t')) {
+            *p = '\0';
+            break;
+        }
+    }
+
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1])) {
+        s[--len] = '\0';
+    }
+}
+
+/**
+ * Find the colon separating a mapping key from its value
+ *
+ * @return Offset of the colon, or -1 if the line is not a "key: value" line
+ */
+static int find_key_colon(const char *text) {
+    char quote = 0;
+
+    if (text[0] == '[' || text[0] == '{') {
+        return -1;
+    }
+
+    for (const char *p = text; *p; p++) {
+        if (quote) {
+            if (quote == '"' && *p == '\\' && p[1]) {
+                p++;
+            } else if (*p == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (opens_quote(text, p)) {
+            quote = *p;
+        } else if (*p == '#' && p > text && (p[-1] == ' ' || p[-1] == '\t')) {
+            return -1;
+        } else if (*p == ':' && (p[1] == ' ' || p[1] == '\t' || p[1] == '\0')) {
+            return (int)(p - text);
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Find the closing quote of a quoted scalar
+ *
+ * @param s Pointer to the opening quote
+ * @return Pointer to the closing quote, or NULL if unterminated
+ */
+static const char *find_closing_quote(const char *s) {
+    char quote = s[0];
+
+    for (const char *p = s + 1; *p; p++) {
+        if (quote == '"' && *p == '\\' && p[1]) {
+            p++;
+        } else if (*p == quote) {
+            if (quote == '\'' && p[1] == '\'') {
+                p++;
+                continue;
+            }
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Decode the body of a quoted scalar
+ *
+ * @param s Pointer to the opening quote
+ * @param end Pointer to the closing quote
+ * @return Newly allocated decoded string, or NULL on error
+ */
+static char *decode_quoted(const char *s, const char *end) {
+    char quote = s[0];
+    char *out = malloc((size_t)(end - s) + 1);
+    if (!out) {
+        fprintf(stderr, "Error: Failed to allocate memory for YAML scalar\n");
+        return NULL;
+    }
+
+    char *o = out;
+    for (const char *p = s + 1; p < end; p++) {
+        if (quote == '\'' && *p == '\'' && p + 1 < end && p[1] == '\'') {
+            *o++ = '\'';
+            p++;
+        } else if (quote == '"' && *p == '\\' && p + 1 < end) {
+            p++;
+            switch (*p) {
+                case 'n': *o++ = '\n'; break;
+                case 't': *o++ = '\t'; break;
+                case 'r': *o++ = '\r'; break;
+                case '0': *o++ = '\0'; break;
+                default:  *o++ = *p;   break;
+            }
+        } else {
+            *o++ = *p;
+        }
+    }
+    *o = '\0';
+
+    return out;
+}
+
+/**
+ * Copy a scalar, trimming whitespace and removing surrounding quotes
+ *
+ * @param s Scalar text
+ * @param len Length of the scalar text
+ * @return Newly allocated string, or NULL on error
+ */
+static char *scalar_dup(const char *s, size_t len) {
+    while (len > 0 && isspace((unsigned char)s[0])) {
+        s++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)s[len - 1])) {
+        len--;
+    }
+
+    if (len >= 2 && (s[0] == '"' || s[0] == '\'')) {
+        const char *end = find_closing_quote(s);
+        if (end == s + len - 1) {
+            return decode_quoted(s, end);
+        }
+    }
+
+    char *out = malloc(len + 1);
+    if (!out) {
+        fprintf(stderr, "Error: Failed to allocate memory for YAML scalar\n");
+        return NULL;
+    }
+    memcpy(out, s, len);
+    out[len] = '\0';
+
+    return out;
+}
+
+/**
+ * Create a scalar node from text
+ */
+static yaml_node_t *scalar_create(const char *text, size_t len, int line_no) {
+    yaml_node_t *node = node_create(YAML_SCALAR, line_no);
+    if (!node) {
+        return NULL;
+    }
+
+    node->value = scalar_dup(text, len);
+    if (!node->value) {
+        free(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+/**
+ * Compute the bracket depth of flow text (ignoring quoted content)
+ */
+static int flow_depth(const char *text) {
+    int depth = 0;
+    char quote = 0;
+
+    for (const char *p = text; *p; p++) {
+        if (quote) {
+            if (quote == '"' && *p == '\\' && p[1]) {
+                p++;
+            } else if (*p == quote) {
+                quote = 0;
+            }
+        } else if (opens_quote(text, p)) {
+            quote = *p;
+        } else if (*p == '[' || *p == '{') {
+            depth++;
+        } else if (*p == ']' || *p == '}') {
+            depth--;
+        }
+    }
+
+    return depth;
+}
+
+/**
+ * Skip whitespace in flow text
+ */
+static void skip_space(const char **pp) {
+    while (isspace((unsigned char)**pp)) {
+        (*pp)++;
+    }
+}
+
+/**
+ * Parse a scalar inside a flow collection
+ *
+ * @param pp Pointer to the current position, advanced past the scalar
+ * @param is_key Whether the scalar is a mapping key (stops at ':')
+ * @return Newly allocated string, or NULL on error
+ */
+static char *parse_flow_scalar(const char **pp, int is_key) {
+    const char *start = *pp;
+
+    if (*start == '"' || *start == '\'') {
+        const char *end = find_closing_quote(start);
+        if (!end) {
+            return NULL;
+        }
+        *pp = end + 1;
+        return decode_quoted(start, end);
+    }
+
+    const char *p = start;
+    while (*p && *p != ',' && *p != ']' && *p != '}') {
+        if (is_key && *p == ':' && (p[1] == ' ' || p[1] == ',' || p[1] == '}' || p[1] == '\0')) {
+            break;
+        }
+        p++;
+    }
+    *pp = p;
+
+    return scalar_dup(start, (size_t)(p - start));
+}
+
+/**
+ * Parse a flow collection or scalar
+ *
+ * @param r Reader (for error messages)
+ * @param pp Pointer to the current position, advanced past the value
+ * @param line_no Line number of the value
+ * @return Parsed node, or NULL on error
+ */
+static yaml_node_t *parse_flow(yaml_reader_t *r, const char **pp, int line_no) {
+    skip_space(pp);
+
+    if (**pp == '[' || **pp == '{') {
+        char close = **pp == '[' ? ']' : '}';
+        yaml_node_t *node = node_create(close == ']' ? YAML_SEQ : YAML_MAP, line_no);
+        yaml_node_t *tail = NULL;
+        if (!node) {
+            return NULL;
+        }
+
+        (*pp)++;
+        for (;;) {
+            skip_space(pp);
+            if (**pp == close) {
+                (*pp)++;
+                return node;
+            }
+
+            char *key = NULL;
+            if (close == '}') {
+                key = parse_flow_scalar(pp, 1);
+                skip_space(pp);
+                if (!key || **pp != ':') {
+                    free(key);
+                    break;
+                }
+                (*pp)++;
+                skip_space(pp);
+            }
+
+            yaml_node_t *child;
+            if (close == '}' && (**pp == ',' || **pp == '}')) {
+                child = scalar_create("", 0, line_no);
+            } else {
+                child = parse_flow(r, pp, line_no);
+            }
+            if (!child) {
+                free(key);
+                yaml_free(node);
+                return NULL;
+            }
+            child->key = key;
+            node_append(node, &tail, child);
+
+            skip_space(pp);
+            if (**pp == ',') {
+                (*pp)++;
+            } else if (**pp != close) {
+                break;
+            }
+        }
+
+        fprintf(stderr, "Error: %s:%d: Malformed flow collection\n", r->source, line_no);
+        yaml_free(node);
+        return NULL;
+    }
+
+    yaml_node_t *node = node_create(YAML_SCALAR, line_no);
+    if (!node) {
+        return NULL;
+    }
+    node->value = parse_flow_scalar(pp, 0);
+    if (!node->value) {
+        fprintf(stderr, "Error: %s:%d: Unterminated quoted scalar\n", r->source, line_no);
+        free(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+/**
+ * Parse a flow value, joining continuation lines until brackets balance
+ */
+static yaml_node_t *parse_flow_lines(yaml_reader_t *r, const char *text, int line_no) {
+    strbuf_t buf = {0};
+
+    if (strbuf_append(&buf, text, strlen(text)) != ANCIBLE_SUCCESS) {
+        return NULL;
+    }
+
+    // Track the depth line by line: rescanning the joined text would make a
+    // large JSON document quadratic
+    int depth = flow_depth(text);
+    while (depth > 0 && r->pos < r->count) {
+        char *more = r->lines[r->pos++].text;
+        strip_comment(more);
+        depth += flow_depth(more);
+        if (strbuf_append(&buf, " ", 1) != ANCIBLE_SUCCESS ||
+            strbuf_append(&buf, more, strlen(more)) != ANCIBLE_SUCCESS) {
+            free(buf.data);
+            return NULL;
+        }
+    }
+
+    const char *p = buf.data;
+    yaml_node_t *node = parse_flow(r, &p, line_no);
+    if (node) {
+        skip_space(&p);
+        if (*p) {
+            fprintf(stderr, "Error: %s:%d: Unexpected content after flow collection\n", r->source, line_no);
+            yaml_free(node);
+            node = NULL;
+        }
+    }
+
+    free(buf.data);
+    return node;
+}
+
+/**
+ * Parse a literal (|) or folded (>) block scalar
+ */
+static yaml_node_t *parse_block_scalar(yaml_reader_t *r, const char *indicator, int parent_indent, int line_no) {
+    int literal = indicator[0] == '|';
+    int strip = strchr(indicator, '-') != NULL;
+    int content_indent = -1;
+    strbuf_t buf = {0};
+
+    if (strbuf_append(&buf, "", 0) != ANCIBLE_SUCCESS) {
+        return NULL;
+    }
+
+    while (r->pos < r->count && r->lines[r->pos].indent > parent_indent) {
+        yaml_line_t *line = &r->lines[r->pos++];
+
+        if (content_indent < 0) {
+            content_indent = line->indent;
+        } else {
+            int breaks = line->blank_before;
+            if (breaks == 0) {
+                if (strbuf_append(&buf, literal ? "\n" : " ", 1) != ANCIBLE_SUCCESS) goto error;
+            }
+            for (int i = 0; i < breaks + (literal ? 1 : 0); i++) {
+                if (strbuf_append(&buf, "\n", 1) != ANCIBLE_SUCCESS) goto error;
+            }
+        }
+
+        for (int i = content_indent; i < line->indent; i++) {
+            if (strbuf_append(&buf, " ", 1) != ANCIBLE_SUCCESS) goto error;
+        }
+        if (strbuf_append(&buf, line->text, strlen(line->text)) != ANCIBLE_SUCCESS) goto error;
+    }
+
+    if (!strip && buf.len > 0) {
+        if (strbuf_append(&buf, "\n", 1) != ANCIBLE_SUCCESS) goto error;
+    }
+
+    yaml_node_t *node = node_create(YAML_SCALAR, line_no);
+    if (!node) goto error;
+    node->value = buf.data;
+    return node;
+
+error:
+    free(buf.data);
+    return NULL;
+}
+
+/**
+ * Parse the value following a "key:" or "- " marker
+ *
+ * @param r Reader
+ * @param rest Text after the marker
+ * @param parent_indent Indentation of the line holding the marker
+ * @param line_no Line number of the marker
+ * @param is_map_value Whether a sequence at the same indentation may follow
+ * @return Parsed node, or NULL on error
+ */
+static yaml_node_t *parse_value(yaml_reader_t *r, char *rest, int parent_indent, int line_no, int is_map_value) {
+    while (*rest == ' ' || *rest == '\t') {
+        rest++;
+    }
+    strip_comment(rest);
+
+    if (*rest == '\0') {
+        if (r->pos < r->count && r->lines[r->pos].indent > parent_indent) {
+            return parse_block(r, r->lines[r->pos].indent);
+        }
+        if (is_map_value && r->pos < r->count && r->lines[r->pos].indent == parent_indent &&
+            is_seq_item(r->lines[r->pos].text)) {
+            return parse_block(r, parent_indent);
+        }
+        return scalar_create("", 0, line_no);
+    }
+
+    if ((rest[0] == '|' || rest[0] == '>') && strspn(rest + 1, "+-0123456789") == strlen(rest + 1)) {
+        return parse_block_scalar(r, rest, parent_indent, line_no);
+    }
+
+    if (rest[0] == '[' || rest[0] == '{') {
+        return parse_flow_lines(r, rest, line_no);
+    }
+
+    // Plain or quoted scalar, possibly continued on more indented lines
+    if (r->pos >= r->count || r->lines[r->pos].indent <= parent_indent) {
+        return scalar_create(rest, strlen(rest), line_no);
+    }
+
+    strbuf_t buf = {0};
+    if (strbuf_append(&buf, rest, strlen(rest)) != ANCIBLE_SUCCESS) {
+        return NULL;
+    }
+    while (r->pos < r->count && r->lines[r->pos].indent > parent_indent) {
+        char *more = r->lines[r->pos++].text;
+        strip_comment(more);
+        if (strbuf_append(&buf, " ", 1) != ANCIBLE_SUCCESS ||
+            strbuf_append(&buf, more, strlen(more)) != ANCIBLE_SUCCESS) {
+            free(buf.data);
+            return NULL;
+        }
+    }
+
+    yaml_node_t *node = scalar_create(buf.data, buf.len, line_no);
+    free(buf.data);
+    return node;
+}
+
+/**
+ * Parse a block sequence at the given indentation
+ */
+static yaml_node_t *parse_seq(yaml_reader_t *r, int indent) {
+    yaml_node_t *seq = node_create(YAML_SEQ, r->lines[r->pos].line_no);
+    yaml_node_t *tail = NULL;
+    if (!seq) {
+        return NULL;
+    }
+
+    while (r->pos < r->count) {
+        yaml_line_t *line = &r->lines[r->pos];
+
+        if (line->indent < indent || !is_seq_item(line->text)) {
+            break;
+        }
+        if (line->indent > indent) {
+            fprintf(stderr, "Error: %s:%d: Unexpected indentation\n", r->source, line->line_no);
+            goto error;
+        }
+
+        char *content = line->text + 1;
+        int offset = 1;
+        while (*content == ' ') {
+            content++;
+            offset++;
+        }
+
+        yaml_node_t *item;
+        if (*content != '\0' && (is_seq_item(content) || find_key_colon(content) >= 0)) {
+            // Re-read the rest of the line as the first line of a nested block
+            line->indent = indent + offset;
+            line->text = content;
+            item = parse_block(r, line->indent);
+        } else {
+            r->pos++;
+            item = parse_value(r, content, indent, line->line_no, 0);
+        }
+
+        if (!item) {
+            goto error;
+        }
+        node_append(seq, &tail, item);
+    }
+
+    return seq;
+
+error:
+    yaml_free(seq);
+    return NULL;
+}
+
+/**
+ * Parse a block mapping at the given indentation
+ */
+static yaml_node_t *parse_map(yaml_reader_t *r, int indent) {
+    yaml_node_t *map = node_create(YAML_MAP, r->lines[r->pos].line_no);
+    yaml_node_t *tail = NULL;
+    if (!map) {
+        return NULL;
+    }
+
+    while (r->pos < r->count) {
+        yaml_line_t *line = &r->lines[r->pos];
+
+        if (line->indent < indent) {
+            break;
+        }
+        if (line->indent > indent) {
+            fprintf(stderr, "Error: %s:%d: Unexpected indentation\n", r->source, line->line_no);
+            goto error;
+        }
+        if (is_seq_item(line->text)) {
+            break;
+        }
+
+        int colon = find_key_colon(line->text);
+        if (colon < 0) {
+            fprintf(stderr, "Error: %s:%d: Expected 'key: value'\n", r->source, line->line_no);
+            goto error;
+        }
+
+        char *key = scalar_dup(line->text, (size_t)colon);
+        if (!key) {
+            goto error;
+        }
+
+        r->pos++;
+        yaml_node_t *value = parse_value(r, line->text + colon + 1, indent, line->line_no, 1);
+        if (!value) {
+            free(key);
+            goto error;
+        }
+        value->key = key;
+        node_append(map, &tail, value);
+    }
+
+    return map;
+
+error:
+    yaml_free(map);
+    return NULL;
+}
+
+/**
+ * Parse a block (sequence, mapping or scalar) starting at the current line
+ */
+static yaml_node_t *parse_block(yaml_reader_t *r, int indent) {
+    yaml_line_t *line = &r->lines[r->pos];
+
+    if (is_seq_item(line->text)) {
+        return parse_seq(r, indent);
+    }
+    if (find_key_colon(line->text) >= 0) {
+        return parse_map(r, indent);
+    }
+
+    r->pos++;
+    return parse_value(r, line->text, indent - 1, line->line_no, 0);
+}
+
+/**
+ * Split a buffer into logical lines (in-place)
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int split_lines(char *buffer, yaml_reader_t *r) {
+    int capacity = 1;
+    for (const char *p = buffer; *p; p++) {
+        if (*p == '\n') {
+            capacity++;
+        }
+    }
+
+    r->lines = malloc((size_t)capacity * sizeof(yaml_line_t));
+    if (!r->lines) {
+        fprintf(stderr, "Error: Failed to allocate memory for YAML lines\n");
+        return ANCIBLE_ERROR;
+    }
+
+    int line_no = 0;
+    int blank = 0;
+    char *line = buffer;
+    while (line) {
+        char *eol = strchr(line, '\n');
+        if (eol) {
+            *eol = '\0';
+        }
+        line_no++;
+
+        // Trim trailing whitespace (including \r)
+        size_t len = strlen(line);
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            line[--len] = '\0';
+        }
+
+        int indent = 0;
+        while (line[indent] == ' ') {
+            indent++;
+        }
+        char *text = line + indent;
+
+        if (*text == '\0') {
+            blank++;
+        } else if (*text != '#' && strcmp(text, "---") != 0 && strcmp(text, "...") != 0) {
+            yaml_line_t *entry = &r->lines[r->count++];
+            entry->indent = indent;
+            entry->text = text;
+            entry->line_no = line_no;
+            entry->blank_before = blank;
+            blank = 0;
+        }
+
+        line = eol ? eol + 1 : NULL;
+    }
+
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Parse a YAML document held in memory
+ *
+ * @param text Document text
+ * @param source Name used in error messages
+ * @return Root node, or NULL on error
+ */
+yaml_node_t *yaml_parse_string(const char *text, const char *source) {
+    if (!text) {
+        return NULL;
+    }
+
+    yaml_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.source = source ? source : "<string>";
+
+    char *buffer = strdup(text);
+    if (!buffer) {
+        fprintf(stderr, "Error: Failed to allocate memory for YAML document\n");
+        return NULL;
+    }
+
+    yaml_node_t *root = NULL;
+    if (split_lines(buffer, &reader) == ANCIBLE_SUCCESS) {
+        if (reader.count == 0) {
+            root = scalar_create("", 0, 0);
+        } else {
+            root = parse_block(&reader, reader.lines[0].indent);
+            if (root && reader.pos < reader.count) {
+                fprintf(stderr, "Error: %s:%d: Unexpected content\n", reader.source,
+                        reader.lines[reader.pos].line_no);
+                yaml_free(root);
+                root = NULL;
+            }
+        }
+    }
+
+    free(reader.lines);
+    free(buffer);
+    return root;
+}
+
+/**
+ * Parse a YAML file into a node tree
+ *
+ * @param filename Path to the YAML file
+ * @return Root node, or NULL on error
+ */
+yaml_node_t *yaml_parse_file(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to open file: %s\n", filename);
+        return NULL;
+    }
+
+    strbuf_t buf = {0};
+    char chunk[4096];
+    size_t bytes_read;
+    while ((bytes_read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        if (strbuf_append(&buf, chunk, bytes_read) != ANCIBLE_SUCCESS) {
+            free(buf.data);
+            fclose(file);
+            return NULL;
+        }
+    }
+    fclose(file);
+
+    yaml_node_t *root = yaml_parse_string(buf.data ? buf.data : "", filename);
+    free(buf.data);
+    return root;
+}
+
+/**
+ * Free a YAML node tree
+ *
+ * @param node Root node to free
+ */
+void yaml_free(yaml_node_t *node) {
+    while (node) {
+        yaml_node_t *next = node->next;
+        yaml_free(node->children);
+        free(node->key);
+        free(node->value);
+        free(node);
+        node = next;
+    }
+}
+
+/**
+ * Look up a key in a mapping node
+ *
+ * @param map Mapping node
+ * @param key Key to look up
+ * @return Child node for the key, or NULL if not found or not a mapping
+ */
+const yaml_node_t *yaml_map_get(const yaml_node_t *map, const char *key) {
+    if (!map || !key || map->type != YAML_MAP) {
+        return NULL;
+    }
+
+    for (const yaml_node_t *child = map->children; child; child = child->next) {
+        if (strcmp(child->key, key) == 0) {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Append a string to a growable buffer
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int text_append(char **out, size_t *len, size_t *cap, const char *str) {
+    size_t n = strlen(str);
+
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = (*cap ? *cap * 2 : 64) + n;
+        char *grown = realloc(*out, new_cap);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for value\n");
+            return ANCIBLE_ERROR;
+        }
+        *out = grown;
+        *cap = new_cap;
+    }
+
+    memcpy(*out + *len, str, n + 1);
+    *len += n;
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Append a node's text representation to a growable buffer
+ *
+ * Scalars are copied as-is, sequences and mappings are written in flow style.
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int append_node_text(char **out, size_t *len, size_t *cap, const yaml_node_t *node) {
+    if (node->type == YAML_SCALAR) {
+        return text_append(out, len, cap, node->value);
+    }
+
+    if (text_append(out, len, cap, node->type == YAML_SEQ ? "[" : "{") != ANCIBLE_SUCCESS) {
+        return ANCIBLE_ERROR;
+    }
+
+    for (const yaml_node_t *child = node->children; child; child = child->next) {
+        if (child != node->children && text_append(out, len, cap, ", ") != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+        if (node->type == YAML_MAP &&
+            (text_append(out, len, cap, child->key) != ANCIBLE_SUCCESS ||
+             text_append(out, len, cap, ": ") != ANCIBLE_SUCCESS)) {
+            return ANCIBLE_ERROR;
+        }
+        if (append_node_text(out, len, cap, child) != ANCIBLE_SUCCESS) {
+            return ANCIBLE_ERROR;
+        }
+    }
+
+    return text_append(out, len, cap, node->type == YAML_SEQ ? "]" : "}");
+}
+
+/**
+ * Convert a node to a newly allocated string
+ *
+ * @param node YAML node
+ * @return Newly allocated string, or NULL on error
+ */
+char *yaml_node_text(const yaml_node_t *node) {
+    char *out = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+
+    if (append_node_text(&out, &len, &cap, node) != ANCIBLE_SUCCESS) {
+        free(out);
+        return NULL;
+    }
+    return out ? out : strdup("");
+}
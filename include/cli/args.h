@@ -1,6 +1,10 @@
 #ifndef ANCIBLE_ARGS_H
 #define ANCIBLE_ARGS_H
 
+#define DEFAULT_FORKS 5
+#define MAX_INVENTORY_SOURCES 64
+#define MAX_EXTRA_VARS 64
+
 /**
  * Structure to hold command-line options
  */
@@ -8,8 +12,20 @@ struct cli_options {
     int help;              // Whether --help was specified
     int verbose;           // Whether --verbose was specified
     int color;             // Whether color output is enabled (not used in this MVP)
-    const char *playbook_path;  // Path to the playbook file
-    const char *inventory_path; // Path to the inventory file
+    const char *playbook_path;  // Path to the playbook file (the first one in planning modes)
+    char **playbook_paths;      // All playbook paths given (several are allowed in planning modes)
+    int playbook_count;         // Number of playbook paths
+    int syntax_check;      // Whether --syntax-check was specified
+    int list_tasks;        // Whether --list-tasks was specified
+    int list_hosts;        // Whether --list-hosts was specified
+    const char *inventory_path; // Path to the inventory file (the last one given)
+    const char *inventory_paths[MAX_INVENTORY_SOURCES]; // All inventory paths given, lowest precedence first
+    int inventory_count;        // Number of inventory paths
+    const char *limit;     // Host pattern restricting every play (--limit), or NULL
+    int forks;             // Maximum number of commands running at once
+    int flush_cache;       // Whether --flush-cache was specified
+    const char *extra_vars[MAX_EXTRA_VARS]; // Extra variables (-e), lowest precedence first
+    int extra_var_count;        // Number of extra variable sources
 };
 
 /**
@@ -0,0 +1,22 @@
+#ifndef ANCIBLE_EXTRA_VARS_H
+#define ANCIBLE_EXTRA_VARS_H
+
+#include "../core/arena.h"
+#include "../core/scope.h"
+
+/**
+ * Build the scope of the extra variables given with -e
+ *
+ * Each source is "NAME=VALUE [NAME=VALUE...]", a JSON or flow-style map
+ * ("{...}"), or "@FILE" naming a YAML or JSON file holding a map. Values
+ * keep their type (see value.h), and a later source wins over an earlier one.
+ *
+ * @param sources Sources, in the order given
+ * @param count Number of sources
+ * @param arena Arena the variables and their values are built in
+ * @param scope Pointer to receive the scope (NULL when there are no sources)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int extra_vars_load(const char *const *sources, int count, arena_t *arena, scope_t **scope);
+
+#endif /* ANCIBLE_EXTRA_VARS_H */
@@ -0,0 +1,25 @@
+#ifndef ANCIBLE_PLAN_H
+#define ANCIBLE_PLAN_H
+
+#include "args.h"
+
+/**
+ * Check if a planning mode (--syntax-check, --list-tasks, --list-hosts) was requested
+ *
+ * @param options Command-line options
+ * @return 1 if a planning mode was requested, 0 otherwise
+ */
+int plan_requested(const struct cli_options *options);
+
+/**
+ * Run the planning modes over every playbook given
+ *
+ * Playbooks are parsed and host patterns resolved against the inventory,
+ * but nothing is executed: no contexts, no state directory, no processes.
+ *
+ * @param options Command-line options
+ * @return ANCIBLE_SUCCESS if every playbook is valid, ANCIBLE_ERROR otherwise
+ */
+int plan_run(const struct cli_options *options);
+
+#endif /* ANCIBLE_PLAN_H */
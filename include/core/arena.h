@@ -0,0 +1,43 @@
+#ifndef ANCIBLE_ARENA_H
+#define ANCIBLE_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Bump allocator for values that live and die together
+ *
+ * Memory comes from large blocks and is only given back when the whole
+ * arena is freed, so building a value of many parts costs a few pointer
+ * bumps instead of one malloc per part. A zeroed arena is empty and ready.
+ */
+typedef struct arena {
+    struct arena_block *blocks; // Blocks, the one being filled first
+} arena_t;
+
+/**
+ * Allocate memory from an arena
+ *
+ * @param arena Arena
+ * @param size Number of bytes (aligned for any type)
+ * @return Pointer to the memory (zeroed), or NULL on error
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * Copy a string into an arena
+ *
+ * @param arena Arena
+ * @param text Text to copy
+ * @param length Number of bytes to copy (a terminator is added)
+ * @return Copy, or NULL on error
+ */
+char *arena_strndup(arena_t *arena, const char *text, size_t length);
+
+/**
+ * Free every block of an arena and leave it empty
+ *
+ * @param arena Arena (may be NULL)
+ */
+void arena_free(arena_t *arena);
+
+#endif /* ANCIBLE_ARENA_H */
@@ -0,0 +1,116 @@
+#ifndef ANCIBLE_BITSET_H
+#define ANCIBLE_BITSET_H
+
+#include <stdint.h>
+
+/**
+ * Growable set of small non-negative integers (host IDs)
+ *
+ * Bits past word_count are zero, so sets of different sizes combine freely.
+ */
+typedef struct {
+    uint64_t *words;      // Bit words, least significant bit first
+    int word_count;       // Number of allocated words
+} bitset_t;
+
+/**
+ * Initialize an empty bitset
+ *
+ * @param set Bitset to initialize
+ */
+void bitset_init(bitset_t *set);
+
+/**
+ * Free the memory held by a bitset and leave it empty
+ *
+ * @param set Bitset to free
+ */
+void bitset_free(bitset_t *set);
+
+/**
+ * Make room for bits [0, bit_count)
+ *
+ * @param set Bitset to grow
+ * @param bit_count Number of bits needed
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_reserve(bitset_t *set, int bit_count);
+
+/**
+ * Add a bit to the set, growing it if needed
+ *
+ * @param set Bitset to update
+ * @param bit Bit to set
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_set(bitset_t *set, int bit);
+
+/**
+ * Remove a bit from the set
+ *
+ * @param set Bitset to update
+ * @param bit Bit to clear
+ */
+void bitset_unset(bitset_t *set, int bit);
+
+/**
+ * Check whether a bit is in the set
+ *
+ * @param set Bitset to check
+ * @param bit Bit to test
+ * @return 1 if the bit is set, 0 otherwise
+ */
+int bitset_test(const bitset_t *set, int bit);
+
+/**
+ * Add every bit of src to dst (dst |= src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to add
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int bitset_or(bitset_t *dst, const bitset_t *src);
+
+/**
+ * Keep only the bits also in src (dst &= src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to intersect with
+ */
+void bitset_and(bitset_t *dst, const bitset_t *src);
+
+/**
+ * Remove every bit of src from dst (dst &= ~src)
+ *
+ * @param dst Bitset to update
+ * @param src Bitset to remove
+ */
+void bitset_andnot(bitset_t *dst, const bitset_t *src);
+
+/**
+ * Remove every bit from the set, keeping its memory
+ *
+ * @param set Bitset to clear
+ */
+void bitset_clear(bitset_t *set);
+
+/**
+ * Count the bits in the set
+ *
+ * @param set Bitset to count
+ * @return Number of set bits
+ */
+int bitset_count(const bitset_t *set);
+
+/**
+ * Find the next set bit
+ *
+ * Iterate with: for (int i = bitset_next(s, 0); i >= 0; i = bitset_next(s, i + 1))
+ *
+ * @param set Bitset to scan
+ * @param from First bit to consider
+ * @return Next set bit at or after from, or -1 if there is none
+ */
+int bitset_next(const bitset_t *set, int from);
+
+#endif /* ANCIBLE_BITSET_H */
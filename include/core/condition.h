@@ -1,15 +1,203 @@
 #ifndef ANCIBLE_CONDITION_H
 #define ANCIBLE_CONDITION_H
 
+#include <regex.h>
+#include "bitset.h"
 #include "context.h"
 
+/**
+ * Conditions
+ *
+ * A when condition is compiled once, when the playbook is parsed, into a
+ * small expression tree whose variable names are already resolved to
+ * symbol IDs. Evaluating it for a host only walks the tree and reads
+ * variables in place: nothing is copied, tokenized or allocated.
+ *
+ * Operands are numbers, quoted strings, true and false, variables (bare
+ * names, {{ name }} or the older ${name}) and fields of registered results
+ * (out.rc). A bare name that is not set stands for its own text when
+ * compared with == or !=, as in older playbooks ("hello == hello"); it is
+ * an error anywhere else, and for names hosts may set (condition_declare).
+ *
+ * Operands are compared (==, !=, <, <=, >, >=), looked up in a list, map
+ * or string (in, not in) and tested (is defined, is match('^web'), ...);
+ * these combine with not, and, or and parentheses, in that order of
+ * precedence, and and/or stop as soon as the result is known. Conditions
+ * the compiler does not handle (filters) are rendered and handed to
+ * condition_evaluate, which compiles the rendered text.
+ *
+ * A condition that only reads what every host of a play shares (literals,
+ * extra variables, task and play variables no host overrides) can also be
+ * folded once for the whole play with condition_fold.
+ *
+ * One that depends on the host can be evaluated for every host of a task
+ * at once with condition_eval_batch, which fills bitsets of the hosts it
+ * holds and does not hold on.
+ */
+
+/**
+ * Node types of a compiled condition
+ */
+typedef enum {
+    CONDITION_LITERAL,    // Number, quoted string, true/false, or a word that is not a name
+    CONDITION_VAR,        // Variable reference
+    CONDITION_FIELD,      // Field of a registered result (out.rc)
+    CONDITION_LIST,       // List of operands ([80, 443]), on the right of in
+    CONDITION_COMPARE,    // Comparison of two operands
+    CONDITION_IN,         // Membership of the left operand in the right one
+    CONDITION_TEST,       // Test of an operand (is defined)
+    CONDITION_NOT,        // Negation of the left node
+    CONDITION_AND,        // Both nodes, the right one only if the left one is true
+    CONDITION_OR          // Either node, the right one only if the left one is false
+} condition_type_t;
+
+/**
+ * Comparison operators
+ */
+typedef enum {
+    CONDITION_OP_EQ,      // ==
+    CONDITION_OP_NE,      // !=
+    CONDITION_OP_LT,      // <
+    CONDITION_OP_LE,      // <=
+    CONDITION_OP_GT,      // >
+    CONDITION_OP_GE       // >=
+} condition_op_t;
+
+/**
+ * Tests (operand is name)
+ */
+typedef enum {
+    CONDITION_TEST_DEFINED,   // Variable or registered result is set
+    CONDITION_TEST_UNDEFINED, // Variable or registered result is not set
+    CONDITION_TEST_TRUTHY,    // Operand is true
+    CONDITION_TEST_FALSY,     // Operand is false
+    CONDITION_TEST_STRING,    // Operand is text (not a number, boolean, list or map)
+    CONDITION_TEST_NUMBER,    // Operand is an integer
+    CONDITION_TEST_MATCH,     // Regex matches at the start of the operand
+    CONDITION_TEST_SEARCH,    // Regex matches anywhere in the operand (also "regex")
+    CONDITION_TEST_FAILED,    // Registered result failed
+    CONDITION_TEST_SUCCEEDED, // Registered result did not fail (also "success")
+    CONDITION_TEST_CHANGED,   // Registered result made changes
+    CONDITION_TEST_SKIPPED    // Registered result was skipped
+} condition_test_t;
+
+/**
+ * What a variable that is not set stands for
+ */
+typedef enum {
+    CONDITION_UNSET_ERROR, // {{ name }}: an error, as in templates
+    CONDITION_UNSET_WORD,  // Bare name: its own text in == and !=, an error anywhere else
+    CONDITION_UNSET_EMPTY  // ${name}: empty text in == and !=, false on its own
+} condition_unset_t;
+
+/**
+ * Node of a compiled condition
+ */
+typedef struct condition {
+    condition_type_t type; // Node type
+    condition_op_t op;    // Operator (CONDITION_COMPARE)
+    condition_test_t test; // Test (CONDITION_TEST)
+    char *text;           // Literal text, or the name as written
+    size_t length;        // Length of text
+    int key;              // Symbol ID of the variable or registered result
+    result_field_t field; // Field of the registered result (CONDITION_FIELD)
+    condition_unset_t unset; // What the variable stands for when it is not set
+    int boolean;          // 1 or 0 for the literals true and false, -1 otherwise
+    int is_integer;       // Whether the literal is an integer
+    long long integer;    // Value of an integer literal
+    regex_t *regex;       // Precompiled pattern of match and search tests, or NULL
+    struct condition **items; // Operands of a list (CONDITION_LIST)
+    int count;            // Number of items
+    struct condition *left;  // Left operand or node
+    struct condition *right; // Right operand or node (NULL for not and tests)
+} condition_t;
+
 /**
  * Evaluate a condition string
- * 
+ *
+ * Compiles the text on every call; text the compiler does not handle is an
+ * error. Compiled conditions are evaluated with condition_eval instead.
+ *
  * @param context Execution context
  * @param condition Condition string to evaluate
  * @return 1 if condition is true, 0 if false, -1 on error
  */
 int condition_evaluate(context_t *context, const char *condition);
 
+/**
+ * Compile a condition
+ *
+ * Unknown tests, and result tests (is failed) on anything but a name, are
+ * rejected here rather than when the condition is evaluated.
+ *
+ * @param source Condition text
+ * @return Compiled condition, or NULL if the text is beyond the compiler (or on error)
+ */
+condition_t *condition_compile(const char *source);
+
+/**
+ * Evaluate a compiled condition for a host
+ *
+ * @param condition Compiled condition
+ * @param context Context of the host
+ * @return 1 if the condition is true, 0 if false, -1 on error
+ */
+int condition_eval(const condition_t *condition, const context_t *context);
+
+/**
+ * Evaluate a compiled condition for many hosts at once
+ *
+ * Gives the same result as condition_eval on each host. Comparisons of a
+ * variable with an integer read the variable of every host into a column
+ * and compare it in one pass; and, or and not combine the results 64 hosts
+ * at a time.
+ *
+ * @param condition Compiled condition
+ * @param contexts Contexts of the hosts
+ * @param count Number of contexts
+ * @param holds Bitset to fill with the hosts (indexes into contexts) the condition holds on
+ * @param fails Bitset to fill with the hosts it does not hold on; on the others it failed to evaluate
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int condition_eval_batch(const condition_t *condition, const context_t *const *contexts, int count,
+                         bitset_t *holds, bitset_t *fails);
+
+/**
+ * Evaluate a compiled condition once for every host of a play
+ *
+ * Variables are read from extra variables first, then from the task's and
+ * the play's variables unless hosts may set their own while the play runs
+ * (facts, loop items). Anything else (host and group variables, registered
+ * results) makes the result depend on the host; so does an error, which is
+ * left to be reported per host.
+ *
+ * @param condition Compiled condition
+ * @param extra_vars Extra variables (may be NULL)
+ * @param task_vars Variables of the task (may be NULL)
+ * @param play_vars Variables of the play (may be NULL)
+ * @param facts Symbol IDs of the variables hosts may set, or NULL if they may set any
+ * @return 1 if the condition holds on every host, 0 if on none, -1 if it depends on the host
+ */
+int condition_fold(const condition_t *condition, const scope_t *extra_vars, const scope_t *task_vars,
+                   const scope_t *play_vars, const bitset_t *facts);
+
+/**
+ * Mark the names hosts may set in a compiled condition
+ *
+ * A bare name stands for its own text in == and != while it is not set;
+ * one that names a fact, loop item or registered result is an error
+ * instead, like any variable.
+ *
+ * @param condition Compiled condition (may be NULL)
+ * @param declared Symbol IDs of the variables and results hosts may set
+ */
+void condition_declare(condition_t *condition, const bitset_t *declared);
+
+/**
+ * Free a compiled condition
+ *
+ * @param condition Compiled condition (may be NULL)
+ */
+void condition_free(condition_t *condition);
+
 #endif /* ANCIBLE_CONDITION_H */
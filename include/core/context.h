@@ -1,25 +1,52 @@
 #ifndef ANCIBLE_CONTEXT_H
 #define ANCIBLE_CONTEXT_H
 
+#include "arena.h"
 #include "inventory.h"
 #include "parser.h"
+#include "scope.h"
+#include "symbol.h"
+#include "template.h"
+#include "value.h"
+#include "variable.h"
 
 /**
- * Structure to hold a variable
+ * Variable slot of a context's overlay (open addressing, keyed by symbol ID)
  */
-typedef struct variable {
-    char *name;           // Variable name
-    char *value;          // Variable value
-    struct variable *next; // Next variable in the list
-} variable_t;
+typedef struct context_var {
+    int key;              // Symbol ID of the name, or -1 for an empty slot
+    char *value;          // Variable value (owned, unless it is the text of typed)
+    const value_t *typed; // Typed value (set_fact), or NULL for plain text
+} context_var_t;
 
 /**
  * Structure to hold execution context for a host
+ *
+ * Variables are looked up through layers, highest precedence first: extra
+ * vars, the overlay of values set while running, registered results, the
+ * current task's vars (including its blocks'), play vars, host vars, group
+ * vars and role defaults. Every layer but the overlay is shared and borrowed.
  */
-typedef struct {
+typedef struct context {
     host_t *host;         // Host to execute on
-    playbook_t *playbook; // Playbook to execute
-    variable_t *vars;     // Variables for this host
+    inventory_t *inventory; // Inventory the host belongs to (for add_host, group_by), or NULL
+    play_t *play;         // Play being executed
+    const task_t *task;   // Task being run (its vars apply), or NULL
+    const task_t *eligible; // Task whose condition a batch found to hold on this host, or NULL
+    const scope_t *extra_vars; // Extra variables, or NULL
+    const scope_t *play_vars; // Play variables, or NULL
+    const scope_t *group_vars; // Group variables of the host, or NULL
+    const scope_t *defaults; // Role defaults of the play, or NULL
+    scope_t *owned[3];    // Indexes built for a host or play that came without them
+    context_var_t *vars;  // Overlay of variables set on this host (power-of-two slot array)
+    int var_count;        // Number of variables in the overlay
+    int var_capacity;     // Number of overlay slots
+    arena_t arena;        // Memory of the typed values set on this host
+    registered_t *results; // Results registered on this host (register:)
+    int result_count;     // Number of registered results
+    int result_capacity;  // Allocated number of registered results
+    const struct context *parent; // Context this one was cloned from (its results are visible), or NULL
+    template_buffer_t render; // Buffer task arguments and conditions are rendered into
     int verbose;          // Whether to be verbose
 } context_t;
 
@@ -27,11 +54,21 @@ typedef struct {
  * Create a new execution context
  * 
  * @param host Host to execute on
- * @param playbook Playbook to execute
+ * @param play Play being executed (its vars are copied into the context)
  * @param verbose Whether to be verbose
  * @return Pointer to the new context, or NULL on error
  */
-context_t *context_create(host_t *host, playbook_t *playbook, int verbose);
+context_t *context_create(host_t *host, play_t *play, int verbose);
+
+/**
+ * Copy a context, with its own copy of the overlay
+ * 
+ * The copy borrows the original's layers, so it must not outlive it.
+ * 
+ * @param context Context to copy
+ * @return Pointer to the new context, or NULL on error
+ */
+context_t *context_clone(const context_t *context);
 
 /**
  * Free resources used by a context
@@ -41,7 +78,7 @@ context_t *context_create(host_t *host, playbook_t *playbook, int verbose);
 void context_free(context_t *context);
 
 /**
- * Set a variable in the context
+ * Set a variable in the context's overlay
  * 
  * @param context Pointer to the context
  * @param name Variable name
@@ -59,6 +96,114 @@ int context_set_var(context_t *context, const char *name, const char *value);
  */
 const char *context_get_var(context_t *context, const char *name);
 
+/**
+ * Set a variable in the context's overlay by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name (see symbol.h)
+ * @param value Variable value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int context_set_var_id(context_t *context, int key, const char *value);
+
+/**
+ * Get a variable from the context by symbol ID
+ * 
+ * Takes no lock and hashes nothing; meant for the SYMBOL_* constants and
+ * names interned ahead of time.
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Variable value, or NULL if not found
+ */
+const char *context_get_var_id(const context_t *context, int key);
+
+/**
+ * Set a typed variable in the context's overlay by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param value Value, built in the context's arena (or living as long as the context)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int context_set_value_id(context_t *context, int key, const value_t *value);
+
+/**
+ * Take a variable out of the context's overlay, to be put back later
+ * 
+ * Whatever the overlay held for the name is handed to the caller, so the
+ * variable is no longer set there until context_restore_var.
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param saved Pointer to receive the variable (its value is NULL if the overlay had none)
+ */
+void context_take_var(context_t *context, int key, context_var_t *saved);
+
+/**
+ * Put back a variable taken out with context_take_var
+ * 
+ * Any value set for the name in the meantime is dropped.
+ * 
+ * @param context Pointer to the context
+ * @param saved Variable taken out
+ */
+void context_restore_var(context_t *context, const context_var_t *saved);
+
+/**
+ * Get the typed value of a variable by symbol ID
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Typed value, or NULL if the variable is not set or only has text
+ */
+const value_t *context_get_value_id(const context_t *context, int key);
+
+/**
+ * Find a variable by symbol ID, with its typed value
+ * 
+ * One lookup for callers that use the text and the type alike.
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param typed Pointer to receive the typed value (NULL when the variable only has text)
+ * @return Variable value, or NULL if not found
+ */
+const char *context_lookup_id(const context_t *context, int key, const value_t **typed);
+
+/**
+ * Register a task result under a name, replacing any result of the same name
+ * 
+ * The context takes over the output buffers and message of the result, so
+ * they must not be freed by the caller afterwards. A trailing newline is cut
+ * off the output, as Ansible does.
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @param result Result to register (its key is set)
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (the buffers then stay with the caller)
+ */
+int context_register(context_t *context, int key, const registered_t *result);
+
+/**
+ * Get a registered result
+ * 
+ * @param context Pointer to the context
+ * @param key Symbol ID of the name
+ * @return Result, or NULL if nothing was registered under the name
+ */
+registered_t *context_get_result(const context_t *context, int key);
+
+/**
+ * Index the lines of a registered result's standard output, on first use
+ * 
+ * Safe to call from the workers of a parallel loop.
+ * 
+ * @param result Registered result
+ * @return Number of lines (see registered_t.lines), or -1 on error
+ */
+int context_result_lines(registered_t *result);
+
 /**
  * Print context (for debugging)
  * 
@@ -2,6 +2,7 @@
 #define ANCIBLE_EXECUTOR_H
 
 #include "../modules/module.h"
+#include "bitset.h"
 #include "context.h"
 
 /**
@@ -33,7 +34,7 @@ int executor_register_module(const char *name, module_func_t func);
  * 
  * @param context Execution context
  * @param task_idx Task index
- * @param args Task arguments
+ * @param args Task arguments (NULL to use the task's own arguments)
  * @param result Pointer to result structure to fill
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
  */
@@ -50,6 +51,72 @@ int executor_run_task(context_t *context, int task_idx, const char *args, module
  */
 int executor_run_block(context_t *context, int block_idx, const char *args, module_result_t *result);
 
+/**
+ * Execute a loop task, once per item
+ *
+ * Each item is exposed as the "item" variable and substituted for
+ * {{ item }} in the arguments. Per-item results are stored in order in
+ * result->items. With loop_control.parallel, up to that many items run at
+ * once, capped by the host's ancible_host_concurrency (default 10).
+ *
+ * @param context Execution context
+ * @param task_idx Task index
+ * @param args Task arguments (NULL to use the task's own arguments)
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_run_loop(context_t *context, int task_idx, const char *args, module_result_t *result);
+
+/**
+ * Execute the tasks of an included file
+ *
+ * @param context Execution context
+ * @param include_idx Include task index
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_run_include(context_t *context, int include_idx, module_result_t *result);
+
+/**
+ * Fold the when conditions of a play's tasks that every host shares
+ *
+ * Called once per play before it runs. A task whose condition holds on
+ * every host is run without evaluating it; one whose condition holds on
+ * none is not dispatched (unless it registers its result).
+ *
+ * @param play Play about to run
+ * @param extra_vars Extra variables (may be NULL)
+ */
+void executor_fold_play(play_t *play, const scope_t *extra_vars);
+
+/**
+ * Evaluate a top-level task's when condition for every host at once
+ *
+ * Only tasks whose compiled condition depends on the host, and that do not
+ * loop, are batched. Hosts the condition holds on then run the task without
+ * evaluating it again; hosts it does not hold on should be given their
+ * skipped result with executor_skip_task instead of running the task.
+ *
+ * @param contexts Contexts of the hosts
+ * @param count Number of contexts
+ * @param task_idx Index of the task
+ * @param fails Bitset to fill with the hosts (indexes into contexts) the condition does not hold on
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR if the task is not batched (or on error)
+ */
+int executor_batch_condition(context_t **contexts, int count, int task_idx, bitset_t *fails);
+
+/**
+ * Mark a task skipped on a host its condition does not hold on, without running it
+ *
+ * The result is registered, as if the task had run and been skipped.
+ *
+ * @param context Execution context
+ * @param task_idx Task index
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int executor_skip_task(context_t *context, int task_idx, module_result_t *result);
+
 /**
  * Clean up the module registry
  */
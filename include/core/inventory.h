@@ -1,13 +1,38 @@
 #ifndef ANCIBLE_INVENTORY_H
 #define ANCIBLE_INVENTORY_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "bitset.h"
+#include "variable.h"
+#include "scope.h"
+
+/**
+ * Compact table of host variables
+ *
+ * Keys are interned symbol IDs; entries and value strings share one allocation.
+ * Range hosts share their range's table.
+ */
+typedef struct {
+    int refs;             // Number of owners (hosts and ranges)
+    int count;            // Number of entries
+    struct host_var {
+        int key;          // Symbol ID of the variable name
+        const char *value; // Value (points into the same allocation)
+    } entries[];
+} var_table_t;
+
 /**
  * Structure to hold a host in the inventory
  */
 typedef struct host {
     char *name;           // Host name
-    char *ansible_host;   // IP address or hostname
-    struct host *next;    // Next host in the list
+    char *ansible_host;   // IP address or hostname (mirrors host_vars)
+    int id;               // Dense host ID (index in inventory->hosts, -1 if not indexed)
+    var_table_t *host_vars; // Variables from the host line, or NULL
+    const variable_t **vars; // Effective group variables, merged in precedence order
+    int var_count;        // Number of effective variables
+    const scope_t *group_scope; // Index of vars, shared by hosts with the same ones (NULL if none)
 } host_t;
 
 /**
@@ -15,18 +40,112 @@ typedef struct host {
  */
 typedef struct group {
     char *name;           // Group name
-    host_t *hosts;        // Linked list of hosts in this group
-    struct group *next;   // Next group in the list
+    int id;               // Dense group ID (index in inventory->groups)
+    int *host_ids;        // IDs of the hosts declared in this group, in declaration order
+    int host_count;       // Number of hosts declared in this group
+    int host_capacity;    // Allocated size of host_ids
+    int *child_ids;       // IDs of the child groups ([name:children])
+    int child_count;      // Number of child groups
+    int child_capacity;   // Allocated size of child_ids
+    variable_t *vars;     // Group variables ([name:vars]), in declaration order
+    int depth;            // Distance from "all", used for variable precedence
+    bitset_t members;     // Flattened membership: own hosts and all descendants' hosts
 } group_t;
 
+/**
+ * Compact descriptor for hosts declared with a range (e.g. "node[0001:2000].dc1")
+ *
+ * Range hosts get consecutive IDs; their names are generated on demand and
+ * their host_t records are only created when first used (see inventory_host).
+ */
+typedef struct {
+    char *prefix;         // Text before the range
+    char *suffix;         // Text after the range
+    long start;           // First value (a character code for alphabetic ranges)
+    long step;            // Distance between values
+    int count;            // Number of hosts
+    int width;            // Zero-padded width of numeric values (0 for none)
+    int alpha;            // Whether values are letters
+    int first_id;         // Host ID of the first value
+    var_table_t *vars;    // Variables given on the range line, or NULL
+} host_range_t;
+
+/**
+ * Open-addressing hash index from names to dense IDs
+ */
+typedef struct {
+    struct name_slot {
+        const char *name; // Indexed name (owned by the host or group, NULL if empty)
+        uint32_t hash;    // Cached hash of the name
+        int id;           // Dense ID the name maps to
+    } *slots;
+    int capacity;         // Number of slots (power of two)
+    int count;            // Number of used slots
+} name_index_t;
+
+/**
+ * Indexes of merged group variables, one per distinct host->vars array
+ *
+ * Hosts in the same groups merge the same variables in the same order, so
+ * they share one scope however many of them there are.
+ */
+typedef struct {
+    struct group_scope {
+        uint32_t hash;            // Hash of the variable pointers
+        int count;                // Number of variables
+        const variable_t **vars;  // Merged variables, as in host->vars (NULL if the slot is empty)
+        scope_t *scope;           // Index of the variables
+    } *slots;
+    int capacity;                 // Number of slots (power of two)
+    int count;                    // Number of used slots
+} group_scopes_t;
+
+/**
+ * Hosts used in place from a mapped snapshot (see snapshot.h)
+ *
+ * Snapshot hosts hold the first host IDs; like range hosts, they only get
+ * a host_t record when first used.
+ */
+typedef struct {
+    void *map;                          // Mapping of the whole file (NULL if none)
+    size_t size;                        // Size of the mapping
+    const char *strings;                // String table
+    size_t strings_size;                // Size of the string table
+    const struct snapshot_host *hosts;  // Host records
+    int host_count;                     // Number of host records
+    const struct snapshot_var *vars;    // Variable records
+    const struct snapshot_slot *index;  // Host name index
+    uint32_t index_capacity;            // Number of index slots (power of two)
+} mapped_hosts_t;
+
 /**
  * Structure to hold the inventory
  */
 typedef struct {
-    group_t *groups;      // Linked list of groups
-    host_t *all_hosts;    // Linked list of all hosts
+    host_t **hosts;           // Hosts indexed by host ID (NULL for range hosts not used yet)
+    int host_count;           // Number of hosts
+    int host_capacity;        // Allocated size of hosts
+    host_range_t *ranges;     // Range descriptors, in host ID order
+    int range_count;          // Number of range descriptors
+    int range_capacity;       // Allocated size of ranges
+    int *group_order;         // Group IDs in variable precedence order (lowest first), group_capacity long
+    group_t **groups;         // Groups indexed by group ID ("all" is 0)
+    int group_count;          // Number of groups
+    int group_capacity;       // Allocated size of groups
+    name_index_t host_index;  // Host name to host ID (hosts not declared by a range)
+    name_index_t group_index; // Group name to group ID
+    mapped_hosts_t mapped;    // Hosts read in place from a snapshot, if loaded from one
+    group_scopes_t group_scopes; // Shared indexes of the hosts' group variables
 } inventory_t;
 
+/**
+ * Hash a host or group name (FNV-1a), as used by the name indexes
+ *
+ * @param name Name to hash
+ * @return 32-bit hash
+ */
+uint32_t inventory_name_hash(const char *name);
+
 /**
  * Load inventory from a file
  * 
@@ -44,13 +163,204 @@ int inventory_load(const char *filename, inventory_t *inventory);
 void inventory_free(inventory_t *inventory);
 
 /**
- * Get hosts in a group
+ * Find a host by name
+ *
+ * @param inventory Pointer to inventory structure
+ * @param name Host name
+ * @return Pointer to the host, or NULL if not found
+ */
+host_t *inventory_find_host(inventory_t *inventory, const char *name);
+
+/**
+ * Get the ID of a host by name, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param name Host name
+ * @return Host ID, or -1 if not found
+ */
+int inventory_host_id(const inventory_t *inventory, const char *name);
+
+/**
+ * Get a host by ID, creating the record of a range host on first use
+ *
+ * Not thread-safe: call it from the thread that owns the inventory.
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @return Pointer to the host, or NULL on error
+ */
+host_t *inventory_host(inventory_t *inventory, int id);
+
+/**
+ * Get the name of a host by ID, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @param buffer Buffer for generated names
+ * @param size Size of the buffer
+ * @return Host name (the host's own string or buffer)
+ */
+const char *inventory_host_name(const inventory_t *inventory, int id, char *buffer, size_t size);
+
+/**
+ * Find a group by name
+ *
+ * @param inventory Pointer to inventory structure
+ * @param name Group name
+ * @return Pointer to the group, or NULL if not found
+ */
+group_t *inventory_find_group(const inventory_t *inventory, const char *name);
+
+/**
+ * Get a variable set on a host's inventory line
+ *
+ * @param host Pointer to the host
+ * @param name Variable name
+ * @return Variable value, or NULL if not set
+ */
+const char *host_get_var(const host_t *host, const char *name);
+
+/**
+ * Get hosts in a group, including the hosts of its descendants
  * 
  * @param inventory Pointer to inventory structure
  * @param group_name Name of the group to get hosts for
- * @return Pointer to the first host in the group, or NULL if group not found
+ * @return Set of host IDs (index inventory->hosts), or NULL if group not found
+ */
+const bitset_t *inventory_get_hosts(const inventory_t *inventory, const char *group_name);
+
+/**
+ * Get the number of variables set on a host, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @return Number of variables
+ */
+int inventory_host_var_count(const inventory_t *inventory, int id);
+
+/**
+ * Get a variable set on a host, without creating its record
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @param index Variable index (below inventory_host_var_count())
+ * @param name Receives the variable name
+ * @param value Receives the variable value
+ */
+void inventory_host_var(const inventory_t *inventory, int id, int index, const char **name, const char **value);
+
+/*
+ * Building an inventory from other sources: start with inventory_init(),
+ * add groups, hosts and variables, then call inventory_resolve_groups().
+ */
+
+/**
+ * Initialize an empty inventory holding only the "all" group
+ *
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_init(inventory_t *inventory);
+
+/**
+ * Find a group by name, creating it if needed
+ *
+ * @param inventory Pointer to inventory structure
+ * @param name Group name
+ * @return Pointer to the group, or NULL on error
+ */
+group_t *inventory_get_group(inventory_t *inventory, const char *name);
+
+/**
+ * Make a group the child of another
+ *
+ * @param inventory Pointer to inventory structure
+ * @param parent Parent group
+ * @param child Child group
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_add_child(inventory_t *inventory, group_t *parent, group_t *child);
+
+/**
+ * Set a group variable, replacing an earlier value for the same name
+ *
+ * @param group Pointer to the group
+ * @param name Variable name
+ * @param value Variable value
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int group_set_var(group_t *group, const char *name, const char *value);
+
+/**
+ * Add a host to a group (and to "all"), creating the host if needed
+ *
+ * The name is used as-is: ranges are not expanded.
+ *
+ * @param inventory Pointer to inventory structure
+ * @param group Group to add the host to
+ * @param name Host name
+ * @return Host ID, or -1 on error
+ */
+int inventory_add_group_host(inventory_t *inventory, group_t *group, const char *name);
+
+/**
+ * Set variables on a host, over the ones it already has
+ *
+ * @param inventory Pointer to inventory structure
+ * @param id Host ID
+ * @param count Number of variables
+ * @param keys Symbol IDs of the names (see symbol_intern())
+ * @param values Values
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_set_host_vars(inventory_t *inventory, int id, int count, const int *keys, const char *const *values);
+
+/**
+ * Resolve the group hierarchy once every group and host is declared
+ *
+ * Flattens group membership and merges group variables into the hosts.
+ *
+ * @param inventory Pointer to inventory structure
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_resolve_groups(inventory_t *inventory);
+
+/*
+ * Runtime changes (add_host, group_by)
+ *
+ * Unlike the builder functions, these keep a resolved inventory resolved:
+ * flattened group membership, the name indexes, the precedence order and
+ * the variables of existing host records are updated in place. Calls are
+ * serialised by a lock, so tasks running in parallel can make them, and
+ * the host_t records running tasks hold never move.
+ */
+
+/**
+ * Add a host at runtime (add_host), or update it if it exists
+ *
+ * @param inventory Pointer to inventory structure (groups resolved)
+ * @param name Host name
+ * @param count Number of variables
+ * @param keys Symbol IDs of the variable names (see symbol_intern())
+ * @param values Variable values, set over the host's own
+ * @param created Set to 1 if the host is new, 0 otherwise
+ * @return Host ID, or -1 on error
+ */
+int inventory_runtime_add_host(inventory_t *inventory, const char *name, int count,
+                               const int *keys, const char *const *values, int *created);
+
+/**
+ * Add a host to a group at runtime (add_host, group_by)
+ *
+ * A new group is a top-level group, or a child of parent when given.
+ *
+ * @param inventory Pointer to inventory structure (groups resolved)
+ * @param id Host ID
+ * @param name Group name (created if needed)
+ * @param parent Parent group name (created if needed), or NULL
+ * @return 1 if the host or the group changed, 0 if nothing changed, -1 on error
  */
-host_t *inventory_get_hosts(inventory_t *inventory, const char *group_name);
+int inventory_runtime_add_group_host(inventory_t *inventory, int id, const char *name, const char *parent);
 
 /**
  * Print inventory (for debugging)
@@ -0,0 +1,49 @@
+#ifndef ANCIBLE_INVENTORY_SOURCE_H
+#define ANCIBLE_INVENTORY_SOURCE_H
+
+#include "inventory.h"
+
+#define INVENTORY_CACHE_TTL 3600  // Default lifetime of a cached inventory, in seconds
+
+/**
+ * Load inventory from any supported source
+ *
+ * - a directory holds several inventory files, merged as by inventory_load_sources()
+ * - a snapshot compiled by ancible-inventory --compile is mapped and used in place
+ * - an executable is a dynamic inventory script: it is run with --list and
+ *   prints the inventory as JSON
+ * - a .json, .yml or .yaml file holds the inventory as JSON or YAML
+ * - anything else is an INI inventory file
+ *
+ * Script and JSON/YAML inventories are cached as binary snapshots in
+ * $ANCIBLE_CACHE_DIR (default: ~/.cache/ancible) for
+ * $ANCIBLE_INVENTORY_CACHE_TTL seconds (default: INVENTORY_CACHE_TTL, 0 disables the cache).
+ *
+ * @param source Inventory path
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_load_source(const char *source, inventory_t *inventory);
+
+/**
+ * Load inventory from several sources, merged into one
+ *
+ * Directories are expanded into their files in name order. Sources are
+ * loaded in parallel, then merged in order: hosts and groups with the same
+ * name are the same host or group, and variables from later sources win.
+ * Host IDs follow the order hosts first appear in. Each file that fails
+ * to load is reported by path.
+ *
+ * @param sources Inventory paths, lowest precedence first
+ * @param count Number of paths
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int inventory_load_sources(const char *const *sources, int count, inventory_t *inventory);
+
+/**
+ * Ignore cached inventories for the rest of the run (they are still refreshed)
+ */
+void inventory_cache_flush(void);
+
+#endif /* ANCIBLE_INVENTORY_SOURCE_H */
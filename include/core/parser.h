@@ -1,6 +1,12 @@
 #ifndef ANCIBLE_PARSER_H
 #define ANCIBLE_PARSER_H
 
+#include "variable.h"
+#include "scope.h"
+#include "template.h"
+
+struct condition;
+
 /**
  * Task type enumeration
  */
@@ -8,29 +14,67 @@ typedef enum {
     TASK_TYPE_NORMAL,    // Regular task
     TASK_TYPE_BLOCK,     // Block (contains other tasks)
     TASK_TYPE_RESCUE,    // Rescue block (error handling)
-    TASK_TYPE_ALWAYS     // Always block (cleanup)
+    TASK_TYPE_ALWAYS,    // Always block (cleanup)
+    TASK_TYPE_INCLUDE    // Dynamic include (args holds the task file path)
 } task_type_t;
 
+/**
+ * What the when condition of a task gives on the hosts of the play being run
+ */
+typedef enum {
+    TASK_WHEN_DYNAMIC,   // Depends on the host, evaluated per host (or there is no condition)
+    TASK_WHEN_ALWAYS,    // Holds on every host
+    TASK_WHEN_NEVER      // Holds on no host; the task is not dispatched at all
+} task_when_t;
+
 /**
  * Structure to hold task data
  */
 typedef struct task {
     char *name;           // Task name
     char *module;         // Task module name
+    char *args;           // Module arguments (may be NULL)
     char *when;           // Task when condition (may be NULL if no condition)
+    template_t *name_template; // Compiled name (NULL if none, or for tasks built by hand)
+    template_t *args_template; // Compiled module arguments (NULL if none)
+    template_t *when_template; // When condition compiled as a template, for conditions beyond the compiler
+    struct condition *condition; // Compiled when condition (NULL if none, or when_template is used)
+    task_when_t when_static; // Condition folded for the play being run (executor_fold_play)
+    char *register_var;   // Name the result is registered as (NULL if none)
+    int register_key;     // Symbol ID of register_var
+    char **loop_items;    // Literal loop items (NULL if the task has none)
+    int loop_count;       // Number of literal loop items
+    char *loop_var;       // Variable holding the loop items (loop: "{{ packages }}"), NULL if none
+    int loop_batch;       // Send all items of a command loop in one round trip (loop_control.batch)
+    int loop_parallel;    // Maximum number of items run at once on a host (loop_control.parallel)
     task_type_t type;     // Task type
+    variable_t *vars;     // Task (or block) variables
+    scope_t *var_scope;   // Own variables over those of enclosing blocks (NULL if none)
     int parent_idx;       // Index of parent block (-1 if top-level)
     int subtask_count;    // Number of subtasks (for blocks)
     int *subtask_indices; // Indices of subtasks (for blocks)
 } task_t;
 
 /**
- * Structure to hold playbook data
+ * Structure to hold a play (one entry of the playbook's top-level list)
  */
 typedef struct {
-    char *hosts;          // Target hosts for this playbook
+    char *name;           // Play name (may be NULL)
+    char *hosts;          // Host pattern targeted by this play
+    variable_t *vars;     // Play variables (role vars included)
+    variable_t *defaults; // Role defaults, below every other variable
+    scope_t *var_scope;   // Index of vars (NULL if none)
+    scope_t *default_scope; // Index of defaults (NULL if none)
     int task_count;       // Number of tasks (including blocks and subtasks)
     task_t *tasks;        // Array of tasks
+} play_t;
+
+/**
+ * Structure to hold playbook data
+ */
+typedef struct {
+    int play_count;       // Number of plays
+    play_t *plays;        // Array of plays, in file order
 } playbook_t;
 
 /**
@@ -49,6 +93,22 @@ int parse_playbook(const char *filename, playbook_t *playbook);
  */
 void playbook_free(playbook_t *playbook);
 
+/**
+ * Parse a task file (a YAML list of tasks) through the shared cache
+ *
+ * The file is parsed and compiled on first use; later calls return the same
+ * tasks. Safe to call from several threads.
+ *
+ * @param filename Path to the task file
+ * @return Compiled tasks (owned by the cache), or NULL on error
+ */
+play_t *parse_task_file(const char *filename);
+
+/**
+ * Free all files held by the parsed-file cache
+ */
+void parser_cache_cleanup(void);
+
 /**
  * Print playbook structure (for debugging)
  * 
@@ -0,0 +1,38 @@
+#ifndef ANCIBLE_PATTERN_H
+#define ANCIBLE_PATTERN_H
+
+#include "bitset.h"
+#include "inventory.h"
+
+/**
+ * Resolve a host pattern against an inventory
+ *
+ * Terms are separated by ':' (or ',' when the pattern contains one):
+ * - name      group or host name ("all" and "*" match every host)
+ * - web*      shell wildcard over group and host names
+ * - ~web\d+   regular expression (POSIX ERE, plus \d \w \s) over group and host names
+ * - &term     intersection
+ * - !term     exclusion
+ * Any term but a regex may end with a slice: [2], [-1], [0:9] (inclusive), [5:], [:3].
+ * As in Ansible, unions apply first, then intersections, then exclusions.
+ *
+ * @param inventory Inventory to resolve against
+ * @param pattern Host pattern
+ * @param result Initialized bitset receiving the matching host IDs
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on an invalid pattern
+ */
+int pattern_resolve(const inventory_t *inventory, const char *pattern, bitset_t *result);
+
+/**
+ * Resolve the hosts of a play, restricted by an optional --limit pattern
+ *
+ * @param inventory Inventory to resolve against
+ * @param pattern Play host pattern
+ * @param limit Limit pattern, or NULL for no limit
+ * @param result Initialized bitset receiving the matching host IDs
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on an invalid pattern
+ */
+int pattern_resolve_limited(const inventory_t *inventory, const char *pattern,
+                            const char *limit, bitset_t *result);
+
+#endif /* ANCIBLE_PATTERN_H */
@@ -0,0 +1,79 @@
+#ifndef ANCIBLE_SCOPE_H
+#define ANCIBLE_SCOPE_H
+
+#include "variable.h"
+
+/**
+ * Variable scopes
+ *
+ * A scope is an immutable index of variables by symbol ID. It points at the
+ * variables it was built from instead of copying them, so one scope can be
+ * shared by every host that sees the same variables, and a value replaced
+ * in place by its owner is seen right away.
+ *
+ * A host's context stacks scopes by precedence (lowest first):
+ * role defaults, group vars, host vars, play vars, block vars, task vars,
+ * extra vars. Block vars are folded into each task's scope when the play
+ * is compiled. Writes made while running (loop items, facts) go to a small
+ * per-host overlay above the task vars, never into a shared scope.
+ */
+
+/**
+ * Immutable open-addressing index of variables
+ *
+ * Reference counts are only changed by owners (parser, inventory) while
+ * building or freeing; contexts borrow scopes without counting.
+ */
+typedef struct scope {
+    int refs;             // Number of owners
+    int count;            // Number of variables
+    int capacity;         // Number of slots (power of two)
+    struct scope_slot {
+        int key;          // Symbol ID of the name, or -1 for an empty slot
+        const variable_t *var; // Indexed variable (owned elsewhere)
+    } slots[];
+} scope_t;
+
+/**
+ * Build a scope from an array of variables
+ *
+ * @param vars Variables (a later one wins over an earlier one of the same name)
+ * @param count Number of variables
+ * @return New scope, or NULL on error
+ */
+scope_t *scope_create(const variable_t *const *vars, int count);
+
+/**
+ * Build a scope holding a base scope's variables overridden by a list
+ *
+ * @param base Base scope (may be NULL)
+ * @param list Variable list taking precedence over the base (may be NULL)
+ * @return New scope, or NULL on error
+ */
+scope_t *scope_extend(const scope_t *base, const variable_t *list);
+
+/**
+ * Find a variable in a scope
+ *
+ * @param scope Scope (may be NULL)
+ * @param key Symbol ID of the name
+ * @return Variable, or NULL if the scope does not hold it
+ */
+const variable_t *scope_find(const scope_t *scope, int key);
+
+/**
+ * Add an owner to a scope
+ *
+ * @param scope Scope (may be NULL)
+ * @return The scope
+ */
+scope_t *scope_retain(scope_t *scope);
+
+/**
+ * Drop an owner of a scope, freeing it with the last one
+ *
+ * @param scope Scope (may be NULL)
+ */
+void scope_release(scope_t *scope);
+
+#endif /* ANCIBLE_SCOPE_H */
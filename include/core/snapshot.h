@@ -0,0 +1,80 @@
+#ifndef ANCIBLE_SNAPSHOT_H
+#define ANCIBLE_SNAPSHOT_H
+
+#include <stdint.h>
+#include "inventory.h"
+
+/**
+ * Binary inventory snapshots
+ *
+ * A snapshot holds a resolved inventory in a form that is used in place
+ * once mapped: a string table, fixed-size host, group and variable records
+ * referring to it by offset, a hash index of host names, and every group's
+ * flattened membership as a bitset. Host and group IDs are kept, so a
+ * loaded snapshot resolves patterns exactly like its source.
+ *
+ * Layout (all offsets from the start of the file, sections 8-byte aligned):
+ * header, strings, hosts, groups, vars, ids, index, words, order.
+ */
+
+#define SNAPSHOT_MAGIC "ANCINV\r\n"
+#define SNAPSHOT_VERSION 2
+
+/**
+ * Host record
+ */
+typedef struct snapshot_host {
+    uint32_t name;            // String offset of the host name
+    uint32_t vars;            // First variable record
+    uint32_t var_count;       // Number of variable records
+} snapshot_host_t;
+
+/**
+ * Variable record
+ */
+typedef struct snapshot_var {
+    uint32_t name;            // String offset of the name
+    uint32_t value;           // String offset of the value
+} snapshot_var_t;
+
+/**
+ * Host name index slot (open addressing, FNV-1a)
+ */
+typedef struct snapshot_slot {
+    uint32_t hash;            // Hash of the host name
+    uint32_t id;              // Host ID + 1 (0 for an empty slot)
+} snapshot_slot_t;
+
+/**
+ * Write an inventory to a snapshot file
+ *
+ * The file is written next to its final path and renamed into place, so
+ * concurrent readers never see a partial snapshot.
+ *
+ * @param inventory Resolved inventory
+ * @param path Snapshot path
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int snapshot_save(const inventory_t *inventory, const char *path);
+
+/**
+ * Load an inventory from a snapshot file
+ *
+ * The file is mapped and its hosts are used in place: a host only gets a
+ * record (and its own strings) when it is first used.
+ *
+ * @param path Snapshot path
+ * @param inventory Pointer to inventory structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error (missing, corrupt or stale format)
+ */
+int snapshot_load(const char *path, inventory_t *inventory);
+
+/**
+ * Check whether a file is a snapshot
+ *
+ * @param path File path
+ * @return 1 if the file starts with the snapshot magic, 0 otherwise
+ */
+int snapshot_detect(const char *path);
+
+#endif /* ANCIBLE_SNAPSHOT_H */
@@ -0,0 +1,56 @@
+#ifndef ANCIBLE_SYMBOL_H
+#define ANCIBLE_SYMBOL_H
+
+/**
+ * Interned strings
+ *
+ * Every distinct name (variable names, mostly) gets a small dense ID that
+ * stays valid for the whole run, so hot paths compare and index by integer.
+ * Interning is thread-safe; symbol_name never takes a lock.
+ */
+
+/**
+ * Well-known names, interned first so their IDs are compile-time constants
+ * (hot paths use them without hashing or locking)
+ */
+enum {
+    SYMBOL_ANSIBLE_CONNECTION,
+    SYMBOL_ANSIBLE_HOST,
+    SYMBOL_ANSIBLE_USER,
+    SYMBOL_ANSIBLE_PORT,
+    SYMBOL_ANCIBLE_HOST_CONCURRENCY,
+    SYMBOL_ITEM,
+    SYMBOL_INVENTORY_HOSTNAME,
+    SYMBOL_BUILTIN_COUNT
+};
+
+/**
+ * Intern a name
+ *
+ * @param name Name to intern
+ * @return Symbol ID, or -1 on error
+ */
+int symbol_intern(const char *name);
+
+/**
+ * Look up a name without interning it
+ *
+ * @param name Name to look up
+ * @return Symbol ID, or -1 if the name was never interned
+ */
+int symbol_find(const char *name);
+
+/**
+ * Get the name of a symbol
+ *
+ * @param id Symbol ID
+ * @return Interned name, or NULL if the ID is unknown
+ */
+const char *symbol_name(int id);
+
+/**
+ * Free every interned name (IDs become invalid)
+ */
+void symbol_cleanup(void);
+
+#endif /* ANCIBLE_SYMBOL_H */
@@ -0,0 +1,159 @@
+#ifndef ANCIBLE_TEMPLATE_H
+#define ANCIBLE_TEMPLATE_H
+
+#include <stddef.h>
+#include <regex.h>
+#include "variable.h"
+
+/**
+ * Templates
+ *
+ * Task names, when conditions and module arguments may hold Jinja-style
+ * {{ expr }} references. A template is compiled once, when the playbook is
+ * parsed, into a list of segments: runs of literal text and expressions
+ * whose variable names are already resolved to symbol IDs. Rendering for a
+ * host only walks the segments and copies values into a reusable buffer.
+ *
+ * An expression is a variable or a literal followed by any number of
+ * filters (name | default('x') | upper). Filters and their arguments are
+ * compiled into the expression tree, regexes included, so rendering never
+ * parses anything; intermediate values live in the buffer's scratch area.
+ *
+ * Fields of registered results (out.stdout, out.rc, out.stdout_lines) are
+ * read straight from the registered output, without copying it. Typed
+ * variables (set_fact, -e) keep their type: lists are walked item by item
+ * and to_json writes numbers and booleans bare.
+ */
+
+struct context;
+
+#define TEMPLATE_MAX_FILTER_ARGS 2
+
+/**
+ * Expression types
+ */
+typedef enum {
+    TEMPLATE_EXPR_VAR,    // Variable reference
+    TEMPLATE_EXPR_STRING, // String literal
+    TEMPLATE_EXPR_NUMBER, // Number literal
+    TEMPLATE_EXPR_BOOL,   // true or false
+    TEMPLATE_EXPR_FILTER  // Filter applied to an input expression
+} template_expr_type_t;
+
+/**
+ * Built-in filters
+ */
+typedef enum {
+    TEMPLATE_FILTER_DEFAULT,       // default(value[, boolean])
+    TEMPLATE_FILTER_LOWER,         // lower
+    TEMPLATE_FILTER_UPPER,         // upper
+    TEMPLATE_FILTER_REPLACE,       // replace(old, new)
+    TEMPLATE_FILTER_REGEX_REPLACE, // regex_replace(pattern[, replacement])
+    TEMPLATE_FILTER_JOIN,          // join([separator])
+    TEMPLATE_FILTER_SPLIT,         // split([separator])
+    TEMPLATE_FILTER_INT,           // int
+    TEMPLATE_FILTER_LENGTH,        // length
+    TEMPLATE_FILTER_B64ENCODE,     // b64encode
+    TEMPLATE_FILTER_TO_JSON        // to_json
+} template_filter_t;
+
+/**
+ * Compiled expression of a {{ }} block
+ */
+typedef struct template_expr {
+    template_expr_type_t type; // Expression type
+    int key;              // Symbol ID of the variable (TEMPLATE_EXPR_VAR)
+    result_field_t field; // Field of a registered result (out.stdout), or RESULT_FIELD_NONE
+    char *text;           // Variable name, literal value or filter name
+    template_filter_t filter; // Filter (TEMPLATE_EXPR_FILTER)
+    struct template_expr *input; // Value the filter applies to
+    struct template_expr *args[TEMPLATE_MAX_FILTER_ARGS]; // Filter arguments
+    int arg_count;        // Number of filter arguments
+    regex_t *regex;       // Precompiled pattern of regex_replace, or NULL
+} template_expr_t;
+
+/**
+ * Segment of a template: a run of literal text, or an expression
+ */
+typedef struct template_segment {
+    const char *text;     // Literal text (points into the source), NULL for an expression
+    size_t length;        // Length of the literal text
+    template_expr_t *expr; // Expression (NULL for literal text)
+} template_segment_t;
+
+/**
+ * Compiled template
+ */
+typedef struct template {
+    char *source;         // Template text
+    int segment_count;    // Number of segments
+    template_segment_t *segments; // Segments, in order
+} template_t;
+
+/**
+ * Growable buffer templates are rendered into, reused from one render to the next
+ */
+typedef struct template_buffer {
+    char *data;           // Rendered text (NUL-terminated)
+    size_t length;        // Length of the rendered text
+    size_t capacity;      // Allocated size of data
+    char *scratch;        // Intermediate filter values
+    size_t scratch_length; // Bytes of scratch in use
+    size_t scratch_capacity; // Allocated size of scratch
+} template_buffer_t;
+
+/**
+ * Compile a template
+ *
+ * @param source Template text
+ * @return Compiled template, or NULL on error (syntax errors are reported)
+ */
+template_t *template_compile(const char *source);
+
+/**
+ * Check whether a template holds any expression
+ *
+ * @param template Compiled template (may be NULL)
+ * @return 1 if rendering can give something other than the source, 0 otherwise
+ */
+int template_is_dynamic(const template_t *template);
+
+/**
+ * Render a template for a host
+ *
+ * A template without expressions renders to its source, and one made of a
+ * single expression to the variable's own value, without copying; anything
+ * else is built in the buffer. The result is valid until the buffer is
+ * reused or the variables change.
+ *
+ * @param template Compiled template
+ * @param context Context of the host (variables are looked up through it)
+ * @param buffer Buffer to render into
+ * @return Rendered text, or NULL on error (the buffer then holds the error message)
+ */
+const char *template_render(const template_t *template, const struct context *context, template_buffer_t *buffer);
+
+/**
+ * Find a field of registered results by name
+ *
+ * @param name Field name (not NUL-terminated)
+ * @param length Length of the name
+ * @return Field, or RESULT_FIELD_NONE if there is no such field
+ */
+result_field_t template_field_find(const char *name, size_t length);
+
+/**
+ * Free the memory held by a template buffer
+ *
+ * @param buffer Buffer (may be NULL)
+ */
+void template_buffer_free(template_buffer_t *buffer);
+
+/**
+ * Free a compiled template
+ *
+ * @param template Compiled template (may be NULL)
+ */
+void template_free(template_t *template);
+
+#endif /* ANCIBLE_TEMPLATE_H */
@@ -0,0 +1,84 @@
+#ifndef ANCIBLE_VALUE_H
+#define ANCIBLE_VALUE_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "yaml.h"
+
+/**
+ * Typed values
+ *
+ * Extra vars and facts keep their type (string, integer, boolean, list or
+ * map) instead of being flattened to text, so conditions and templates
+ * compare integers and walk list items without parsing anything. Every
+ * value also carries a text form, which is what string lookups see: lists
+ * and maps in flow style, booleans as True and False. Values are built in
+ * an arena and never freed one by one.
+ */
+
+/**
+ * Value types
+ */
+typedef enum {
+    VALUE_STRING,         // Text
+    VALUE_INT,            // Integer
+    VALUE_BOOL,           // True or False
+    VALUE_LIST,           // Sequence of values
+    VALUE_MAP             // Mapping of names to values
+} value_type_t;
+
+/**
+ * Typed value
+ */
+typedef struct value {
+    value_type_t type;    // Value type
+    long long integer;    // Integer (VALUE_INT), or 1 and 0 (VALUE_BOOL)
+    const char *text;     // Text form
+    size_t length;        // Length of the text form
+    int count;            // Number of items (VALUE_LIST) or entries (VALUE_MAP)
+    struct value *items;  // Items, or the values of the entries
+    const char **keys;    // Keys of the entries (VALUE_MAP)
+} value_t;
+
+/**
+ * Build a value from text, inferring its type
+ *
+ * Integers, booleans (true, false, yes, no) and flow-style lists and maps
+ * ("[a, b]", "{a: 1}") are recognized; anything else is a string.
+ *
+ * @param arena Arena the value is built in
+ * @param text Text of the value
+ * @return Value, or NULL on error
+ */
+const value_t *value_parse(arena_t *arena, const char *text);
+
+/**
+ * Build a value from a YAML (or JSON) node
+ *
+ * @param arena Arena the value is built in
+ * @param node Node
+ * @return Value, or NULL on error
+ */
+const value_t *value_from_yaml(arena_t *arena, const yaml_node_t *node);
+
+/**
+ * Look up an entry of a map
+ *
+ * @param map Map value
+ * @param key Key of the entry
+ * @return Value of the entry, or NULL if the value is not a map or has no such entry
+ */
+const value_t *value_map_get(const value_t *map, const char *key);
+
+/**
+ * Check whether a value contains a text: an item of a list, a key of a map
+ * or a substring of a string
+ *
+ * @param value Container
+ * @param text Text to look for
+ * @param length Length of the text
+ * @return 1 if it does, 0 otherwise
+ */
+int value_contains(const value_t *value, const char *text, size_t length);
+
+#endif /* ANCIBLE_VALUE_H */
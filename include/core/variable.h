@@ -0,0 +1,51 @@
+#ifndef ANCIBLE_VARIABLE_H
+#define ANCIBLE_VARIABLE_H
+
+#include <stddef.h>
+
+/**
+ * Structure to hold a variable
+ */
+typedef struct variable {
+    char *name;           // Variable name
+    char *value;          // Variable value
+    struct variable *next; // Next variable in the list
+    const struct value *typed; // Typed value whose text is value (see value.h), or NULL for plain text
+} variable_t;
+
+/**
+ * Fields of a registered task result (out.stdout for "register: out")
+ */
+typedef enum {
+    RESULT_FIELD_NONE,    // Not a field reference
+    RESULT_FIELD_STDOUT,  // Standard output, without its trailing newline
+    RESULT_FIELD_STDERR,  // Standard error, without its trailing newline
+    RESULT_FIELD_RC,      // Exit code
+    RESULT_FIELD_CHANGED, // Whether the task made changes
+    RESULT_FIELD_FAILED,  // Whether the task failed
+    RESULT_FIELD_SKIPPED, // Whether the task was skipped
+    RESULT_FIELD_MSG,     // Message of the module
+    RESULT_FIELD_STDOUT_LINES // Standard output as a list of lines
+} result_field_t;
+
+/**
+ * Task result registered as a variable
+ *
+ * The output buffers are taken over from the command result rather than
+ * copied; the line index behind stdout_lines is only built when used.
+ */
+typedef struct registered {
+    int key;              // Symbol ID of the registered name
+    int changed;          // Whether the task made changes
+    int failed;           // Whether the task failed
+    int skipped;          // Whether the task was skipped
+    char rc[16];          // Exit code as text ("" when no command ran)
+    char *msg;            // Message of the module (may be NULL)
+    char *stdout_data;    // Standard output (NULL when no command ran)
+    char *stderr_data;    // Standard error (NULL when no command ran)
+    size_t stdout_length; // Length of the standard output
+    int line_count;       // Number of lines of the standard output, -1 until indexed
+    size_t *lines;        // Start of each line, then one past the end of the last
+} registered_t;
+
+#endif /* ANCIBLE_VARIABLE_H */
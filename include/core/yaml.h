@@ -0,0 +1,72 @@
+#ifndef ANCIBLE_YAML_H
+#define ANCIBLE_YAML_H
+
+/**
+ * YAML node type enumeration
+ */
+typedef enum {
+    YAML_SCALAR,         // Plain or quoted scalar value
+    YAML_MAP,            // Mapping (children carry their key)
+    YAML_SEQ             // Sequence
+} yaml_type_t;
+
+/**
+ * Structure to hold a YAML node
+ */
+typedef struct yaml_node {
+    yaml_type_t type;           // Node type
+    char *key;                  // Key when this node is a mapping entry (NULL otherwise)
+    char *value;                // Value for scalars (empty string for null)
+    int line;                   // Line number in the source document
+    int child_count;            // Number of children (for mappings and sequences)
+    struct yaml_node *children; // First child (for mappings and sequences)
+    struct yaml_node *next;     // Next sibling
+} yaml_node_t;
+
+/**
+ * Parse a YAML file into a node tree
+ *
+ * Only the block/flow subset used by playbooks and inventories is supported:
+ * mappings, sequences, flow collections, quoted scalars and | / > block scalars.
+ *
+ * @param filename Path to the YAML file
+ * @return Root node, or NULL on error
+ */
+yaml_node_t *yaml_parse_file(const char *filename);
+
+/**
+ * Parse a YAML document held in memory
+ *
+ * @param text Document text
+ * @param source Name used in error messages
+ * @return Root node, or NULL on error
+ */
+yaml_node_t *yaml_parse_string(const char *text, const char *source);
+
+/**
+ * Free a YAML node tree
+ *
+ * @param node Root node to free
+ */
+void yaml_free(yaml_node_t *node);
+
+/**
+ * Look up a key in a mapping node
+ *
+ * @param map Mapping node
+ * @param key Key to look up
+ * @return Child node for the key, or NULL if not found or not a mapping
+ */
+const yaml_node_t *yaml_map_get(const yaml_node_t *map, const char *key);
+
+/**
+ * Convert a node to text
+ *
+ * Scalars are copied as-is, sequences and mappings are written in flow style.
+ *
+ * @param node YAML node
+ * @return Newly allocated string, or NULL on error
+ */
+char *yaml_node_text(const yaml_node_t *node);
+
+#endif /* ANCIBLE_YAML_H */
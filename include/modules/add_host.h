@@ -0,0 +1,21 @@
+#ifndef ANCIBLE_ADD_HOST_MODULE_H
+#define ANCIBLE_ADD_HOST_MODULE_H
+
+#include "../core/context.h"
+#include "module.h"
+
+/**
+ * Execute the add_host module
+ * 
+ * Adds a host to the in-memory inventory, for the plays that follow:
+ * "name=HOST groups=GROUP[,GROUP...] [VAR=VALUE ...]". Every other
+ * argument becomes a host variable.
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int add_host_module_exec(context_t *context, const char *args, module_result_t *result);
+
+#endif /* ANCIBLE_ADD_HOST_MODULE_H */
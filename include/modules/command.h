@@ -15,4 +15,15 @@
  */
 int command_module_exec(context_t *context, const char *args, module_result_t *result);
 
+/**
+ * Execute the command module for several items in one round trip
+ * 
+ * @param context Execution context
+ * @param args Argument strings, one per item
+ * @param count Number of items
+ * @param results Array of count results to fill, in item order
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int command_module_exec_batch(context_t *context, const char **args, int count, module_result_t *results);
+
 #endif /* ANCIBLE_COMMAND_MODULE_H */
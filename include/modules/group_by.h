@@ -0,0 +1,20 @@
+#ifndef ANCIBLE_GROUP_BY_MODULE_H
+#define ANCIBLE_GROUP_BY_MODULE_H
+
+#include "../core/context.h"
+#include "module.h"
+
+/**
+ * Execute the group_by module
+ * 
+ * Adds the current host to a group of the in-memory inventory, for the
+ * plays that follow: "key=GROUP [parents=GROUP[,GROUP...]]".
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int group_by_module_exec(context_t *context, const char *args, module_result_t *result);
+
+#endif /* ANCIBLE_GROUP_BY_MODULE_H */
@@ -8,14 +8,30 @@
 /**
  * Structure to hold module result
  */
-typedef struct {
+typedef struct module_result {
     int changed;         // Whether the module made changes
     int failed;          // Whether the module failed
     int skipped;         // Whether the module was skipped
     char *msg;           // Message from the module
     command_result_t cmd_result;  // Command result (if applicable)
+    int registered;      // The output buffers belong to a registered variable (see context_register)
+    char *item;          // Loop item this result belongs to (NULL outside loops)
+    int item_count;      // Number of per-item results (loop tasks only)
+    struct module_result *items;  // Per-item results, in item order
 } module_result_t;
 
+#define MAX_MODULE_ARGS 64
+
+/**
+ * Structure to hold "key=value" module arguments
+ */
+typedef struct {
+    char *keys[MAX_MODULE_ARGS];    // Argument names (in buffer)
+    char *values[MAX_MODULE_ARGS];  // Argument values (in buffer)
+    int count;                      // Number of arguments
+    char *buffer;                   // Storage for the names and values
+} module_args_t;
+
 /**
  * Module function signature
  * 
@@ -40,6 +56,44 @@ void module_result_init(module_result_t *result);
  */
 void module_result_free(module_result_t *result);
 
+/**
+ * Parse "key=value" module arguments
+ *
+ * Values may be quoted. A word without '=' continues the previous value,
+ * so mappings flattened by the parser ("msg=hello world") keep their spaces.
+ *
+ * @param args Argument string (may be NULL)
+ * @param parsed Pointer to the structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int module_args_parse(const char *args, module_args_t *parsed);
+
+/**
+ * Get a parsed module argument
+ *
+ * @param parsed Parsed arguments
+ * @param key Argument name
+ * @return Argument value, or NULL if not given
+ */
+const char *module_args_get(const module_args_t *parsed, const char *key);
+
+/**
+ * Get the next item of a list argument ("a,b" or "[a, b]")
+ *
+ * @param list Pointer to the rest of the list, advanced past the item
+ * @param item Buffer receiving the item (without spaces and quotes)
+ * @param size Size of the buffer
+ * @return 1 if an item was read, 0 at the end of the list
+ */
+int module_list_next(const char **list, char *item, size_t size);
+
+/**
+ * Free resources used by parsed module arguments
+ *
+ * @param parsed Parsed arguments
+ */
+void module_args_free(module_args_t *parsed);
+
 /**
  * Print module result (for debugging)
  * 
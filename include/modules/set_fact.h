@@ -0,0 +1,21 @@
+#ifndef ANCIBLE_SET_FACT_MODULE_H
+#define ANCIBLE_SET_FACT_MODULE_H
+
+#include "../core/context.h"
+#include "module.h"
+
+/**
+ * Execute the set_fact module
+ * 
+ * Sets variables on the current host for the rest of the play:
+ * "NAME=VALUE [NAME=VALUE...]". Values keep their type: integers, booleans
+ * and flow-style lists and maps are stored as such.
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int set_fact_module_exec(context_t *context, const char *args, module_result_t *result);
+
+#endif /* ANCIBLE_SET_FACT_MODULE_H */
@@ -0,0 +1,54 @@
+#ifndef ANCIBLE_CONNECTION_H
+#define ANCIBLE_CONNECTION_H
+
+/**
+ * Initialize the SSH connection cache
+ *
+ * Creates a private directory for SSH control sockets. Once initialized,
+ * every SSH command multiplexes over one persistent master per user@host,
+ * shared by all plays of the run.
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int connection_cache_init(void);
+
+/**
+ * User ssh logs in as when a host sets no ansible_user
+ */
+#define CONNECTION_DEFAULT_USER "root"
+
+/**
+ * Check the port of a host (ansible_port)
+ *
+ * @param port Port as text
+ * @return 1 if it is a number from 1 to 65535, 0 otherwise
+ */
+int connection_port_valid(const char *port);
+
+/**
+ * Start opening a connection in the background
+ *
+ * Spawns the control master for user@host:port without waiting for it, so
+ * the handshake overlaps with whatever is currently running. Does nothing
+ * if that connection was already requested or the cache is disabled.
+ *
+ * @param user Remote user
+ * @param host Remote host
+ * @param port Remote port, or NULL for ssh's default
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int connection_prefetch(const char *user, const char *host, const char *port);
+
+/**
+ * Get the directory holding the control sockets
+ *
+ * @return Directory path, or NULL if the cache is not initialized
+ */
+const char *connection_control_dir(void);
+
+/**
+ * Close all cached connections and remove the control directory
+ */
+void connection_cache_cleanup(void);
+
+#endif /* ANCIBLE_CONNECTION_H */
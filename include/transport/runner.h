@@ -21,6 +21,15 @@ typedef struct {
  */
 int run_local(const char *cmd, command_result_t *result);
 
+/**
+ * Set the maximum number of commands running at once
+ * 
+ * Applies to every command started by any thread (the global fork limit).
+ * 
+ * @param limit Maximum number of concurrent commands (0 for no limit)
+ */
+void runner_set_fork_limit(int limit);
+
 /**
  * Run a command on a host (local or remote)
  * 
@@ -31,6 +40,30 @@ int run_local(const char *cmd, command_result_t *result);
  */
 int run_command(context_t *context, const char *cmd, command_result_t *result);
 
+/**
+ * Run several commands on a host in one round trip
+ *
+ * The commands are sent as a single script. Each one runs in its own shell
+ * and its exit code, stdout and stderr come back in a framed block:
+ * "@@ANCIBLE-ITEM <index> <rc> <stdout bytes> <stderr bytes>" followed by
+ * the raw output. Commands without a frame get exit code -1.
+ * 
+ * @param context Execution context with host information
+ * @param cmds Commands to run
+ * @param count Number of commands
+ * @param results Array of count results to fill, in command order
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int run_command_batch(context_t *context, const char **cmds, int count, command_result_t *results);
+
+/**
+ * Quote a string for use as a single shell word
+ * 
+ * @param str String to quote
+ * @return Newly allocated quoted string, or NULL on error
+ */
+char *shell_quote(const char *str);
+
 /**
  * Free resources used by a command result
  * 
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/core/context.h"
+#include "../include/core/inventory.h"
+#include "../include/core/symbol.h"
+#include "../include/modules/module.h"
+#include "../include/modules/add_host.h"
+
+/**
+ * Check whether an add_host argument is one of the module's own options
+ */
+static int is_option(const char *key) {
+    return strcmp(key, "name") == 0 || strcmp(key, "hostname") == 0 || strcmp(key, "host") == 0 ||
+           strcmp(key, "groups") == 0 || strcmp(key, "groupname") == 0 || strcmp(key, "group") == 0;
+}
+
+/**
+ * Execute the add_host module
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int add_host_module_exec(context_t *context, const char *args, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    module_result_init(result);
+    
+    if (!context->inventory) {
+        result->failed = 1;
+        result->msg = strdup("add_host requires an inventory");
+        return ANCIBLE_SUCCESS;
+    }
+    
+    module_args_t parsed;
+    if (module_args_parse(args, &parsed) != ANCIBLE_SUCCESS) {
+        result->failed = 1;
+        result->msg = strdup("Invalid add_host arguments");
+        return ANCIBLE_SUCCESS;
+    }
+    
+    const char *name = module_args_get(&parsed, "name");
+    const char *groups = module_args_get(&parsed, "groups");
+    name = name ? name : module_args_get(&parsed, "hostname");
+    name = name ? name : module_args_get(&parsed, "host");
+    groups = groups ? groups : module_args_get(&parsed, "groupname");
+    groups = groups ? groups : module_args_get(&parsed, "group");
+    if (!name || !*name) {
+        result->failed = 1;
+        result->msg = strdup("add_host requires a host name (name=HOST)");
+        module_args_free(&parsed);
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // Every other argument is a host variable
+    int keys[MAX_MODULE_ARGS];
+    const char *values[MAX_MODULE_ARGS];
+    int count = 0;
+    for (int i = 0; i < parsed.count; i++) {
+        if (is_option(parsed.keys[i])) {
+            continue;
+        }
+        keys[count] = symbol_intern(parsed.keys[i]);
+        values[count] = parsed.values[i];
+        if (keys[count++] < 0) {
+            module_args_free(&parsed);
+            return ANCIBLE_ERROR;
+        }
+    }
+    
+    int created = 0;
+    int id = inventory_runtime_add_host(context->inventory, name, count, keys, values, &created);
+    int changed = created;
+    char group[256];
+    for (const char *list = groups; id >= 0 && list && module_list_next(&list, group, sizeof(group));) {
+        int joined = inventory_runtime_add_group_host(context->inventory, id, group, NULL);
+        if (joined < 0) {
+            id = -1;
+        }
+        changed |= joined > 0;
+    }
+    
+    if (id < 0) {
+        result->failed = 1;
+        result->msg = strdup("Failed to add host to the inventory");
+    } else {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Host %s %s%s%s", name, created ? "added" : "updated",
+                 groups ? " in groups: " : "", groups ? groups : "");
+        result->changed = changed || count > 0;
+        result->msg = strdup(msg);
+    }
+    
+    module_args_free(&parsed);
+    return ANCIBLE_SUCCESS;
+}
@@ -7,6 +7,25 @@
 #include "../include/modules/module.h"
 #include "../include/modules/command.h"
 
+/**
+ * Set changed/failed and the message from the command's exit code
+ * 
+ * @param result Module result holding the command result
+ */
+static void command_set_status(module_result_t *result) {
+    if (result->cmd_result.exit_code != 0) {
+        result->failed = 1;
+        
+        // Create message with exit code
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Command failed with exit code %d", result->cmd_result.exit_code);
+        result->msg = strdup(msg);
+    } else {
+        result->changed = 1;
+        result->msg = strdup("Command executed successfully");
+    }
+}
+
 /**
  * Execute the command module
  * 
@@ -40,18 +59,69 @@ int command_module_exec(context_t *context, const char *args, module_result_t *r
         return ANCIBLE_SUCCESS;
     }
     
-    // Check command result
-    if (result->cmd_result.exit_code != 0) {
-        result->failed = 1;
-        
-        // Create message with exit code
-        char msg[128];
-        snprintf(msg, sizeof(msg), "Command failed with exit code %d", result->cmd_result.exit_code);
-        result->msg = strdup(msg);
-    } else {
-        result->changed = 1;
-        result->msg = strdup("Command executed successfully");
+    command_set_status(result);
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Execute the command module for several items in one round trip
+ * 
+ * @param context Execution context
+ * @param args Argument strings, one per item
+ * @param count Number of items
+ * @param results Array of count results to fill, in item order
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int command_module_exec_batch(context_t *context, const char **args, int count, module_result_t *results) {
+    if (!context || !args || !results || count <= 0) {
+        return ANCIBLE_ERROR;
     }
     
+    command_result_t *cmd_results = calloc((size_t)count, sizeof(command_result_t));
+    if (!cmd_results) {
+        fprintf(stderr, "Error: Failed to allocate memory for batch results\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    // Items without a command fail on their own, the rest share one script
+    const char **cmds = calloc((size_t)count, sizeof(char *));
+    int *slots = calloc((size_t)count, sizeof(int));
+    if (!cmds || !slots) {
+        fprintf(stderr, "Error: Failed to allocate memory for batch results\n");
+        free(cmd_results);
+        free(cmds);
+        free(slots);
+        return ANCIBLE_ERROR;
+    }
+    
+    int batched = 0;
+    for (int i = 0; i < count; i++) {
+        if (args[i]) {
+            cmds[batched] = args[i];
+            slots[batched++] = i;
+        }
+    }
+    
+    int ret = run_command_batch(context, cmds, batched, cmd_results);
+    
+    for (int i = 0; i < count; i++) {
+        results[i].failed = 1;
+        results[i].msg = strdup(args[i] ? "Failed to execute command" : "No command specified");
+    }
+    
+    for (int j = 0; ret == ANCIBLE_SUCCESS && j < batched; j++) {
+        module_result_t *result = &results[slots[j]];
+        free(result->msg);
+        result->msg = NULL;
+        result->failed = 0;
+        result->cmd_result = cmd_results[j];
+        command_set_status(result);
+    }
+    
+    free(cmd_results);
+    free(cmds);
+    free(slots);
+    
     return ANCIBLE_SUCCESS;
 }
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ancible.h"
+#include "../include/core/context.h"
+#include "../include/core/inventory.h"
+#include "../include/modules/module.h"
+#include "../include/modules/group_by.h"
+
+/**
+ * Execute the group_by module
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int group_by_module_exec(context_t *context, const char *args, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    module_result_init(result);
+    
+    if (!context->inventory) {
+        result->failed = 1;
+        result->msg = strdup("group_by requires an inventory");
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // "group_by: web" is short for "group_by: key=web"
+    module_args_t parsed;
+    const char *key = NULL;
+    if (args && !strchr(args, '=')) {
+        memset(&parsed, 0, sizeof(parsed));
+        key = args;
+    } else if (module_args_parse(args, &parsed) == ANCIBLE_SUCCESS) {
+        key = module_args_get(&parsed, "key");
+    } else {
+        result->failed = 1;
+        result->msg = strdup("Invalid group_by arguments");
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // Spaces are not allowed in group names
+    char group[256];
+    size_t len = 0;
+    for (const char *c = key; c && *c && len < sizeof(group) - 1; c++) {
+        group[len++] = (*c == ' ' || *c == '-') ? '_' : *c;
+    }
+    group[len] = '\0';
+    if (len == 0) {
+        result->failed = 1;
+        result->msg = strdup("group_by requires a group name (key=GROUP)");
+        module_args_free(&parsed);
+        return ANCIBLE_SUCCESS;
+    }
+    
+    const char *parents = module_args_get(&parsed, "parents");
+    int changed = 0;
+    int ret = 0;
+    char parent[256];
+    if (parents) {
+        for (const char *list = parents; ret >= 0 && module_list_next(&list, parent, sizeof(parent));) {
+            ret = inventory_runtime_add_group_host(context->inventory, context->host->id, group, parent);
+            changed |= ret > 0;
+        }
+    } else {
+        ret = inventory_runtime_add_group_host(context->inventory, context->host->id, group, NULL);
+        changed = ret > 0;
+    }
+    
+    if (ret < 0) {
+        result->failed = 1;
+        result->msg = strdup("Failed to add host to group");
+    } else {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Host %s %s group %s", context->host->name,
+                 changed ? "added to" : "already in", group);
+        result->changed = changed;
+        result->msg = strdup(msg);
+    }
+    
+    module_args_free(&parsed);
+    return ANCIBLE_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "../include/ancible.h"
 #include "../include/modules/module.h"
 
@@ -30,9 +31,167 @@ void module_result_free(module_result_t *result) {
     free(result->msg);
     result->msg = NULL;
     
+    free(result->item);
+    result->item = NULL;
+    
+    for (int i = 0; i < result->item_count; i++) {
+        module_result_free(&result->items[i]);
+    }
+    free(result->items);
+    result->items = NULL;
+    result->item_count = 0;
+    
+    // Registered output is freed with the context that holds it
+    if (result->registered) {
+        result->cmd_result.stdout_data = NULL;
+        result->cmd_result.stderr_data = NULL;
+        result->registered = 0;
+    }
     command_result_free(&result->cmd_result);
 }
 
+/**
+ * Parse "key=value" module arguments
+ * 
+ * @param args Argument string (may be NULL)
+ * @param parsed Pointer to the structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int module_args_parse(const char *args, module_args_t *parsed) {
+    memset(parsed, 0, sizeof(module_args_t));
+    if (!args) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // Unquoting only shrinks the text, so it is rewritten into one buffer
+    parsed->buffer = malloc(strlen(args) + 1);
+    if (!parsed->buffer) {
+        fprintf(stderr, "Error: Failed to allocate memory for module arguments\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    const char *in = args;
+    char *out = parsed->buffer;
+    for (;;) {
+        while (isspace((unsigned char)*in)) in++;
+        if (!*in) {
+            break;
+        }
+        
+        // Find the word's key, if it has one
+        const char *equals = in;
+        while (*equals && *equals != '=' && !isspace((unsigned char)*equals)) equals++;
+        int has_key = *equals == '=' && equals != in;
+        
+        if (has_key) {
+            if (parsed->count == MAX_MODULE_ARGS) {
+                fprintf(stderr, "Error: Too many module arguments (at most %d)\n", MAX_MODULE_ARGS);
+                module_args_free(parsed);
+                return ANCIBLE_ERROR;
+            }
+            parsed->keys[parsed->count] = out;
+            memcpy(out, in, (size_t)(equals - in));
+            out += equals - in;
+            *out++ = '\0';
+            parsed->values[parsed->count++] = out;
+            in = equals + 1;
+        } else if (parsed->count > 0) {
+            // Continue the previous value, which ends right before out
+            out[-1] = ' ';
+        } else {
+            fprintf(stderr, "Error: Expected key=value module argument, got '%s'\n", args);
+            module_args_free(parsed);
+            return ANCIBLE_ERROR;
+        }
+        
+        char quote = '\0';
+        while (*in && (quote || !isspace((unsigned char)*in))) {
+            if (quote && *in == quote) {
+                quote = '\0';
+            } else if (!quote && (*in == '"' || *in == '\'')) {
+                quote = *in;
+            } else {
+                *out++ = *in;
+            }
+            in++;
+        }
+        if (quote) {
+            fprintf(stderr, "Error: Unterminated quote in module arguments: %s\n", args);
+            module_args_free(parsed);
+            return ANCIBLE_ERROR;
+        }
+        *out++ = '\0';
+    }
+    
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Get a parsed module argument
+ * 
+ * @param parsed Parsed arguments
+ * @param key Argument name
+ * @return Argument value, or NULL if not given
+ */
+const char *module_args_get(const module_args_t *parsed, const char *key) {
+    // The last occurrence wins, like for repeated YAML keys
+    for (int i = parsed->count - 1; i >= 0; i--) {
+        if (strcmp(parsed->keys[i], key) == 0) {
+            return parsed->values[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get the next item of a list argument ("a,b" or "[a, b]")
+ * 
+ * @param list Pointer to the rest of the list, advanced past the item
+ * @param item Buffer receiving the item (without spaces and quotes)
+ * @param size Size of the buffer
+ * @return 1 if an item was read, 0 at the end of the list
+ */
+int module_list_next(const char **list, char *item, size_t size) {
+    const char *in = *list;
+    
+    for (;;) {
+        while (*in == ',' || *in == '[' || *in == ']' || isspace((unsigned char)*in)) in++;
+        if (!*in) {
+            *list = in;
+            return 0;
+        }
+        
+        const char *end = in;
+        while (*end && *end != ',' && *end != ']') end++;
+        *list = end;
+        
+        // Trim trailing spaces and surrounding quotes
+        const char *last = end;
+        while (last > in && isspace((unsigned char)last[-1])) last--;
+        if (last - in >= 2 && (*in == '"' || *in == '\'') && last[-1] == *in) {
+            in++;
+            last--;
+        }
+        if (last > in) {
+            size_t len = (size_t)(last - in) < size - 1 ? (size_t)(last - in) : size - 1;
+            memcpy(item, in, len);
+            item[len] = '\0';
+            return 1;
+        }
+        in = end;
+    }
+}
+
+/**
+ * Free resources used by parsed module arguments
+ * 
+ * @param parsed Parsed arguments
+ */
+void module_args_free(module_args_t *parsed) {
+    free(parsed->buffer);
+    memset(parsed, 0, sizeof(module_args_t));
+}
+
 /**
  * Print module result (for debugging)
  * 
@@ -49,6 +208,10 @@ void module_result_print(const module_result_t *result) {
     printf("  Skipped: %s\n", result->skipped ? "yes" : "no");
     printf("  Message: %s\n", result->msg ? result->msg : "(none)");
     
+    if (result->item) {
+        printf("  Item: %s\n", result->item);
+    }
+    
     if (result->cmd_result.stdout_data || result->cmd_result.stderr_data) {
         printf("  Command Result:\n");
         printf("    Exit Code: %d\n", result->cmd_result.exit_code);
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/ancible.h"
+#include "../include/core/context.h"
+#include "../include/core/symbol.h"
+#include "../include/core/value.h"
+#include "../include/modules/module.h"
+#include "../include/modules/set_fact.h"
+
+/**
+ * Check whether a text is a valid variable name
+ * 
+ * @param name Name to check
+ * @return 1 if it is, 0 otherwise
+ */
+static int fact_name_valid(const char *name) {
+    if (!isalpha((unsigned char)name[0]) && name[0] != '_') {
+        return 0;
+    }
+    for (const char *c = name; *c; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Execute the set_fact module
+ * 
+ * @param context Execution context
+ * @param args String containing module arguments
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int set_fact_module_exec(context_t *context, const char *args, module_result_t *result) {
+    if (!context || !result) {
+        return ANCIBLE_ERROR;
+    }
+    
+    module_result_init(result);
+    
+    module_args_t parsed;
+    if (module_args_parse(args, &parsed) != ANCIBLE_SUCCESS) {
+        result->failed = 1;
+        result->msg = strdup("Invalid set_fact arguments");
+        return ANCIBLE_SUCCESS;
+    }
+    if (parsed.count == 0) {
+        result->failed = 1;
+        result->msg = strdup("set_fact requires at least one NAME=VALUE argument");
+        module_args_free(&parsed);
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // Names are checked first, so a bad one sets nothing
+    for (int i = 0; i < parsed.count; i++) {
+        if (!fact_name_valid(parsed.keys[i])) {
+            char msg[512];
+            snprintf(msg, sizeof(msg), "Invalid fact name '%s'", parsed.keys[i]);
+            result->failed = 1;
+            result->msg = strdup(msg);
+            module_args_free(&parsed);
+            return ANCIBLE_SUCCESS;
+        }
+    }
+    
+    // Values are typed once here, in the host's arena, and read as they are afterwards
+    for (int i = 0; i < parsed.count; i++) {
+        const value_t *value = value_parse(&context->arena, parsed.values[i]);
+        int key = symbol_intern(parsed.keys[i]);
+        if (!value || key < 0 || context_set_value_id(context, key, value) != ANCIBLE_SUCCESS) {
+            result->failed = 1;
+            result->msg = strdup("Failed to set fact");
+            module_args_free(&parsed);
+            return ANCIBLE_SUCCESS;
+        }
+    }
+    
+    char msg[512];
+    snprintf(msg, sizeof(msg), "Set %d fact%s on %s", parsed.count, parsed.count == 1 ? "" : "s",
+             context->host->name);
+    result->msg = strdup(msg);
+    
+    module_args_free(&parsed);
+    return ANCIBLE_SUCCESS;
+}
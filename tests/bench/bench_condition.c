@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/ancible.h"
+#include "../../include/core/condition.h"
+#include "../../include/core/context.h"
+#include "../../include/core/symbol.h"
+#include "../../include/core/template.h"
+
+#define DEFAULT_HOSTS 1000
+#define ROUNDS 200
+
+/**
+ * Get the elapsed time between two timestamps
+ *
+ * @param start Start timestamp
+ * @param end End timestamp
+ * @return Elapsed time in milliseconds
+ */
+static double elapsed_ms(struct timespec start, struct timespec end) {
+    return (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+           (double)(end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+/**
+ * Time a condition through the string path, compiled, and batched across hosts
+ *
+ * The string path is what tasks did before conditions were compiled:
+ * render the condition as a template, then parse the text.
+ *
+ * @param source Condition text
+ * @param contexts Contexts of the hosts
+ * @param host_count Number of hosts
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int bench_condition(const char *source, context_t **contexts, int host_count) {
+    template_t *template = template_compile(source);
+    condition_t *condition = condition_compile(source);
+    if (!template || !condition) {
+        fprintf(stderr, "Error: Failed to compile '%s'\n", source);
+        template_free(template);
+        condition_free(condition);
+        return ANCIBLE_ERROR;
+    }
+
+    struct timespec start, end;
+    long evaluations = (long)ROUNDS * host_count;
+    int matched_string = 0;
+    int matched_compiled = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < host_count; i++) {
+            const char *text = template_render(template, contexts[i], &contexts[i]->render);
+            matched_string += text && condition_evaluate(contexts[i], text) == 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double string_ms = elapsed_ms(start, end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < host_count; i++) {
+            matched_compiled += condition_eval(condition, contexts[i]) == 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double compiled_ms = elapsed_ms(start, end);
+
+    bitset_t holds;
+    bitset_t fails;
+    bitset_init(&holds);
+    bitset_init(&fails);
+    int matched_batch = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < ROUNDS; round++) {
+        if (condition_eval_batch(condition, (const context_t *const *)contexts, host_count, &holds, &fails) ==
+            ANCIBLE_SUCCESS) {
+            matched_batch += bitset_count(&holds);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double batch_ms = elapsed_ms(start, end);
+
+    printf("%-24s string %6.2f M/s, compiled %7.2f M/s (%.1fx), batch %7.2f M/s (%.1fx, %d/%d matched)\n",
+           source, evaluations / string_ms / 1000.0, evaluations / compiled_ms / 1000.0, string_ms / compiled_ms,
+           evaluations / batch_ms / 1000.0, string_ms / batch_ms, matched_compiled / ROUNDS, matched_string / ROUNDS);
+
+    bitset_free(&holds);
+    bitset_free(&fails);
+    template_free(template);
+    condition_free(condition);
+    return matched_string == matched_compiled && matched_batch == matched_compiled ? ANCIBLE_SUCCESS : ANCIBLE_ERROR;
+}
+
+int main(int argc, char *argv[]) {
+    int host_count = argc > 1 ? atoi(argv[1]) : DEFAULT_HOSTS;
+    if (host_count <= 0) {
+        fprintf(stderr, "Usage: %s [HOSTS]\n", argv[0]);
+        return 1;
+    }
+
+    play_t play;
+    memset(&play, 0, sizeof(play));
+    host_t *hosts = calloc((size_t)host_count, sizeof(host_t));
+    context_t **contexts = calloc((size_t)host_count, sizeof(context_t *));
+    char (*names)[32] = calloc((size_t)host_count, sizeof(*names));
+    if (!hosts || !contexts || !names) {
+        fprintf(stderr, "Error: Failed to allocate memory for hosts\n");
+        return 1;
+    }
+
+    // Every host has a port and an environment of its own
+    char port[16];
+    for (int i = 0; i < host_count; i++) {
+        snprintf(names[i], sizeof(names[i]), "host%06d", i);
+        hosts[i].name = names[i];
+        hosts[i].id = i;
+        contexts[i] = context_create(&hosts[i], &play, 0);
+        if (!contexts[i]) {
+            fprintf(stderr, "Error: Failed to create context\n");
+            return 1;
+        }
+        snprintf(port, sizeof(port), "%d", i % 2 ? 8080 : 443);
+        context_set_var(contexts[i], "port", port);
+        context_set_var(contexts[i], "env", i % 10 ? "staging" : "prod");
+        context_set_var(contexts[i], "enabled", i % 4 ? "true" : "false");
+    }
+
+    printf("%d hosts, %d rounds (millions of evaluations per second)\n", host_count, ROUNDS);
+    static const char *const sources[] = {
+        "true",
+        "${enabled}",
+        "{{ env }} != prod",
+        "{{ port }} == 8080",
+        "{{ port }} > 1024"
+    };
+    int result = ANCIBLE_SUCCESS;
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        if (bench_condition(sources[i], contexts, host_count) != ANCIBLE_SUCCESS) {
+            fprintf(stderr, "Error: String, compiled and batch results differ for '%s'\n", sources[i]);
+            result = ANCIBLE_ERROR;
+        }
+    }
+
+    for (int i = 0; i < host_count; i++) {
+        context_free(contexts[i]);
+    }
+    free(contexts);
+    free(hosts);
+    free(names);
+    symbol_cleanup();
+
+    return result == ANCIBLE_SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../include/ancible.h"
+#include "../../include/core/inventory.h"
+#include "../../include/core/inventory_source.h"
+#include "../../include/core/pattern.h"
+#include "../../include/core/snapshot.h"
+
+#define DEFAULT_HOSTS 100000
+#define HOSTS_PER_GROUP 1000
+
+/**
+ * Get the elapsed time between two timestamps
+ *
+ * @param start Start timestamp
+ * @param end End timestamp
+ * @return Elapsed time in milliseconds
+ */
+static double elapsed_ms(struct timespec start, struct timespec end) {
+    return (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+           (double)(end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+/**
+ * Write a generated inventory with one group per HOSTS_PER_GROUP hosts
+ *
+ * @param path Path of the file to write
+ * @param host_count Number of hosts to generate
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_inventory(const char *path, int host_count) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to create %s\n", path);
+        return ANCIBLE_ERROR;
+    }
+
+    for (int i = 0; i < host_count; i++) {
+        if (i % HOSTS_PER_GROUP == 0) {
+            fprintf(file, "[group%04d]\n", i / HOSTS_PER_GROUP);
+        }
+        fprintf(file, "host%06d ansible_host=10.%d.%d.%d\n", i, (i >> 16) & 255, (i >> 8) & 255, i & 255);
+    }
+
+    fclose(file);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Write the same fleet as JSON, in the dynamic inventory script format
+ *
+ * @param path Path of the file to write
+ * @param host_count Number of hosts to generate
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_json_inventory(const char *path, int host_count) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to create %s\n", path);
+        return ANCIBLE_ERROR;
+    }
+
+    fprintf(file, "{\n");
+    for (int i = 0; i < host_count; i++) {
+        if (i % HOSTS_PER_GROUP == 0) {
+            fprintf(file, "%s  \"group%04d\": {\"hosts\": [", i ? "]},\n" : "", i / HOSTS_PER_GROUP);
+        }
+        fprintf(file, "%s\"host%06d\"", i % HOSTS_PER_GROUP ? ", " : "", i);
+    }
+    fprintf(file, "]},\n  \"_meta\": {\"hostvars\": {\n");
+    for (int i = 0; i < host_count; i++) {
+        fprintf(file, "    \"host%06d\": {\"ansible_host\": \"10.%d.%d.%d\"}%s\n",
+                i, (i >> 16) & 255, (i >> 8) & 255, i & 255, i + 1 < host_count ? "," : "");
+    }
+    fprintf(file, "  }}\n}\n");
+
+    fclose(file);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Write the same fleet declared with one host range per group
+ *
+ * @param path Path of the file to write
+ * @param host_count Number of hosts to generate
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int write_range_inventory(const char *path, int host_count) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to create %s\n", path);
+        return ANCIBLE_ERROR;
+    }
+
+    for (int i = 0; i < host_count; i += HOSTS_PER_GROUP) {
+        int last = i + HOSTS_PER_GROUP < host_count ? i + HOSTS_PER_GROUP - 1 : host_count - 1;
+        fprintf(file, "[group%04d]\nhost[%06d:%06d]\n", i / HOSTS_PER_GROUP, i, last);
+    }
+
+    fclose(file);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Benchmark inventory loading and lookups
+ *
+ * Usage: bench_inventory [HOSTS]
+ */
+int main(int argc, char *argv[]) {
+    int host_count = argc > 1 ? atoi(argv[1]) : DEFAULT_HOSTS;
+    if (host_count <= 0) {
+        fprintf(stderr, "Usage: %s [HOSTS]\n", argv[0]);
+        return 1;
+    }
+
+    char path[] = "/tmp/ancible-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    if (write_inventory(path, host_count) != ANCIBLE_SUCCESS) {
+        unlink(path);
+        return 1;
+    }
+
+    struct timespec start, end;
+    inventory_t inventory;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = inventory_load(path, &inventory);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    unlink(path);
+
+    if (result != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to load generated inventory\n");
+        return 1;
+    }
+    printf("load:          %8.2f ms (%d hosts, %d groups)\n",
+           elapsed_ms(start, end), inventory.host_count, inventory.group_count);
+
+    // Look every host up by name, in a scattered order
+    char name[32];
+    int found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < host_count; i++) {
+        snprintf(name, sizeof(name), "host%06d", (int)(((long)i * 7919) % host_count));
+        found += inventory_find_host(&inventory, name) != NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("host lookups:  %8.2f ms (%d found, %.1f ns each)\n",
+           elapsed_ms(start, end), found, elapsed_ms(start, end) * 1000000.0 / host_count);
+
+    int group_count = inventory.group_count - 1;  // Generated groups, without "all"
+    found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < host_count; i++) {
+        snprintf(name, sizeof(name), "group%04d", i % group_count);
+        found += inventory_find_group(&inventory, name) != NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("group lookups: %8.2f ms (%d found, %.1f ns each)\n",
+           elapsed_ms(start, end), found, elapsed_ms(start, end) * 1000000.0 / host_count);
+
+    // Set algebra over whole groups, the common shape of play patterns
+    const char *pattern = "group0001:group0002:group0003:&all:!group0002:!host001500";
+    bitset_t hosts;
+    bitset_init(&hosts);
+    int rounds = 1000;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        pattern_resolve(&inventory, pattern, &hosts);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("pattern:       %8.2f us per resolve (%d hosts matched)\n",
+           elapsed_ms(start, end) * 1000.0 / rounds, bitset_count(&hosts));
+    bitset_free(&hosts);
+
+    // Binary snapshot, as used by the dynamic inventory cache
+    char snapshot[sizeof(path) + 8];
+    snprintf(snapshot, sizeof(snapshot), "%s.snap", path);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = snapshot_save(&inventory, snapshot);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result == ANCIBLE_SUCCESS) {
+        printf("snapshot save: %8.2f ms\n", elapsed_ms(start, end));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    inventory_free(&inventory);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("free:          %8.2f ms\n", elapsed_ms(start, end));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = snapshot_load(snapshot, &inventory);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    unlink(snapshot);
+    if (result != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to load inventory snapshot\n");
+        return 1;
+    }
+    printf("snapshot load: %8.2f ms (%d hosts)\n", elapsed_ms(start, end), inventory.host_count);
+    inventory_free(&inventory);
+
+    // The same fleet as JSON, parsed without the cache
+    char json_path[sizeof(path) + 8];
+    snprintf(json_path, sizeof(json_path), "%s.json", path);
+    if (write_json_inventory(json_path, host_count) != ANCIBLE_SUCCESS) {
+        return 1;
+    }
+    setenv("ANCIBLE_INVENTORY_CACHE_TTL", "0", 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = inventory_load_source(json_path, &inventory);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    unlink(json_path);
+    if (result != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to load generated JSON inventory\n");
+        return 1;
+    }
+    printf("json load:     %8.2f ms (%d hosts)\n", elapsed_ms(start, end), inventory.host_count);
+    inventory_free(&inventory);
+
+    // Same fleet with ranges: no per-host records or strings at load time
+    if (write_range_inventory(path, host_count) != ANCIBLE_SUCCESS) {
+        unlink(path);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = inventory_load(path, &inventory);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    unlink(path);
+
+    if (result != ANCIBLE_SUCCESS) {
+        fprintf(stderr, "Error: Failed to load generated range inventory\n");
+        return 1;
+    }
+    printf("range load:    %8.2f ms (%d hosts, %d ranges)\n",
+           elapsed_ms(start, end), inventory.host_count, inventory.range_count);
+
+    found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < host_count; i++) {
+        snprintf(name, sizeof(name), "host%06d", (int)(((long)i * 7919) % host_count));
+        found += inventory_host_id(&inventory, name) >= 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("range lookups: %8.2f ms (%d found, %.1f ns each)\n",
+           elapsed_ms(start, end), found, elapsed_ms(start, end) * 1000000.0 / host_count);
+
+    inventory_free(&inventory);
+
+    return 0;
+}
@@ -4,6 +4,9 @@
 #include <assert.h>
 #include "../../include/ancible.h"
 #include "../../include/cli/args.h"
+#include "../../include/cli/extra_vars.h"
+#include "../../include/core/symbol.h"
+#include "../../include/core/value.h"
 
 /**
  * Test for args.c functionality
@@ -78,12 +81,147 @@ int main(void) {
         result = parse_args(4, argv, &options);
         assert(result == ANCIBLE_SUCCESS);
         assert(strcmp(options.inventory_path, "custom_inventory.ini") == 0);
+        assert(options.inventory_count == 1);
+        
+        // Several -i options are kept in order, replacing the default
+        result = parse_args(6, (char *[]){"ancible-playbook", "-i", "dc1.ini", "-i", "dc2", "test.yml"}, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.inventory_count == 2);
+        assert(strcmp(options.inventory_paths[0], "dc1.ini") == 0);
+        assert(strcmp(options.inventory_paths[1], "dc2") == 0);
+        
+        result = parse_args(2, (char *[]){"ancible-playbook", "test.yml"}, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.inventory_count == 1 && strcmp(options.inventory_paths[0], "inventory.ini") == 0);
         
         // Clean up
         remove("test.yml");
         printf("OK\n");
     }
     
+    // Test 6: Forks flag
+    {
+        printf("Test 6: Testing forks flag... ");
+        char *argv[] = {"ancible-playbook", "-f", "20", "test.yml"};
+        char *bad_argv[] = {"ancible-playbook", "--forks", "0", "test.yml"};
+        
+        // Create a test file
+        FILE *fp = fopen("test.yml", "w");
+        assert(fp != NULL);
+        fprintf(fp, "# Test playbook\n");
+        fclose(fp);
+        
+        result = parse_args(4, argv, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.forks == 20);
+        
+        result = parse_args(4, bad_argv, &options);
+        assert(result == ANCIBLE_ERROR);
+        
+        // Clean up
+        remove("test.yml");
+        printf("OK\n");
+    }
+    
+    // Test 7: Limit flag
+    {
+        printf("Test 7: Testing limit flag... ");
+        char *argv[] = {"ancible-playbook", "--limit", "web:!web01", "test.yml"};
+        char *short_argv[] = {"ancible-playbook", "test.yml", "-l", "db"};
+        char *bad_argv[] = {"ancible-playbook", "test.yml", "-l"};
+        
+        FILE *fp = fopen("test.yml", "w");
+        assert(fp != NULL);
+        fprintf(fp, "# Test playbook\n");
+        fclose(fp);
+        
+        result = parse_args(4, argv, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(strcmp(options.limit, "web:!web01") == 0);
+        
+        result = parse_args(4, short_argv, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(strcmp(options.limit, "db") == 0);
+        
+        result = parse_args(3, bad_argv, &options);
+        assert(result == ANCIBLE_ERROR);
+        
+        remove("test.yml");
+        printf("OK\n");
+    }
+    
+    // Test 8: Flush cache flag
+    {
+        printf("Test 8: Testing flush cache flag... ");
+        char *argv[] = {"ancible-playbook", "--flush-cache", "test.yml"};
+        
+        FILE *fp = fopen("test.yml", "w");
+        assert(fp != NULL);
+        fprintf(fp, "# Test playbook\n");
+        fclose(fp);
+        
+        result = parse_args(3, argv, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.flush_cache == 1);
+        
+        result = parse_args(2, (char *[]){"ancible-playbook", "test.yml"}, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.flush_cache == 0);
+        
+        remove("test.yml");
+        printf("OK\n");
+    }
+    
+    // Test 9: Extra variables
+    {
+        printf("Test 9: Testing extra variables... ");
+        char *argv[] = {"ancible-playbook", "-e", "port=8080 debug=yes", "test.yml",
+                        "--extra-vars", "@vars.json", "-e", "port=9090"};
+        char *bad_argv[] = {"ancible-playbook", "test.yml", "-e"};
+        
+        FILE *fp = fopen("test.yml", "w");
+        assert(fp != NULL);
+        fprintf(fp, "# Test playbook\n");
+        fclose(fp);
+        fp = fopen("vars.json", "w");
+        assert(fp != NULL);
+        fprintf(fp, "{\"packages\": [\"nginx\", \"git\"], \"limits\": {\"cpu\": 2}}\n");
+        fclose(fp);
+        
+        assert(parse_args(3, bad_argv, &options) == ANCIBLE_ERROR);
+        result = parse_args(8, argv, &options);
+        assert(result == ANCIBLE_SUCCESS);
+        assert(options.extra_var_count == 3);
+        assert(strcmp(options.extra_vars[1], "@vars.json") == 0);
+        
+        // Values keep their type, and the last source wins
+        arena_t arena = { 0 };
+        scope_t *scope = NULL;
+        result = extra_vars_load(options.extra_vars, options.extra_var_count, &arena, &scope);
+        assert(result == ANCIBLE_SUCCESS && scope != NULL);
+        const variable_t *var = scope_find(scope, symbol_find("port"));
+        assert(var && var->typed->type == VALUE_INT && var->typed->integer == 9090);
+        var = scope_find(scope, symbol_find("debug"));
+        assert(var && var->typed->type == VALUE_BOOL && strcmp(var->value, "True") == 0);
+        var = scope_find(scope, symbol_find("packages"));
+        assert(var && var->typed->type == VALUE_LIST && var->typed->count == 2);
+        assert(strcmp(var->value, "[nginx, git]") == 0);
+        var = scope_find(scope, symbol_find("limits"));
+        assert(var && value_map_get(var->typed, "cpu")->integer == 2);
+        scope_release(scope);
+        
+        // Sources must be maps or NAME=VALUE pairs
+        const char *list_source[] = { "{not closed", "novalue" };
+        assert(extra_vars_load(list_source, 1, &arena, &scope) == ANCIBLE_ERROR);
+        assert(extra_vars_load(list_source + 1, 1, &arena, &scope) == ANCIBLE_ERROR);
+        arena_free(&arena);
+        
+        remove("test.yml");
+        remove("vars.json");
+        symbol_cleanup();
+        printf("OK\n");
+    }
+    
     printf("All args.c tests passed!\n");
     return 0;
 }
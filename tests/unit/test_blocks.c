@@ -7,6 +7,8 @@
 #include "../../include/core/executor.h"
 #include "../../include/modules/module.h"
 #include "../../include/core/inventory.h"
+#include "../../include/core/context.h"
+#include "../../include/core/symbol.h"
 
 /**
  * Test parsing a playbook with blocks
@@ -25,20 +27,22 @@ void test_parse_blocks(void) {
     assert(result == ANCIBLE_SUCCESS);
     
     // Verify hosts
-    assert(playbook.hosts != NULL);
-    assert(strcmp(playbook.hosts, "all") == 0);
+    assert(playbook.play_count == 1);
+    play_t *play = &playbook.plays[0];
+    assert(play->hosts != NULL);
+    assert(strcmp(play->hosts, "all") == 0);
     
     // Print the playbook structure for debugging
     playbook_print(&playbook);
     
     // Verify that we have tasks
-    assert(playbook.task_count > 0);
+    assert(play->task_count > 0);
     
     // Find the basic block (Task 3 in the output)
     int basic_block_idx = -1;
-    for (int i = 0; i < playbook.task_count; i++) {
-        if (playbook.tasks[i].type == TASK_TYPE_BLOCK && 
-            playbook.tasks[i].subtask_count == 2) {
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].type == TASK_TYPE_BLOCK && 
+            play->tasks[i].subtask_count == 2) {
             basic_block_idx = i;
             break;
         }
@@ -48,22 +52,37 @@ void test_parse_blocks(void) {
     assert(basic_block_idx >= 0);
     
     // Verify that the basic block has subtasks
-    assert(playbook.tasks[basic_block_idx].subtask_count > 0);
+    assert(play->tasks[basic_block_idx].subtask_count > 0);
+    
+    // The block's when condition belongs to the block, not its last subtask
+    int conditional_block_idx = -1;
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].name && strcmp(play->tasks[i].name, "Conditional block") == 0) {
+            conditional_block_idx = i;
+            break;
+        }
+    }
+    assert(conditional_block_idx >= 0);
+    assert(play->tasks[conditional_block_idx].type == TASK_TYPE_BLOCK);
+    assert(play->tasks[conditional_block_idx].when != NULL);
+    for (int i = 0; i < play->tasks[conditional_block_idx].subtask_count; i++) {
+        assert(play->tasks[play->tasks[conditional_block_idx].subtask_indices[i]].when == NULL);
+    }
     
     // Find the error handling block (Task 11 in the output)
     int error_block_idx = -1;
-    for (int i = 0; i < playbook.task_count; i++) {
-        if (playbook.tasks[i].type == TASK_TYPE_BLOCK && 
-            playbook.tasks[i].subtask_count == 2 &&
-            playbook.tasks[i].subtask_indices[0] >= 0) {
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].type == TASK_TYPE_BLOCK && 
+            play->tasks[i].subtask_count == 2 &&
+            play->tasks[i].subtask_indices[0] >= 0) {
             // Check if this block has rescue and always blocks
             int has_rescue = 0;
             int has_always = 0;
-            for (int j = 0; j < playbook.task_count; j++) {
-                if (playbook.tasks[j].parent_idx == i) {
-                    if (playbook.tasks[j].type == TASK_TYPE_RESCUE) {
+            for (int j = 0; j < play->task_count; j++) {
+                if (play->tasks[j].parent_idx == i) {
+                    if (play->tasks[j].type == TASK_TYPE_RESCUE) {
                         has_rescue = 1;
-                    } else if (playbook.tasks[j].type == TASK_TYPE_ALWAYS) {
+                    } else if (play->tasks[j].type == TASK_TYPE_ALWAYS) {
                         has_always = 1;
                     }
                 }
@@ -80,9 +99,9 @@ void test_parse_blocks(void) {
     
     // Find the rescue block
     int rescue_block_idx = -1;
-    for (int i = 0; i < playbook.task_count; i++) {
-        if (playbook.tasks[i].type == TASK_TYPE_RESCUE && 
-            playbook.tasks[i].parent_idx == error_block_idx) {
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].type == TASK_TYPE_RESCUE && 
+            play->tasks[i].parent_idx == error_block_idx) {
             rescue_block_idx = i;
             break;
         }
@@ -93,9 +112,9 @@ void test_parse_blocks(void) {
     
     // Find the always block
     int always_block_idx = -1;
-    for (int i = 0; i < playbook.task_count; i++) {
-        if (playbook.tasks[i].type == TASK_TYPE_ALWAYS && 
-            playbook.tasks[i].parent_idx == error_block_idx) {
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].type == TASK_TYPE_ALWAYS && 
+            play->tasks[i].parent_idx == error_block_idx) {
             always_block_idx = i;
             break;
         }
@@ -105,10 +124,10 @@ void test_parse_blocks(void) {
     assert(always_block_idx >= 0);
     
     // Verify that the rescue block has subtasks
-    assert(playbook.tasks[rescue_block_idx].subtask_count > 0);
+    assert(play->tasks[rescue_block_idx].subtask_count > 0);
     
     // Verify that the always block has subtasks
-    assert(playbook.tasks[always_block_idx].subtask_count > 0);
+    assert(play->tasks[always_block_idx].subtask_count > 0);
     
     // Clean up
     playbook_free(&playbook);
@@ -148,78 +167,84 @@ void test_execute_blocks(void) {
     // Register mock module with a different name
     assert(executor_register_module("mock", mock_module_exec) == ANCIBLE_SUCCESS);
     
-    // Create a simple playbook with blocks
-    playbook_t playbook;
-    memset(&playbook, 0, sizeof(playbook_t));
+    // Create a simple play with blocks
+    play_t play;
+    memset(&play, 0, sizeof(play_t));
     
     // Allocate tasks
-    playbook.tasks = malloc(10 * sizeof(task_t));
-    assert(playbook.tasks != NULL);
+    play.tasks = calloc(10, sizeof(task_t));
+    assert(play.tasks != NULL);
     
     // Initialize tasks
     for (int i = 0; i < 10; i++) {
-        playbook.tasks[i].name = NULL;
-        playbook.tasks[i].module = NULL;
-        playbook.tasks[i].when = NULL;
-        playbook.tasks[i].type = TASK_TYPE_NORMAL;
-        playbook.tasks[i].parent_idx = -1;
-        playbook.tasks[i].subtask_count = 0;
-        playbook.tasks[i].subtask_indices = NULL;
+        play.tasks[i].name = NULL;
+        play.tasks[i].module = NULL;
+        play.tasks[i].args = NULL;
+        play.tasks[i].when = NULL;
+        play.tasks[i].type = TASK_TYPE_NORMAL;
+        play.tasks[i].parent_idx = -1;
+        play.tasks[i].subtask_count = 0;
+        play.tasks[i].subtask_indices = NULL;
     }
     
     // Set up hosts
-    playbook.hosts = strdup("all");
+    play.hosts = strdup("all");
     
     // Task 0: Normal task
-    playbook.tasks[0].name = strdup("Normal task");
-    playbook.tasks[0].module = strdup("mock");
+    play.tasks[0].name = strdup("Normal task");
+    play.tasks[0].module = strdup("mock");
+    play.tasks[0].args = strdup("normal");
     
     // Task 1: Block
-    playbook.tasks[1].name = strdup("Test block");
-    playbook.tasks[1].type = TASK_TYPE_BLOCK;
-    playbook.tasks[1].subtask_indices = malloc(3 * sizeof(int));
-    playbook.tasks[1].subtask_count = 2;
-    playbook.tasks[1].subtask_indices[0] = 2;
-    playbook.tasks[1].subtask_indices[1] = 3;
+    play.tasks[1].name = strdup("Test block");
+    play.tasks[1].type = TASK_TYPE_BLOCK;
+    play.tasks[1].subtask_indices = malloc(3 * sizeof(int));
+    play.tasks[1].subtask_count = 2;
+    play.tasks[1].subtask_indices[0] = 2;
+    play.tasks[1].subtask_indices[1] = 3;
     
     // Task 2: Subtask 1 in block
-    playbook.tasks[2].name = strdup("Subtask 1");
-    playbook.tasks[2].module = strdup("mock");
-    playbook.tasks[2].parent_idx = 1;
+    play.tasks[2].name = strdup("Subtask 1");
+    play.tasks[2].module = strdup("mock");
+    play.tasks[2].args = strdup("succeed");
+    play.tasks[2].parent_idx = 1;
     
     // Task 3: Subtask 2 in block (will fail)
-    playbook.tasks[3].name = strdup("Subtask 2 (fail)");
-    playbook.tasks[3].module = strdup("mock");
-    playbook.tasks[3].parent_idx = 1;
+    play.tasks[3].name = strdup("Subtask 2 (fail)");
+    play.tasks[3].module = strdup("mock");
+    play.tasks[3].args = strdup("fail");
+    play.tasks[3].parent_idx = 1;
     
     // Task 4: Rescue block
-    playbook.tasks[4].name = strdup("Rescue block");
-    playbook.tasks[4].type = TASK_TYPE_RESCUE;
-    playbook.tasks[4].parent_idx = 1;
-    playbook.tasks[4].subtask_indices = malloc(2 * sizeof(int));
-    playbook.tasks[4].subtask_count = 1;
-    playbook.tasks[4].subtask_indices[0] = 5;
+    play.tasks[4].name = strdup("Rescue block");
+    play.tasks[4].type = TASK_TYPE_RESCUE;
+    play.tasks[4].parent_idx = 1;
+    play.tasks[4].subtask_indices = malloc(2 * sizeof(int));
+    play.tasks[4].subtask_count = 1;
+    play.tasks[4].subtask_indices[0] = 5;
     
     // Task 5: Rescue task
-    playbook.tasks[5].name = strdup("Rescue task");
-    playbook.tasks[5].module = strdup("mock");
-    playbook.tasks[5].parent_idx = 4;
+    play.tasks[5].name = strdup("Rescue task");
+    play.tasks[5].module = strdup("mock");
+    play.tasks[5].args = strdup("rescue");
+    play.tasks[5].parent_idx = 4;
     
     // Task 6: Always block
-    playbook.tasks[6].name = strdup("Always block");
-    playbook.tasks[6].type = TASK_TYPE_ALWAYS;
-    playbook.tasks[6].parent_idx = 1;
-    playbook.tasks[6].subtask_indices = malloc(2 * sizeof(int));
-    playbook.tasks[6].subtask_count = 1;
-    playbook.tasks[6].subtask_indices[0] = 7;
+    play.tasks[6].name = strdup("Always block");
+    play.tasks[6].type = TASK_TYPE_ALWAYS;
+    play.tasks[6].parent_idx = 1;
+    play.tasks[6].subtask_indices = malloc(2 * sizeof(int));
+    play.tasks[6].subtask_count = 1;
+    play.tasks[6].subtask_indices[0] = 7;
     
     // Task 7: Always task
-    playbook.tasks[7].name = strdup("Always task");
-    playbook.tasks[7].module = strdup("mock");
-    playbook.tasks[7].parent_idx = 6;
+    play.tasks[7].name = strdup("Always task");
+    play.tasks[7].module = strdup("mock");
+    play.tasks[7].args = strdup("always");
+    play.tasks[7].parent_idx = 6;
     
     // Set task count
-    playbook.task_count = 8;
+    play.task_count = 8;
     
     // Create a simple host
     host_t host;
@@ -228,7 +253,7 @@ void test_execute_blocks(void) {
     host.ansible_host = strdup("127.0.0.1");
     
     // Create context
-    context_t *context = context_create(&host, &playbook, 1);
+    context_t *context = context_create(&host, &play, 1);
     assert(context != NULL);
     
     // Execute normal task
@@ -249,21 +274,234 @@ void test_execute_blocks(void) {
     free(host.name);
     free(host.ansible_host);
     
-    for (int i = 0; i < playbook.task_count; i++) {
-        free(playbook.tasks[i].name);
-        free(playbook.tasks[i].module);
-        free(playbook.tasks[i].when);
-        free(playbook.tasks[i].subtask_indices);
+    for (int i = 0; i < play.task_count; i++) {
+        free(play.tasks[i].name);
+        free(play.tasks[i].module);
+        free(play.tasks[i].args);
+        free(play.tasks[i].when);
+        free(play.tasks[i].subtask_indices);
     }
     
-    free(playbook.tasks);
-    free(playbook.hosts);
+    free(play.tasks);
+    free(play.hosts);
     
     executor_cleanup();
     
     printf("Block execution tests passed!\n");
 }
 
+/**
+ * Find a task of a play by name
+ */
+static int find_task(const play_t *play, const char *name) {
+    for (int i = 0; i < play->task_count; i++) {
+        if (play->tasks[i].name && strcmp(play->tasks[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Test folding conditions every host shares before a play runs
+ */
+void test_fold_blocks(void) {
+    printf("Testing condition folding...\n");
+    
+    assert(executor_init() == ANCIBLE_SUCCESS);
+    assert(executor_register_module("mock", mock_module_exec) == ANCIBLE_SUCCESS);
+    
+    const char *path = "runtime/test_blocks_fold.yml";
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "- hosts: all\n"
+                  "  vars:\n"
+                  "    region: eu\n"
+                  "    tier: web\n"
+                  "    status: pending\n"
+                  "  tasks:\n"
+                  "    - name: Canary block\n"
+                  "      when: deploy_canary\n"
+                  "      block:\n"
+                  "        - name: Canary task\n"
+                  "          mock: canary\n"
+                  "    - name: Regional block\n"
+                  "      when: region == 'eu'\n"
+                  "      block:\n"
+                  "        - name: Outside the region\n"
+                  "          mock: fail\n"
+                  "          when: not deploy_canary and region != 'eu'\n"
+                  "        - name: Regional task\n"
+                  "          mock: eu\n"
+                  "          when: deploy_canary == false\n"
+                  "    - name: Registered\n"
+                  "      mock: registered\n"
+                  "      when: false\n"
+                  "      register: out\n"
+                  "    - name: Per host\n"
+                  "      mock: host\n"
+                  "      when: deploy_canary or inventory_hostname == 'web01'\n"
+                  "    - name: Shadowed\n"
+                  "      mock: shadowed\n"
+                  "      when: tier == 'web'\n"
+                  "    - name: Set tier\n"
+                  "      set_fact: tier=db\n"
+                  "    - name: Status\n"
+                  "      mock: status\n"
+                  "      register: status\n"
+                  "    - name: Pending\n"
+                  "      mock: pending\n"
+                  "      when: status == 'pending'\n");
+    fclose(file);
+    
+    playbook_t playbook;
+    assert(parse_playbook(path, &playbook) == ANCIBLE_SUCCESS);
+    play_t *play = &playbook.plays[0];
+    
+    variable_t canary = { "deploy_canary", "false", NULL, NULL };
+    const variable_t *extra[] = { &canary };
+    scope_t *extra_vars = scope_create(extra, 1);
+    assert(extra_vars != NULL);
+    executor_fold_play(play, extra_vars);
+    
+    // Extra and play variables fold; host variables, facts and registered tasks do not
+    assert(play->tasks[find_task(play, "Canary block")].when_static == TASK_WHEN_NEVER);
+    assert(play->tasks[find_task(play, "Regional block")].when_static == TASK_WHEN_ALWAYS);
+    assert(play->tasks[find_task(play, "Outside the region")].when_static == TASK_WHEN_NEVER);
+    assert(play->tasks[find_task(play, "Regional task")].when_static == TASK_WHEN_ALWAYS);
+    assert(play->tasks[find_task(play, "Registered")].when_static == TASK_WHEN_DYNAMIC);
+    assert(play->tasks[find_task(play, "Per host")].when_static == TASK_WHEN_DYNAMIC);
+    assert(play->tasks[find_task(play, "Shadowed")].when_static == TASK_WHEN_DYNAMIC);
+    assert(play->tasks[find_task(play, "Pending")].when_static == TASK_WHEN_DYNAMIC);
+    
+    // Folded conditions are not evaluated again: without the extra variables,
+    // deploy_canary would be undefined on the host
+    host_t host;
+    memset(&host, 0, sizeof(host_t));
+    host.name = "web01";
+    context_t *context = context_create(&host, play, 0);
+    assert(context != NULL);
+    module_result_t result;
+    module_result_init(&result);
+    assert(executor_run_task(context, find_task(play, "Regional block"), NULL, &result) == ANCIBLE_SUCCESS);
+    assert(result.failed == 0 && result.skipped == 0);
+    module_result_free(&result);
+    
+    // The extra variables change from run to run, so the play folds again
+    canary.value = "true";
+    executor_fold_play(play, extra_vars);
+    assert(play->tasks[find_task(play, "Canary block")].when_static == TASK_WHEN_ALWAYS);
+    assert(play->tasks[find_task(play, "Per host")].when_static == TASK_WHEN_ALWAYS);
+    
+    context_free(context);
+    scope_release(extra_vars);
+    playbook_free(&playbook);
+    remove(path);
+    executor_cleanup();
+    symbol_cleanup();
+    
+    printf("Condition folding tests passed!\n");
+}
+
+/**
+ * Test evaluating a task's condition for every host before dispatching it
+ */
+void test_batch_blocks(void) {
+    printf("Testing batch conditions...\n");
+    
+    assert(executor_init() == ANCIBLE_SUCCESS);
+    assert(executor_register_module("mock", mock_module_exec) == ANCIBLE_SUCCESS);
+    
+    const char *path = "runtime/test_blocks_batch.yml";
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "- hosts: all\n"
+                  "  tasks:\n"
+                  "    - name: High ports\n"
+                  "      when: \"{{ port }} > 1024\"\n"
+                  "      block:\n"
+                  "        - name: High port task\n"
+                  "          mock: high\n"
+                  "    - name: Registered\n"
+                  "      mock: registered\n"
+                  "      when: \"{{ port }} > 1024\"\n"
+                  "      register: out\n"
+                  "    - name: Looped\n"
+                  "      mock: \"{{ item }}\"\n"
+                  "      loop: [1, 2]\n"
+                  "      when: item == 2\n"
+                  "    - name: Folded\n"
+                  "      mock: folded\n"
+                  "      when: true\n");
+    fclose(file);
+    
+    playbook_t playbook;
+    assert(parse_playbook(path, &playbook) == ANCIBLE_SUCCESS);
+    play_t *play = &playbook.plays[0];
+    executor_fold_play(play, NULL);
+    
+    // The third host has no port, so its condition fails to evaluate
+    host_t hosts[3];
+    context_t *contexts[3];
+    static const char *const names[] = { "web01", "web02", "web03" };
+    for (int h = 0; h < 3; h++) {
+        memset(&hosts[h], 0, sizeof(host_t));
+        hosts[h].name = (char *)names[h];
+        contexts[h] = context_create(&hosts[h], play, 0);
+        assert(contexts[h] != NULL);
+    }
+    context_set_var(contexts[0], "port", "8080");
+    context_set_var(contexts[1], "port", "80");
+    
+    bitset_t skipped;
+    bitset_init(&skipped);
+    int block_idx = find_task(play, "High ports");
+    assert(executor_batch_condition(contexts, 3, block_idx, &skipped) == ANCIBLE_SUCCESS);
+    assert(bitset_count(&skipped) == 1 && bitset_test(&skipped, 1));
+    assert(contexts[0]->eligible == &play->tasks[block_idx]);
+    assert(contexts[1]->eligible == NULL && contexts[2]->eligible == NULL);
+    
+    // Eligible hosts run the task without evaluating the condition again
+    context_set_var(contexts[0], "port", "80");
+    module_result_t result;
+    module_result_init(&result);
+    assert(executor_run_task(contexts[0], block_idx, NULL, &result) == ANCIBLE_SUCCESS);
+    assert(result.skipped == 0 && contexts[0]->eligible == NULL);
+    module_result_free(&result);
+    
+    // The others are skipped without running it, and still register their result
+    context_set_var(contexts[0], "port", "8080");
+    int registered_idx = find_task(play, "Registered");
+    assert(executor_batch_condition(contexts, 3, registered_idx, &skipped) == ANCIBLE_SUCCESS);
+    assert(bitset_count(&skipped) == 1 && bitset_test(&skipped, 1));
+    module_result_init(&result);
+    assert(executor_skip_task(contexts[1], registered_idx, &result) == ANCIBLE_SUCCESS);
+    assert(result.skipped == 1 && result.registered == 1);
+    module_result_free(&result);
+    registered_t *out = context_get_result(contexts[1], symbol_intern("out"));
+    assert(out != NULL && out->skipped == 1);
+    
+    // Hosts the condition fails on report the error when the task runs
+    module_result_init(&result);
+    assert(executor_run_task(contexts[2], registered_idx, NULL, &result) == ANCIBLE_ERROR);
+    module_result_free(&result);
+    
+    // Loops and folded conditions are not batched
+    assert(executor_batch_condition(contexts, 3, find_task(play, "Looped"), &skipped) == ANCIBLE_ERROR);
+    assert(executor_batch_condition(contexts, 3, find_task(play, "Folded"), &skipped) == ANCIBLE_ERROR);
+    
+    bitset_free(&skipped);
+    for (int h = 0; h < 3; h++) {
+        context_free(contexts[h]);
+    }
+    playbook_free(&playbook);
+    remove(path);
+    executor_cleanup();
+    symbol_cleanup();
+    
+    printf("Batch condition tests passed!\n");
+}
+
 /**
  * Main function
  */
@@ -272,6 +510,8 @@ int main(void) {
     
     test_parse_blocks();
     test_execute_blocks();
+    test_fold_blocks();
+    test_batch_blocks();
     
     printf("All block tests passed!\n");
     return 0;
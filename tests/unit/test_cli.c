@@ -33,7 +33,7 @@ int main(void) {
     // Create a test inventory file
     fp = fopen("inventory.ini", "w");
     assert(fp != NULL);
-    fprintf(fp, "[all]\nlocalhost ansible_host=127.0.0.1\n");
+    fprintf(fp, "[all]\nlocalhost ansible_host=127.0.0.1 ansible_connection=local\n");
     fclose(fp);
     
     // Create runtime/state directory
@@ -42,10 +42,118 @@ int main(void) {
     result = system("../../bin/ancible-playbook test.yml > /dev/null");
     assert(WEXITSTATUS(result) == 0);
     
+    // A play whose host pattern is invalid fails the run
+    fp = fopen("test.yml", "w");
+    assert(fp != NULL);
+    fprintf(fp, "---\n- hosts: all\n  tasks:\n    - command: echo first\n"
+                "- hosts: ~web(\n  tasks:\n    - command: echo second\n");
+    fclose(fp);
+    result = system("../../bin/ancible-playbook test.yml > /dev/null 2>&1");
+    assert(WEXITSTATUS(result) == 1);
+    
+    // Only planning modes take several playbooks
+    result = system("../../bin/ancible-playbook test.yml test.yml > /dev/null 2>&1");
+    assert(WEXITSTATUS(result) == 1);
+    
     // Clean up
     system("rm test.yml inventory.ini");
     printf("OK\n");
     
+    // Test 4: Verify planning modes
+    printf("Test 4: Testing planning modes... ");
+    fp = fopen("broken.yml", "w");
+    assert(fp != NULL);
+    fprintf(fp, "---\n- name: No hosts\n  tasks:\n    - command: echo test\n");
+    fclose(fp);
+    
+    // Several playbooks are checked in one run, and one broken file fails it
+    result = system("../../bin/ancible-playbook --syntax-check ../../examples/playbooks/11_multiple_plays.yml "
+                    "../../examples/playbooks/12_roles_and_includes.yml > /dev/null");
+    assert(WEXITSTATUS(result) == 0);
+    result = system("../../bin/ancible-playbook --syntax-check ../../examples/playbooks/simple.yml broken.yml "
+                    "> /dev/null 2>&1");
+    assert(WEXITSTATUS(result) == 1);
+    
+    // Host patterns are resolved, tasks printed as a tree, nothing runs
+    FILE *out = popen("../../bin/ancible-playbook --list-hosts --list-tasks -i ../../examples/inventory_local.ini "
+                      "../../examples/playbooks/10_blocks.yml", "r");
+    assert(out != NULL);
+    char listing[8192];
+    size_t len = fread(listing, 1, sizeof(listing) - 1, out);
+    listing[len] = '\0';
+    assert(WEXITSTATUS(pclose(out)) == 0);
+    assert(strstr(listing, "hosts (1):") != NULL);
+    assert(strstr(listing, "      localhost\n") != NULL);
+    assert(strstr(listing, "(block)") != NULL);
+    assert(strstr(listing, "rescue:") != NULL);
+    
+    // --limit goes through the same pattern engine as the play's hosts
+    out = popen("../../bin/ancible-playbook --list-hosts -i ../../examples/inventory.ini "
+                "--limit 'servers:!db01' ../../examples/playbooks/1_simple.yml", "r");
+    assert(out != NULL);
+    len = fread(listing, 1, sizeof(listing) - 1, out);
+    listing[len] = '\0';
+    assert(WEXITSTATUS(pclose(out)) == 0);
+    assert(strstr(listing, "hosts (2):") != NULL);
+    assert(strstr(listing, "      web02\n") != NULL);
+    assert(strstr(listing, "db01") == NULL);
+    
+    system("rm broken.yml");
+    printf("OK\n");
+    
+    // Test 5: Verify compiled inventory snapshots
+    printf("Test 5: Testing ancible-inventory --compile... ");
+    result = system("../../bin/ancible-inventory -i ../../examples/inventory.ini --compile inventory.snap");
+    assert(WEXITSTATUS(result) == 0);
+    
+    // A snapshot is loaded like any other inventory source
+    out = popen("../../bin/ancible-playbook --list-hosts -i inventory.snap "
+                "--limit 'servers:!db01' ../../examples/playbooks/1_simple.yml", "r");
+    assert(out != NULL);
+    len = fread(listing, 1, sizeof(listing) - 1, out);
+    listing[len] = '\0';
+    assert(WEXITSTATUS(pclose(out)) == 0);
+    assert(strstr(listing, "hosts (2):") != NULL);
+    assert(strstr(listing, "      web02\n") != NULL);
+    
+    out = popen("../../bin/ancible-inventory -i inventory.snap --list", "r");
+    assert(out != NULL);
+    len = fread(listing, 1, sizeof(listing) - 1, out);
+    listing[len] = '\0';
+    assert(WEXITSTATUS(pclose(out)) == 0);
+    assert(strstr(listing, "\"_meta\": {\"hostvars\"") != NULL);
+    assert(strstr(listing, "\"web02\"") != NULL);
+    
+    system("rm inventory.snap");
+    printf("OK\n");
+    
+    // Test 6: Verify hosts added at runtime are targeted by later plays
+    printf("Test 6: Testing add_host and group_by across plays... ");
+    fp = fopen("runtime_hosts.yml", "w");
+    assert(fp != NULL);
+    fprintf(fp, "---\n- hosts: all\n  tasks:\n"
+                "    - name: Add a host\n      add_host:\n        name: late\n        groups: added\n"
+                "        ansible_connection: local\n"
+                "    - name: Group by role\n      group_by:\n        key: role_web\n"
+                "- hosts: added:role_web\n  tasks:\n    - name: Late task\n      command: echo late\n");
+    fclose(fp);
+    fp = fopen("inventory.ini", "w");
+    assert(fp != NULL);
+    fprintf(fp, "[all]\nlocalhost ansible_host=127.0.0.1 ansible_connection=local\n");
+    fclose(fp);
+    
+    out = popen("../../bin/ancible-playbook -v runtime_hosts.yml 2>&1", "r");
+    assert(out != NULL);
+    len = fread(listing, 1, sizeof(listing) - 1, out);
+    listing[len] = '\0';
+    assert(WEXITSTATUS(pclose(out)) == 0);
+    assert(strstr(listing, "Warning: No hosts matched") == NULL);
+    assert(strstr(listing, "  late\n") != NULL);
+    assert(strstr(listing, "  localhost") != NULL);
+    
+    system("rm runtime_hosts.yml inventory.ini");
+    printf("OK\n");
+    
     printf("All CLI tests passed!\n");
     return 0;
 }
@@ -16,7 +16,11 @@ static host_t *create_test_host(void) {
     
     host->name = strdup("localhost");
     host->ansible_host = strdup("localhost");
-    host->next = NULL;
+    host->id = -1;
+    host->vars = NULL;
+    host->var_count = 0;
+    host->group_scope = NULL;
+    host->host_vars = NULL;
     
     return host;
 }
@@ -33,39 +37,39 @@ static void free_test_host(host_t *host) {
 }
 
 /**
- * Create a test playbook
+ * Create a test play
  */
-static playbook_t *create_test_playbook(void) {
-    playbook_t *playbook = malloc(sizeof(playbook_t));
-    assert(playbook != NULL);
+static play_t *create_test_play(void) {
+    play_t *play = calloc(1, sizeof(play_t));
+    assert(play != NULL);
     
-    playbook->hosts = strdup("all");
-    playbook->task_count = 1;
+    play->hosts = strdup("all");
+    play->task_count = 1;
     
-    playbook->tasks = malloc(sizeof(task_t));
+    play->tasks = calloc(1, sizeof(task_t));
     
-    playbook->tasks[0].name = strdup("Test task");
-    playbook->tasks[0].module = strdup("command");
+    play->tasks[0].name = strdup("Test task");
+    play->tasks[0].module = strdup("command");
     
-    return playbook;
+    return play;
 }
 
 /**
- * Free a test playbook
+ * Free a test play
  */
-static void free_test_playbook(playbook_t *playbook) {
-    if (!playbook) return;
+static void free_test_play(play_t *play) {
+    if (!play) return;
     
-    free(playbook->hosts);
+    free(play->hosts);
     
-    for (int i = 0; i < playbook->task_count; i++) {
-        free(playbook->tasks[i].name);
-        free(playbook->tasks[i].module);
+    for (int i = 0; i < play->task_count; i++) {
+        free(play->tasks[i].name);
+        free(play->tasks[i].module);
     }
     
-    free(playbook->tasks);
+    free(play->tasks);
     
-    free(playbook);
+    free(play);
 }
 
 /**
@@ -79,9 +83,9 @@ int main(void) {
         printf("Test 1: Executing simple command... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 0);
+        context_t *context = context_create(host, play, 0);
         assert(context != NULL);
         
         // Set local connection
@@ -101,7 +105,7 @@ int main(void) {
         module_result_free(&result);
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
         
         printf("OK\n");
     }
@@ -111,9 +115,9 @@ int main(void) {
         printf("Test 2: Executing failing command... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 0);
+        context_t *context = context_create(host, play, 0);
         assert(context != NULL);
         
         // Set local connection
@@ -130,7 +134,52 @@ int main(void) {
         module_result_free(&result);
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 3: Execute several commands in one batch
+    {
+        printf("Test 3: Executing a batch of commands... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        // Set local connection
+        context_set_var(context, "ansible_connection", "local");
+        
+        // Quotes, a fake frame header in the output, a failure and an empty output
+        const char *args[] = {
+            "echo 'it'\\''s quoted'",
+            "printf '@@ANCIBLE-ITEM 9 9 9 9\\nline two'",
+            "echo oops >&2; exit 3",
+            "true"
+        };
+        module_result_t results[4];
+        memset(results, 0, sizeof(results));
+        
+        int ret = command_module_exec_batch(context, args, 4, results);
+        
+        assert(ret == ANCIBLE_SUCCESS);
+        assert(strcmp(results[0].cmd_result.stdout_data, "it's quoted\n") == 0);
+        assert(results[0].changed == 1 && results[0].failed == 0);
+        assert(strcmp(results[1].cmd_result.stdout_data, "@@ANCIBLE-ITEM 9 9 9 9\nline two") == 0);
+        assert(results[2].failed == 1);
+        assert(results[2].cmd_result.exit_code == 3);
+        assert(strcmp(results[2].cmd_result.stderr_data, "oops\n") == 0);
+        assert(results[3].failed == 0);
+        assert(strcmp(results[3].cmd_result.stdout_data, "") == 0);
+        
+        for (int i = 0; i < 4; i++) {
+            module_result_free(&results[i]);
+        }
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
         
         printf("OK\n");
     }
@@ -7,7 +7,8 @@
 #include "../../include/core/condition.h"
 #include "../../include/core/context.h"
 #include "../../include/core/inventory.h" // For host_t
-#include "../../include/core/parser.h" // For playbook_t
+#include "../../include/core/parser.h" // For play_t
+#include "../../include/core/symbol.h"
 
 /**
  * Create a minimal test context for testing
@@ -18,25 +19,24 @@ context_t *create_test_context(void) {
     memset(host, 0, sizeof(host_t));
     host->name = strdup("test-host");
     
-    // Create a dummy playbook
-    playbook_t *playbook = malloc(sizeof(playbook_t));
-    memset(playbook, 0, sizeof(playbook_t));
-    playbook->hosts = strdup("all");
+    // Create a dummy play
+    play_t *play = calloc(1, sizeof(play_t));
+    play->hosts = strdup("all");
     
     // Create the context
-    context_t *context = context_create(host, playbook, 1);
+    context_t *context = context_create(host, play, 1);
     return context;
 }
 
 /**
- * Free a test context including its host and playbook
+ * Free a test context including its host and play
  */
 void free_test_context(context_t *context) {
     if (!context) return;
     
-    // Save pointers to host and playbook before freeing context
+    // Save pointers to host and play before freeing context
     host_t *host = context->host;
-    playbook_t *playbook = context->playbook;
+    play_t *play = context->play;
     
     // Free context
     context_free(context);
@@ -47,10 +47,10 @@ void free_test_context(context_t *context) {
         free(host);
     }
     
-    // Free playbook
-    if (playbook) {
-        free(playbook->hosts);
-        free(playbook);
+    // Free play
+    if (play) {
+        free(play->hosts);
+        free(play);
     }
 }
 
@@ -110,6 +110,322 @@ void test_comparison_conditions(void) {
     printf("Comparison conditions test passed\n");
 }
 
+/**
+ * Compile and evaluate a condition in one go
+ */
+static int compiled(context_t *context, const char *source) {
+    condition_t *condition = condition_compile(source);
+    assert(condition != NULL);
+    int result = condition_eval(condition, context);
+    condition_free(condition);
+    return result;
+}
+
+/**
+ * Test compiled conditions
+ */
+void test_compiled_conditions(void) {
+    context_t *context = create_test_context();
+    assert(context != NULL);
+    
+    // Compiled conditions agree with the string path
+    static const char *const sources[] = {
+        "true", "NO", "1", "0", "abc == abc", "abc != abc", "123 < 456", "456 < 123", "123 >= 123"
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        assert(compiled(context, sources[i]) == condition_evaluate(context, sources[i]));
+    }
+    
+    // Names are resolved to symbols at compile time
+    condition_t *condition = condition_compile("{{ port }} >= 1024");
+    assert(condition != NULL && condition->type == CONDITION_COMPARE && condition->op == CONDITION_OP_GE);
+    assert(condition->left->type == CONDITION_VAR && condition->left->key == symbol_find("port"));
+    assert(condition->right->is_integer && condition->right->integer == 1024);
+    assert(condition_eval(condition, context) == -1);
+    context_set_var(context, "port", "8080");
+    assert(condition_eval(condition, context) == 1);
+    condition_free(condition);
+    
+    // Typed values compare without parsing; booleans match their words
+    const value_t *port = value_parse(&context->arena, "80");
+    const value_t *debug = value_parse(&context->arena, "yes");
+    context_set_value_id(context, symbol_find("port"), port);
+    context_set_value_id(context, symbol_intern("debug"), debug);
+    assert(compiled(context, "port < 1024") == 1);
+    assert(compiled(context, "port == '80'") == 1);
+    assert(compiled(context, "debug == true") == 1 && compiled(context, "debug") == 1);
+    assert(compiled(context, "debug != False") == 1);
+    
+    // Bare words that are not variables stand for themselves; ${} reads as empty
+    assert(compiled(context, "hello == hello") == 1);
+    assert(compiled(context, "/usr/bin != /usr/sbin") == 1);
+    assert(compiled(context, "skip != ${missing}") == 1);
+    assert(compiled(context, "${missing}") == 0);
+    assert(compiled(context, "missing") == -1);
+    assert(compiled(context, "{{ missing }} == missing") == -1);
+    assert(compiled(context, "'abc' < 'abd'") == 1);
+    
+    // Outside == and != a name that is not set is an error, not its own text
+    assert(compiled(context, "missing > 1024") == -1 && compiled(context, "1024 <= missing") == -1);
+    assert(compiled(context, "missing in [missing]") == -1);
+    assert(compiled(context, "${missing} < 1") == -1);
+    
+    // Fields of registered results
+    registered_t out;
+    memset(&out, 0, sizeof(out));
+    strcpy(out.rc, "3");
+    out.changed = 1;
+    out.line_count = -1;
+    context_register(context, symbol_intern("out"), &out);
+    assert(compiled(context, "{{ out.rc }} == 3") == 1 && compiled(context, "out.rc != 0") == 1);
+    assert(compiled(context, "out.changed") == 1 && compiled(context, "out.failed == false") == 1);
+    assert(compiled(context, "out is changed and out is succeeded") == 1);
+    assert(compiled(context, "out is failed or out is skipped") == 0);
+    assert(compiled(context, "missing is success") == -1);
+    assert(condition_compile("3 is failed") == NULL && condition_compile("out.rc is changed") == NULL);
+    
+    // A registered name shadows a play variable of the same name
+    variable_t play_status = { "status", "pending", NULL, NULL };
+    const variable_t *play[] = { &play_status };
+    scope_t *play_vars = scope_create(play, 1);
+    assert(play_vars != NULL);
+    context->play_vars = play_vars;
+    assert(compiled(context, "status == 'pending'") == 1);
+    registered_t status;
+    memset(&status, 0, sizeof(status));
+    strcpy(status.rc, "0");
+    status.stdout_data = strdup("ready");
+    status.line_count = -1;
+    context_register(context, symbol_intern("status"), &status);
+    assert(compiled(context, "status == 'ready' and status.rc == 0") == 1);
+    assert(compiled(context, "{{ status }} != pending and status is defined") == 1);
+    
+    // So are names hosts may set, once declared
+    bitset_t declared;
+    bitset_init(&declared);
+    assert(bitset_set(&declared, symbol_intern("later")) == ANCIBLE_SUCCESS);
+    condition = condition_compile("later == later or missing == missing");
+    assert(condition != NULL && condition_eval(condition, context) == 1);
+    condition_declare(condition, &declared);
+    assert(condition_eval(condition, context) == -1);
+    condition_free(condition);
+    bitset_free(&declared);
+    
+    // Anything else is left to the string path
+    assert(condition_compile("a == b == c") == NULL);
+    assert(condition_compile("{{ x | length }} > 2") == NULL);
+    assert(condition_compile("== 3") == NULL);
+    assert(condition_compile("'open") == NULL);
+    
+    free_test_context(context);
+    scope_release(play_vars);
+    symbol_cleanup();
+    printf("Compiled conditions test passed\n");
+}
+
+/**
+ * Test and, or, not, membership and tests
+ */
+void test_boolean_operators(void) {
+    context_t *context = create_test_context();
+    assert(context != NULL);
+    
+    // Precedence is not, and, or; parentheses group
+    assert(compiled(context, "true or false and false") == 1);
+    assert(compiled(context, "(true or false) and false") == 0);
+    assert(compiled(context, "not false and false") == 0);
+    assert(compiled(context, "not (1 == 2)") == 1);
+    assert(compiled(context, "not not yes") == 1);
+    
+    // The right side is only evaluated when needed
+    assert(compiled(context, "missing") == -1);
+    assert(compiled(context, "false and missing") == 0);
+    assert(compiled(context, "true or missing") == 1);
+    assert(compiled(context, "true and missing") == -1);
+    
+    // Membership in lists, maps and text
+    context_set_value_id(context, symbol_intern("groups"), value_parse(&context->arena, "[web, db]"));
+    context_set_value_id(context, symbol_intern("limits"), value_parse(&context->arena, "{cpu: 2}"));
+    context_set_var(context, "role", "web");
+    context_set_var(context, "motd", "welcome to web01");
+    assert(compiled(context, "role in groups") == 1);
+    assert(compiled(context, "'we' in groups") == 0);
+    assert(compiled(context, "'cache' not in groups") == 1);
+    assert(compiled(context, "'cpu' in limits and 'memory' not in limits") == 1);
+    assert(compiled(context, "'web01' in motd") == 1);
+    assert(compiled(context, "role in [db, 'web']") == 1);
+    assert(compiled(context, "8080 in [80, 443]") == 0);
+    assert(compiled(context, "role in missing") == -1);
+    
+    // Tests, including the string tests, compiled once
+    assert(compiled(context, "role is defined and missing is undefined") == 1);
+    assert(compiled(context, "{{ missing is defined }}") == 0);
+    assert(compiled(context, "missing is not defined") == 1);
+    assert(compiled(context, "role is string and 42 is number") == 1);
+    assert(compiled(context, "motd is match('wel')") == 1);
+    assert(compiled(context, "motd is match('web')") == 0);
+    assert(compiled(context, "motd is search('web[0-9]+$')") == 1);
+    assert(compiled(context, "motd is not regex('^db')") == 1);
+    assert(compiled(context, "missing is truthy") == -1);
+    
+    // The string path evaluates what the compiler handles, and/or included
+    assert(condition_evaluate(context, "abc == abc and 1 < 2") == 1);
+    assert(condition_evaluate(context, "${role} != web or false") == 0);
+    
+    // What the compiler rejects is an error, not split on the first operator
+    assert(condition_evaluate(context, "1 != 1 and 2 is bogus") == -1);
+    assert(condition_evaluate(context, "web server == web server") == -1);
+    
+    // Keywords are not operands, and tests must be known
+    assert(condition_compile("role and") == NULL);
+    assert(condition_compile("role in") == NULL);
+    assert(condition_compile("(role == web") == NULL);
+    assert(condition_compile("role is sorted") == NULL);
+    assert(condition_compile("1 != 1 and 2 is bogus") == NULL);
+    assert(condition_compile("role is match(web)") == NULL);
+    assert(condition_compile("role not groups") == NULL);
+    
+    free_test_context(context);
+    symbol_cleanup();
+    printf("Boolean operators test passed\n");
+}
+
+/**
+ * Fold a condition with the given variables
+ */
+static int folded(const char *source, const scope_t *extra_vars, const scope_t *play_vars, const bitset_t *facts) {
+    condition_t *condition = condition_compile(source);
+    assert(condition != NULL);
+    int result = condition_fold(condition, extra_vars, NULL, play_vars, facts);
+    condition_free(condition);
+    return result;
+}
+
+/**
+ * Test folding conditions for every host of a play
+ */
+void test_folding(void) {
+    variable_t env = { "env", "prod", NULL, NULL };
+    variable_t canary = { "deploy_canary", "false", NULL, NULL };
+    variable_t tier = { "tier", "web", NULL, NULL };
+    const variable_t *extra[] = { &env };
+    const variable_t *play[] = { &canary, &tier, &env };
+    scope_t *extra_vars = scope_create(extra, 1);
+    scope_t *play_vars = scope_create(play, 3);
+    assert(extra_vars != NULL && play_vars != NULL);
+    
+    bitset_t facts;
+    bitset_init(&facts);
+    assert(bitset_set(&facts, symbol_intern("tier")) == ANCIBLE_SUCCESS);
+    
+    // Literals, extra and play variables are the same on every host
+    assert(folded("true", NULL, NULL, &facts) == 1);
+    assert(folded("42 > 10 and not (1 == 2)", NULL, NULL, &facts) == 1);
+    assert(folded("deploy_canary", extra_vars, play_vars, &facts) == 0);
+    assert(folded("env == 'prod' and deploy_canary is defined", extra_vars, play_vars, &facts) == 1);
+    assert(folded("'prod' in [env, 'staging']", extra_vars, play_vars, &facts) == 1);
+    
+    // Facts, host variables and registered results depend on the host
+    assert(folded("tier == 'web'", extra_vars, play_vars, &facts) == -1);
+    assert(folded("region == 'eu'", extra_vars, play_vars, &facts) == -1);
+    assert(folded("out.rc == 0", extra_vars, play_vars, &facts) == -1);
+    assert(folded("deploy_canary or region is defined", extra_vars, play_vars, &facts) == -1);
+    assert(folded("region is defined and deploy_canary", extra_vars, play_vars, &facts) == -1);
+    
+    // So do bare words, which may name a host variable
+    assert(folded("env == prod", extra_vars, play_vars, &facts) == -1);
+    
+    // A known side decides and/or on its own only when it comes first
+    assert(folded("deploy_canary and region == 'eu'", extra_vars, play_vars, &facts) == 0);
+    assert(folded("env == 'prod' or tier == 'web'", extra_vars, play_vars, &facts) == 1);
+    
+    // When hosts may set any variable, only extra variables fold
+    assert(folded("deploy_canary", extra_vars, play_vars, NULL) == -1);
+    assert(folded("env == 'prod'", extra_vars, play_vars, NULL) == 1);
+    
+    bitset_free(&facts);
+    scope_release(extra_vars);
+    scope_release(play_vars);
+    symbol_cleanup();
+    printf("Condition folding test passed\n");
+}
+
+/**
+ * Test batch evaluation: the same result as evaluating on each host
+ */
+void test_batch(void) {
+    // More hosts than a bitset word holds
+    enum { HOSTS = 150 };
+    context_t *contexts[HOSTS];
+    char port[16];
+    for (int h = 0; h < HOSTS; h++) {
+        contexts[h] = create_test_context();
+        assert(contexts[h] != NULL);
+        
+        // Ports that are integers, text, or not set at all
+        if (h % 7 == 3) {
+            context_set_var(contexts[h], "port", "http");
+        } else if (h % 7 != 5) {
+            snprintf(port, sizeof(port), "%d", h % 2 ? 8000 + h : 80);
+            context_set_var(contexts[h], "port", port);
+        }
+        context_set_var(contexts[h], "env", h % 3 ? "staging" : "prod");
+        
+        if (h % 4 == 0) {
+            registered_t out;
+            memset(&out, 0, sizeof(out));
+            snprintf(out.rc, sizeof(out.rc), "%d", h % 8 ? 0 : 2);
+            out.line_count = -1;
+            context_register(contexts[h], symbol_intern("out"), &out);
+        }
+    }
+    
+    static const char *const sources[] = {
+        "port > 1024",
+        "1024 >= port",
+        "{{ port }} == 80",
+        "port != 80 and env == 'prod'",
+        "env == 'prod' or {{ port }} < 8100",
+        "not (out.rc == 0)",
+        "out is defined and out.rc > 0",
+        "port is defined and port >= 8050",
+        "{{ port }} > 100 or env == 'staging'",
+        "env in ['prod', 'dev'] and not port is number"
+    };
+    
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        condition_t *condition = condition_compile(sources[i]);
+        assert(condition != NULL);
+        
+        bitset_t holds;
+        bitset_t fails;
+        bitset_init(&holds);
+        bitset_init(&fails);
+        assert(condition_eval_batch(condition, (const context_t *const *)contexts, HOSTS, &holds, &fails) ==
+               ANCIBLE_SUCCESS);
+        
+        // Hosts in neither set are the ones the condition fails to evaluate on
+        for (int h = 0; h < HOSTS; h++) {
+            int result = condition_eval(condition, contexts[h]);
+            assert(bitset_test(&holds, h) == (result == 1));
+            assert(bitset_test(&fails, h) == (result == 0));
+        }
+        
+        // "port > 1024" does not compare the word "port" on a host without a port
+        assert(i != 0 || (!bitset_test(&holds, 5) && !bitset_test(&fails, 5)));
+        
+        bitset_free(&holds);
+        bitset_free(&fails);
+        condition_free(condition);
+    }
+    
+    for (int h = 0; h < HOSTS; h++) {
+        free_test_context(contexts[h]);
+    }
+    symbol_cleanup();
+    printf("Batch condition test passed\n");
+}
+
 /**
  * Main test function
  */
@@ -118,6 +434,10 @@ int main(void) {
     
     test_boolean_conditions();
     test_comparison_conditions();
+    test_compiled_conditions();
+    test_boolean_operators();
+    test_folding();
+    test_batch();
     
     printf("All condition tests passed!\n");
     return 0;
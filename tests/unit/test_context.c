@@ -6,6 +6,8 @@
 #include "../../include/core/inventory.h"
 #include "../../include/core/parser.h"
 #include "../../include/core/context.h"
+#include "../../include/core/symbol.h"
+#include "../../include/core/value.h"
 
 /**
  * Create a test host
@@ -16,7 +18,11 @@ static host_t *create_test_host(void) {
     
     host->name = strdup("test_host");
     host->ansible_host = strdup("192.168.1.100");
-    host->next = NULL;
+    host->id = -1;
+    host->vars = NULL;
+    host->var_count = 0;
+    host->group_scope = NULL;
+    host->host_vars = NULL;
     
     return host;
 }
@@ -33,38 +39,38 @@ static void free_test_host(host_t *host) {
 }
 
 /**
- * Create a test playbook
+ * Create a test play
  */
-static playbook_t *create_test_playbook(void) {
-    playbook_t *playbook = malloc(sizeof(playbook_t));
-    assert(playbook != NULL);
+static play_t *create_test_play(void) {
+    play_t *play = calloc(1, sizeof(play_t));
+    assert(play != NULL);
     
-    playbook->hosts = strdup("all");
-    playbook->task_count = 1;
+    play->hosts = strdup("all");
+    play->task_count = 1;
     
-    playbook->tasks = malloc(sizeof(task_t));
+    play->tasks = calloc(1, sizeof(task_t));
     
-    playbook->tasks[0].name = strdup("Test task");
-    playbook->tasks[0].module = strdup("command");
+    play->tasks[0].name = strdup("Test task");
+    play->tasks[0].module = strdup("command");
     
-    return playbook;
+    return play;
 }
 
 /**
- * Free a test playbook
+ * Free a test play
  */
-static void free_test_playbook(playbook_t *playbook) {
-    if (!playbook) return;
+static void free_test_play(play_t *play) {
+    if (!play) return;
     
-    free(playbook->hosts);
+    free(play->hosts);
     
-    for (int i = 0; i < playbook->task_count; i++) {
-        free(playbook->tasks[i].name);
-        free(playbook->tasks[i].module);
+    for (int i = 0; i < play->task_count; i++) {
+        free(play->tasks[i].name);
+        free(play->tasks[i].module);
     }
     
-    free(playbook->tasks);
-    free(playbook);
+    free(play->tasks);
+    free(play);
 }
 
 /**
@@ -78,12 +84,12 @@ int main(void) {
         printf("Test 1: Creating context... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 1);
+        context_t *context = context_create(host, play, 1);
         assert(context != NULL);
         assert(context->host == host);
-        assert(context->playbook == playbook);
+        assert(context->play == play);
         assert(context->verbose == 1);
         
         // Check that ansible_host was set
@@ -93,7 +99,7 @@ int main(void) {
         
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
         
         printf("OK\n");
     }
@@ -103,9 +109,9 @@ int main(void) {
         printf("Test 2: Setting and getting variables... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 0);
+        context_t *context = context_create(host, play, 0);
         assert(context != NULL);
         
         // Set a new variable
@@ -132,11 +138,306 @@ int main(void) {
         
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
         
         printf("OK\n");
     }
     
+    // Test 3: Play variables are copied into the context
+    {
+        printf("Test 3: Play variables... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        variable_t var;
+        var.name = "app_port";
+        var.value = "8080";
+        var.next = NULL;
+        var.typed = NULL;
+        play->vars = &var;
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        const char *value = context_get_var(context, "app_port");
+        assert(value != NULL);
+        assert(strcmp(value, "8080") == 0);
+        
+        play->vars = NULL;
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 4: Group variables sit below play variables
+    {
+        printf("Test 4: Group variables... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        variable_t group_vars[3] = {
+            {"region", "eu", NULL, NULL},
+            {"app_port", "80", NULL, NULL},
+            {"ansible_host", "10.0.0.1", NULL, NULL}
+        };
+        const variable_t *merged[3] = {&group_vars[0], &group_vars[1], &group_vars[2]};
+        host->vars = merged;
+        host->var_count = 3;
+        
+        variable_t play_var = {"app_port", "8080", NULL, NULL};
+        play->vars = &play_var;
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        assert(strcmp(context_get_var(context, "region"), "eu") == 0);
+        assert(strcmp(context_get_var(context, "app_port"), "8080") == 0);
+        // The host line's ansible_host wins over the group's
+        assert(strcmp(context_get_var(context, "ansible_host"), "192.168.1.100") == 0);
+        context_free(context);
+        
+        // Without one, the group's value is kept
+        free(host->ansible_host);
+        host->ansible_host = NULL;
+        context = context_create(host, play, 0);
+        assert(context != NULL);
+        assert(strcmp(context_get_var(context, "ansible_host"), "10.0.0.1") == 0);
+        context_free(context);
+        
+        play->vars = NULL;
+        host->vars = NULL;
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 5: Host variables sit between group and play variables
+    {
+        printf("Test 5: Host variables... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        variable_t group_vars[2] = {
+            {"ansible_user", "admin", NULL, NULL},
+            {"app_port", "80", NULL, NULL}
+        };
+        const variable_t *merged[2] = {&group_vars[0], &group_vars[1]};
+        host->vars = merged;
+        host->var_count = 2;
+        
+        var_table_t *table = malloc(sizeof(var_table_t) + 2 * sizeof(struct host_var));
+        assert(table != NULL);
+        table->refs = 1;
+        table->count = 2;
+        table->entries[0].key = symbol_intern("ansible_user");
+        table->entries[0].value = "deploy";
+        table->entries[1].key = symbol_intern("app_port");
+        table->entries[1].value = "81";
+        host->host_vars = table;
+        
+        variable_t play_var = {"app_port", "8080", NULL, NULL};
+        play->vars = &play_var;
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        assert(strcmp(context_get_var(context, "ansible_user"), "deploy") == 0);
+        assert(strcmp(context_get_var(context, "app_port"), "8080") == 0);
+        context_free(context);
+        
+        play->vars = NULL;
+        host->vars = NULL;
+        host->host_vars = NULL;
+        free(table);
+        free_test_host(host);
+        free_test_play(play);
+        symbol_cleanup();
+        
+        printf("OK\n");
+    }
+    
+    // Test 6: Symbol-keyed variable table
+    {
+        printf("Test 6: Variable table... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        // Well-known names have fixed IDs, even before anything is interned
+        assert(strcmp(symbol_name(SYMBOL_ANSIBLE_HOST), "ansible_host") == 0);
+        assert(symbol_intern("ansible_user") == SYMBOL_ANSIBLE_USER);
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        assert(strcmp(context_get_var_id(context, SYMBOL_ANSIBLE_CONNECTION), "ssh") == 0);
+        assert(strcmp(context_get_var_id(context, SYMBOL_ANSIBLE_HOST), "192.168.1.100") == 0);
+        assert(context_get_var_id(context, SYMBOL_ANSIBLE_USER) == NULL);
+        
+        // Enough variables to grow the table several times
+        char name[32];
+        char value[32];
+        for (int i = 0; i < 500; i++) {
+            snprintf(name, sizeof(name), "var_%d", i);
+            snprintf(value, sizeof(value), "value_%d", i);
+            assert(context_set_var(context, name, value) == ANCIBLE_SUCCESS);
+        }
+        assert(context_set_var_id(context, SYMBOL_ANSIBLE_USER, "deploy") == ANCIBLE_SUCCESS);
+        assert(context->var_count == 501);
+        assert(context->var_count * 4 <= context->var_capacity * 3);
+        assert(strcmp(context_get_var(context, "var_321"), "value_321") == 0);
+        assert(strcmp(context_get_var(context, "ansible_user"), "deploy") == 0);
+        
+        // A clone is independent of the original
+        context_t *clone = context_clone(context);
+        assert(clone != NULL && clone->var_count == 501);
+        assert(context_set_var(clone, "var_7", "changed") == ANCIBLE_SUCCESS);
+        assert(strcmp(context_get_var(clone, "var_7"), "changed") == 0);
+        assert(strcmp(context_get_var(context, "var_7"), "value_7") == 0);
+        assert(strcmp(context_get_var(clone, "var_499"), "value_499") == 0);
+        context_free(clone);
+        
+        assert(context_set_var_id(context, -1, "x") == ANCIBLE_ERROR);
+        assert(context_get_var_id(context, -1) == NULL);
+        
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        symbol_cleanup();
+        
+        printf("OK\n");
+    }
+    
+    // Test 7: Layered scopes
+    {
+        printf("Test 7: Layered scopes... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        variable_t group_vars[2] = {
+            {"layer", "group", NULL, NULL},
+            {"region", "eu", NULL, NULL}
+        };
+        const variable_t *merged[2] = {&group_vars[0], &group_vars[1]};
+        host->vars = merged;
+        host->var_count = 2;
+        
+        variable_t defaults[2] = {{"layer", "defaults", &defaults[1], NULL}, {"timeout", "30", NULL, NULL}};
+        variable_t play_var = {"app_port", "8080", NULL, NULL};
+        variable_t block_vars[2] = {{"layer", "block", &block_vars[1], NULL}, {"tier", "frontend", NULL, NULL}};
+        variable_t task_var = {"layer", "task", NULL, NULL};
+        play->defaults = defaults;
+        play->vars = &play_var;
+        play->default_scope = scope_extend(NULL, play->defaults);
+        play->var_scope = scope_extend(NULL, play->vars);
+        scope_t *block_scope = scope_extend(NULL, block_vars);
+        scope_t *task_scope = scope_extend(block_scope, &task_var);
+        assert(play->default_scope && play->var_scope && block_scope && task_scope);
+        assert(task_scope->count == 2);
+        
+        context_t *first = context_create(host, play, 0);
+        context_t *second = context_create(host, play, 0);
+        assert(first != NULL && second != NULL);
+        
+        // Nothing is copied: both hosts borrow the play's indexes
+        assert(first->play_vars == play->var_scope && second->defaults == play->default_scope);
+        assert(first->var_count == 0);
+        assert(strcmp(context_get_var(first, "timeout"), "30") == 0);
+        assert(strcmp(context_get_var(first, "layer"), "group") == 0);
+        
+        // Task vars beat block vars, which beat everything below them
+        task_t task;
+        memset(&task, 0, sizeof(task));
+        task.var_scope = task_scope;
+        first->task = &task;
+        assert(strcmp(context_get_var(first, "layer"), "task") == 0);
+        assert(strcmp(context_get_var(first, "tier"), "frontend") == 0);
+        
+        // Writes go to the host's own overlay, above the task vars
+        assert(context_set_var(first, "layer", "fact") == ANCIBLE_SUCCESS);
+        assert(strcmp(context_get_var(first, "layer"), "fact") == 0);
+        assert(strcmp(context_get_var(second, "layer"), "group") == 0);
+        assert(strcmp(defaults[0].value, "defaults") == 0);
+        
+        // Values replaced in place by their owner are seen right away
+        group_vars[1].value = "us";
+        assert(strcmp(context_get_var(second, "region"), "us") == 0);
+        
+        // Built-in defaults sit below everything
+        free(host->ansible_host);
+        host->ansible_host = NULL;
+        assert(strcmp(context_get_var_id(second, SYMBOL_ANSIBLE_HOST), "test_host") == 0);
+        assert(strcmp(context_get_var_id(second, SYMBOL_ANSIBLE_CONNECTION), "ssh") == 0);
+        
+        context_free(first);
+        context_free(second);
+        scope_release(task_scope);
+        scope_release(block_scope);
+        scope_release(play->var_scope);
+        scope_release(play->default_scope);
+        play->var_scope = NULL;
+        play->default_scope = NULL;
+        play->vars = NULL;
+        play->defaults = NULL;
+        host->vars = NULL;
+        free_test_host(host);
+        free_test_play(play);
+        symbol_cleanup();
+        
+        printf("OK\n");
+    }
+    
+    // Test 8: Typed values
+    {
+        printf("Test 8: Typed values... ");
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        // Types are inferred from the text
+        const value_t *port = value_parse(&context->arena, "8080");
+        const value_t *flag = value_parse(&context->arena, "yes");
+        const value_t *name = value_parse(&context->arena, "8080 tcp");
+        const value_t *ports = value_parse(&context->arena, "[80, 'a, b', [1, 2]]");
+        const value_t *limits = value_parse(&context->arena, "{cpu: 2, tags: [web]}");
+        assert(port->type == VALUE_INT && port->integer == 8080);
+        assert(flag->type == VALUE_BOOL && flag->integer == 1 && strcmp(flag->text, "True") == 0);
+        assert(name->type == VALUE_STRING);
+        assert(ports->type == VALUE_LIST && ports->count == 3 && ports->items[0].type == VALUE_INT);
+        assert(ports->items[2].type == VALUE_LIST && ports->items[2].count == 2);
+        assert(strcmp(ports->text, "[80, 'a, b', [1, 2]]") == 0);
+        assert(value_contains(ports, "a, b", 4) && !value_contains(ports, "8", 1));
+        assert(value_map_get(limits, "cpu")->integer == 2 && value_map_get(limits, "mem") == NULL);
+        assert(strcmp(limits->text, "{cpu: 2, tags: [web]}") == 0);
+        assert(value_contains(limits, "tags", 4) && value_contains(name, "tcp", 3));
+        
+        // Typed and plain values replace each other; the text is not copied
+        int key = symbol_intern("port");
+        assert(context_set_var_id(context, key, "80") == ANCIBLE_SUCCESS);
+        assert(context_get_value_id(context, key) == NULL);
+        assert(context_set_value_id(context, key, port) == ANCIBLE_SUCCESS);
+        assert(context_get_var_id(context, key) == port->text);
+        assert(context_get_value_id(context, key) == port);
+        
+        // Copies share the values of their original
+        context_t *copy = context_clone(context);
+        assert(copy != NULL && context_get_value_id(copy, key) == port);
+        assert(context_set_var_id(copy, key, "443") == ANCIBLE_SUCCESS);
+        assert(context_get_value_id(copy, key) == NULL && context_get_value_id(context, key) == port);
+        context_free(copy);
+        
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        symbol_cleanup();
+        printf("OK\n");
+    }
+    
     printf("All context.c tests passed!\n");
     return 0;
 }
@@ -2,10 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "../../include/ancible.h"
 #include "../../include/core/context.h"
 #include "../../include/core/executor.h"
+#include "../../include/core/symbol.h"
+#include "../../include/core/template.h"
+#include "../../include/core/value.h"
 #include "../../include/modules/module.h"
+#include "../../include/transport/runner.h"
 
 /**
  * Create a test host
@@ -16,7 +21,11 @@ static host_t *create_test_host(void) {
     
     host->name = strdup("localhost");
     host->ansible_host = strdup("localhost");
-    host->next = NULL;
+    host->id = -1;
+    host->vars = NULL;
+    host->var_count = 0;
+    host->group_scope = NULL;
+    host->host_vars = NULL;
     
     return host;
 }
@@ -33,39 +42,39 @@ static void free_test_host(host_t *host) {
 }
 
 /**
- * Create a test playbook
+ * Create a test play
  */
-static playbook_t *create_test_playbook(void) {
-    playbook_t *playbook = malloc(sizeof(playbook_t));
-    assert(playbook != NULL);
+static play_t *create_test_play(void) {
+    play_t *play = calloc(1, sizeof(play_t));
+    assert(play != NULL);
     
-    playbook->hosts = strdup("all");
-    playbook->task_count = 1;
+    play->hosts = strdup("all");
+    play->task_count = 1;
     
-    playbook->tasks = malloc(sizeof(task_t));
+    play->tasks = calloc(1, sizeof(task_t));
     
-    playbook->tasks[0].name = strdup("Test command");
-    playbook->tasks[0].module = strdup("command");
+    play->tasks[0].name = strdup("Test command");
+    play->tasks[0].module = strdup("command");
     
-    return playbook;
+    return play;
 }
 
 /**
- * Free a test playbook
+ * Free a test play
  */
-static void free_test_playbook(playbook_t *playbook) {
-    if (!playbook) return;
+static void free_test_play(play_t *play) {
+    if (!play) return;
     
-    free(playbook->hosts);
+    free(play->hosts);
     
-    for (int i = 0; i < playbook->task_count; i++) {
-        free(playbook->tasks[i].name);
-        free(playbook->tasks[i].module);
+    for (int i = 0; i < play->task_count; i++) {
+        free(play->tasks[i].name);
+        free(play->tasks[i].module);
     }
     
-    free(playbook->tasks);
+    free(play->tasks);
     
-    free(playbook);
+    free(play);
 }
 
 /**
@@ -115,9 +124,9 @@ int main(void) {
         printf("Test 3: Executing command module... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 0);
+        context_t *context = context_create(host, play, 0);
         assert(context != NULL);
         
         // Set local connection
@@ -135,16 +144,304 @@ int main(void) {
         assert(strstr(result.cmd_result.stdout_data, "Hello from executor!") != NULL);
         
         module_result_free(&result);
+        
+        // Arguments are rendered for the host
+        context_set_var(context, "greeting", "Hello");
+        assert(executor_run_task(context, 0, "echo {{ greeting }} from {{ ansible_host }}", &result) == ANCIBLE_SUCCESS);
+        assert(strcmp(result.cmd_result.stdout_data, "Hello from localhost\n") == 0);
+        module_result_free(&result);
+        
+        // An undefined variable fails the task
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "echo {{ nobody }}", &result) == ANCIBLE_ERROR);
+        assert(result.failed == 1 && strcmp(result.msg, "Undefined variable 'nobody'") == 0);
+        module_result_free(&result);
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 4: Execute a loop, one item at a time and batched
+    {
+        printf("Test 4: Executing loop items... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        task_t *task = &play->tasks[0];
+        task->loop_var = strdup("fruits");
+        task->when = strdup("skip != ${item}");
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        context_set_var(context, "ansible_connection", "local");
+        context_set_var(context, "fruits", "[apple, skip, pear]");
+        
+        for (int batch = 0; batch <= 1; batch++) {
+            task->loop_batch = batch;
+            
+            module_result_t result;
+            module_result_init(&result);
+            int ret = executor_run_task(context, 0, "echo {{ item }}-{{item}}", &result);
+            
+            assert(ret == ANCIBLE_SUCCESS);
+            assert(result.item_count == 3);
+            assert(result.changed == 1 && result.failed == 0);
+            
+            // Results are kept in item order
+            assert(strcmp(result.items[0].item, "apple") == 0);
+            assert(strcmp(result.items[0].cmd_result.stdout_data, "apple-apple\n") == 0);
+            assert(result.items[1].skipped == 1);
+            assert(strcmp(result.items[2].cmd_result.stdout_data, "pear-pear\n") == 0);
+            
+            // The item is not left behind for the tasks that follow
+            assert(context_get_var(context, "item") == NULL);
+            module_result_free(&result);
+        }
+        
+        // An item whose condition fails does not fail the items that ran
+        free(task->when);
+        task->when = strdup("{{ item }}");
+        task->when_template = template_compile(task->when);
+        assert(task->when_template != NULL);
+        context_set_var(context, "fruits", "[true, a b, yes]");
+        context_set_var(context, "item", "outer");
+        for (int batch = 0; batch <= 1; batch++) {
+            task->loop_batch = batch;
+            
+            module_result_t result;
+            module_result_init(&result);
+            assert(executor_run_task(context, 0, "echo {{ item }}", &result) == ANCIBLE_ERROR);
+            assert(result.item_count == 3 && result.items[1].failed == 1);
+            assert(result.items[0].failed == 0 && strcmp(result.items[0].cmd_result.stdout_data, "true\n") == 0);
+            assert(result.items[2].failed == 0 && strcmp(result.items[2].cmd_result.stdout_data, "yes\n") == 0);
+            module_result_free(&result);
+            
+            // An item set before the loop (an enclosing loop's) comes back
+            assert(strcmp(context_get_var(context, "item"), "outer") == 0);
+        }
+        task->loop_batch = 0;
+        template_free(task->when_template);
+        task->when_template = NULL;
+        
+        // A loop over something that is not a list fails the task
+        context_set_var(context, "fruits", "{a: 1}");
+        module_result_t result;
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "echo {{ item }}", &result) == ANCIBLE_ERROR);
+        assert(result.failed == 1);
+        module_result_free(&result);
+        
+        free(task->loop_var);
+        free(task->when);
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 5: Execute loop items in parallel
+    {
+        printf("Test 5: Executing loop items in parallel... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        task_t *task = &play->tasks[0];
+        task->loop_var = strdup("delays");
+        task->loop_parallel = 4;
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        context_set_var(context, "ansible_connection", "local");
+        context_set_var(context, "delays", "[0.4, 0.3, 0.2, 0.1]");
+        
+        // Without a fork limit the four items overlap
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        
+        module_result_t result;
+        module_result_init(&result);
+        int ret = executor_run_task(context, 0, "sleep {{ item }}; echo {{ item }}", &result);
+        
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        
+        assert(ret == ANCIBLE_SUCCESS);
+        assert(result.item_count == 4);
+        assert(elapsed < 0.9);
+        
+        // Results stay in item order even though the last item ends first
+        assert(strcmp(result.items[0].cmd_result.stdout_data, "0.4\n") == 0);
+        assert(strcmp(result.items[3].cmd_result.stdout_data, "0.1\n") == 0);
+        module_result_free(&result);
+        
+        // The global fork limit still applies
+        runner_set_fork_limit(1);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        
+        module_result_init(&result);
+        ret = executor_run_task(context, 0, "sleep {{ item }}", &result);
+        
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        
+        assert(ret == ANCIBLE_SUCCESS);
+        assert(elapsed >= 1.0);
+        module_result_free(&result);
+        runner_set_fork_limit(0);
+        
+        free(task->loop_var);
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 6: Register results for later tasks
+    {
+        printf("Test 6: Registering results... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        task_t *task = &play->tasks[0];
+        task->register_var = strdup("out");
+        task->register_key = symbol_intern("out");
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        context_set_var(context, "ansible_connection", "local");
+        
+        module_result_t result;
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "printf 'one\\ntwo\\n'; echo oops >&2; exit 3", &result) == ANCIBLE_SUCCESS);
+        assert(result.registered == 1);
+        char *data = result.cmd_result.stdout_data;
+        module_result_free(&result);
+        
+        // The output buffer moved to the context, without its trailing newline
+        registered_t *out = context_get_result(context, task->register_key);
+        assert(out != NULL && out->stdout_data == data);
+        assert(strcmp(out->stdout_data, "one\ntwo") == 0 && out->line_count == -1);
+        
+        template_t *template = template_compile("{{ out.rc }}/{{ out.stderr }}/{{ out.stdout_lines | join(',') }}/"
+                                                "{{ out.stdout_lines }}/{{ out.stdout_lines | length }}/{{ out.changed }}");
+        assert(template != NULL);
+        assert(strcmp(template_render(template, context, &context->render),
+                      "3/oops/one,two/['one', 'two']/2/False") == 0);
+        assert(out->line_count == 2);
+        template_free(template);
+        
+        // A second task sees the result in its condition and arguments
+        task->register_var[0] = 'x';
+        task->register_key = symbol_intern("xut");
+        task->when = strdup("{{ out.rc }} == 3");
+        task->when_template = template_compile(task->when);
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "echo {{ out.stdout_lines | join('+') }}", &result) == ANCIBLE_SUCCESS);
+        assert(result.skipped == 0 && strcmp(result.cmd_result.stdout_data, "one+two") == 0);
+        module_result_free(&result);
+        
+        // Skipped tasks register too, without output
+        free(task->when);
+        template_free(task->when_template);
+        task->when = strdup("{{ out.rc }} == 0");
+        task->when_template = template_compile(task->when);
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "echo never", &result) == ANCIBLE_SUCCESS);
+        module_result_free(&result);
+        out = context_get_result(context, task->register_key);
+        assert(out->skipped == 1 && out->stdout_data == NULL && out->rc[0] == '\0');
+        
+        template = template_compile("{{ xut.stdout }}");
+        assert(template_render(template, context, &context->render) == NULL);
+        assert(strcmp(context->render.data, "Undefined variable 'xut.stdout'") == 0);
+        template_free(template);
+        assert(template_compile("{{ out.nothing }}") == NULL);
+        
+        free(task->register_var);
+        free(task->when);
+        template_free(task->when_template);
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 7: Typed facts
+    {
+        printf("Test 7: Setting facts... ");
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        
+        task_t *task = &play->tasks[0];
+        free(task->module);
+        task->module = strdup("set_fact");
+        
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        context_set_var(context, "ansible_connection", "local");
+        
+        module_result_t result;
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "packages=[nginx, 'web server'] port=8080 debug=false",
+                                 &result) == ANCIBLE_SUCCESS);
+        assert(result.failed == 0 && result.changed == 0);
+        module_result_free(&result);
+        
+        // Facts keep their type, and their text for string lookups
+        const value_t *packages = context_get_value_id(context, symbol_find("packages"));
+        assert(packages != NULL && packages->type == VALUE_LIST && packages->count == 2);
+        assert(value_contains(packages, "web server", 10) && !value_contains(packages, "web", 3));
+        assert(context_get_value_id(context, symbol_find("port"))->integer == 8080);
+        assert(strcmp(context_get_var(context, "debug"), "False") == 0);
+        
+        template_t *template = template_compile("{{ packages | length }} {{ packages | join('/') }} "
+                                                "{{ packages | to_json }} {{ port | to_json }} {{ debug | to_json }}");
+        assert(template != NULL);
+        assert(strcmp(template_render(template, context, &context->render),
+                      "2 nginx/web server [\"nginx\", \"web server\"] 8080 false") == 0);
+        template_free(template);
+        
+        // A loop walks the items of a typed list as they are
+        free(task->module);
+        task->module = strdup("command");
+        task->loop_var = strdup("packages");
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "echo {{ item }}", &result) == ANCIBLE_SUCCESS);
+        assert(result.item_count == 2 && strcmp(result.items[1].item, "web server") == 0);
+        assert(strcmp(result.items[1].cmd_result.stdout_data, "web server\n") == 0);
+        module_result_free(&result);
+        free(task->loop_var);
+        task->loop_var = NULL;
+        
+        // Bad names set nothing
+        free(task->module);
+        task->module = strdup("set_fact");
+        module_result_init(&result);
+        assert(executor_run_task(context, 0, "ok=1 2bad=3", &result) == ANCIBLE_SUCCESS);
+        assert(result.failed == 1 && context_get_var(context, "ok") == NULL);
+        module_result_free(&result);
+        
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
         
         printf("OK\n");
     }
     
-    // Test 4: Clean up
+    // Test 8: Clean up
     {
-        printf("Test 4: Cleaning up executor... ");
+        printf("Test 8: Cleaning up executor... ");
         
         executor_cleanup();
         
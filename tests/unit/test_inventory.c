@@ -4,6 +4,7 @@
 #include <assert.h>
 #include "../../include/ancible.h"
 #include "../../include/core/inventory.h"
+#include "../../include/core/symbol.h"
 
 /**
  * Test for inventory.c functionality
@@ -20,14 +21,14 @@ int main(void) {
         assert(result == ANCIBLE_SUCCESS);
         
         // Check that we have the expected groups
-        group_t *group = inventory.groups;
-        int group_count = 0;
+        int group_count = inventory.group_count;
         int found_webservers = 0;
         int found_dbservers = 0;
         int found_all = 0;
         
-        while (group) {
-            group_count++;
+        for (int i = 0; i < inventory.group_count; i++) {
+            group_t *group = inventory.groups[i];
+            assert(group->id == i);
             if (strcmp(group->name, "webservers") == 0) {
                 found_webservers = 1;
             } else if (strcmp(group->name, "dbservers") == 0) {
@@ -35,7 +36,6 @@ int main(void) {
             } else if (strcmp(group->name, "all") == 0) {
                 found_all = 1;
             }
-            group = group->next;
         }
         
         assert(group_count >= 3); // at least webservers, dbservers, and all
@@ -44,20 +44,25 @@ int main(void) {
         assert(found_all);
         
         // Check that we can get hosts from a group
-        host_t *webservers = inventory_get_hosts(&inventory, "webservers");
+        const bitset_t *webservers = inventory_get_hosts(&inventory, "webservers");
         assert(webservers != NULL);
-        
-        int web_host_count = 0;
-        host_t *host = webservers;
-        while (host) {
-            web_host_count++;
-            host = host->next;
-        }
-        assert(web_host_count == 2); // web01 and web02
+        assert(bitset_count(webservers) == 2); // web01 and web02
+        assert(bitset_test(webservers, inventory_find_host(&inventory, "web01")->id));
+        assert(bitset_test(webservers, inventory_find_host(&inventory, "web02")->id));
         
         // Check that we can get hosts from the "all" group
-        host_t *all_hosts = inventory_get_hosts(&inventory, "all");
+        const bitset_t *all_hosts = inventory_get_hosts(&inventory, "all");
         assert(all_hosts != NULL);
+        assert(bitset_count(all_hosts) == inventory.host_count);
+        assert(inventory.host_count == 3);
+        
+        // [servers:children] pulls in the hosts of both groups
+        const bitset_t *servers = inventory_get_hosts(&inventory, "servers");
+        assert(servers != NULL);
+        assert(bitset_count(servers) == 3);
+        assert(inventory_find_host(&inventory, "webservers") == NULL);
+        
+        assert(inventory_get_hosts(&inventory, "missing") == NULL);
         
         inventory_free(&inventory);
         printf("OK\n");
@@ -73,6 +78,289 @@ int main(void) {
         printf("OK\n");
     }
     
+    // Test 3: Hash-indexed lookups over a large inventory
+    {
+        printf("Test 3: Indexed lookups over 20000 hosts... ");
+        const char *path = "runtime/test_inventory_large.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        for (int g = 0; g < 20; g++) {
+            fprintf(file, "[group%02d]\n", g);
+            for (int h = 0; h < 1000; h++) {
+                fprintf(file, "host%05d ansible_host=10.%d.%d.%d\n", g * 1000 + h, g, h / 256, h % 256);
+            }
+        }
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 20000);
+        assert(inventory.group_count == 21);
+        
+        // Host IDs are dense and follow declaration order
+        for (int i = 0; i < inventory.host_count; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "host%05d", i);
+            host_t *host = inventory_find_host(&inventory, name);
+            assert(host != NULL);
+            assert(host->id == i);
+            assert(inventory.hosts[i] == host);
+        }
+        assert(strcmp(inventory_find_host(&inventory, "host12345")->ansible_host, "10.12.1.89") == 0);
+        assert(inventory_find_host(&inventory, "host20000") == NULL);
+        assert(inventory_find_group(&inventory, "group07")->id == 8);
+        assert(inventory_find_group(&inventory, "group20") == NULL);
+        
+        inventory_free(&inventory);
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 4: Groups share one host record
+    {
+        printf("Test 4: Sharing hosts across groups... ");
+        const char *path = "runtime/test_inventory_shared.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb01 ansible_host=10.0.0.1\nweb02\n");
+        fprintf(file, "[prod]\nweb02 ansible_host=10.0.0.2\nweb01\nweb01\n");
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 2);
+        
+        assert(bitset_count(inventory_get_hosts(&inventory, "all")) == 2);
+        
+        // Groups keep their declaration order
+        group_t *prod = inventory_find_group(&inventory, "prod");
+        assert(prod->host_count == 2 && prod->host_ids[0] == 1 && prod->host_ids[1] == 0);
+        
+        // Variables set in one group are seen through every group
+        group_t *web = inventory_find_group(&inventory, "web");
+        assert(web->host_count == 2);
+        assert(strcmp(inventory.hosts[web->host_ids[1]]->ansible_host, "10.0.0.2") == 0);
+        assert(inventory.hosts[web->host_ids[0]] == inventory_find_host(&inventory, "web01"));
+        
+        inventory_free(&inventory);
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 5: Children and vars sections
+    {
+        printf("Test 5: Group children and variables... ");
+        const char *path = "runtime/test_inventory_children.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[all:vars]\nntp = pool.ntp.org\nrole=generic\n");
+        fprintf(file, "[prod:children]\neu\nus\n");
+        fprintf(file, "[eu:children]\neu_web\n");
+        fprintf(file, "[eu_web]\nweb01\n[us]\nweb02\n[staging]\nweb03\n");
+        fprintf(file, "[prod:vars]\nrole=prod\ntier=1\n");
+        fprintf(file, "[eu:vars]\ntier=2\nmotd=\"hello world\"\n");
+        fprintf(file, "[us:vars]\ntier=3\n");
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 3);
+        
+        // Membership is flattened through every level of children
+        const bitset_t *prod = inventory_get_hosts(&inventory, "prod");
+        assert(bitset_count(prod) == 2);
+        assert(bitset_test(prod, inventory_find_host(&inventory, "web01")->id));
+        assert(bitset_test(prod, inventory_find_host(&inventory, "web02")->id));
+        assert(bitset_count(inventory_get_hosts(&inventory, "eu")) == 1);
+        assert(inventory_find_group(&inventory, "eu_web")->depth == 3);
+        
+        // Deeper groups win over their parents, which win over "all"
+        host_t *web01 = inventory_find_host(&inventory, "web01");
+        const char *tier = NULL, *role = NULL, *ntp = NULL, *motd = NULL;
+        for (int i = 0; i < web01->var_count; i++) {
+            const variable_t *var = web01->vars[i];
+            if (strcmp(var->name, "tier") == 0) tier = var->value;
+            if (strcmp(var->name, "role") == 0) role = var->value;
+            if (strcmp(var->name, "ntp") == 0) ntp = var->value;
+            if (strcmp(var->name, "motd") == 0) motd = var->value;
+        }
+        assert(tier && strcmp(tier, "2") == 0);
+        assert(role && strcmp(role, "prod") == 0);
+        assert(ntp && strcmp(ntp, "pool.ntp.org") == 0);
+        assert(motd && strcmp(motd, "hello world") == 0);
+        
+        // Hosts outside any vars group only see "all"
+        host_t *web03 = inventory_find_host(&inventory, "web03");
+        assert(web03->var_count == 2);
+        
+        inventory_free(&inventory);
+        
+        // Cycles are rejected
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[a:children]\nb\n[b:children]\na\n");
+        fclose(file);
+        assert(inventory_load(path, &inventory) == ANCIBLE_ERROR);
+        
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 6: Host ranges
+    {
+        printf("Test 6: Host ranges... ");
+        const char *path = "runtime/test_inventory_ranges.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb[001:500].example.com\n");
+        fprintf(file, "[db]\ndb-[a:c]\n");
+        fprintf(file, "[even]\nnode[0:8:2] ansible_host=10.0.0.1\n");
+        fprintf(file, "[rack]\nr[1:2]-n[1:3]\n");
+        fprintf(file, "[canary]\nweb[499:502].example.com\nweb010.example.com\n");
+        fprintf(file, "[web:vars]\nrole=web\n");
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        
+        // 500 + 3 + 5 + 6 + 2 new hosts (web499/500 and web010 already exist)
+        assert(inventory.host_count == 516);
+        assert(bitset_count(inventory_get_hosts(&inventory, "web")) == 500);
+        assert(bitset_count(inventory_get_hosts(&inventory, "canary")) == 5);
+        
+        // Range hosts have no record until they are used
+        int id = inventory_host_id(&inventory, "web042.example.com");
+        assert(id == 41);
+        assert(inventory.hosts[id] == NULL);
+        assert(inventory_host_id(&inventory, "web42.example.com") < 0);
+        assert(inventory_host_id(&inventory, "web000.example.com") < 0);
+        assert(inventory_host_id(&inventory, "node3") < 0);
+        assert(inventory_host_id(&inventory, "db-d") < 0);
+        
+        char name[64];
+        assert(strcmp(inventory_host_name(&inventory, id, name, sizeof(name)), "web042.example.com") == 0);
+        assert(strcmp(inventory_host_name(&inventory, inventory_host_id(&inventory, "db-b"), name, sizeof(name)), "db-b") == 0);
+        assert(inventory_host_id(&inventory, "r2-n3") >= 0);
+        
+        // Records are created on demand, with the range's and the groups' variables
+        host_t *host = inventory_host(&inventory, id);
+        assert(host != NULL && host->id == id);
+        assert(strcmp(host->name, "web042.example.com") == 0);
+        assert(inventory.hosts[id] == host);
+        assert(host->var_count == 1 && strcmp(host->vars[0]->value, "web") == 0);
+        
+        host = inventory_find_host(&inventory, "node6");
+        assert(host != NULL);
+        assert(strcmp(host->ansible_host, "10.0.0.1") == 0);
+        
+        // Overlapping declarations share the existing hosts
+        assert(inventory_host_id(&inventory, "web500.example.com") == 499);
+        assert(bitset_test(inventory_get_hosts(&inventory, "canary"), 499));
+        assert(bitset_test(inventory_get_hosts(&inventory, "canary"), 9));
+        
+        inventory_free(&inventory);
+        
+        // Malformed ranges are rejected
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb[5:1]\n");
+        fclose(file);
+        assert(inventory_load(path, &inventory) == ANCIBLE_ERROR);
+        
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 7: Host variables
+    {
+        printf("Test 7: Host variables... ");
+        const char *path = "runtime/test_inventory_host_vars.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\n");
+        fprintf(file, "web01 ansible_host=10.0.0.1 ansible_port=2222 motd='hello world' # comment\n");
+        fprintf(file, "web02 path=\"C:\\\\tmp \\\"x\\\"\" empty= escaped=a\\ b\n");
+        fprintf(file, "node[1:3] ansible_user=deploy rack=r1\n");
+        fprintf(file, "[db]\nweb01 ansible_port=2200\nnode2 rack=r2\n");
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        
+        host_t *host = inventory_find_host(&inventory, "web01");
+        assert(host != NULL);
+        assert(strcmp(host->ansible_host, "10.0.0.1") == 0);
+        assert(strcmp(host_get_var(host, "motd"), "hello world") == 0);
+        assert(strcmp(host_get_var(host, "ansible_port"), "2200") == 0);  // Later line wins
+        assert(host->host_vars->count == 3);
+        assert(host_get_var(host, "comment") == NULL);
+        
+        host = inventory_find_host(&inventory, "web02");
+        assert(strcmp(host_get_var(host, "path"), "C:\\tmp \"x\"") == 0);
+        assert(strcmp(host_get_var(host, "empty"), "") == 0);
+        assert(strcmp(host_get_var(host, "escaped"), "a b") == 0);
+        assert(host->ansible_host == NULL);
+        
+        // Range hosts share one table until a host line of their own changes it
+        host_t *node1 = inventory_find_host(&inventory, "node1");
+        host_t *node3 = inventory_find_host(&inventory, "node3");
+        assert(node1->host_vars == node3->host_vars);
+        assert(strcmp(host_get_var(node3, "ansible_user"), "deploy") == 0);
+        host_t *node2 = inventory_find_host(&inventory, "node2");
+        assert(node2->host_vars != node1->host_vars);
+        assert(strcmp(host_get_var(node2, "rack"), "r2") == 0);
+        assert(strcmp(host_get_var(node2, "ansible_user"), "deploy") == 0);
+        assert(strcmp(host_get_var(node1, "rack"), "r1") == 0);
+        
+        inventory_free(&inventory);
+        
+        // Words that are not assignments and unterminated quotes are rejected
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb01 ansible_host\n");
+        fclose(file);
+        assert(inventory_load(path, &inventory) == ANCIBLE_ERROR);
+        
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb01 motd='hello\n");
+        fclose(file);
+        assert(inventory_load(path, &inventory) == ANCIBLE_ERROR);
+        
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 8: Hosts in the same groups share one index of their variables
+    {
+        printf("Test 8: Shared group variable scopes... ");
+        const char *path = "runtime/test_inventory_scopes.ini";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb01\nweb02\nweb[03:04]\n[db]\ndb01\n");
+        fprintf(file, "[web:vars]\nhttp_port=80\n[all:vars]\nntp=pool.ntp.org\n");
+        fclose(file);
+        
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        
+        host_t *web01 = inventory_find_host(&inventory, "web01");
+        host_t *web04 = inventory_find_host(&inventory, "web04");
+        host_t *db01 = inventory_find_host(&inventory, "db01");
+        assert(web01->group_scope != NULL && web01->group_scope == web04->group_scope);
+        assert(db01->group_scope != NULL && db01->group_scope != web01->group_scope);
+        assert(inventory.group_scopes.count == 2);
+        
+        const variable_t *var = scope_find(web04->group_scope, symbol_find("http_port"));
+        assert(var != NULL && strcmp(var->value, "80") == 0);
+        assert(scope_find(db01->group_scope, symbol_find("http_port")) == NULL);
+        assert(strcmp(scope_find(db01->group_scope, symbol_find("ntp"))->value, "pool.ntp.org") == 0);
+        
+        inventory_free(&inventory);
+        remove(path);
+        printf("OK\n");
+    }
+    
     printf("All inventory.c tests passed!\n");
     return 0;
 }
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "../../include/ancible.h"
+#include "../../include/core/context.h"
+#include "../../include/core/inventory.h"
+#include "../../include/core/symbol.h"
+#include "../../include/modules/module.h"
+#include "../../include/modules/add_host.h"
+#include "../../include/modules/group_by.h"
+
+#define WORKERS 8
+#define HOSTS_PER_WORKER 200
+
+/**
+ * Work of one concurrent add_host worker
+ */
+typedef struct {
+    inventory_t *inventory;
+    int worker;
+} worker_arg_t;
+
+/**
+ * Add hosts from a worker thread, as parallel loop items would
+ */
+static void *add_hosts_worker(void *arg) {
+    worker_arg_t *work = arg;
+    char name[64];
+    int created;
+
+    for (int i = 0; i < HOSTS_PER_WORKER; i++) {
+        snprintf(name, sizeof(name), "dyn-%d-%d", work->worker, i);
+        int id = inventory_runtime_add_host(work->inventory, name, 0, NULL, NULL, &created);
+        assert(id >= 0 && created);
+        assert(inventory_runtime_add_group_host(work->inventory, id, "dynamic", NULL) == 1);
+        assert(inventory_runtime_add_group_host(work->inventory, id, i % 2 ? "odd" : "even", "dynamic") >= 0);
+    }
+
+    return NULL;
+}
+
+/**
+ * Test for the add_host and group_by modules and runtime inventory changes
+ */
+int main(void) {
+    printf("Running inventory module tests\n");
+
+    const char *path = "runtime/test_inventory_modules.ini";
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "[web]\nweb01\nweb02\n[web:vars]\nhttp_port=80\n[linux:children]\nweb\n");
+    fclose(file);
+
+    inventory_t inventory;
+    assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+
+    play_t play;
+    memset(&play, 0, sizeof(play));
+    context_t *context = context_create(inventory_find_host(&inventory, "web01"), &play, 0);
+    assert(context != NULL);
+    context->inventory = &inventory;
+
+    // Test 1: Module argument parsing
+    {
+        printf("Test 1: Module arguments... ");
+        module_args_t parsed;
+        assert(module_args_parse("name=web05 motd='hello world' msg=a b c", &parsed) == ANCIBLE_SUCCESS);
+        assert(parsed.count == 3);
+        assert(strcmp(module_args_get(&parsed, "name"), "web05") == 0);
+        assert(strcmp(module_args_get(&parsed, "motd"), "hello world") == 0);
+        assert(strcmp(module_args_get(&parsed, "msg"), "a b c") == 0);
+        assert(module_args_get(&parsed, "groups") == NULL);
+        module_args_free(&parsed);
+
+        assert(module_args_parse("web05", &parsed) == ANCIBLE_ERROR);
+        assert(module_args_parse("motd='hello", &parsed) == ANCIBLE_ERROR);
+
+        const char *list = "[web, 'db']";
+        char item[32];
+        assert(module_list_next(&list, item, sizeof(item)) && strcmp(item, "web") == 0);
+        assert(module_list_next(&list, item, sizeof(item)) && strcmp(item, "db") == 0);
+        assert(!module_list_next(&list, item, sizeof(item)));
+        printf("OK\n");
+    }
+
+    // Test 2: add_host
+    {
+        printf("Test 2: add_host... ");
+        module_result_t result;
+        assert(add_host_module_exec(context, "name=web05 groups=web,canary ansible_host=10.0.0.5", &result) == ANCIBLE_SUCCESS);
+        assert(!result.failed && result.changed);
+        module_result_free(&result);
+
+        // Membership, the name index and group variables are current right away
+        int id = inventory_host_id(&inventory, "web05");
+        assert(id == 2);
+        assert(bitset_test(inventory_get_hosts(&inventory, "web"), id));
+        assert(bitset_test(inventory_get_hosts(&inventory, "linux"), id));
+        assert(bitset_test(inventory_get_hosts(&inventory, "canary"), id));
+        assert(bitset_count(inventory_get_hosts(&inventory, "all")) == 3);
+
+        host_t *host = inventory_host(&inventory, id);
+        assert(strcmp(host->ansible_host, "10.0.0.5") == 0);
+        assert(host->var_count == 1 && strcmp(host->vars[0]->value, "80") == 0);
+
+        // Running it again changes nothing
+        assert(add_host_module_exec(context, "name=web05 groups=web,canary", &result) == ANCIBLE_SUCCESS);
+        assert(!result.failed && !result.changed);
+        module_result_free(&result);
+
+        assert(add_host_module_exec(context, "groups=web", &result) == ANCIBLE_SUCCESS);
+        assert(result.failed);
+        module_result_free(&result);
+        printf("OK\n");
+    }
+
+    // Test 3: group_by
+    {
+        printf("Test 3: group_by... ");
+        module_result_t result;
+        assert(group_by_module_exec(context, "key=kernel 6.1 parents=kernels", &result) == ANCIBLE_SUCCESS);
+        assert(!result.failed && result.changed);
+        module_result_free(&result);
+
+        const group_t *group = inventory_find_group(&inventory, "kernel_6.1");
+        assert(group != NULL && group->depth == 2);
+        assert(bitset_count(&group->members) == 1);
+        assert(bitset_test(inventory_get_hosts(&inventory, "kernels"), context->host->id));
+
+        // Group variables set later still follow precedence: deeper groups win
+        assert(group_set_var(inventory_find_group(&inventory, "kernels"), "motd", "kernels") == ANCIBLE_SUCCESS);
+        assert(group_set_var(inventory_find_group(&inventory, "kernel_6.1"), "motd", "kernel 6.1") == ANCIBLE_SUCCESS);
+        context_t *other = context_create(inventory_find_host(&inventory, "web02"), &play, 0);
+        assert(other != NULL);
+        other->inventory = &inventory;
+        assert(group_by_module_exec(other, "kernel_6.1", &result) == ANCIBLE_SUCCESS);
+        assert(!result.failed && result.changed);
+        module_result_free(&result);
+        const host_t *host = other->host;
+        for (int i = 0; i < host->var_count; i++) {
+            if (strcmp(host->vars[i]->name, "motd") == 0) {
+                assert(strcmp(host->vars[i]->value, "kernel 6.1") == 0);
+            }
+        }
+        assert(bitset_count(inventory_get_hosts(&inventory, "kernels")) == 2);
+        context_free(other);
+
+        assert(group_by_module_exec(context, "key=kernel_6.1", &result) == ANCIBLE_SUCCESS);
+        assert(!result.failed && !result.changed);
+        module_result_free(&result);
+        printf("OK\n");
+    }
+
+    // Test 4: Concurrent runtime changes
+    {
+        printf("Test 4: Concurrent add_host... ");
+        pthread_t threads[WORKERS];
+        worker_arg_t args[WORKERS];
+        int before = inventory.host_count;
+        for (int i = 0; i < WORKERS; i++) {
+            args[i].inventory = &inventory;
+            args[i].worker = i;
+            assert(pthread_create(&threads[i], NULL, add_hosts_worker, &args[i]) == 0);
+        }
+        for (int i = 0; i < WORKERS; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        assert(inventory.host_count == before + WORKERS * HOSTS_PER_WORKER);
+        assert(bitset_count(inventory_get_hosts(&inventory, "dynamic")) == WORKERS * HOSTS_PER_WORKER);
+        assert(bitset_count(inventory_get_hosts(&inventory, "odd")) == WORKERS * HOSTS_PER_WORKER / 2);
+        assert(inventory_host_id(&inventory, "dyn-7-199") >= before);
+        printf("OK\n");
+    }
+
+    context_free(context);
+    inventory_free(&inventory);
+    remove(path);
+    symbol_cleanup();
+
+    printf("All inventory module tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../include/ancible.h"
+#include "../../include/core/inventory.h"
+#include "../../include/core/inventory_source.h"
+#include "../../include/core/snapshot.h"
+#include "../../include/core/symbol.h"
+
+/**
+ * Count the lines of a file (0 if it does not exist)
+ */
+static int count_lines(const char *path) {
+    FILE *file = fopen(path, "r");
+    int count = 0;
+    int c;
+
+    if (!file) {
+        return 0;
+    }
+    while ((c = fgetc(file)) != EOF) {
+        count += c == '\n';
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * Test for inventory_source.c and snapshot.c functionality
+ */
+int main(void) {
+    printf("Running inventory source tests\n");
+
+    setenv("ANCIBLE_CACHE_DIR", "runtime/inventory_cache", 1);
+    unsetenv("ANCIBLE_INVENTORY_CACHE_TTL");
+
+    // Test 1: JSON inventory in the dynamic inventory script format
+    {
+        printf("Test 1: JSON inventory... ");
+        const char *path = "runtime/test_inventory_source.json";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "{\n");
+        fprintf(file, "  \"web\": {\"hosts\": [\"web01\", \"web02\"], \"vars\": {\"http_port\": 80}},\n");
+        fprintf(file, "  \"db\": [\"db01\"],\n");
+        fprintf(file, "  \"prod\": {\"children\": [\"web\", \"db\"], \"vars\": {\"env\": \"prod\", \"http_port\": 8080}},\n");
+        fprintf(file, "  \"_meta\": {\"hostvars\": {\n");
+        fprintf(file, "    \"web01\": {\"ansible_host\": \"10.0.0.1\", \"tags\": [\"a\", \"b\"]},\n");
+        fprintf(file, "    \"db01\": {\"ansible_user\": \"postgres\"},\n");
+        fprintf(file, "    \"lone\": {\"motd\": \"hello world\"}\n");
+        fprintf(file, "  }}\n");
+        fprintf(file, "}\n");
+        fclose(file);
+
+        inventory_t inventory;
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 4);
+        assert(bitset_count(inventory_get_hosts(&inventory, "prod")) == 3);
+        assert(bitset_count(inventory_get_hosts(&inventory, "all")) == 4);
+
+        host_t *host = inventory_find_host(&inventory, "web01");
+        assert(host != NULL && host->id == 0);
+        assert(strcmp(host->ansible_host, "10.0.0.1") == 0);
+        assert(strcmp(host_get_var(host, "tags"), "[a, b]") == 0);
+
+        // The deeper group wins
+        int found = 0;
+        for (int i = 0; i < host->var_count; i++) {
+            if (strcmp(host->vars[i]->name, "http_port") == 0) {
+                assert(strcmp(host->vars[i]->value, "80") == 0);
+                found = 1;
+            }
+        }
+        assert(found);
+
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "db01"), "ansible_user"), "postgres") == 0);
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "lone"), "motd"), "hello world") == 0);
+        inventory_free(&inventory);
+
+        remove(path);
+        printf("OK\n");
+    }
+
+    // Test 2: YAML inventory in the nested format
+    {
+        printf("Test 2: YAML inventory... ");
+        const char *path = "runtime/test_inventory_source.yml";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "all:\n");
+        fprintf(file, "  vars:\n");
+        fprintf(file, "    ntp: pool.ntp.org\n");
+        fprintf(file, "  children:\n");
+        fprintf(file, "    web:\n");
+        fprintf(file, "      hosts:\n");
+        fprintf(file, "        web01:\n");
+        fprintf(file, "          ansible_port: 2222\n");
+        fprintf(file, "        web02:\n");
+        fprintf(file, "      children:\n");
+        fprintf(file, "        canary:\n");
+        fprintf(file, "          hosts:\n");
+        fprintf(file, "            web03:\n");
+        fprintf(file, "    db:\n");
+        fprintf(file, "      hosts: [db01]\n");
+        fclose(file);
+
+        inventory_t inventory;
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 4);
+        assert(bitset_count(inventory_get_hosts(&inventory, "web")) == 3);
+        assert(bitset_count(inventory_get_hosts(&inventory, "canary")) == 1);
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "web01"), "ansible_port"), "2222") == 0);
+
+        host_t *host = inventory_find_host(&inventory, "db01");
+        assert(host->var_count == 1 && strcmp(host->vars[0]->value, "pool.ntp.org") == 0);
+        inventory_free(&inventory);
+
+        // Unknown keys in a group are rejected
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "all:\n  host:\n    web01:\n");
+        fclose(file);
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_ERROR);
+
+        remove(path);
+        printf("OK\n");
+    }
+
+    // Test 3: Inventory scripts and the cache
+    {
+        printf("Test 3: Inventory script with cache... ");
+        const char *path = "runtime/test_inventory_script.sh";
+        const char *runs = "runtime/test_inventory_script.runs";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "#!/bin/sh\n");
+        fprintf(file, "[ \"$1\" = \"--list\" ] || exit 2\n");
+        fprintf(file, "echo run >> %s\n", runs);
+        fprintf(file, "echo '{\"app\": {\"hosts\": [\"app01\", \"app02\"]}, "
+                      "\"_meta\": {\"hostvars\": {\"app02\": {\"ansible_host\": \"10.1.0.2\"}}}}'\n");
+        fclose(file);
+        chmod(path, 0755);
+        remove(runs);
+
+        inventory_t inventory;
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(count_lines(runs) == 1);
+        assert(bitset_count(inventory_get_hosts(&inventory, "app")) == 2);
+        inventory_free(&inventory);
+
+        // The second load comes from the cache, with the same hosts and variables
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(count_lines(runs) == 1);
+        assert(inventory_host_id(&inventory, "app02") == 1);
+        assert(strcmp(inventory_find_host(&inventory, "app02")->ansible_host, "10.1.0.2") == 0);
+        assert(bitset_count(inventory_get_hosts(&inventory, "app")) == 2);
+        inventory_free(&inventory);
+
+        // A TTL of 0 disables the cache
+        setenv("ANCIBLE_INVENTORY_CACHE_TTL", "0", 1);
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(count_lines(runs) == 2);
+        inventory_free(&inventory);
+        unsetenv("ANCIBLE_INVENTORY_CACHE_TTL");
+
+        // Flushing ignores the cache entry
+        inventory_cache_flush();
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(count_lines(runs) == 3);
+        inventory_free(&inventory);
+
+        // A failing script is an error
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "#!/bin/sh\necho 'no CMDB' >&2\nexit 1\n");
+        fclose(file);
+        assert(inventory_load_source(path, &inventory) == ANCIBLE_ERROR);
+
+        remove(path);
+        remove(runs);
+        printf("OK\n");
+    }
+
+    // Test 4: Snapshot round trip
+    {
+        printf("Test 4: Snapshot round trip... ");
+        const char *path = "runtime/test_inventory_snapshot.ini";
+        const char *snapshot = "runtime/test_inventory.snap";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb[01:50] ansible_user=deploy\nweb07 motd='hi there'\n");
+        fprintf(file, "[db]\ndb01\n[prod:children]\nweb\ndb\n[prod:vars]\nenv=prod\n");
+        fclose(file);
+
+        inventory_t inventory;
+        assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+        assert(snapshot_save(&inventory, snapshot) == ANCIBLE_SUCCESS);
+
+        inventory_t loaded;
+        assert(snapshot_load(snapshot, &loaded) == ANCIBLE_SUCCESS);
+        assert(loaded.host_count == inventory.host_count);
+        assert(loaded.group_count == inventory.group_count);
+        for (int i = 0; i < inventory.group_count; i++) {
+            assert(strcmp(loaded.groups[i]->name, inventory.groups[i]->name) == 0);
+            assert(bitset_count(&loaded.groups[i]->members) == bitset_count(&inventory.groups[i]->members));
+        }
+
+        // Hosts are used in place until first needed
+        assert(loaded.hosts[6] == NULL);
+        assert(inventory_host_id(&loaded, "web07") == 6);
+        assert(inventory_host_id(&loaded, "web51") == -1);
+        assert(inventory_host_var_count(&loaded, 6) == 2);
+        assert(loaded.hosts[6] == NULL);
+
+        host_t *host = inventory_find_host(&loaded, "web07");
+        assert(host->id == 6 && loaded.hosts[6] == host);
+        assert(strcmp(host_get_var(host, "motd"), "hi there") == 0);
+        assert(strcmp(host_get_var(host, "ansible_user"), "deploy") == 0);
+        assert(host->var_count == 1 && strcmp(host->vars[0]->value, "prod") == 0);
+        inventory_free(&loaded);
+        inventory_free(&inventory);
+
+        // A truncated snapshot is rejected
+        file = fopen(snapshot, "r+");
+        assert(file != NULL);
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+        assert(truncate(snapshot, size / 2) == 0);
+        assert(snapshot_load(snapshot, &loaded) == ANCIBLE_ERROR);
+
+        remove(path);
+        remove(snapshot);
+        printf("OK\n");
+    }
+
+    // Test 5: Several sources and inventory directories
+    {
+        printf("Test 5: Merged inventory sources... ");
+        system("rm -rf runtime/test_inventory_dir && mkdir -p runtime/test_inventory_dir/group_vars");
+        FILE *file = fopen("runtime/test_inventory_dir/10-dc1.ini", "w");
+        assert(file != NULL);
+        fprintf(file, "[web]\nweb[01:03] dc=dc1\n[db]\ndb01 role=primary\n[web:vars]\nhttp_port=80\n");
+        fclose(file);
+        file = fopen("runtime/test_inventory_dir/20-dc2.json", "w");
+        assert(file != NULL);
+        fprintf(file, "{\"web\": {\"hosts\": [\"web03\", \"web04\"], \"vars\": {\"http_port\": 8080}},\n");
+        fprintf(file, " \"prod\": {\"children\": [\"web\", \"db\"]},\n");
+        fprintf(file, " \"_meta\": {\"hostvars\": {\"web03\": {\"dc\": \"dc2\"}}}}\n");
+        fclose(file);
+        file = fopen("runtime/test_inventory_dir/README.md", "w");
+        assert(file != NULL);
+        fprintf(file, "not an inventory\n");
+        fclose(file);
+        file = fopen("runtime/test_inventory_extra.ini", "w");
+        assert(file != NULL);
+        fprintf(file, "[db]\ndb01 role=replica\n");
+        fclose(file);
+
+        // Files load in name order; later sources win
+        const char *sources[] = { "runtime/test_inventory_dir", "runtime/test_inventory_extra.ini" };
+        inventory_t inventory;
+        assert(inventory_load_sources(sources, 2, &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 5);
+        assert(inventory_host_id(&inventory, "web03") == 2);
+        assert(inventory_host_id(&inventory, "db01") == 3);
+        assert(inventory_host_id(&inventory, "web04") == 4);
+        assert(bitset_count(inventory_get_hosts(&inventory, "web")) == 4);
+        assert(bitset_count(inventory_get_hosts(&inventory, "prod")) == 5);
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "web03"), "dc"), "dc2") == 0);
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "web01"), "dc"), "dc1") == 0);
+        assert(strcmp(host_get_var(inventory_find_host(&inventory, "db01"), "role"), "replica") == 0);
+
+        host_t *host = inventory_find_host(&inventory, "web02");
+        assert(host->var_count == 1 && strcmp(host->vars[0]->value, "8080") == 0);
+        inventory_free(&inventory);
+
+        // A directory given alone is merged the same way
+        assert(inventory_load_source("runtime/test_inventory_dir", &inventory) == ANCIBLE_SUCCESS);
+        assert(inventory.host_count == 5);
+        inventory_free(&inventory);
+
+        // Any failing source fails the whole load
+        const char *missing[] = { "runtime/test_inventory_extra.ini", "runtime/test_inventory_missing.ini" };
+        assert(inventory_load_sources(missing, 2, &inventory) == ANCIBLE_ERROR);
+
+        system("rm -rf runtime/test_inventory_dir runtime/test_inventory_extra.ini");
+        printf("OK\n");
+    }
+
+    system("rm -rf runtime/inventory_cache");
+    symbol_cleanup();
+
+    printf("All inventory source tests passed!\n");
+    return 0;
+}
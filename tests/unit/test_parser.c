@@ -4,6 +4,8 @@
 #include <assert.h>
 #include "../../include/ancible.h"
 #include "../../include/core/parser.h"
+#include "../../include/core/condition.h"
+#include "../../include/core/symbol.h"
 
 /**
  * Test for parser.c functionality
@@ -18,13 +20,17 @@ int main(void) {
         int result = parse_playbook("../../examples/playbooks/simple.yml", &playbook);
         
         assert(result == ANCIBLE_SUCCESS);
-        assert(playbook.hosts != NULL);
-        assert(strcmp(playbook.hosts, "all") == 0);
-        assert(playbook.task_count == 1);
-        assert(playbook.tasks[0].name != NULL);
-        assert(playbook.tasks[0].module != NULL);
-        assert(strcmp(playbook.tasks[0].name, "Echo a message") == 0);
-        assert(strcmp(playbook.tasks[0].module, "command") == 0);
+        assert(playbook.play_count == 1);
+        
+        play_t *play = &playbook.plays[0];
+        assert(play->hosts != NULL);
+        assert(strcmp(play->hosts, "all") == 0);
+        assert(play->task_count == 1);
+        assert(play->tasks[0].name != NULL);
+        assert(play->tasks[0].module != NULL);
+        assert(strcmp(play->tasks[0].name, "Echo a message") == 0);
+        assert(strcmp(play->tasks[0].module, "command") == 0);
+        assert(play->tasks[0].args != NULL);
         
         playbook_free(&playbook);
         printf("OK\n");
@@ -40,6 +46,280 @@ int main(void) {
         printf("OK\n");
     }
     
+    // Test 3: Parse playbook with multiple plays
+    {
+        printf("Test 3: Parsing playbook with multiple plays... ");
+        playbook_t playbook;
+        int result = parse_playbook("../../examples/playbooks/11_multiple_plays.yml", &playbook);
+        
+        assert(result == ANCIBLE_SUCCESS);
+        assert(playbook.play_count == 3);
+        
+        // Each play keeps its own hosts, vars and tasks
+        assert(strcmp(playbook.plays[0].hosts, "webservers") == 0);
+        assert(strcmp(playbook.plays[1].hosts, "dbservers") == 0);
+        assert(strcmp(playbook.plays[2].hosts, "all") == 0);
+        
+        assert(playbook.plays[0].vars != NULL);
+        assert(strcmp(playbook.plays[0].vars->name, "greeting") == 0);
+        assert(strcmp(playbook.plays[0].vars->value, "hello") == 0);
+        assert(strcmp(playbook.plays[1].vars->value, "bonjour") == 0);
+        assert(playbook.plays[2].vars == NULL);
+        
+        assert(playbook.plays[0].task_count == 1);
+        assert(strcmp(playbook.plays[0].tasks[0].name, "Greet web servers") == 0);
+        assert(strcmp(playbook.plays[0].tasks[0].args, "echo \"Preparing web servers\"") == 0);
+        
+        // "cmd:" form of the command module
+        assert(playbook.plays[1].task_count == 1);
+        assert(strcmp(playbook.plays[1].tasks[0].args, "echo \"Preparing database servers\"") == 0);
+        
+        playbook_free(&playbook);
+        printf("OK\n");
+    }
+    
+    // Test 4: Parse playbook with roles, import_tasks and include_tasks
+    {
+        printf("Test 4: Parsing roles and task files... ");
+        playbook_t playbook;
+        int result = parse_playbook("../../examples/playbooks/12_roles_and_includes.yml", &playbook);
+        
+        assert(result == ANCIBLE_SUCCESS);
+        assert(playbook.play_count == 1);
+        
+        // Role defaults are kept apart; play vars come before role parameters
+        play_t *play = &playbook.plays[0];
+        assert(strcmp(play->defaults->name, "motd") == 0 && strcmp(play->defaults->value, "from the role defaults") == 0);
+        assert(strcmp(play->defaults->next->name, "run_setup") == 0 && play->defaults->next->next == NULL);
+        const variable_t *var = play->vars;
+        assert(strcmp(var->name, "motd") == 0 && strcmp(var->value, "from the play") == 0);
+        var = var->next;
+        assert(strcmp(var->name, "http_port") == 0 && strcmp(var->value, "8080") == 0);
+        assert(var->next == NULL);
+        
+        // Role tasks come first, the web role imports a file of its own
+        assert(play->task_count == 6);
+        assert(strcmp(play->tasks[0].name, "Common role task") == 0);
+        assert(strcmp(play->tasks[1].name, "Web role task") == 0);
+        
+        // A conditional import becomes a block guarding the imported tasks
+        assert(play->tasks[2].type == TASK_TYPE_BLOCK);
+        assert(strcmp(play->tasks[2].when, "${run_setup}") == 0);
+        assert(play->tasks[2].subtask_count == 2);
+        assert(play->tasks[3].parent_idx == 2 && play->tasks[4].parent_idx == 2);
+        assert(strcmp(play->tasks[4].name, "Second setup step") == 0);
+        
+        // Includes keep the resolved path of their file
+        assert(play->tasks[5].type == TASK_TYPE_INCLUDE);
+        assert(play->tasks[5].parent_idx == -1);
+        const char *suffix = "playbooks/tasks/report.yml";
+        size_t len = strlen(play->tasks[5].args);
+        assert(len > strlen(suffix) && strcmp(play->tasks[5].args + len - strlen(suffix), suffix) == 0);
+        
+        // The included file is compiled once and then served from the cache
+        play_t *included = parse_task_file(play->tasks[5].args);
+        assert(included != NULL);
+        assert(included->task_count == 1);
+        assert(strcmp(included->tasks[0].name, "Report") == 0);
+        assert(parse_task_file("../../examples/playbooks/tasks/report.yml") == included);
+        assert(parse_task_file("../../examples/playbooks/tasks/missing.yml") == NULL);
+        
+        playbook_free(&playbook);
+        parser_cache_cleanup();
+        printf("OK\n");
+    }
+    
+    // Test 5: Parse loops
+    {
+        printf("Test 5: Parsing loops... ");
+        playbook_t playbook;
+        int result = parse_playbook("../../examples/playbooks/13_loops.yml", &playbook);
+        
+        assert(result == ANCIBLE_SUCCESS);
+        
+        play_t *play = &playbook.plays[0];
+        assert(play->task_count == 4);
+        
+        // Literal list
+        assert(play->tasks[0].loop_count == 3);
+        assert(strcmp(play->tasks[0].loop_items[2], "three") == 0);
+        assert(play->tasks[0].loop_var == NULL);
+        
+        // with_items over a variable
+        assert(play->tasks[1].loop_items == NULL);
+        assert(strcmp(play->tasks[1].loop_var, "users") == 0);
+        
+        // Flow list with batching
+        assert(play->tasks[2].loop_count == 3);
+        assert(strcmp(play->tasks[2].loop_items[0], "/tmp") == 0);
+        assert(play->tasks[2].loop_batch == 1);
+        assert(play->tasks[0].loop_batch == 0);
+        
+        // Parallel items
+        assert(play->tasks[3].loop_parallel == 3);
+        assert(play->tasks[0].loop_parallel == 0);
+        playbook_free(&playbook);
+        
+        // Facts set by parallel items would be lost, so set_fact and includes cannot run them
+        const char *path = "runtime/test_parser_loops.yml";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - set_fact: last={{ item }}\n"
+                      "      loop: [a, b, c]\n"
+                      "      loop_control:\n"
+                      "        parallel: 3\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_ERROR);
+        
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - include_tasks: tasks/report.yml\n"
+                      "      loop: [a, b]\n"
+                      "      loop_control:\n"
+                      "        parallel: 2\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_ERROR);
+        
+        // One item at a time, they keep what they set
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - set_fact: last={{ item }}\n"
+                      "      loop: [a, b, c]\n"
+                      "      loop_control:\n"
+                      "        parallel: 1\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_SUCCESS);
+        playbook_free(&playbook);
+        
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 6: Block and task variables
+    {
+        printf("Test 6: Parsing block and task variables... ");
+        const char *path = "runtime/test_parser_vars.yml";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  vars:\n"
+                      "    tier: play\n"
+                      "  tasks:\n"
+                      "    - command: echo plain\n"
+                      "    - block:\n"
+                      "        - command: echo inherited\n"
+                      "        - command: echo own\n"
+                      "          vars:\n"
+                      "            tier: task\n"
+                      "      vars:\n"
+                      "        tier: block\n"
+                      "        zone: a\n");
+        fclose(file);
+        
+        playbook_t playbook;
+        assert(parse_playbook(path, &playbook) == ANCIBLE_SUCCESS);
+        play_t *play = &playbook.plays[0];
+        assert(play->task_count == 4);
+        int tier = symbol_find("tier");
+        int zone = symbol_find("zone");
+        
+        assert(strcmp(scope_find(play->var_scope, tier)->value, "play") == 0);
+        assert(play->tasks[0].var_scope == NULL);
+        
+        // Block vars are folded into every task of the block, below the task's own
+        assert(strcmp(scope_find(play->tasks[1].var_scope, tier)->value, "block") == 0);
+        assert(play->tasks[2].var_scope == play->tasks[1].var_scope);
+        assert(strcmp(scope_find(play->tasks[3].var_scope, tier)->value, "task") == 0);
+        assert(strcmp(scope_find(play->tasks[3].var_scope, zone)->value, "a") == 0);
+        
+        playbook_free(&playbook);
+        remove(path);
+        printf("OK\n");
+    }
+    
+    // Test 7: Templates are compiled with the playbook
+    {
+        printf("Test 7: Compiling templates... ");
+        const char *path = "runtime/test_parser_templates.yml";
+        FILE *file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - name: Greet {{ user }}\n"
+                      "      command: echo {{ greeting }}\n"
+                      "      when: \"{{ enabled }}\"\n"
+                      "    - command: uptime\n"
+                      "      register: load\n"
+                      "      when:\n"
+                      "        - enabled\n"
+                      "        - port > 1024 or debug\n"
+                      "    - command: uptime\n"
+                      "      when: \"{{ packages | length }} > 2\"\n");
+        fclose(file);
+        
+        playbook_t playbook;
+        assert(parse_playbook(path, &playbook) == ANCIBLE_SUCCESS);
+        task_t *task = &playbook.plays[0].tasks[0];
+        assert(task->name_template != NULL && task->name_template->segment_count == 2);
+        assert(task->args_template != NULL && task->args_template->segments[1].expr->key == symbol_find("greeting"));
+        assert(task->condition != NULL && task->condition->type == CONDITION_VAR);
+        assert(task->condition->key == symbol_find("enabled") && task->when_template == NULL);
+        
+        // A list of conditions must all hold
+        task = &playbook.plays[0].tasks[1];
+        assert(strcmp(task->when, "(enabled) and (port > 1024 or debug)") == 0);
+        assert(task->condition != NULL && task->condition->type == CONDITION_AND);
+        assert(task->condition->right->type == CONDITION_OR && task->when_template == NULL);
+        
+        // Conditions beyond the condition compiler are rendered as templates
+        task = &playbook.plays[0].tasks[2];
+        assert(task->condition == NULL && template_is_dynamic(task->when_template));
+        task = &playbook.plays[0].tasks[0];
+        assert(!template_is_dynamic(playbook.plays[0].tasks[1].args_template));
+        assert(task->register_var == NULL);
+        assert(strcmp(playbook.plays[0].tasks[1].register_var, "load") == 0);
+        assert(playbook.plays[0].tasks[1].register_key == symbol_find("load"));
+        playbook_free(&playbook);
+        
+        // A malformed template is a parse error
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - command: echo {{ greeting\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_ERROR);
+        
+        // So is a register that is not a variable name
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - command: uptime\n"
+                      "      register: out.stdout\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_ERROR);
+        
+        // And a condition the compiler rejects outright, such as an unknown test
+        file = fopen(path, "w");
+        assert(file != NULL);
+        fprintf(file, "- hosts: all\n"
+                      "  tasks:\n"
+                      "    - command: uptime\n"
+                      "      when: 1 != 1 and 2 is bogus\n");
+        fclose(file);
+        assert(parse_playbook(path, &playbook) == ANCIBLE_ERROR);
+        
+        remove(path);
+        printf("OK\n");
+    }
+    
     printf("All parser.c tests passed!\n");
     return 0;
 }
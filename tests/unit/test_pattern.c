@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../../include/ancible.h"
+#include "../../include/core/inventory.h"
+#include "../../include/core/pattern.h"
+
+/**
+ * Resolve a pattern and return the matching host names, comma-separated
+ */
+static const char *resolve(const inventory_t *inventory, const char *pattern) {
+    static char names[1024];
+    char name[64];
+    bitset_t hosts;
+    bitset_init(&hosts);
+
+    assert(pattern_resolve(inventory, pattern, &hosts) == ANCIBLE_SUCCESS);
+
+    names[0] = '\0';
+    for (int id = bitset_next(&hosts, 0); id >= 0; id = bitset_next(&hosts, id + 1)) {
+        if (names[0]) {
+            strcat(names, ",");
+        }
+        strcat(names, inventory_host_name(inventory, id, name, sizeof(name)));
+    }
+
+    bitset_free(&hosts);
+    return names;
+}
+
+/**
+ * Test for pattern.c functionality
+ */
+int main(void) {
+    printf("Running pattern.c tests\n");
+
+    const char *path = "runtime/test_pattern.ini";
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "[web]\nweb01\nweb02\nweb03\nweb10\n");
+    fprintf(file, "[db]\ndb01\ndb02\n");
+    fprintf(file, "[prod]\nweb01\nweb02\ndb01\n");
+    fprintf(file, "[staging]\nweb03\ndb02\n");
+    fprintf(file, "[fleet]\nnode[08:12]\n");
+    fclose(file);
+
+    inventory_t inventory;
+    assert(inventory_load(path, &inventory) == ANCIBLE_SUCCESS);
+
+    // Test 1: Names and set algebra
+    {
+        printf("Test 1: Names, unions, intersections and exclusions... ");
+        assert(strcmp(resolve(&inventory, "all:!fleet"), "web01,web02,web03,web10,db01,db02") == 0);
+        assert(strcmp(resolve(&inventory, "*:!fleet"), "web01,web02,web03,web10,db01,db02") == 0);
+        assert(strcmp(resolve(&inventory, "db01"), "db01") == 0);
+        assert(strcmp(resolve(&inventory, "web:db"), "web01,web02,web03,web10,db01,db02") == 0);
+        assert(strcmp(resolve(&inventory, "web:&prod"), "web01,web02") == 0);
+        assert(strcmp(resolve(&inventory, "prod:!db01"), "web01,web02") == 0);
+        assert(strcmp(resolve(&inventory, "web,db,&prod,!web02"), "web01,db01") == 0);
+        // Exclusions apply last, wherever they are written
+        assert(strcmp(resolve(&inventory, "!staging:all:!fleet"), "web01,web02,web10,db01") == 0);
+        assert(strcmp(resolve(&inventory, "missing"), "") == 0);
+        assert(strcmp(resolve(&inventory, "!web"), "") == 0);
+        printf("OK\n");
+    }
+
+    // Test 2: Wildcards and regexes
+    {
+        printf("Test 2: Wildcards and regexes... ");
+        assert(strcmp(resolve(&inventory, "web0*"), "web01,web02,web03") == 0);
+        assert(strcmp(resolve(&inventory, "db0?:web1*"), "web10,db01,db02") == 0);
+        assert(strcmp(resolve(&inventory, "~web\\d0"), "web10") == 0);
+        assert(strcmp(resolve(&inventory, "~(db|web)0[12]:&~.*1$"), "web01,db01") == 0);
+        // Group names match too
+        assert(strcmp(resolve(&inventory, "~stag"), "web03,db02") == 0);
+        assert(strcmp(resolve(&inventory, "st*:!web*"), "db02") == 0);
+
+        bitset_t hosts;
+        bitset_init(&hosts);
+        assert(pattern_resolve(&inventory, "~web(", &hosts) == ANCIBLE_ERROR);
+        bitset_free(&hosts);
+        printf("OK\n");
+    }
+
+    // Test 3: Slices
+    {
+        printf("Test 3: Slices... ");
+        assert(strcmp(resolve(&inventory, "web[0]"), "web01") == 0);
+        assert(strcmp(resolve(&inventory, "web[-1]"), "web10") == 0);
+        assert(strcmp(resolve(&inventory, "web[1:2]"), "web02,web03") == 0);
+        assert(strcmp(resolve(&inventory, "web[2:]"), "web03,web10") == 0);
+        assert(strcmp(resolve(&inventory, "web[:1]:db[1]"), "web01,web02,db02") == 0);
+        assert(strcmp(resolve(&inventory, "all[0:6]:!web[0:2]"), "web10,db01,db02,node08") == 0);
+        // A non-numeric subscript is a wildcard class
+        assert(strcmp(resolve(&inventory, "web0[!2]"), "web01,web03") == 0);
+        printf("OK\n");
+    }
+
+    // Test 4: Range hosts
+    {
+        printf("Test 4: Range hosts... ");
+        assert(strcmp(resolve(&inventory, "node10"), "node10") == 0);
+        assert(strcmp(resolve(&inventory, "node1*"), "node10,node11,node12") == 0);
+        assert(strcmp(resolve(&inventory, "~node(09|11)"), "node09,node11") == 0);
+        assert(strcmp(resolve(&inventory, "fleet[-2:]:node08"), "node08,node11,node12") == 0);
+        // Resolving names never creates host records
+        for (int i = 0; i < inventory.host_count; i++) {
+            if (i >= 6) {
+                assert(inventory.hosts[i] == NULL);
+            }
+        }
+        printf("OK\n");
+    }
+
+    // Test 5: Limit
+    {
+        printf("Test 5: Limit... ");
+        bitset_t hosts;
+        bitset_init(&hosts);
+        assert(pattern_resolve_limited(&inventory, "web", "prod:staging", &hosts) == ANCIBLE_SUCCESS);
+        assert(bitset_count(&hosts) == 3);
+        assert(!bitset_test(&hosts, inventory_find_host(&inventory, "web10")->id));
+        assert(pattern_resolve_limited(&inventory, "web", NULL, &hosts) == ANCIBLE_SUCCESS);
+        assert(bitset_count(&hosts) == 4);
+        bitset_free(&hosts);
+        printf("OK\n");
+    }
+
+    inventory_free(&inventory);
+    remove(path);
+
+    printf("All pattern.c tests passed!\n");
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "../../include/core/context.h"
 #include "../../include/transport/runner.h"
 #include "../../include/transport/ssh.h"
+#include "../../include/transport/connection.h"
 
 /**
  * Create a test host
@@ -16,7 +17,11 @@ static host_t *create_test_host(void) {
     
     host->name = strdup("localhost");
     host->ansible_host = strdup("localhost");
-    host->next = NULL;
+    host->id = -1;
+    host->vars = NULL;
+    host->var_count = 0;
+    host->group_scope = NULL;
+    host->host_vars = NULL;
     
     return host;
 }
@@ -33,38 +38,38 @@ static void free_test_host(host_t *host) {
 }
 
 /**
- * Create a test playbook
+ * Create a test play
  */
-static playbook_t *create_test_playbook(void) {
-    playbook_t *playbook = malloc(sizeof(playbook_t));
-    assert(playbook != NULL);
+static play_t *create_test_play(void) {
+    play_t *play = calloc(1, sizeof(play_t));
+    assert(play != NULL);
     
-    playbook->hosts = strdup("all");
-    playbook->task_count = 1;
+    play->hosts = strdup("all");
+    play->task_count = 1;
     
-    playbook->tasks = malloc(sizeof(task_t));
+    play->tasks = calloc(1, sizeof(task_t));
     
-    playbook->tasks[0].name = strdup("Test task");
-    playbook->tasks[0].module = strdup("command");
+    play->tasks[0].name = strdup("Test task");
+    play->tasks[0].module = strdup("command");
     
-    return playbook;
+    return play;
 }
 
 /**
- * Free a test playbook
+ * Free a test play
  */
-static void free_test_playbook(playbook_t *playbook) {
-    if (!playbook) return;
+static void free_test_play(play_t *play) {
+    if (!play) return;
     
-    free(playbook->hosts);
+    free(play->hosts);
     
-    for (int i = 0; i < playbook->task_count; i++) {
-        free(playbook->tasks[i].name);
-        free(playbook->tasks[i].module);
+    for (int i = 0; i < play->task_count; i++) {
+        free(play->tasks[i].name);
+        free(play->tasks[i].module);
     }
     
-    free(playbook->tasks);
-    free(playbook);
+    free(play->tasks);
+    free(play);
 }
 
 /**
@@ -78,9 +83,9 @@ int main(void) {
         printf("Test 1: Running SSH command to localhost... ");
         
         host_t *host = create_test_host();
-        playbook_t *playbook = create_test_playbook();
+        play_t *play = create_test_play();
         
-        context_t *context = context_create(host, playbook, 0);
+        context_t *context = context_create(host, play, 0);
         assert(context != NULL);
         
         // Set variables
@@ -100,7 +105,31 @@ int main(void) {
         
         context_free(context);
         free_test_host(host);
-        free_test_playbook(playbook);
+        free_test_play(play);
+        
+        printf("OK\n");
+    }
+    
+    // Test 2: The port of a host must be a number
+    {
+        printf("Test 2: Checking ansible_port... ");
+        
+        assert(connection_port_valid("22") && connection_port_valid("65535"));
+        assert(!connection_port_valid("") && !connection_port_valid("0") && !connection_port_valid("70000"));
+        assert(!connection_port_valid("22; reboot") && !connection_port_valid("-p"));
+        
+        host_t *host = create_test_host();
+        play_t *play = create_test_play();
+        context_t *context = context_create(host, play, 0);
+        assert(context != NULL);
+        
+        command_result_t result;
+        context_set_var(context, "ansible_port", "22 -o ProxyCommand=false");
+        assert(run_ssh(context, "true", &result) == ANCIBLE_ERROR);
+        
+        context_free(context);
+        free_test_host(host);
+        free_test_play(play);
         
         printf("OK\n");
     }
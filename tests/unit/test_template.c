@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../../include/ancible.h"
+#include "../../include/core/context.h"
+#include "../../include/core/symbol.h"
+#include "../../include/core/template.h"
+
+/**
+ * Test for template compilation and rendering
+ */
+int main(void) {
+    printf("Running template tests\n");
+
+    host_t web01;
+    host_t web02;
+    memset(&web01, 0, sizeof(web01));
+    memset(&web02, 0, sizeof(web02));
+    web01.name = "web01";
+    web02.name = "web02";
+
+    play_t play;
+    memset(&play, 0, sizeof(play));
+
+    context_t *first = context_create(&web01, &play, 0);
+    context_t *second = context_create(&web02, &play, 0);
+    assert(first != NULL && second != NULL);
+
+    // Test 1: Compilation into segments
+    {
+        printf("Test 1: Compiling templates... ");
+        template_t *template = template_compile("echo {{ greeting }}, {{name}}!");
+        assert(template != NULL);
+        assert(template->segment_count == 5);
+        assert(template->segments[0].expr == NULL && template->segments[0].length == 5);
+        assert(template->segments[1].expr->type == TEMPLATE_EXPR_VAR);
+        assert(template->segments[1].expr->key == symbol_find("greeting"));
+        assert(template->segments[3].expr->key == symbol_find("name"));
+        assert(template->segments[4].length == 1);
+        assert(template_is_dynamic(template));
+        template_free(template);
+
+        template = template_compile("uptime");
+        assert(template != NULL && template->segment_count == 1 && !template_is_dynamic(template));
+        template_free(template);
+
+        template = template_compile("{{ '}}' }} {{ 42 }}");
+        assert(template != NULL && template->segment_count == 3);
+        assert(strcmp(template->segments[0].expr->text, "}}") == 0);
+        assert(strcmp(template->segments[2].expr->text, "42") == 0);
+        template_free(template);
+
+        assert(template_compile("echo {{ greeting") == NULL);
+        assert(template_compile("echo {{ }}") == NULL);
+        assert(template_compile("echo {{ a b }}") == NULL);
+        assert(template_compile("echo {{ 'open }}") == NULL);
+        printf("OK\n");
+    }
+
+    // Test 2: Rendering for several hosts
+    {
+        printf("Test 2: Rendering per host... ");
+        template_t *template = template_compile("kernel_{{ ansible_kernel }} on {{ inventory_hostname }}");
+        assert(template != NULL);
+        context_set_var(first, "ansible_kernel", "6.1");
+        context_set_var(second, "ansible_kernel", "5.15");
+
+        template_buffer_t buffer = { 0 };
+        assert(strcmp(template_render(template, first, &buffer), "kernel_6.1 on web01") == 0);
+        size_t capacity = buffer.capacity;
+        char *data = buffer.data;
+        assert(strcmp(template_render(template, second, &buffer), "kernel_5.15 on web02") == 0);
+
+        // The buffer is reused from one host to the next
+        assert(buffer.capacity == capacity && buffer.data == data);
+        template_free(template);
+
+        // A template without expressions or with a lone expression is not copied
+        template = template_compile("uptime");
+        assert(template_render(template, first, &buffer) == template->source);
+        template_free(template);
+        template = template_compile("{{ ansible_kernel }}");
+        assert(template_render(template, first, &buffer) == context_get_var(first, "ansible_kernel"));
+        template_free(template);
+
+        template_buffer_free(&buffer);
+        printf("OK\n");
+    }
+
+    // Test 3: Undefined variables
+    {
+        printf("Test 3: Undefined variables... ");
+        template_t *template = template_compile("echo {{ missing }}");
+        template_buffer_t buffer = { 0 };
+        assert(template_render(template, first, &buffer) == NULL);
+        assert(strcmp(buffer.data, "Undefined variable 'missing'") == 0);
+
+        // The same template renders once the variable is set
+        context_set_var(first, "missing", "found");
+        assert(strcmp(template_render(template, first, &buffer), "echo found") == 0);
+        template_free(template);
+        template_buffer_free(&buffer);
+        printf("OK\n");
+    }
+
+    // Test 4: Filters
+    {
+        printf("Test 4: Filters... ");
+        context_set_var(first, "version", "v1.2.3");
+        context_set_var(first, "packages", "[nginx, 'curl', git]");
+        context_set_var(first, "path", "/usr/local/bin");
+        context_set_var(first, "empty", "");
+        context_set_var(first, "count", "12abc");
+        context_set_var(first, "settings", "{port: 80, name: 'web 1', tls: true}");
+
+        static const struct {
+            const char *source;
+            const char *expected;
+        } cases[] = {
+            { "{{ nobody | default('none') }}", "none" },
+            { "{{ empty | default('none') }}", "" },
+            { "{{ empty | default('none', true) }}", "none" },
+            { "{{ inventory_hostname | upper }}-{{ 'ABC' | lower }}", "WEB01-abc" },
+            { "{{ path | replace('/', ':') }}", ":usr:local:bin" },
+            { "{{ version | regex_replace('^v(\\d+)\\.(\\d+).*$', '\\\\2.\\\\1') }}", "2.1" },
+            { "{{ version | regex_replace('[.]') }}", "v123" },
+            { "{{ packages | join(',') }}", "nginx,curl,git" },
+            { "{{ path | split('/') }}", "['', 'usr', 'local', 'bin']" },
+            { "{{ 'a  b c ' | split | join('-') }}", "a-b-c" },
+            { "{{ count | int }} {{ 'x' | int(7) }} {{ '-3' | int }}", "0 7 -3" },
+            { "{{ packages | length }} {{ 'héllo' | length }}", "3 5" },
+            { "{{ 'user:pass' | b64encode }} {{ 'ab' | b64encode }}", "dXNlcjpwYXNz YWI=" },
+            { "{{ packages | to_json }} {{ 'say \"hi\"' | to_json }}", "[\"nginx\", \"curl\", \"git\"] \"say \\\"hi\\\"\"" },
+            { "{{ 42 | to_json }} {{ true | to_json }}", "42 true" },
+            { "{{ settings | to_json }} {{ '{x' | to_json }}", "{\"port\": 80, \"name\": \"web 1\", \"tls\": true} \"{x\"" },
+            { "{{ '[1, x, false]' | to_json }}", "[1, \"x\", false]" },
+            { "{{ nobody | default(path) | split('/') | length }}", "4" }
+        };
+
+        template_buffer_t buffer = { 0 };
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+            template_t *template = template_compile(cases[i].source);
+            assert(template != NULL);
+            const char *rendered = template_render(template, first, &buffer);
+            assert(rendered != NULL && strcmp(rendered, cases[i].expected) == 0);
+            template_free(template);
+        }
+
+        // Filters on an undefined variable fail like a bare reference
+        template_t *template = template_compile("{{ nobody | upper }}");
+        assert(template_render(template, first, &buffer) == NULL);
+        assert(strcmp(buffer.data, "Undefined variable 'nobody'") == 0);
+        template_free(template);
+
+        template_buffer_free(&buffer);
+        printf("OK\n");
+    }
+
+    // Test 5: Filters are compiled with the template
+    {
+        printf("Test 5: Compiling filters... ");
+        template_t *template = template_compile("{{ version | regex_replace('\\d', 'N') | upper }}");
+        assert(template != NULL && template->segment_count == 1);
+        const template_expr_t *upper = template->segments[0].expr;
+        assert(upper->type == TEMPLATE_EXPR_FILTER && upper->filter == TEMPLATE_FILTER_UPPER);
+        assert(upper->input->filter == TEMPLATE_FILTER_REGEX_REPLACE && upper->input->regex != NULL);
+        assert(upper->input->input->key == symbol_find("version"));
+
+        // The same compiled regex serves every host
+        context_set_var(second, "version", "v2.0");
+        template_buffer_t buffer = { 0 };
+        assert(strcmp(template_render(template, first, &buffer), "VN.N.N") == 0);
+        assert(strcmp(template_render(template, second, &buffer), "VN.N") == 0);
+        template_free(template);
+        template_buffer_free(&buffer);
+
+        assert(template_compile("{{ version | shout }}") == NULL);
+        assert(template_compile("{{ version | replace('a') }}") == NULL);
+        assert(template_compile("{{ version | upper('a') }}") == NULL);
+        assert(template_compile("{{ version | regex_replace(pattern) }}") == NULL);
+        assert(template_compile("{{ version | regex_replace('(') }}") == NULL);
+        assert(template_compile("{{ version | }}") == NULL);
+        printf("OK\n");
+    }
+
+    // Test 6: Registered results shadow play variables
+    {
+        printf("Test 6: Registered names... ");
+        variable_t status = { "status", "pending", NULL, NULL };
+        play_t vars_play;
+        memset(&vars_play, 0, sizeof(vars_play));
+        vars_play.vars = &status;
+        context_t *context = context_create(&web01, &vars_play, 0);
+        assert(context != NULL);
+
+        template_t *bare = template_compile("{{ status }}");
+        template_t *template = template_compile("{{ status }}/{{ status.rc }}");
+        assert(bare != NULL && template != NULL);
+        template_buffer_t buffer = { 0 };
+        assert(strcmp(template_render(bare, context, &buffer), "pending") == 0);
+
+        registered_t result;
+        memset(&result, 0, sizeof(result));
+        strcpy(result.rc, "0");
+        result.stdout_data = strdup("ready");
+        result.line_count = -1;
+        assert(context_register(context, symbol_intern("status"), &result) == ANCIBLE_SUCCESS);
+        assert(strcmp(template_render(bare, context, &buffer), "ready") == 0);
+        assert(strcmp(template_render(template, context, &buffer), "ready/0") == 0);
+
+        template_free(bare);
+        template_free(template);
+        template_buffer_free(&buffer);
+        context_free(context);
+        printf("OK\n");
+    }
+
+    context_free(first);
+    context_free(second);
+    symbol_cleanup();
+
+    printf("All template tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../include/ancible.h"
+#include "../include/transport/connection.h"
+
+#define CONTROL_PERSIST "ControlPersist=60"
+
+/**
+ * Structure to hold a cached connection
+ */
+typedef struct connection {
+    char *user;               // Remote user
+    char *host;               // Remote host
+    char port[8];             // Remote port ("" for ssh's default)
+    pid_t pid;                // Pid of the process that opened the master (0 once reaped)
+    struct connection *next;  // Next connection in the list
+} connection_t;
+
+// Cached connections and the directory holding their control sockets
+static connection_t *connections = NULL;
+static char control_dir[64] = "";
+
+/**
+ * Spawn ssh with the given arguments, discarding its output
+ *
+ * @param argv NULL-terminated argument vector (argv[0] is "ssh")
+ * @return Pid of the child, or -1 on error
+ */
+static pid_t spawn_ssh(char *const argv[]) {
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+        execvp("ssh", argv);
+        _exit(EXIT_FAILURE);
+    }
+
+    return pid;
+}
+
+/**
+ * Insert "-p port" before the target of an ssh argument vector
+ *
+ * The master's control socket is named after the port too (%C), so every
+ * command for the connection must name the same port.
+ *
+ * @param argv Argument vector, with two NULL slots to spare at its end
+ * @param target Index of the target (user@host)
+ * @param port Remote port ("" for ssh's default)
+ */
+static void connection_port_args(char **argv, int target, char *port) {
+    if (!port[0]) {
+        return;
+    }
+
+    int end = target;
+    while (argv[end]) {
+        end++;
+    }
+    memmove(&argv[target + 2], &argv[target], (size_t)(end - target + 1) * sizeof(char *));
+    argv[target] = "-p";
+    argv[target + 1] = port;
+}
+
+/**
+ * Initialize the SSH connection cache
+ *
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int connection_cache_init(void) {
+    if (control_dir[0]) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    char template[] = "/tmp/ancible-XXXXXX";
+    if (!mkdtemp(template)) {
+        fprintf(stderr, "Error: Failed to create control socket directory: %s\n", strerror(errno));
+        return ANCIBLE_ERROR;
+    }
+
+    snprintf(control_dir, sizeof(control_dir), "%s", template);
+    return ANCIBLE_SUCCESS;
+}
+
+/**
+ * Check the port of a host (ansible_port)
+ *
+ * @param port Port as text
+ * @return 1 if it is a number from 1 to 65535, 0 otherwise
+ */
+int connection_port_valid(const char *port) {
+    size_t length = strspn(port, "0123456789");
+    return length > 0 && length < 6 && port[length] == '\0' && atoi(port) >= 1 && atoi(port) <= 65535;
+}
+
+/**
+ * Start opening a connection in the background
+ *
+ * @param user Remote user
+ * @param host Remote host
+ * @param port Remote port, or NULL for ssh's default
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int connection_prefetch(const char *user, const char *host, const char *port) {
+    if (!user || !host || (port && !connection_port_valid(port))) {
+        return ANCIBLE_ERROR;
+    }
+
+    if (!control_dir[0]) {
+        return ANCIBLE_SUCCESS;
+    }
+
+    // Only one master per user@host:port, no matter how many plays target it
+    port = port ? port : "";
+    for (connection_t *conn = connections; conn; conn = conn->next) {
+        if (strcmp(conn->user, user) == 0 && strcmp(conn->host, host) == 0 && strcmp(conn->port, port) == 0) {
+            return ANCIBLE_SUCCESS;
+        }
+    }
+
+    connection_t *conn = calloc(1, sizeof(connection_t));
+    if (!conn) {
+        fprintf(stderr, "Error: Failed to allocate memory for connection\n");
+        return ANCIBLE_ERROR;
+    }
+
+    conn->user = strdup(user);
+    conn->host = strdup(host);
+    if (!conn->user || !conn->host) {
+        fprintf(stderr, "Error: Failed to allocate memory for connection\n");
+        free(conn->user);
+        free(conn->host);
+        free(conn);
+        return ANCIBLE_ERROR;
+    }
+    snprintf(conn->port, sizeof(conn->port), "%s", port);
+
+    char target[512];
+    char control_path[128];
+    snprintf(target, sizeof(target), "%s@%s", user, host);
+    snprintf(control_path, sizeof(control_path), "ControlPath=%s/%%C", control_dir);
+
+    // Running "true" through an auto master leaves the master persisting behind it
+    char *argv[] = {
+        "ssh", "-o", "BatchMode=yes", "-o", "StrictHostKeyChecking=no",
+        "-o", "ControlMaster=auto", "-o", CONTROL_PERSIST, "-o", control_path,
+        target, "true", NULL, NULL, NULL
+    };
+    connection_port_args(argv, 11, conn->port);
+    conn->pid = spawn_ssh(argv);
+
+    conn->next = connections;
+    connections = conn;
+
+    return conn->pid > 0 ? ANCIBLE_SUCCESS : ANCIBLE_ERROR;
+}
+
+/**
+ * Get the directory holding the control sockets
+ *
+ * @return Directory path, or NULL if the cache is not initialized
+ */
+const char *connection_control_dir(void) {
+    return control_dir[0] ? control_dir : NULL;
+}
+
+/**
+ * Close all cached connections and remove the control directory
+ */
+void connection_cache_cleanup(void) {
+    char control_path[128];
+    snprintf(control_path, sizeof(control_path), "ControlPath=%s/%%C", control_dir);
+
+    connection_t *conn = connections;
+    while (conn) {
+        connection_t *next = conn->next;
+
+        if (conn->pid > 0) {
+            waitpid(conn->pid, NULL, 0);
+        }
+
+        // Ask the persisting master to exit
+        char target[512];
+        snprintf(target, sizeof(target), "%s@%s", conn->user, conn->host);
+        char *argv[] = {"ssh", "-o", control_path, "-O", "exit", target, NULL, NULL, NULL};
+        connection_port_args(argv, 5, conn->port);
+        pid_t pid = spawn_ssh(argv);
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+
+        free(conn->user);
+        free(conn->host);
+        free(conn);
+        conn = next;
+    }
+    connections = NULL;
+
+    if (control_dir[0]) {
+        rmdir(control_dir);
+        control_dir[0] = '\0';
+    }
+}
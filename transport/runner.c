@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include "../include/ancible.h"
@@ -9,10 +11,27 @@
 #include "../include/transport/ssh.h"
 
 #define BUFFER_SIZE 4096
+#define BATCH_FRAME "@@ANCIBLE-ITEM "
+
+// Commands may be started from several threads (parallel loop items)
+static pthread_mutex_t spawn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_freed = PTHREAD_COND_INITIALIZER;
+static int fork_limit = 0;      // Maximum number of commands running at once (0 = unlimited)
+static int forks_running = 0;   // Number of commands currently running
+
+// Runs one batched command with its output captured, then prints its frame
+#define BATCH_PROLOGUE \
+    "d=$(mktemp -d) || exit 1\n" \
+    "trap 'rm -rf \"$d\"' EXIT\n" \
+    "a() { sh -c \"$2\" </dev/null >\"$d/o\" 2>\"$d/e\"; r=$?; " \
+    "printf '" BATCH_FRAME "%s %s %s %s\\n' \"$1\" \"$r\" $(wc -c <\"$d/o\") $(wc -c <\"$d/e\"); " \
+    "cat \"$d/o\" \"$d/e\"; }\n"
 
 /**
  * Read all data from a file descriptor into a dynamically allocated string
  * 
+ * The descriptor is closed before returning, even on error.
+ * 
  * @param fd File descriptor to read from
  * @return Dynamically allocated string, or NULL on error
  */
@@ -26,6 +45,7 @@ static char *read_all(int fd) {
     FILE *stream = fdopen(fd, "r");
     if (!stream) {
         perror("fdopen");
+        close(fd);
         return NULL;
     }
     
@@ -64,9 +84,64 @@ static char *read_all(int fd) {
     return result;
 }
 
+/**
+ * Set the maximum number of commands running at once
+ * 
+ * @param limit Maximum number of concurrent commands (0 for no limit)
+ */
+void runner_set_fork_limit(int limit) {
+    pthread_mutex_lock(&spawn_lock);
+    fork_limit = limit > 0 ? limit : 0;
+    pthread_cond_broadcast(&slot_freed);
+    pthread_mutex_unlock(&spawn_lock);
+}
+
+/**
+ * Wait for a free fork slot and take it
+ */
+static void fork_slot_acquire(void) {
+    pthread_mutex_lock(&spawn_lock);
+    while (fork_limit > 0 && forks_running >= fork_limit) {
+        pthread_cond_wait(&slot_freed, &spawn_lock);
+    }
+    forks_running++;
+    pthread_mutex_unlock(&spawn_lock);
+}
+
+/**
+ * Give a fork slot back
+ */
+static void fork_slot_release(void) {
+    pthread_mutex_lock(&spawn_lock);
+    forks_running--;
+    pthread_cond_signal(&slot_freed);
+    pthread_mutex_unlock(&spawn_lock);
+}
+
+/**
+ * Create a pipe whose ends are closed in executed children
+ * 
+ * Without close-on-exec, a command started by another thread would inherit
+ * the write end and keep this pipe open until it exits.
+ * 
+ * @return 0 on success, -1 on error
+ */
+static int pipe_cloexec(int fds[2]) {
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+static int spawn_and_wait(const char *cmd, command_result_t *result);
+
 /**
  * Run a command locally
  * 
+ * Waits for a free slot when the fork limit is reached.
+ * 
  * @param cmd Command to run
  * @param result Pointer to result structure to fill
  * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
@@ -76,20 +151,39 @@ int run_local(const char *cmd, command_result_t *result) {
         return ANCIBLE_ERROR;
     }
     
+    fork_slot_acquire();
+    int ret = spawn_and_wait(cmd, result);
+    fork_slot_release();
+    
+    return ret;
+}
+
+/**
+ * Run a command through /bin/sh and collect its output
+ * 
+ * @param cmd Command to run
+ * @param result Pointer to result structure to fill
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+static int spawn_and_wait(const char *cmd, command_result_t *result) {
     // Initialize result
     memset(result, 0, sizeof(command_result_t));
     
-    // Create pipes for stdout and stderr
+    // Create pipes for stdout and stderr (no fork may happen in between)
     int stdout_pipe[2];
     int stderr_pipe[2];
     
-    if (pipe(stdout_pipe) == -1) {
+    pthread_mutex_lock(&spawn_lock);
+    
+    if (pipe_cloexec(stdout_pipe) == -1) {
         perror("pipe");
+        pthread_mutex_unlock(&spawn_lock);
         return ANCIBLE_ERROR;
     }
     
-    if (pipe(stderr_pipe) == -1) {
+    if (pipe_cloexec(stderr_pipe) == -1) {
         perror("pipe");
+        pthread_mutex_unlock(&spawn_lock);
         close(stdout_pipe[0]);
         close(stdout_pipe[1]);
         return ANCIBLE_ERROR;
@@ -98,6 +192,10 @@ int run_local(const char *cmd, command_result_t *result) {
     // Fork a child process
     pid_t pid = fork();
     
+    if (pid != 0) {
+        pthread_mutex_unlock(&spawn_lock);
+    }
+    
     if (pid == -1) {
         // Fork failed
         perror("fork");
@@ -141,14 +239,11 @@ int run_local(const char *cmd, command_result_t *result) {
         close(stdout_pipe[1]);
         close(stderr_pipe[1]);
         
-        // Read stdout and stderr
+        // Read stdout and stderr; closing the streams closes the read ends of the pipes, and
+        // closing them again could close a descriptor another thread has opened since
         result->stdout_data = read_all(stdout_pipe[0]);
         result->stderr_data = read_all(stderr_pipe[0]);
         
-        // Close read ends of pipes
-        close(stdout_pipe[0]);
-        close(stderr_pipe[0]);
-        
         // Wait for child process to finish
         int status;
         waitpid(pid, &status, 0);
@@ -195,7 +290,7 @@ int run_command(context_t *context, const char *cmd, command_result_t *result) {
     }
     
     // Check connection type
-    const char *connection = context_get_var(context, "ansible_connection");
+    const char *connection = context_get_var_id(context, SYMBOL_ANSIBLE_CONNECTION);
     if (!connection) {
         connection = "ssh";  // Default connection type
     }
@@ -213,6 +308,161 @@ int run_command(context_t *context, const char *cmd, command_result_t *result) {
     }
 }
 
+/**
+ * Quote a string for use as a single shell word
+ * 
+ * @param str String to quote
+ * @return Newly allocated quoted string, or NULL on error
+ */
+char *shell_quote(const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    
+    // Every single quote becomes '\'' (4 bytes)
+    size_t len = 3;
+    for (const char *p = str; *p; p++) {
+        len += *p == '\'' ? 4 : 1;
+    }
+    
+    char *quoted = malloc(len);
+    if (!quoted) {
+        return NULL;
+    }
+    
+    char *out = quoted;
+    *out++ = '\'';
+    for (const char *p = str; *p; p++) {
+        if (*p == '\'') {
+            memcpy(out, "'\\''", 4);
+            out += 4;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out++ = '\'';
+    *out = '\0';
+    
+    return quoted;
+}
+
+/**
+ * Copy a slice of batch output into a new string
+ */
+static char *batch_slice(const char *start, size_t len) {
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, start, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * Run several commands on a host in one round trip
+ * 
+ * @param context Execution context with host information
+ * @param cmds Commands to run
+ * @param count Number of commands
+ * @param results Array of count results to fill, in command order
+ * @return ANCIBLE_SUCCESS on success, ANCIBLE_ERROR on error
+ */
+int run_command_batch(context_t *context, const char **cmds, int count, command_result_t *results) {
+    if (!context || !cmds || !results || count < 0) {
+        return ANCIBLE_ERROR;
+    }
+    
+    memset(results, 0, (size_t)count * sizeof(command_result_t));
+    for (int i = 0; i < count; i++) {
+        results[i].exit_code = -1;
+    }
+    
+    if (count == 0) {
+        return ANCIBLE_SUCCESS;
+    }
+    
+    // Build the script: the prologue, then one "a <index> '<command>'" line per item
+    size_t len = strlen(BATCH_PROLOGUE) + 1;
+    char **quoted = calloc((size_t)count, sizeof(char *));
+    if (!quoted) {
+        fprintf(stderr, "Error: Failed to allocate memory for batch script\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    int ret = ANCIBLE_ERROR;
+    char *script = NULL;
+    command_result_t raw;
+    memset(&raw, 0, sizeof(raw));
+    
+    for (int i = 0; i < count; i++) {
+        quoted[i] = shell_quote(cmds[i]);
+        if (!quoted[i]) {
+            fprintf(stderr, "Error: Failed to allocate memory for batch script\n");
+            goto cleanup;
+        }
+        len += strlen(quoted[i]) + 16;
+    }
+    
+    script = malloc(len);
+    if (!script) {
+        fprintf(stderr, "Error: Failed to allocate memory for batch script\n");
+        goto cleanup;
+    }
+    
+    char *out = script;
+    out += sprintf(out, "%s", BATCH_PROLOGUE);
+    for (int i = 0; i < count; i++) {
+        out += sprintf(out, "a %d %s\n", i, quoted[i]);
+    }
+    
+    if (run_command(context, script, &raw) != ANCIBLE_SUCCESS) {
+        goto cleanup;
+    }
+    
+    // Split the framed output; lengths are exact, so payloads may contain anything
+    const char *p = raw.stdout_data ? raw.stdout_data : "";
+    const char *end = p + strlen(p);
+    while ((size_t)(end - p) > strlen(BATCH_FRAME) && strncmp(p, BATCH_FRAME, strlen(BATCH_FRAME)) == 0) {
+        int idx;
+        int rc;
+        unsigned long out_len;
+        unsigned long err_len;
+        const char *newline = strchr(p, '\n');
+        
+        if (!newline || sscanf(p + strlen(BATCH_FRAME), "%d %d %lu %lu", &idx, &rc, &out_len, &err_len) != 4 ||
+            idx < 0 || idx >= count || out_len + err_len > (size_t)(end - newline - 1)) {
+            break;
+        }
+        
+        p = newline + 1;
+        command_result_free(&results[idx]);
+        results[idx].exit_code = rc;
+        results[idx].stdout_data = batch_slice(p, out_len);
+        results[idx].stderr_data = batch_slice(p + out_len, err_len);
+        p += out_len + err_len;
+    }
+    
+    // Items that never reported (script killed, connection lost)
+    for (int i = 0; i < count; i++) {
+        if (!results[i].stdout_data) {
+            results[i].stdout_data = strdup("");
+            results[i].stderr_data = strdup(raw.stderr_data && raw.stderr_data[0] ? raw.stderr_data : "No result received from batch\n");
+        }
+    }
+    
+    ret = ANCIBLE_SUCCESS;
+    
+cleanup:
+    for (int i = 0; i < count; i++) {
+        free(quoted[i]);
+    }
+    free(quoted);
+    free(script);
+    command_result_free(&raw);
+    
+    return ret;
+}
+
 /**
  * Print command result (for debugging)
  * 
@@ -7,6 +7,7 @@
 #include "../include/ancible.h"
 #include "../include/transport/ssh.h"
 #include "../include/transport/runner.h"
+#include "../include/transport/connection.h"
 
 /**
  * Run a command remotely via SSH
@@ -22,21 +23,55 @@ int run_ssh(context_t *context, const char *cmd, command_result_t *result) {
     }
     
     // Get host and user from context
-    const char *host = context_get_var(context, "ansible_host");
+    const char *host = context_get_var_id(context, SYMBOL_ANSIBLE_HOST);
     if (!host) {
         host = context->host->name;
     }
     
-    const char *user = context_get_var(context, "ansible_user");
+    const char *user = context_get_var_id(context, SYMBOL_ANSIBLE_USER);
     if (!user) {
-        user = "root";  // Default user
+        user = CONNECTION_DEFAULT_USER;
     }
     
-    // Build SSH command
-    char ssh_cmd[4096];
-    snprintf(ssh_cmd, sizeof(ssh_cmd), "ssh -o BatchMode=yes -o StrictHostKeyChecking=no %s@%s '%s'", 
-             user, host, cmd);
+    // The port goes into a shell command, so it must be a plain number
+    const char *port = context_get_var_id(context, SYMBOL_ANSIBLE_PORT);
+    if (port && !connection_port_valid(port)) {
+        fprintf(stderr, "Error: Invalid ansible_port '%s' for host %s\n", port, context->host->name);
+        return ANCIBLE_ERROR;
+    }
+    char port_opts[16] = "";
+    if (port) {
+        snprintf(port_opts, sizeof(port_opts), "-p %s ", port);
+    }
+    
+    // Multiplex over the cached master connection when available
+    char control_opts[256] = "";
+    const char *control_dir = connection_control_dir();
+    if (control_dir) {
+        snprintf(control_opts, sizeof(control_opts),
+                 "-o ControlMaster=auto -o ControlPersist=60 -o ControlPath=%s/%%C ", control_dir);
+    }
+    
+    // Build SSH command (the remote command may be a whole batch script)
+    char *quoted = shell_quote(cmd);
+    if (!quoted) {
+        fprintf(stderr, "Error: Failed to allocate memory for SSH command\n");
+        return ANCIBLE_ERROR;
+    }
+    
+    size_t len = strlen(control_opts) + strlen(port_opts) + strlen(user) + strlen(host) + strlen(quoted) + 64;
+    char *ssh_cmd = malloc(len);
+    if (!ssh_cmd) {
+        fprintf(stderr, "Error: Failed to allocate memory for SSH command\n");
+        free(quoted);
+        return ANCIBLE_ERROR;
+    }
+    snprintf(ssh_cmd, len, "ssh -o BatchMode=yes -o StrictHostKeyChecking=no %s%s%s@%s %s", 
+             control_opts, port_opts, user, host, quoted);
+    free(quoted);
     
     // Use run_local to execute the SSH command
-    return run_local(ssh_cmd, result);
+    int ret = run_local(ssh_cmd, result);
+    free(ssh_cmd);
+    return ret;
 }